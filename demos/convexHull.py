@@ -7,9 +7,10 @@ minpt, = pgf.vec3(minCoord, minCoord, minCoord)
 maxpt, = pgf.vec3(maxCoord, maxCoord, maxCoord)
 box, = pgf.box3(minpt, maxpt)
 npts, = pgv.slideri32("Point count", 10, 1000, 100)
+mode, = pgv.slideri32("Mode", 0, 2, 0)
 
 cloud, = pgf.randomPointCloudFromBox(box, npts)
-hull, = pgf.pointCloudConvexHull(cloud)
+hull, = pgf.pointCloudConvexHull(cloud, mode)
 
 pgv.show("Convex Hull", hull)
 pgv.show("Points", cloud)
@@ -0,0 +1,15 @@
+import pygalfunc as pgf
+import pygalview as pgv
+
+relpath, = pgv.textField("relpath")
+path, = pgf.absPath(relpath)
+mesh, = pgf.loadObjFile(path)
+scale, = pgf.numberf32(10.0)
+meshA, = pgf.scaleMesh(mesh, scale)
+scale2, = pgf.numberf32(8.0)
+meshB, = pgf.scaleMesh(mesh, scale2)
+
+operation, = pgv.slideri32("Operation", 0, 2, 0)
+result, = pgf.meshBoolean(meshA, meshB, operation)
+
+pgv.show("Result", result)
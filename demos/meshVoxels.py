@@ -0,0 +1,14 @@
+import pygalfunc as pgf
+import pygalview as pgv
+
+relpath, = pgv.textField("relpath")
+path, = pgf.absPath(relpath)
+mesh, = pgf.loadObjFile(path)
+scale, = pgf.numberf32(10.0)
+scaled, = pgf.scaleMesh(mesh, scale)
+
+voxelSize, = pgv.sliderf32("Voxel size", 0.05, 1., 0.2)
+mode, = pgv.slideri32("Mode", 0, 1, 0)
+voxels, = pgf.meshVoxels(scaled, voxelSize, mode)
+
+pgv.show("Voxels", voxels)
@@ -0,0 +1,16 @@
+import pygalfunc as pgf
+import pygalview as pgv
+
+minCoord, = pgf.numberf32(-1.)
+maxCoord, = pgf.numberf32(1.)
+minpt, = pgf.vec3(minCoord, minCoord, minCoord)
+maxpt, = pgf.vec3(maxCoord, maxCoord, maxCoord)
+box, = pgf.box3(minpt, maxpt)
+npts, = pgv.slideri32("Point count", 5, 500, 25)
+mode, = pgv.slideri32("Mode", 0, 1, 1)
+
+cloud, = pgf.randomPointCloudFromBox(box, npts)
+obb, *_ = pgf.pointCloudOrientedBox(cloud, mode)
+
+pgv.show("cloud", cloud)
+pgv.show("box", obb)
@@ -37,6 +37,11 @@ struct Box3
   glm::vec3 center() const;
   float     volume() const;
   bool      valid() const;
+  /*Squared distance between the closest points of the two boxes. It is zero when the
+   * boxes touch or overlap.*/
+  float sqDistance(const Box3&) const;
+  /*Bounding box of this box after it is transformed by the given affine matrix.*/
+  Box3 transformed(const glm::mat4& mat) const;
 
   glm::vec3 eval(float u, float v, float w) const;
 
@@ -21,6 +21,7 @@ public:
                                      const glm::vec2& b,
                                      const glm::vec2& c);
   static Circle2d createFromDiameter(const glm::vec2& a, const glm::vec2& b);
+  static Circle2d minBoundingCircle(const glm::vec2* points, size_t nPoints);
   static Circle2d minBoundingCircle(const std::vector<glm::vec2>& points);
 
 private:
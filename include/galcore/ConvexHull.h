@@ -1,25 +1,34 @@
 #pragma once
 #include <galcore/Box.h>
+#include <galcore/Predicates.h>
 #include <galcore/Util.h>
+#include <cfloat>
 #include <numeric>
-#include <queue>
 #include <unordered_map>
-#include <unordered_set>
 
 #include <galcore/Mesh.h>
 
-static constexpr float PLANE_DIST_TOL = 1e-10;
-
 namespace gal {
 
+enum class eConvexHullMode
+{
+  sequential = 0,
+  filtered,  // Interior points are discarded in parallel before the sequential phase.
+  parallel   // Also computes the hulls of chunks of the cloud in parallel, and only keeps
+             // their vertices. Only pays off when most points are inside the hull.
+};
+
+/*QuickHull with conflict lists. Every point outside the current hull is assigned to
+ * exactly one face that can see it, so each step only looks at the points of the faces
+ * it removes. The faces live in a pool and know their neighbors, so finding the faces
+ * visible from a point and stitching in the new faces doesn't need any hash maps. Whether
+ * a face sees a point is decided exactly, with a floating point filter in front of
+ * orient3dExact, so coplanar points never produce an inconsistent horizon.*/
 class ConvexHull
 {
 public:
   struct Face
   {
-    static const Face unset;
-
-    size_t id;
     union
     {
       struct
@@ -28,62 +37,122 @@ public:
       };
       size_t indices[3];
     };
-
-    glm::vec3 normal;
+    /*The face across the edge from indices[i] to indices[(i + 1) % 3].*/
+    size_t adjacent[3];
+    /*The plane of the face, and a bound on the error of the distance from it that holds
+     * for any point of the cloud.*/
+    glm::dvec3 normal;
+    double     offset;
+    double     bound;
+    /*Conflict list, i.e. the outside points assigned to this face, and the farthest of
+     * them.*/
+    std::vector<size_t> outside;
+    size_t              farthest;
+    double              farthestDist;
+    size_t              visited;  // Stamp of the last search that found it visible.
+    bool                alive;
 
     Face();
-    Face(size_t i, size_t v1, size_t v2, size_t v3);
+    Face(size_t v1, size_t v2, size_t v3);
+  };
 
-    bool           isValid();
-    void           flip();
-    gal::IndexPair edge(char edgeIndex) const;
-    bool           containsVertex(size_t vertIndex) const;
+protected:
+  struct HorizonEdge
+  {
+    size_t p, q;      // The edge, as seen from the removed face.
+    size_t neighbor;  // The face across the edge that stays.
+  };
+
+  struct Frame
+  {
+    size_t  face;
+    uint8_t entry;  // Edge through which the search entered the face.
+    uint8_t step;
+    uint8_t end;
   };
 
-private:
   std::vector<glm::vec3> mPts;
-  glm::vec3              mCenter;
-
-  std::unordered_map<size_t, Face, gal::CustomSizeTHash, std::equal_to<size_t>> mFaces;
-  std::unordered_map<gal::IndexPair,
-                     gal::IndexPair,
-                     gal::IndexPairHash,
-                     std::equal_to<gal::IndexPair>>
-                                                                          mEdgeFaceMap;
-  std::unordered_set<size_t, gal::CustomSizeTHash, std::equal_to<size_t>> mOutsidePts;
-
-  void      compute();
-  void      initOutside();
-  void      setFace(Face& face);
-  Face      popFace(size_t index, gal::IndexPair edges[3], Face adjFaces[3]);
-  bool      faceVisible(const Face&, const glm::vec3&) const;
-  float     facePlaneDistance(const Face&, const glm::vec3&) const;
-  bool      getFarthestPt(const Face&, glm::vec3& pt, size_t& ptIndex) const;
-  void      updateExteriorPt(const std::vector<Face>& newFaces,
-                             const std::vector<Face>& poppedFaces);
-  void      createInitialSimplex(size_t& faceIndex);
-  bool      getFace(size_t id, Face& face) const;
-  bool      getEdgeFaces(const gal::IndexPair& edge, gal::IndexPair& faces) const;
-  glm::vec3 faceCenter(const Face& face) const;
+  std::vector<Face>      mFaces;  // Pool of faces, the dead ones are reused.
+  std::vector<size_t>    mFreeFaces;
+  size_t                 mExtremes[6];  // Points with the min and max x, y and z.
+  size_t                 mNumFaces = 0;
+  size_t                 mStamp    = 0;
+  double                 mMaxCoord = 0.;  // Largest absolute coordinate in the cloud.
+
+  // Scratch space reused by every step.
+  std::vector<size_t>      mFaceStack;
+  std::vector<Frame>       mFrames;
+  std::vector<HorizonEdge> mHorizon;
+  std::vector<size_t>      mVisible;
+  std::vector<size_t>      mNewFaces;
+  std::vector<size_t>      mOrphans;
+
+  ConvexHull() = default;
+
+  void   compute(eConvexHullMode mode);
+  void   expand();
+  void   createInitialSimplex();
+  size_t addFace(size_t a, size_t b, size_t c);
+  void   setPlane(Face& face) const;
+  void   removeFace(size_t fi);
+  int    side(const Face& face, const glm::vec3& pt, double& dist) const;
+  int    sideExact(const Face& face, const glm::vec3& pt) const;
+  size_t farthestFace(size_t pi, const size_t* faces, size_t nFaces, double& dist) const;
+  void   assign(size_t pi, const size_t* faces, size_t nFaces);
+  void   assign(size_t pi, size_t fi, double dist);
+  std::vector<size_t> filterInterior() const;
+  void keepSubHullVertices(const size_t* begin, const size_t* end, uint8_t* keep) const;
+  void   addPoint(size_t fi);
+  void   findHorizon(size_t fi, const glm::vec3& eye);
 
 public:
   template<typename vec3Iter>
-  ConvexHull(vec3Iter vbegin, vec3Iter vend)
+  ConvexHull(vec3Iter        vbegin,
+             vec3Iter        vend,
+             eConvexHullMode mode = eConvexHullMode::sequential)
       : mPts(vbegin, vend)
   {
-    initOutside();
-    compute();
+    compute(mode);
   };
 
-  ConvexHull(const std::vector<glm::vec3>& points);
+  ConvexHull(const std::vector<glm::vec3>& points,
+             eConvexHullMode mode = eConvexHullMode::sequential);
 
-  ConvexHull(std::vector<glm::vec3>&& points);
+  ConvexHull(std::vector<glm::vec3>&& points,
+             eConvexHullMode          mode = eConvexHullMode::sequential);
 
   glm::vec3 getPt(size_t index) const;
   size_t    numFaces() const;
   void      copyFaces(int* faceIndices) const;
+  /*Sorted indices of the points that are vertices of the hull.*/
+  std::vector<size_t> vertexIndices() const;
 
   Mesh toMesh() const;
 };
 
-}  // namespace gal
\ No newline at end of file
+/*Convex hull of points that arrive in batches. Each batch is first reduced to the
+ * vertices of its own hull, and only those are tested against the faces of the current
+ * hull. The points that end up inside are dropped right away, so only the vertices of the
+ * hull are kept in memory. Until the points span a volume, only the vertices of their
+ * hull within their line or plane are kept.*/
+class IncrementalConvexHull : public ConvexHull
+{
+  bool                        mInitialized = false;
+  std::shared_ptr<const Mesh> mMesh;
+
+  std::vector<glm::vec3> reduceBatch(const glm::vec3* points, size_t nPoints) const;
+  void                   reduceFlat();
+  void                   compact();
+
+public:
+  IncrementalConvexHull() = default;
+
+  void addPoints(const glm::vec3* points, size_t nPoints);
+  /*The hull of the points added so far, built once per batch. Null until the points span
+   * a volume.*/
+  std::shared_ptr<const Mesh> mesh() const noexcept;
+  /*Number of points kept in memory.*/
+  size_t numPoints() const noexcept;
+};
+
+}  // namespace gal
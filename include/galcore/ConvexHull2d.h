@@ -0,0 +1,29 @@
+#pragma once
+#include <galcore/Box.h>
+#include <vector>
+
+namespace gal {
+
+/*Convex hull of 2d points, with Andrew's monotone chain. The points can be added in
+ * chunks, and each chunk is merged into the hull so far. Before sorting, the points of a
+ * chunk are filtered in parallel against the polygon of the hull so far and the extreme
+ * points of the chunk, so usually only a small fraction of them is sorted.*/
+class ConvexHull2d
+{
+public:
+  ConvexHull2d() = default;
+  ConvexHull2d(const glm::vec2* points, size_t nPoints);
+
+  void addPoints(const glm::vec2* points, size_t nPoints);
+
+  /*Vertices of the hull in counter-clockwise order, without collinear vertices.*/
+  const std::vector<glm::vec2>& vertices() const noexcept;
+  size_t                        size() const noexcept;
+  /*Whether the point is inside the hull or on its boundary.*/
+  bool contains(const glm::vec2& pt) const;
+
+private:
+  std::vector<glm::vec2> mVertices;
+};
+
+}  // namespace gal
@@ -0,0 +1,92 @@
+#pragma once
+#include <galcore/Circle2d.h>
+#include <galcore/Predicates.h>
+#include <galcore/Util.h>
+#include <array>
+#include <vector>
+
+namespace gal {
+
+/*Constrained Delaunay triangulation of 2d points. The points are inserted with
+ * Bowyer-Watson in a biased randomized order along a Hilbert curve, like Delaunay3. Then
+ * each constraint edge that is missing is recovered by flipping the edges it crosses
+ * (Sloan), and the flipped edges are flipped back towards Delaunay where the constraints
+ * allow. The triangles live in a pool and know their neighbors, so every edge is a pair
+ * of half edges on two adjacent triangles. The constraint edges must not cross each
+ * other. A constraint edge that passes through a point is split there.*/
+class Delaunay2
+{
+public:
+  /*Index of the vertex at infinity.*/
+  static constexpr size_t sInfinite = SIZE_MAX - 1;
+
+  struct Tri
+  {
+    size_t  v[3];    // Counter-clockwise.
+    size_t  adj[3];  // The triangle across the edge opposite v[i].
+    size_t  stamp;   // Stamp of the last cavity search that tested it.
+    uint8_t constrained;  // Bit i is set if the edge opposite v[i] is a constraint.
+    bool    alive;
+  };
+
+private:
+  struct BoundaryEdge
+  {
+    size_t  v[2];      // The new point is on the left.
+    size_t  neighbor;  // The triangle outside the cavity.
+    uint8_t slot;      // Slot of the cavity triangle in the adjacency of the neighbor.
+  };
+
+  std::vector<glm::vec2> mPts;
+  std::vector<Tri>       mTris;  // Pool of triangles, the dead ones are reused.
+  std::vector<size_t>    mFreeTris;
+  std::vector<size_t>    mFinite;       // The finite triangles of the result.
+  std::vector<size_t>    mVertTri;      // A triangle around each vertex.
+  std::vector<size_t>    mDuplicateOf;  // The inserted point equal to each duplicate.
+  size_t                 mLast  = 0;
+  size_t                 mStamp = 0;
+  uint32_t               mRand  = 1;
+
+  // Scratch space reused by every insertion.
+  std::vector<size_t>       mStack;
+  std::vector<size_t>       mCavity;
+  std::vector<BoundaryEdge> mBoundary;
+  std::vector<size_t>       mNewTris;
+  std::vector<size_t>       mStartOf;  // New triangle starting at each boundary vertex.
+
+  void                  compute(const std::vector<IndexPair>& constraints);
+  std::array<size_t, 3> createInitialTri(const std::vector<size_t>& order);
+  size_t                addTri(size_t a, size_t b, size_t c);
+  void                  linkNewTris();
+  uint8_t               infiniteSlot(const Tri& tri) const;
+  glm::dvec2            point(size_t vi) const;
+  bool                  inConflict(size_t ti, const glm::dvec2& pt) const;
+  size_t                locate(const glm::dvec2& pt);
+  void                  insert(size_t pi);
+  bool   findEdge(size_t u, size_t v, size_t& ti, uint8_t& slot) const;
+  void   replaceNeighbor(size_t ti, size_t oldNeighbor, size_t newNeighbor);
+  void   flip(size_t ti, uint8_t slot);
+  void   setConstrained(size_t u, size_t v);
+  void   insertConstraint(size_t a, size_t b);
+  size_t crossedEdges(size_t a, size_t b, std::vector<IndexPair>& edges) const;
+  void   recoverConstraint(size_t a, size_t b, std::vector<IndexPair>& crossed);
+
+public:
+  Delaunay2(const std::vector<glm::vec2>& points,
+            const std::vector<IndexPair>& constraints = {});
+
+  glm::vec2 getPt(size_t index) const;
+  size_t    numPoints() const;
+  size_t    numTriangles() const;
+  /*Point indices of the ti-th finite triangle, counter-clockwise.*/
+  std::array<size_t, 3> triangle(size_t ti) const;
+  /*Whether the edge of the ti-th triangle opposite its i-th vertex is a constraint.*/
+  bool     isConstrained(size_t ti, uint8_t i) const;
+  void     copyTriangles(int* triIndices) const;
+  Circle2d circumcircle(size_t ti) const;
+  /*The triangles enclosed by the constraint edges, by the even-odd rule, i.e. the ones
+   * separated from the outside of the convex hull by an odd number of constraints.*/
+  std::vector<size_t> enclosedTriangles() const;
+};
+
+}  // namespace gal
@@ -0,0 +1,88 @@
+#pragma once
+#include <galcore/Predicates.h>
+#include <galcore/Sphere.h>
+#include <array>
+#include <vector>
+
+namespace gal {
+
+/*Delaunay tetrahedralization with Bowyer-Watson insertion. The points are inserted in a
+ * biased randomized order (BRIO): random rounds of growing size, each sorted along a
+ * Hilbert curve, so that locating each point from the last inserted tetrahedron takes
+ * only a few steps. The faces of the convex hull are connected to a vertex at infinity,
+ * so every tetrahedron has four neighbors and points outside the hull need no special
+ * case. The orientation and insphere tests are exact. The insertion is sequential, and
+ * only the ordering of large clouds runs in parallel.*/
+class Delaunay3
+{
+public:
+  /*Index of the vertex at infinity.*/
+  static constexpr size_t sInfinite = SIZE_MAX - 1;
+
+  struct Tet
+  {
+    size_t v[4];    // Positively oriented, see orient3d.
+    size_t adj[4];  // The tetrahedron across the face opposite v[i].
+    size_t stamp;   // Stamp of the last cavity search that tested it.
+    bool   alive;
+  };
+
+private:
+  struct BoundaryFace
+  {
+    size_t  v[3];      // Oriented so that the new point is on the positive side.
+    size_t  neighbor;  // The tetrahedron outside the cavity.
+    uint8_t slot;      // Slot of the cavity tetrahedron in the adjacency of the neighbor.
+  };
+
+  /*Entry of the hash table that matches the open faces of the new tetrahedra by the
+   * directed edges of their bases.*/
+  struct EdgeLink
+  {
+    size_t  p, q;
+    size_t  tet;
+    size_t  stamp;
+    uint8_t slot;
+  };
+
+  std::vector<glm::vec3>  mPts;
+  std::vector<Tet>        mTets;  // Pool of tetrahedra, the dead ones are reused.
+  std::vector<size_t>     mFreeTets;
+  std::vector<size_t>     mFinite;  // The finite tetrahedra of the result.
+  std::vector<glm::dvec3> mCoords;  // The points in insertion order, during the build.
+  size_t                  mLast  = 0;
+  size_t                  mStamp = 0;
+  uint32_t                mRand  = 1;
+
+  // Scratch space reused by every insertion.
+  std::vector<size_t>       mStack;
+  std::vector<size_t>       mCavity;
+  std::vector<BoundaryFace> mBoundary;
+  std::vector<size_t>       mNewTets;
+  std::vector<EdgeLink>     mLinks;
+
+  void                  compute();
+  std::array<size_t, 4> createInitialTet();
+  size_t                addTet(size_t a, size_t b, size_t c, size_t d);
+  void                  linkFaces();
+  uint8_t               infiniteSlot(const Tet& tet) const;
+  const glm::dvec3&     point(size_t vi) const;
+  int                   faceSide(const Tet& tet, uint8_t fi, const glm::dvec3& pt) const;
+  bool                  inConflict(size_t ti, const glm::dvec3& pt) const;
+  size_t                locate(const glm::dvec3& pt);
+  void                  insert(size_t pi);
+
+public:
+  Delaunay3(const std::vector<glm::vec3>& points);
+  Delaunay3(std::vector<glm::vec3>&& points);
+
+  glm::vec3 getPt(size_t index) const;
+  size_t    numPoints() const;
+  size_t    numTetrahedra() const;
+  /*Point indices of the ti-th finite tetrahedron, positively oriented.*/
+  std::array<size_t, 4> tetrahedron(size_t ti) const;
+  void                  copyTetrahedra(int* tetIndices) const;
+  Sphere                circumsphere(size_t ti) const;
+};
+
+}  // namespace gal
@@ -0,0 +1,50 @@
+#pragma once
+#include <galcore/SparseLDLT.h>
+#include <vector>
+
+namespace gal {
+
+class Mesh;
+
+enum class eGeodesicMethod
+{
+  heat = 0,
+  fastMarching
+};
+
+/*Geodesic distances on a mesh with the heat method (Crane, Weischedel and Wardetzky
+ * 2013). The heat flow and Poisson systems built from the cotan Laplacian are factorized
+ * once, after which every query costs two back-substitutions and a few passes over the
+ * faces. The factorization is only valid for the mesh it was built from.*/
+class HeatGeodesics
+{
+public:
+  explicit HeatGeodesics(const Mesh& mesh);
+
+  /*False if the mesh is degenerate and the systems could not be factorized.*/
+  bool valid() const;
+  /*Writes the distance from the nearest source to each vertex. Vertices that are not
+   * connected to any source get FLT_MAX.*/
+  void distances(const Mesh&   mesh,
+                 const size_t* sources,
+                 size_t        nSources,
+                 float*        dst) const;
+
+private:
+  bool                mValid = false;
+  SparseLDLT          mHeatFlow;
+  SparseLDLT          mPoisson;
+  std::vector<double> mCotans;      // Cotangents at the three corners of each face.
+  std::vector<size_t> mComponents;  // Connected component of each vertex.
+};
+
+/*Geodesic distances with the fast iterative method, which uses the same triangle update
+ * as fast marching but relaxes the whole active front in parallel until it converges,
+ * instead of one vertex at a time in the order of a heap. Vertices that are not
+ * connected to any source get FLT_MAX.*/
+void fastMarchingDistances(const Mesh&   mesh,
+                           const size_t* sources,
+                           size_t        nSources,
+                           float*        dst);
+
+}  // namespace gal
@@ -0,0 +1,91 @@
+#pragma once
+#include <galcore/Box.h>
+#include <stdint.h>
+#include <vector>
+
+namespace gal {
+
+/*Balanced k-d tree over 3d points with an implicit layout. Node i has the children 2i+1
+ * and 2i+2, and splits its range of points in the middle, so neither the ranges nor the
+ * links to the children are stored. All the leaves are at the same depth, and hold
+ * buckets of at most a few dozen points. The points are copied in the tree order so the
+ * points of a bucket are contiguous in memory.*/
+class KdTree3
+{
+public:
+  static constexpr size_t LeafSize = 16;
+
+  KdTree3() = default;
+  KdTree3(const glm::vec3* points, size_t nPoints);
+
+  size_t size() const noexcept;
+
+  /*Writes the indices of the k points nearest to pt and their distances, sorted by
+   * distance. Returns the number of points found, which is less than k only when the
+   * tree has fewer points.*/
+  size_t queryNearestN(const glm::vec3& pt,
+                       size_t           k,
+                       size_t*          indices,
+                       float*           distances) const;
+  /*Appends the indices of the points within the radius to the results.*/
+  void queryRadius(const glm::vec3& pt, float radius, std::vector<size_t>& results) const;
+
+  /*Nearest neighbors of many points in parallel. The results of the i-th point are
+   * written to [i * k, (i + 1) * k) of the outputs, and the slots left over when the tree
+   * has fewer than k points get SIZE_MAX and FLT_MAX.*/
+  void queryNearestNBatch(const glm::vec3* points,
+                          size_t           nPoints,
+                          size_t           k,
+                          size_t*          outIndices,
+                          float*           outDistances) const;
+  /*Radius search for many points in parallel. The results of the i-th point are
+   * indices[offsets[i], offsets[i + 1]).*/
+  void queryRadiusBatch(const glm::vec3*     points,
+                        size_t               nPoints,
+                        float                radius,
+                        std::vector<size_t>& offsets,
+                        std::vector<size_t>& indices) const;
+
+private:
+  struct Node
+  {
+    float   split;
+    uint8_t axis;
+  };
+
+  struct Entry
+  {
+    glm::vec3 pos;
+    size_t    index;
+  };
+
+  using Heap = std::vector<std::pair<float, size_t>>;
+
+  size_t                 mDepth = 0;  // Number of levels of internal nodes.
+  std::vector<Node>      mNodes;
+  std::vector<glm::vec3> mPoints;
+  std::vector<size_t>    mIndices;  // Original index of each point in the tree order.
+
+  void build(size_t node, size_t level, Entry* begin, Entry* end, const Box3& cell);
+  void nearestN(size_t           node,
+                size_t           level,
+                size_t           begin,
+                size_t           end,
+                const glm::vec3& pt,
+                size_t           k,
+                Heap&            heap) const;
+  void radius(size_t               node,
+              size_t               level,
+              size_t               begin,
+              size_t               end,
+              const glm::vec3&     pt,
+              float                sqRadius,
+              std::vector<size_t>& results) const;
+  size_t nearestN(const glm::vec3& pt,
+                  size_t           k,
+                  Heap&            heap,
+                  size_t*          indices,
+                  float*           distances) const;
+};
+
+}  // namespace gal
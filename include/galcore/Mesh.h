@@ -1,10 +1,13 @@
 #pragma once
 #include <galcore/Box.h>
+#include <galcore/Geodesics.h>
 #include <galcore/RTree.h>
 #include <galcore/Sphere.h>
 #include <galcore/Util.h>
+#include <galcore/VoxelGrid.h>
 #include <filesystem>
 #include <limits>
+#include <memory>
 #include <unordered_map>
 
 #include <galcore/Plane.h>
@@ -27,6 +30,18 @@ enum class eMeshElement
   face
 };
 
+enum class eMeshConnectivity
+{
+  edge = 0,  // Faces sharing an edge are connected.
+  vertex     // Faces sharing a vertex are connected.
+};
+
+enum class eMeshVoxelMode
+{
+  surface = 0,
+  solid
+};
+
 class Mesh
 {
 public:
@@ -92,25 +107,70 @@ private:
   RTree3d                mFaceTree;
   RTree3d                mVertexTree;
 
+  /*Lazily computed when first needed, and dropped when the geometry changes. Access
+   * through std::atomic_load / std::atomic_store because const queries can race to
+   * fill it.*/
+  mutable std::shared_ptr<const HeatGeodesics> mHeatGeodesics;
+
+  /*Scratch space of extractFaces and updateVertices, reused across calls. An entry of
+   * the index arrays is only valid if its stamp matches the current generation, so they
+   * never need to be cleared.*/
+  struct RemapScratch
+  {
+    std::vector<size_t> vertIndices, vertStamps;
+    std::vector<size_t> faceIndices, faceStamps;
+    size_t              generation = 0;
+  };
+  RemapScratch mRemap;
+
+  /*Used by the deserialization to reuse the saved trees. A tree that doesn't match the
+   * number of elements is rebuilt.*/
+  Mesh(std::vector<glm::vec3>&& verts,
+       std::vector<Face>&&      faces,
+       RTree3d&&                faceTree,
+       RTree3d&&                vertexTree);
+  /*Used by extractFaces to carry over the face tree and face normals of the parent.*/
+  Mesh(std::vector<glm::vec3>&& verts,
+       std::vector<Face>&&      faces,
+       RTree3d&&                faceTree,
+       std::vector<glm::vec3>&& faceNormals);
+
   void  computeCache();
   void  computeTopology();
   void  computeRTrees();
   void  computeNormals();
+  void  computeVertexNormals();
+  void  computeVertexNormal(size_t vi, std::vector<glm::vec3>& faceNormals);
   void  addEdge(const Face&, size_t fi, uint8_t, size_t&);
   void  addEdges(const Face&, size_t fi);
   float faceArea(const Face& f) const;
   void  getFaceCenter(const Face& f, glm::vec3& center) const;
   void  checkSolid();
 
-  glm::vec3      areaCentroid() const;
-  glm::vec3      volumeCentroid() const;
-  const RTree3d& elementTree(eMeshElement element) const;
+  glm::vec3 areaCentroid() const;
+  glm::vec3 volumeCentroid() const;
 
   void faceClosestPt(size_t           faceIndex,
                      const glm::vec3& pt,
                      glm::vec3&       closePt,
                      float&           bestSqDist) const;
 
+  void faceTriangle(size_t fi, glm::vec3 (&tri)[3]) const;
+  void faceTriangle(size_t fi, const glm::mat4& xform, glm::vec3 (&tri)[3]) const;
+  bool facesIntersect(size_t           fi,
+                      const Mesh&      other,
+                      size_t           ofi,
+                      const glm::mat4& otherXform) const;
+  /*Copy of the face tree with every box transformed.*/
+  RTree3d placedFaceTree(const glm::mat4& xform) const;
+
+  std::shared_ptr<const HeatGeodesics> heatGeodesics() const;
+
+  void voxelizeSurface(VoxelGrid& grid) const;
+  void voxelizeInterior(VoxelGrid& grid) const;
+
+  friend struct Serial<Mesh>;
+
 public:
   Mesh(const Mesh& other);
   Mesh(const glm::vec3* verts, size_t nVerts, const Face* faces, size_t nFaces);
@@ -144,11 +204,23 @@ public:
   glm::vec3 centroid() const;
   glm::vec3 centroid(const eMeshCentroidType centroid_type) const;
 
+  /*Whether the point is inside the closed mesh, using exact predicates. Points on the
+   * surface are inside.*/
   bool contains(const glm::vec3& pt) const;
 
-  void clipWithPlane(const Plane& plane);
+  /*Keeps the part of the mesh behind the plane. If cap is true, the section is closed
+   * with a constrained Delaunay triangulation of the cut contours, so a closed mesh stays
+   * closed.*/
+  void clipWithPlane(const Plane& plane, bool cap = false);
 
   void transform(const glm::mat4& mat);
+  /*Moves the vertices to the given positions, one per vertex. Only the faces around the
+   * vertices that moved are updated, and the trees are refit rather than rebuilt, so the
+   * cost is proportional to the region that moved. Meant for meshes that deform every
+   * frame.*/
+  void updateVertices(const glm::vec3* positions, size_t nPositions);
+
+  const RTree3d& elementTree(eMeshElement element) const;
 
   template<typename size_t_inserter>
   void queryBox(const gal::Box3& box,
@@ -158,6 +230,14 @@ public:
     elementTree(element).queryBoxIntersects(box, inserter);
   };
 
+  /*Box queries for many boxes in parallel. The elements that touch the i-th box are
+   * indices[offsets[i], offsets[i + 1]).*/
+  void queryBox(const gal::Box3*     boxes,
+                size_t               nBoxes,
+                std::vector<size_t>& offsets,
+                std::vector<size_t>& indices,
+                eMeshElement         element) const;
+
   template<typename size_t_inserter>
   void querySphere(const gal::Sphere& sphere,
                    size_t_inserter    inserter,
@@ -166,9 +246,74 @@ public:
     elementTree(element).queryByDistance(sphere.center, sphere.radius, inserter);
   };
 
+  /*Simultaneously traverses the face trees of this mesh and the other mesh placed with
+   * otherXform, and calls the callback with the indices of every pair of intersecting
+   * faces (this mesh's face first). The callback can return false to stop the search.
+   * Returns false if the search was stopped.
+   *
+   * By default the boxes of the other tree are transformed as the traversal reaches
+   * them, which costs nothing up front and is best when the search ends early or prunes
+   * most of the tree. With placeTree, the whole other tree is copied and transformed once
+   * before the search, which only pays off when most of it is visited anyway.*/
+  template<typename FacePairFn>
+  bool overlappingFaces(const Mesh&      other,
+                        const glm::mat4& otherXform,
+                        FacePairFn       callback,
+                        bool             placeTree = false) const
+  {
+    auto facePairFn = [&](size_t fi, size_t ofi) {
+      return !facesIntersect(fi, other, ofi, otherXform) || callback(fi, ofi);
+    };
+    if (placeTree) {
+      return mFaceTree.traverseWith(
+        other.placedFaceTree(otherXform),
+        [](const Box3& a, const Box3& b) { return a.sqDistance(b) == 0.f; },
+        facePairFn);
+    }
+    return mFaceTree.traverseWith(
+      other.mFaceTree,
+      [&otherXform](const Box3& a, const Box3& b) {
+        return a.sqDistance(b.transformed(otherXform)) == 0.f;
+      },
+      facePairFn);
+  };
+
+  /*Checks if any faces of the meshes intersect, stopping at the first such pair.*/
+  bool intersects(const Mesh& other, const glm::mat4& otherXform = glm::mat4(1.f)) const;
+
+  /*Distance between the closest points of the two meshes' surfaces. Returns zero if the
+   * surfaces intersect. The placeTree option is the same as for overlappingFaces.*/
+  float minimumDistance(const Mesh&      other,
+                        const glm::mat4& otherXform = glm::mat4(1.f),
+                        bool             placeTree  = false) const;
+
+  /*Creates a new mesh with the given faces, and the vertices they use. Repeated face
+   * indices are only included once, so the faces of the new mesh are in the order of
+   * their first occurrence in the list.*/
   Mesh extractFaces(const std::vector<size_t>& faces);
 
+  /*Labels every face with the index of its connected component, and returns the number
+   * of components. The components are numbered in the order of their first faces.*/
+  size_t components(std::vector<size_t>& faceLabels,
+                    eMeshConnectivity    connectivity = eMeshConnectivity::edge) const;
+  /*Splits the mesh into one mesh per connected component, in the order of the labels
+   * assigned by components().*/
+  std::vector<Mesh> shells(
+    eMeshConnectivity connectivity = eMeshConnectivity::edge) const;
+
   glm::vec3 closestPoint(const glm::vec3& pt, float searchDist) const;
+
+  /*Distance along the surface from the nearest of the given source vertices to every
+   * vertex. The heat method factorizes the mesh once on the first query and reuses it
+   * for later queries. It falls back to fast marching if the mesh has degenerate faces.
+   * Vertices not connected to any source get FLT_MAX.*/
+  std::vector<float> geodesicDistances(
+    const size_t*   sources,
+    size_t          nSources,
+    eGeodesicMethod method = eGeodesicMethod::heat) const;
+
+  VoxelGrid voxelize(float          voxelSize,
+                     eMeshVoxelMode mode = eMeshVoxelMode::surface) const;
 };
 
 template<>
@@ -183,13 +328,19 @@ struct Serial<Mesh> : public std::true_type
   {
     std::vector<glm::vec3>  verts;
     std::vector<Mesh::Face> faces;
+    RTree3d                 faceTree, vertexTree;
     bytes >> verts >> faces;
-    return Mesh(verts, faces);
+    // Meshes saved before the trees were serialized end here.
+    if (bytes.remaining() > 0) {
+      bytes >> faceTree >> vertexTree;
+    }
+    return Mesh(
+      std::move(verts), std::move(faces), std::move(faceTree), std::move(vertexTree));
   }
   static Bytes serialize(const Mesh& msh)
   {
     Bytes bytes;
-    bytes << msh.vertices() << msh.faces();
+    bytes << msh.vertices() << msh.faces() << msh.mFaceTree << msh.mVertexTree;
     return bytes;
   }
 };
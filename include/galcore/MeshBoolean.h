@@ -0,0 +1,19 @@
+#pragma once
+#include <galcore/Mesh.h>
+
+namespace gal {
+
+enum class eMeshBoolean
+{
+  unite = 0,
+  intersect,
+  subtract
+};
+
+/*Computes the boolean combination of two closed meshes with outward facing normals.
+ * The faces of the two meshes that cross each other are cut along the intersection
+ * curves and retriangulated, and the resulting patches are kept or dropped depending on
+ * whether they lie inside the other mesh. Coplanar overlapping faces are not cut.*/
+Mesh meshBoolean(const Mesh& a, const Mesh& b, eMeshBoolean op);
+
+}  // namespace gal
@@ -0,0 +1,69 @@
+#pragma once
+#include <galcore/Box.h>
+#include <glm/glm.hpp>
+
+namespace gal {
+
+enum class eOrientedBoxFit
+{
+  pca = 0,    // Axes along the principal components of the points.
+  minVolume,  // Smallest box with a face flush with a face of the convex hull.
+};
+
+/*Box with arbitrary orientation. The columns of axes are the unit directions of the box,
+ * forming a right handed frame, and halfSize is the half of its size along each of
+ * them.*/
+struct OrientedBox3
+{
+  glm::vec3 center   = glm::vec3 {0.f, 0.f, 0.f};
+  glm::mat3 axes     = glm::mat3(1.f);
+  glm::vec3 halfSize = glm::vec3 {0.f, 0.f, 0.f};
+
+  OrientedBox3() = default;
+  OrientedBox3(const glm::vec3& center, const glm::mat3& axes, const glm::vec3& halfSize);
+
+  float volume() const;
+  Box3  bounds() const;
+  bool  contains(const glm::vec3& pt, float tolerance = 0.f) const;
+  /*The corners of the bottom face, followed by those of the top face, both counter
+   * clockwise around the third axis.*/
+  void corners(glm::vec3 (&pts)[8]) const;
+
+  /*The tightest box with the given axes.*/
+  static OrientedBox3 fitAxes(const glm::mat3& axes,
+                              const glm::vec3* points,
+                              size_t           nPoints);
+  /*Axes along the eigenvectors of the covariance of the points. Linear time, but the
+   * box can be far from the smallest one.*/
+  static OrientedBox3 fitPCA(const glm::vec3* points, size_t nPoints);
+  /*For every distinct face normal of the convex hull, the outline of the hull seen along
+   * the normal is found by walking the hull graph, and the smallest rectangle containing
+   * its projection is found with rotating calipers. The faces are evaluated in parallel.
+   * Hulls with more than a few thousand distinct normals are searched coarse to fine,
+   * one normal per cell of a cube map first, then every normal of the best cells. The
+   * smallest box always has a face flush with the hull in the plane, but not always in
+   * 3d, so it is exact for most inputs and near-exact otherwise. Falls back to the PCA
+   * fit for flat inputs.*/
+  static OrientedBox3 fitMinVolume(const glm::vec3* points, size_t nPoints);
+  static OrientedBox3 fit(const glm::vec3* points, size_t nPoints, eOrientedBoxFit mode);
+  static OrientedBox3 fit(const std::vector<glm::vec3>& points, eOrientedBoxFit mode);
+};
+
+template<>
+struct Serial<OrientedBox3> : public std::true_type
+{
+  static OrientedBox3 deserialize(Bytes& bytes)
+  {
+    OrientedBox3 box;
+    bytes >> box.center >> box.axes[0] >> box.axes[1] >> box.axes[2] >> box.halfSize;
+    return box;
+  }
+  static Bytes serialize(const OrientedBox3& box)
+  {
+    Bytes bytes;
+    bytes << box.center << box.axes[0] << box.axes[1] << box.axes[2] << box.halfSize;
+    return bytes;
+  }
+};
+
+}  // namespace gal
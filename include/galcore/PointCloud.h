@@ -1,10 +1,16 @@
 #pragma once
 #include <atomic>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
 #include <vector>
 
 #include <tbb/tbb.h>
 
 #include <galcore/Box.h>
+#include <galcore/KdTree.h>
 #include <galcore/Serialization.h>
 #include <glm/glm.hpp>
 
@@ -17,6 +23,76 @@ public:
   PointCloud(const std::vector<glm::vec2>& pts2d);
 
   Box3 bounds() const;
+
+  /*The attributes of the points are stored one array per attribute, alongside the
+   * points. An attribute is either empty or has one value per point. Editing the points
+   * doesn't update the attributes.*/
+  bool                          hasNormals() const noexcept;
+  std::vector<glm::vec3>&       normals() noexcept;
+  const std::vector<glm::vec3>& normals() const noexcept;
+  bool                          hasColors() const noexcept;
+  std::vector<glm::vec3>&       colors() noexcept;
+  const std::vector<glm::vec3>& colors() const noexcept;
+  bool                          hasScalarField(const std::string& name) const;
+  /*Adds the field with zero for every point if it doesn't exist.*/
+  std::vector<float>&           scalarField(const std::string& name);
+  const std::vector<float>&     scalarField(const std::string& name) const;
+  void                          removeScalarField(const std::string& name);
+  std::vector<std::string>      scalarFieldNames() const;
+  void                          clearAttributes();
+
+  /*The normal of every point is the direction of least variance of its k nearest
+   * neighbors, including itself, i.e. the eigenvector of the smallest eigenvalue of their
+   * covariance. The points are processed in parallel. The normals have arbitrary signs
+   * until orientNormals is called. The tree, if given, must be the k-d tree of the points
+   * as they are, otherwise one is built.*/
+  void estimateNormals(size_t nNeighbors);
+  void estimateNormals(size_t nNeighbors, const KdTree3& tree);
+  /*Flips the normals so that they agree with their neighbors, after Hoppe et al. The
+   * graph of the k nearest neighbors is weighted by 1 - |dot(ni, nj)|, and the
+   * orientation is propagated along its minimum spanning tree, which goes across nearly
+   * parallel normals first. The tree is built with Kruskal's algorithm over the edges
+   * sorted in parallel. Each connected part starts from its highest point, whose normal
+   * is made to point up. The tree is as for estimateNormals.*/
+  void orientNormals(size_t nNeighbors);
+  void orientNormals(size_t nNeighbors, const KdTree3& tree);
+
+  /*Replaces the points in each cube of the given size by their centroid. The points are
+   * grouped by sorting their voxel keys in parallel, and the centroids are reduced in
+   * parallel. The attributes are averaged the same way, with the normals flipped to agree
+   * with the first one of the voxel before they are added. The points merged into the
+   * i-th point of the result are sources[offsets[i], offsets[i + 1]).*/
+  PointCloud voxelDownsample(float                voxelSize,
+                             std::vector<size_t>& offsets,
+                             std::vector<size_t>& sources) const;
+  /*Subset of the points in which no two points are closer than the radius, and every
+   * point left out is within the radius of one that is kept. The points are bucketed in
+   * cells as large as the radius, and only the samples of the 27 cells around a point
+   * are checked. Cells of the same phase, i.e. with the same indices modulo 3, are not
+   * neighbors, so the 27 phases are visited in turn and the cells of each phase in
+   * parallel. The i-th point of the result is the sources[i]-th point of the cloud, and
+   * has the same attributes.*/
+  PointCloud poissonDiskSample(float radius, std::vector<size_t>& sources) const;
+
+  /*Builds the k-d tree of the points. The tree is not cached, because the points can be
+   * edited in place through the vector. To run several searches over the same points,
+   * build it once and pass it to the methods that take one.*/
+  KdTree3 kdTree() const;
+
+private:
+  std::vector<glm::vec3>                    mNormals;
+  std::vector<glm::vec3>                    mColors;
+  std::map<std::string, std::vector<float>> mScalarFields;
+
+  /*The attributes of the i-th point of the result are those of the sources[i]-th point.*/
+  void copyAttributes(const std::vector<size_t>& sources, PointCloud& result) const;
+  /*The attributes of the i-th point of the result are the averages of those of the
+   * points sources[offsets[i], offsets[i + 1]).*/
+  void averageAttributes(const std::vector<size_t>& offsets,
+                         const std::vector<size_t>& sources,
+                         PointCloud&                result) const;
+
+  friend struct Serial<PointCloud>;
 };
 
 template<>
@@ -28,8 +104,16 @@ struct Serial<PointCloud> : public std::true_type
     uint64_t   npts = 0;
     bytes >> npts;
     cloud.resize(npts);
-    for (auto& pt : cloud) {
-      bytes >> pt;
+    bytes.readBytes(npts * sizeof(glm::vec3), (char*)cloud.data());
+    // Clouds saved before the attributes were serialized end here.
+    if (bytes.remaining() > 0) {
+      uint64_t nFields = 0;
+      bytes >> cloud.mNormals >> cloud.mColors >> nFields;
+      for (uint64_t i = 0; i < nFields; i++) {
+        std::string name;
+        bytes >> name;
+        bytes >> cloud.mScalarFields[name];
+      }
     }
     return cloud;
   }
@@ -37,67 +121,275 @@ struct Serial<PointCloud> : public std::true_type
   {
     Bytes dst;
     dst << uint64_t(cloud.size());
-    for (const auto& pt : cloud) {
-      dst << pt;
+    dst.writeBytes((const char*)cloud.data(), cloud.size() * sizeof(glm::vec3));
+    dst << cloud.mNormals << cloud.mColors << uint64_t(cloud.mScalarFields.size());
+    for (const auto& field : cloud.mScalarFields) {
+      dst << field.first << field.second;
     }
     return dst;
   }
 };
 
+/*k-means++ seeding. Each seed is a point picked with probability proportional to its
+ * squared distance from the closest seed so far. Large clouds are seeded from a uniform
+ * sample of a few dozen points per cluster, which is enough for the seeds to spread over
+ * all the clusters. After a seed is added, a point only needs its distance updated if
+ * the seed is less than twice as far from the point's closest seed as the point itself,
+ * by the triangle inequality.*/
+template<typename TPt, typename TPtIter>
+std::vector<TPt> kMeansSeeds(TPtIter begin, TPtIter end, size_t nClusters)
+{
+  static constexpr size_t sSamplesPerCluster = 64;
+  const size_t            nPts               = std::distance(begin, end);
+  if (nClusters == 0 || nClusters > nPts) {
+    throw "Cannot seed more clusters than there are points";
+  }
+  std::mt19937     rng(42);
+  std::vector<TPt> samples;
+  size_t           nSamples = std::min(nPts, nClusters * sSamplesPerCluster);
+  if (nSamples == nPts) {
+    samples.assign(begin, end);
+  }
+  else {
+    std::uniform_int_distribution<size_t> pick(0, nPts - 1);
+    samples.resize(nSamples);
+    for (TPt& pt : samples) {
+      pt = *(begin + pick(rng));
+    }
+  }
+
+  std::vector<TPt>      seeds(nClusters);
+  std::vector<float>    sqDists(nSamples, FLT_MAX);
+  std::vector<uint32_t> nearest(nSamples, 0);
+  std::vector<float>    seedSqDists(nClusters);
+  for (size_t si = 0; si < nClusters; si++) {
+    double total = si == 0 ? 0. : std::accumulate(sqDists.begin(), sqDists.end(), 0.);
+    size_t chosen = 0;
+    if (total > 0.) {
+      double r = std::uniform_real_distribution<double>(0., total)(rng);
+      while (chosen + 1 < nSamples && (r -= sqDists[chosen]) >= 0.) {
+        chosen++;
+      }
+    }
+    else {
+      chosen = std::uniform_int_distribution<size_t>(0, nSamples - 1)(rng);
+    }
+    const TPt seed = samples[chosen];
+    seeds[si]      = seed;
+    for (size_t sj = 0; sj < si; sj++) {
+      seedSqDists[sj] = glm::distance2(seed, seeds[sj]);
+    }
+    tbb::parallel_for(size_t(0), nSamples, [&](size_t i) {
+      if (si > 0 && seedSqDists[nearest[i]] >= 4.f * sqDists[i]) {
+        return;
+      }
+      float d2 = glm::distance2(samples[i], seed);
+      if (d2 < sqDists[i]) {
+        sqDists[i] = d2;
+        nearest[i] = uint32_t(si);
+      }
+    });
+  }
+  return seeds;
+}
+
+/*Lloyd's k-means with k-means++ seeds and Hamerly's bounds. Every point keeps an upper
+ * bound on the distance to its center and a lower bound on the distance to every other
+ * center. When the centers move, the bounds are loosened by how far they moved, and the
+ * point is only looked up again when the bounds no longer prove that its center is the
+ * closest. The sums of the new centers are accumulated per thread in the
+ * same parallel pass. Stops when no point changes its cluster, when no center moves
+ * farther than the tolerance, or after the maximum number of iterations. Writes the
+ * index of the cluster of every point, and returns the centers.*/
 template<typename TPt, typename TPtIter, typename IdxOutIter>
-void kMeansClusters(TPtIter begin, TPtIter end, size_t nClusters, IdxOutIter idxOut)
+std::vector<TPt> kMeansClusters(TPtIter    begin,
+                                TPtIter    end,
+                                size_t     nClusters,
+                                IdxOutIter idxOut,
+                                size_t     maxIterations = 100,
+                                float      tolerance     = 0.f)
 {
   static_assert(std::is_same_v<TPt, glm::vec3> || std::is_same_v<TPt, glm::vec2>,
                 "Unsupported point type.");
-  static constexpr TPt sZeroVec = TPt(0.f);
-  using BoxType = std::conditional_t<std::is_same_v<TPt, glm::vec3>, Box3, Box2>;
+  using SumType =
+    std::conditional_t<std::is_same_v<TPt, glm::vec3>, glm::dvec3, glm::dvec2>;
+  struct Partial
+  {
+    std::vector<SumType> sums;
+    std::vector<size_t>  counts;
+    size_t               nChanged;
+  };
+
+  const size_t nPts = std::distance(begin, end);
+  if (nPts == 0) {
+    return {};
+  }
+  nClusters                = std::min(nClusters, nPts);
+  std::vector<TPt> centers = kMeansSeeds<TPt>(begin, end, nClusters);
+
+  std::vector<uint32_t> assigned(nPts, 0);
+  std::vector<float>    upper(nPts, FLT_MAX);
+  std::vector<float>    lower(nPts, 0.f);
+  std::vector<float>    halfGaps(nClusters);
+  std::vector<float>    moved(nClusters, 0.f);
+  uint32_t              farthest = 0;  // The center that moved the most.
+  float                 maxMove  = 0.f, secondMove = 0.f;
 
-  size_t              nPts = std::distance(begin, end);
-  auto                box  = BoxType::template create<TPtIter>(begin, end);
-  std::vector<TPt>    centers(nClusters);
-  std::vector<size_t> counts(nClusters);
-  box.randomPoints(nClusters, centers.begin());
+  Partial empty;
+  empty.sums.assign(nClusters, SumType(0.));
+  empty.counts.assign(nClusters, 0);
+  empty.nChanged = 0;
+  tbb::enumerable_thread_specific<Partial> partials(empty);
+  Partial                                  total = empty;
 
-  std::vector<std::pair<float, size_t>> mapping(nPts, std::make_pair(FLT_MAX, SIZE_MAX));
+  // The points whose bounds fail are matched with the centers using a k-d tree of the
+  // centers. 2d points are placed in the xy plane.
+  auto to3d = [](const TPt& pt) {
+    if constexpr (std::is_same_v<TPt, glm::vec3>) {
+      return pt;
+    }
+    else {
+      return glm::vec3(pt.x, pt.y, 0.f);
+    }
+  };
+  std::vector<glm::vec3> centers3d(nClusters);
+
+  for (size_t iter = 0; iter < maxIterations; iter++) {
+    std::transform(centers.begin(), centers.end(), centers3d.begin(), to3d);
+    KdTree3 tree(centers3d.data(), nClusters);
+    // A point closer to its center than half the distance to the nearest other center
+    // can't be closer to any other center.
+    tbb::parallel_for(size_t(0), nClusters, [&](size_t ci) {
+      size_t nbrs[2];
+      float  dists[2] = {FLT_MAX, FLT_MAX};
+      tree.queryNearestN(centers3d[ci], 2, nbrs, dists);
+      halfGaps[ci] = 0.5f * dists[1];
+    });
 
-  std::atomic_bool keepGoing = true;
-  while (keepGoing) {
-    keepGoing = false;
     tbb::parallel_for(
-      size_t(0), nPts, [&centers, &mapping, &keepGoing, &begin](size_t i) {
-        auto& map            = mapping.at(i);
-        map.first            = FLT_MAX;
-        size_t      minIndex = SIZE_MAX;
-        const auto& pt       = *(begin + i);
-        for (size_t ci = 0; ci < centers.size(); ci++) {
-          float d2 = glm::distance2(pt, centers[ci]);
-          if (d2 < map.first) {
-            map.first = d2;
-            minIndex  = ci;
+      tbb::blocked_range<size_t>(0, nPts), [&](const tbb::blocked_range<size_t>& range) {
+        Partial& partial = partials.local();
+        for (size_t i = range.begin(); i < range.end(); i++) {
+          const TPt& pt = *(begin + i);
+          uint32_t   ci = assigned[i];
+          upper[i] += moved[ci];
+          lower[i] -= ci == farthest ? secondMove : maxMove;
+          float bound = std::max(halfGaps[ci], lower[i]);
+          if (upper[i] > bound) {
+            upper[i] = glm::distance(pt, centers[ci]);
           }
+          if (upper[i] > bound) {
+            size_t nbrs[2];
+            float  dists[2] = {FLT_MAX, FLT_MAX};
+            tree.queryNearestN(to3d(pt), 2, nbrs, dists);
+            if (uint32_t(nbrs[0]) != ci) {
+              partial.nChanged++;
+              ci          = uint32_t(nbrs[0]);
+              assigned[i] = ci;
+            }
+            upper[i] = dists[0];
+            lower[i] = dists[1];
+          }
+          partial.sums[ci] += SumType(pt);
+          partial.counts[ci]++;
         }
-        keepGoing  = keepGoing || map.second != minIndex;
-        map.second = minIndex;
       });
 
-    if (keepGoing) {
-      std::fill(centers.begin(), centers.end(), sZeroVec);
-      std::fill(counts.begin(), counts.end(), size_t(0));
-      for (size_t i = 0; i < nPts; i++) {
-        const auto& map = mapping.at(i);
-        centers[map.second] += *(begin + i);
-        counts[map.second]++;
+    partials.combine_each([&](Partial& partial) {
+      for (size_t ci = 0; ci < nClusters; ci++) {
+        total.sums[ci] += partial.sums[ci];
+        total.counts[ci] += partial.counts[ci];
+      }
+      total.nChanged += partial.nChanged;
+      partial = empty;
+    });
+
+    // Empty clusters keep their centers.
+    farthest   = 0;
+    maxMove    = 0.f;
+    secondMove = 0.f;
+    for (size_t ci = 0; ci < nClusters; ci++) {
+      moved[ci] = 0.f;
+      if (total.counts[ci] > 0) {
+        TPt center  = TPt(total.sums[ci] / double(total.counts[ci]));
+        moved[ci]   = glm::distance(center, centers[ci]);
+        centers[ci] = center;
+      }
+      if (moved[ci] > maxMove) {
+        secondMove = maxMove;
+        maxMove    = moved[ci];
+        farthest   = uint32_t(ci);
       }
-      for (size_t i = 0; i < centers.size(); i++) {
-        centers[i] /= float(counts[i]);
+      else if (moved[ci] > secondMove) {
+        secondMove = moved[ci];
       }
     }
+    bool converged = total.nChanged == 0 || maxMove <= tolerance;
+    total          = empty;
+    if (converged) {
+      break;
+    }
   }
 
   std::transform(
-    mapping.begin(), mapping.end(), idxOut, [](const std::pair<float, size_t>& m) {
-      return m.second;
-    });
+    assigned.begin(), assigned.end(), idxOut, [](uint32_t ci) { return size_t(ci); });
+  return centers;
 }
 
+/*Mini-batch k-means for clouds that don't fit in memory, fed one chunk at a time. Each
+ * batch is assigned to the nearest centers in parallel, and every center then moves to
+ * the running mean of all the points ever assigned to it. That is the per-center
+ * learning rate of 1 / count of Sculley's mini-batch k-means, applied to the whole batch
+ * at once. Only the centers and their counts are kept between batches, so the memory
+ * doesn't grow with the size of the cloud. The centers are seeded with k-means++ from the
+ * first points, which are held back until there are at least as many as clusters.*/
+class MiniBatchKMeans
+{
+public:
+  explicit MiniBatchKMeans(size_t nClusters);
+
+  void addBatch(const glm::vec3* points, size_t nPoints);
+  /*Calls readChunk with the same cloud until it returns false, and adds every chunk it
+   * reads as a batch.*/
+  void addBatches(const std::function<bool(PointCloud&)>& readChunk);
+  /*Writes the index of the nearest center of every point.*/
+  void assign(const glm::vec3* points, size_t nPoints, size_t* idxOut) const;
+
+  size_t                        numClusters() const noexcept;
+  /*Empty until enough points are added to seed the centers.*/
+  const std::vector<glm::vec3>& centers() const noexcept;
+  /*Number of points assigned to each center so far.*/
+  const std::vector<uint64_t>&  counts() const noexcept;
+
+private:
+  size_t                 mNumClusters = 0;
+  std::vector<glm::vec3> mCenters;
+  std::vector<uint64_t>  mCounts;
+  std::vector<glm::vec3> mPending;  // Points waiting for the centers to be seeded.
+
+  void update(const glm::vec3* points, size_t nPoints);
+
+  friend struct Serial<MiniBatchKMeans>;
+};
+
+template<>
+struct Serial<MiniBatchKMeans> : public std::true_type
+{
+  static MiniBatchKMeans deserialize(Bytes& bytes)
+  {
+    uint64_t nClusters = 0;
+    bytes >> nClusters;
+    MiniBatchKMeans kmeans(nClusters);
+    bytes >> kmeans.mCenters >> kmeans.mCounts >> kmeans.mPending;
+    return kmeans;
+  }
+  static Bytes serialize(const MiniBatchKMeans& kmeans)
+  {
+    Bytes bytes;
+    bytes << uint64_t(kmeans.mNumClusters) << kmeans.mCenters << kmeans.mCounts
+          << kmeans.mPending;
+    return bytes;
+  }
+};
+
 }  // namespace gal
@@ -0,0 +1,157 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cmath>
+#include <limits>
+
+namespace gal {
+
+/*Robust orientation predicates, following Shewchuk. The determinant is first evaluated in
+ * floating point and compared against an error bound proportional to its permanent. Only
+ * when the bound can't decide the sign is it evaluated exactly with expansions.*/
+
+static constexpr double PREDICATE_EPSILON = std::numeric_limits<double>::epsilon() * 0.5;
+static constexpr double ORIENT2D_BOUND =
+  (3.0 + 16.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+static constexpr double ORIENT3D_BOUND =
+  (7.0 + 56.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+static constexpr double INCIRCLE_BOUND =
+  (10.0 + 96.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+static constexpr double INSPHERE_BOUND =
+  (16.0 + 224.0 * PREDICATE_EPSILON) * PREDICATE_EPSILON;
+
+/*Exact signs, without the floating point filter. These are meant for callers that filter
+ * with determinants they have already cached.*/
+int orient2dExact(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c);
+int orient3dExact(const glm::dvec3& a,
+                  const glm::dvec3& b,
+                  const glm::dvec3& c,
+                  const glm::dvec3& d);
+int incircleExact(const glm::dvec2& a,
+                  const glm::dvec2& b,
+                  const glm::dvec2& c,
+                  const glm::dvec2& d);
+int insphereExact(const glm::dvec3& a,
+                  const glm::dvec3& b,
+                  const glm::dvec3& c,
+                  const glm::dvec3& d,
+                  const glm::dvec3& e);
+
+/*Sign of the signed area of the triangle abc. Positive if counter-clockwise.*/
+inline int orient2d(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c)
+{
+  double l     = (a.x - c.x) * (b.y - c.y);
+  double r     = (a.y - c.y) * (b.x - c.x);
+  double det   = l - r;
+  double bound = ORIENT2D_BOUND * (std::abs(l) + std::abs(r));
+  if (det > bound) {
+    return 1;
+  }
+  else if (-det > bound) {
+    return -1;
+  }
+  return orient2dExact(a, b, c);
+}
+
+/*Side of the plane of the triangle abc on which d lies. Positive along the normal of abc,
+ * i.e. the direction from which abc appears counter-clockwise.*/
+inline int orient3d(const glm::dvec3& a,
+                    const glm::dvec3& b,
+                    const glm::dvec3& c,
+                    const glm::dvec3& d)
+{
+  glm::dvec3 u     = b - a;
+  glm::dvec3 v     = c - a;
+  glm::dvec3 w     = d - a;
+  double     m[6]  = {v.y * w.z, v.z * w.y, v.z * w.x, v.x * w.z, v.x * w.y, v.y * w.x};
+  double     det   = u.x * (m[0] - m[1]) + u.y * (m[2] - m[3]) + u.z * (m[4] - m[5]);
+  double     perm  = std::abs(u.x) * (std::abs(m[0]) + std::abs(m[1])) +
+                std::abs(u.y) * (std::abs(m[2]) + std::abs(m[3])) +
+                std::abs(u.z) * (std::abs(m[4]) + std::abs(m[5]));
+  double bound = ORIENT3D_BOUND * perm;
+  if (det > bound) {
+    return 1;
+  }
+  else if (-det > bound) {
+    return -1;
+  }
+  return orient3dExact(a, b, c, d);
+}
+
+/*Positive if d is strictly inside the circumcircle of the counter-clockwise triangle abc,
+ * negative if it is outside, and zero if it is on it.*/
+inline int incircle(const glm::dvec2& a,
+                    const glm::dvec2& b,
+                    const glm::dvec2& c,
+                    const glm::dvec2& d)
+{
+  glm::dvec2 ad = a - d, bd = b - d, cd = c - d;
+  double     bc[2] = {bd.x * cd.y, cd.x * bd.y};
+  double     ca[2] = {cd.x * ad.y, ad.x * cd.y};
+  double     ab[2] = {ad.x * bd.y, bd.x * ad.y};
+  double     alift = glm::dot(ad, ad);
+  double     blift = glm::dot(bd, bd);
+  double     clift = glm::dot(cd, cd);
+  double     det =
+    alift * (bc[0] - bc[1]) + blift * (ca[0] - ca[1]) + clift * (ab[0] - ab[1]);
+  double perm = alift * (std::abs(bc[0]) + std::abs(bc[1])) +
+                blift * (std::abs(ca[0]) + std::abs(ca[1])) +
+                clift * (std::abs(ab[0]) + std::abs(ab[1]));
+  double bound = INCIRCLE_BOUND * perm;
+  if (det > bound) {
+    return 1;
+  }
+  else if (-det > bound) {
+    return -1;
+  }
+  return incircleExact(a, b, c, d);
+}
+
+/*Positive if e is strictly inside the circumsphere of the tetrahedron abcd, negative if
+ * it is outside, and zero if it is on it. This assumes orient3d(a, b, c, d) > 0, the sign
+ * flips otherwise.*/
+inline int insphere(const glm::dvec3& a,
+                    const glm::dvec3& b,
+                    const glm::dvec3& c,
+                    const glm::dvec3& d,
+                    const glm::dvec3& e)
+{
+  glm::dvec3 ae = a - e, be = b - e, ce = c - e, de = d - e;
+  // Minors of the xy coordinates, with their permanents.
+  double ab  = ae.x * be.y - be.x * ae.y;
+  double bc  = be.x * ce.y - ce.x * be.y;
+  double cd  = ce.x * de.y - de.x * ce.y;
+  double da  = de.x * ae.y - ae.x * de.y;
+  double ac  = ae.x * ce.y - ce.x * ae.y;
+  double bd  = be.x * de.y - de.x * be.y;
+  double abp = std::abs(ae.x * be.y) + std::abs(be.x * ae.y);
+  double bcp = std::abs(be.x * ce.y) + std::abs(ce.x * be.y);
+  double cdp = std::abs(ce.x * de.y) + std::abs(de.x * ce.y);
+  double dap = std::abs(de.x * ae.y) + std::abs(ae.x * de.y);
+  double acp = std::abs(ae.x * ce.y) + std::abs(ce.x * ae.y);
+  double bdp = std::abs(be.x * de.y) + std::abs(de.x * be.y);
+
+  double abc  = ae.z * bc - be.z * ac + ce.z * ab;
+  double bcd  = be.z * cd - ce.z * bd + de.z * bc;
+  double cda  = ce.z * da + de.z * ac + ae.z * cd;
+  double dab  = de.z * ab + ae.z * bd + be.z * da;
+  double abcp = std::abs(ae.z) * bcp + std::abs(be.z) * acp + std::abs(ce.z) * abp;
+  double bcdp = std::abs(be.z) * cdp + std::abs(ce.z) * bdp + std::abs(de.z) * bcp;
+  double cdap = std::abs(ce.z) * dap + std::abs(de.z) * acp + std::abs(ae.z) * cdp;
+  double dabp = std::abs(de.z) * abp + std::abs(ae.z) * bdp + std::abs(be.z) * dap;
+
+  double alift = glm::dot(ae, ae), blift = glm::dot(be, be);
+  double clift = glm::dot(ce, ce), dlift = glm::dot(de, de);
+  // The determinant of the lifted matrix is negative when e is inside.
+  double det   = (dlift * abc - clift * dab) + (blift * cda - alift * bcd);
+  double perm  = dlift * abcp + clift * dabp + blift * cdap + alift * bcdp;
+  double bound = INSPHERE_BOUND * perm;
+  if (det > bound) {
+    return -1;
+  }
+  else if (-det > bound) {
+    return 1;
+  }
+  return insphereExact(a, b, c, d, e);
+}
+
+}  // namespace gal
@@ -1,159 +1,1320 @@
 #pragma once
 #include <galcore/Box.h>
 #include <galcore/Util.h>
-#include <boost/geometry.hpp>
-#include <boost/geometry/geometries/box.hpp>
-#include <boost/geometry/geometries/point.hpp>
 #include <glm/glm.hpp>
+#include <stdint.h>
+#include <tbb/tbb.h>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <vector>
 
 constexpr unsigned int RTREE_NUM_ELEMENTS_PER_NODE = 16;
-namespace bg                                       = boost::geometry;
-namespace bgi                                      = boost::geometry::index;
-namespace bgm                                      = boost::geometry::model;
-namespace rtree                                    = bgi::detail::rtree;
-
-template<typename Predicate,
-         typename Value,
-         typename Options,
-         typename Box,
-         typename Allocators>
-struct BFSQuery : public rtree::visitor<Value,
-                                        typename Options::parameters_type,
-                                        Box,
-                                        Allocators,
-                                        typename Options::node_tag,
-                                        true>::type
-{
-  typedef typename rtree::internal_node<Value,
-                                        typename Options::parameters_type,
-                                        Box,
-                                        Allocators,
-                                        typename Options::node_tag>::type internal_node;
-  typedef typename rtree::leaf<Value,
-                               typename Options::parameters_type,
-                               Box,
-                               Allocators,
-                               typename Options::node_tag>::type          leaf;
-
-  inline BFSQuery(Predicate const& p)
-      : pr(p)
-  {}
-
-  inline void operator()(internal_node const& n)
-  {
-    for (auto&& [bounds, node] : rtree::elements(n))
-      if (pr(bounds))
-        rtree::apply_visitor(*this, *node);
-  }
-
-  inline void operator()(leaf const& n)
-  {
-    for (auto& item : rtree::elements(n))
-      if (pr(item.first))
-        results.insert(&item);
-  }
 
-  Predicate const& pr;
-
-  std::set<Value const*> results;
-};
-
-template<typename TreeT, typename PredFn, typename Fn>
-void doBfsQuery(const TreeT& tree, PredFn pred, Fn action)
+/*Node of an RTree. The bounds of the children are stored as a structure of arrays, so a
+ * query can test all the children of a node with a few vectorized comparisons instead of
+ * one box at a time. The unused slots hold empty boxes that fail every test. The children
+ * of a leaf are the indices of the items, and those of an internal node are the indices
+ * of the nodes in the node array of the tree.*/
+template<int Dim>
+struct alignas(64) RTreeNode
 {
-  using V = rtree::utilities::view<TreeT>;
-  V av(tree);
-
-  BFSQuery<PredFn,
-           typename V::value_type,
-           typename V::options_type,
-           typename V::box_type,
-           typename V::allocators_type>
-    vis(pred);
-
-  av.apply_visitor(vis);
-  for (auto* hit : vis.results)
-    action(*hit);
+  static constexpr size_t Width = RTREE_NUM_ELEMENTS_PER_NODE;
+
+  float    mins[Dim][Width];
+  float    maxs[Dim][Width];
+  uint64_t children[Width];
+  uint32_t count;
+  uint32_t leaf;
 };
 
-template<class BoostPointT, typename VecT, typename BoxT>
+template<typename VecT, typename BoxT>
 class RTree
 {
 public:
-  typedef BoostPointT                                                       PointType;
-  typedef bgm::box<BoostPointT>                                             BoxType;
-  typedef std::pair<BoxType, size_t>                                        ItemType;
-  typedef bgi::rtree<ItemType, bgi::quadratic<RTREE_NUM_ELEMENTS_PER_NODE>> BoostTreeType;
+  static constexpr int    Dim   = VecT::length();
+  static constexpr size_t Width = RTREE_NUM_ELEMENTS_PER_NODE;
+  typedef RTreeNode<Dim>  Node;
+  /*Version of the serialized layout of the tree, to be bumped when it changes.*/
+  static constexpr uint32_t FormatVersion = 2;
 
-  void insert(const BoxT& b, size_t i) { mTree.insert(std::make_pair(toBoost(b), i)); };
+  size_t size() const { return mNumItems; };
+
+  void insert(const BoxT& b, size_t i)
+  {
+    if (mNodes.empty()) {
+      mNodes.push_back(emptyNode(true));
+    }
+    mNumItems++;
+    mLinks = RefitLinks();
+    // Descend to a leaf, growing the boxes along the way.
+    std::vector<std::pair<size_t, size_t>> path;  // Node and the slot taken from it.
+    size_t                                 node = 0;
+    while (!mNodes[node].leaf) {
+      Node&  nd   = mNodes[node];
+      size_t slot = chooseChild(nd, b);
+      path.emplace_back(node, slot);
+      BoxT cbox = childBox(nd, slot);
+      for (int d = 0; d < Dim; d++) {
+        cbox.min[d] = std::min(cbox.min[d], b.min[d]);
+        cbox.max[d] = std::max(cbox.max[d], b.max[d]);
+      }
+      setChild(nd, slot, cbox, nd.children[slot]);
+      node = size_t(nd.children[slot]);
+    }
+    if (mNodes[node].count < Width) {
+      Node& nd = mNodes[node];
+      setChild(nd, nd.count++, b, i);
+      return;
+    }
+    // Split the full nodes bottom up.
+    size_t sibling = split(node, b, i);
+    while (!path.empty()) {
+      auto [parent, slot] = path.back();
+      path.pop_back();
+      setChild(mNodes[parent], slot, nodeBounds(node), node);
+      BoxT sbox = nodeBounds(sibling);
+      if (mNodes[parent].count < Width) {
+        Node& nd = mNodes[parent];
+        setChild(nd, nd.count++, sbox, sibling);
+        return;
+      }
+      sibling = split(parent, sbox, sibling);
+      node    = parent;
+    }
+    // The root was split. The root always stays at the front of the node array.
+    size_t moved = mNodes.size();
+    mNodes.push_back(mNodes[0]);
+    mNodes[0] = emptyNode(false);
+    setChild(mNodes[0], 0, nodeBounds(moved), moved);
+    setChild(mNodes[0], 1, nodeBounds(sibling), sibling);
+    mNodes[0].count = 2;
+  };
+
+  /*Replaces the contents with the items [0, n) whose boxes are given by boxFn. Packing
+   * all the items at once is much faster than inserting them one by one, and produces a
+   * better tree.*/
+  template<typename BoxFn>
+  void build(size_t n, BoxFn boxFn)
+  {
+    std::vector<BoxT> boxes(n);
+    tbb::parallel_for(size_t(0), n, [&](size_t i) { boxes[i] = boxFn(i); });
+    pack(boxes, {});
+  };
+
+  /*Replaces the boxes of the given items with the ones from boxFn, and refits the boxes
+   * of their ancestors without changing the structure of the tree, so the cost is
+   * proportional to the number of items that moved. The treelets that contain the moved
+   * items are rebuilt in place when their quality, by the surface area heuristic, has
+   * degraded too much since they were built. Items that are not in the tree are
+   * ignored.*/
+  template<typename BoxFn>
+  void refit(const size_t* items, size_t nItems, BoxFn boxFn)
+  {
+    if (mNodes.empty() || nItems == 0) {
+      return;
+    }
+    if (mLinks.parents.size() != mNodes.size()) {
+      linkNodes();
+    }
+    const auto& itemSlots = mLinks.itemSlots;
+    tbb::parallel_for(size_t(0), nItems, [&](size_t i) {
+      size_t item = items[i];
+      if (item < itemSlots.size() && itemSlots[item].first != SIZE_MAX) {
+        auto [leaf, slot] = itemSlots[item];
+        setChild(mNodes[leaf], slot, boxFn(item), item);
+      }
+    });
+    // Collect the leaves and treelets that changed, visiting each of them once.
+    size_t              gen = ++mLinks.generation;
+    std::vector<size_t> leaves, treelets;
+    for (size_t i = 0; i < nItems; i++) {
+      size_t item = items[i];
+      if (item >= itemSlots.size() || itemSlots[item].first == SIZE_MAX) {
+        continue;
+      }
+      size_t node = itemSlots[item].first;
+      if (mLinks.stamps[node] == gen) {
+        continue;
+      }
+      mLinks.stamps[node] = gen;
+      leaves.push_back(node);
+      size_t treelet = node;
+      while (mLinks.treeletCosts[treelet] < 0.f) {
+        treelet = mLinks.parents[treelet].first;
+      }
+      // A leaf can be a treelet by itself in a small tree.
+      if (treelet == node || mLinks.stamps[treelet] != gen) {
+        mLinks.stamps[treelet] = gen;
+        treelets.push_back(treelet);
+      }
+    }
+    if (leaves.size() * 8 > mNodes.size()) {
+      // Too many leaves moved to be worth walking up from each of them.
+      refitNode(0);
+    }
+    else {
+      for (size_t leaf : leaves) {
+        refitAncestors(leaf);
+      }
+    }
+    // The nodes freed by the rebuilds are released at the end, because releasing them
+    // moves other nodes, including the treelets that are yet to be checked.
+    std::vector<size_t> freed;
+    for (size_t treelet : treelets) {
+      if (sahCost(treelet) > sRebuildRatio * mLinks.treeletCosts[treelet]) {
+        rebuildTreelet(treelet, freed);
+      }
+    }
+    if (!freed.empty()) {
+      releaseNodes(std::move(freed));
+    }
+    // The levels above the treelets can only be fixed by repacking the whole tree.
+    if (topCost(0) > sRebuildRatio * mLinks.topCost) {
+      std::vector<size_t> nodes, items;
+      std::vector<BoxT>   boxes;
+      collectSubtree(0, nodes, boxes, items);
+      pack(boxes, items);
+    }
+  };
+
+  /*Builds a tree with the items of this tree that pass the filter. The filter maps the
+   * index of an item to its index in the new tree, or to SIZE_MAX to drop the item. Only
+   * the subtrees that touch the given bounds are visited, so the bounds must enclose all
+   * the items to keep. The boxes are taken from the leaves of this tree rather than
+   * recomputed.*/
+  template<typename FilterFn>
+  RTree filtered(const BoxT& bounds, FilterFn filter) const
+  {
+    std::vector<BoxT>   boxes;
+    std::vector<size_t> items;
+    if (!mNodes.empty()) {
+      collectItems(0, bounds, filter, boxes, items);
+    }
+    RTree tree;
+    tree.pack(boxes, items);
+    return tree;
+  };
+
+  /*Copy of this tree with the same structure, in which the box of every item is replaced
+   * by boxFn of that box, and the boxes of the nodes are refitted around them. This is
+   * useful to place a tree with a transform once, rather than transforming its boxes in
+   * every test of a traversal.*/
+  template<typename BoxFn>
+  RTree transformed(BoxFn boxFn) const
+  {
+    RTree tree;
+    tree.mNodes    = mNodes;
+    tree.mNumItems = mNumItems;
+    if (tree.mNodes.empty()) {
+      return tree;
+    }
+    tbb::parallel_for(size_t(0), tree.mNodes.size(), [&](size_t ni) {
+      Node& nd = tree.mNodes[ni];
+      if (nd.leaf) {
+        for (size_t i = 0; i < nd.count; i++) {
+          setChild(nd, i, boxFn(childBox(nd, i)), nd.children[i]);
+        }
+      }
+    });
+    tree.refitNode(0);
+    return tree;
+  };
 
   template<typename SizeTIter>
   void queryBoxIntersects(const BoxT& b, SizeTIter inserter) const
   {
-    query(bgi::intersects(toBoost(b)), inserter);
+    if (!mNodes.empty()) {
+      queryBox(0, b, inserter);
+    }
+  };
+
+  /*Box queries for many boxes, with the queries running in parallel. The items that
+   * touch the i-th box are indices[offsets[i], offsets[i + 1]).*/
+  void queryBoxIntersectsBatch(const BoxT*          boxes,
+                               size_t               nBoxes,
+                               std::vector<size_t>& offsets,
+                               std::vector<size_t>& indices) const
+  {
+    // The queries are split into fixed chunks whose results are gathered separately,
+    // then copied into place once the offsets are known.
+    static constexpr size_t          sChunkSize = 256;
+    size_t                           nChunks    = (nBoxes + sChunkSize - 1) / sChunkSize;
+    std::vector<std::vector<size_t>> chunkResults(nChunks);
+    offsets.assign(nBoxes + 1, 0);
+    tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+      std::vector<size_t>& results = chunkResults[ci];
+      size_t               last    = std::min(nBoxes, (ci + 1) * sChunkSize);
+      for (size_t i = ci * sChunkSize; i < last; i++) {
+        size_t before = results.size();
+        queryBoxIntersects(boxes[i], std::back_inserter(results));
+        offsets[i + 1] = results.size() - before;
+      }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    indices.resize(offsets.back());
+    tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+      std::copy(chunkResults[ci].begin(),
+                chunkResults[ci].end(),
+                indices.begin() + offsets[ci * sChunkSize]);
+    });
   };
 
   template<typename SizeTIter>
   void queryByDistance(const VecT& pt, float distance, SizeTIter inserter) const
   {
-    PointType  center = toBoost(pt);
-    const auto pred   = [&center, distance](const BoxType& bounds) {
-      return bg::distance(center, bounds) < distance;
-    };
-    const auto action = [&inserter](const ItemType& item) {
-      *(inserter++) = item.second;
-    };
-    doBfsQuery<BoostTreeType, decltype(pred), decltype(action)>(mTree, pred, action);
+    if (!mNodes.empty() && distance > 0.f) {
+      queryDistance(0, pt, distance * distance, inserter);
+    }
   };
 
   template<typename SizeTIter>
   void queryNearestN(const VecT& pt, size_t numResults, SizeTIter inserter) const
   {
-    query(bgi::nearest(toBoost(pt), (unsigned int)numResults), inserter);
+    NearestScratch scratch;
+    nearestN(pt, numResults, scratch);
+    for (const auto& result : scratch.results) {
+      *(inserter++) = result.second;
+    }
+  };
+
+  /*Finds the numResults items nearest to each of the points, with the queries running
+   * in parallel. The results of the i-th point are written to [i * numResults,
+   * (i + 1) * numResults) of the outputs, sorted by the distance to the item's box. When
+   * the tree has fewer items, the remaining slots get SIZE_MAX and FLT_MAX.*/
+  void queryNearestNBatch(const VecT* points,
+                          size_t      nPoints,
+                          size_t      numResults,
+                          size_t*     outIndices,
+                          float*      outDistances) const
+  {
+    if (numResults == 0) {
+      return;
+    }
+    tbb::enumerable_thread_specific<NearestScratch> scratches;
+    tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, nPoints), [&](const tbb::blocked_range<size_t>& r) {
+        NearestScratch& scratch = scratches.local();
+        for (size_t i = r.begin(); i < r.end(); i++) {
+          nearestN(points[i], numResults, scratch);
+          size_t* indices = outIndices + i * numResults;
+          float*  dists   = outDistances + i * numResults;
+          size_t  nFound  = scratch.results.size();
+          for (size_t j = 0; j < numResults; j++) {
+            indices[j] = j < nFound ? scratch.results[j].second : SIZE_MAX;
+            dists[j]   = j < nFound ? std::sqrt(scratch.results[j].first) : FLT_MAX;
+          }
+        }
+      });
+  };
+
+  /*Simultaneously traverses this tree and the other tree. The boxPred decides if a box
+   * from this tree and a box from the other tree need to be looked into. The itemFn is
+   * called with the indices of the pairs of items whose boxes pass the boxPred, and can
+   * return false to stop the traversal. Returns false if the traversal was stopped.*/
+  template<typename BoxPredFn, typename ItemFn>
+  bool traverseWith(const RTree& other, BoxPredFn boxPred, ItemFn itemFn) const
+  {
+    NodeRef a = rootRef();
+    NodeRef b = other.rootRef();
+    if (!a.valid() || !b.valid() || !boxPred(a.bounds, b.bounds)) {
+      return true;
+    }
+    return traverseNodes(other, a, b, boxPred, itemFn);
+  };
+
+  /*Same as traverseWith, but the pairs of subtrees are traversed in parallel, so the
+   * boxPred and itemFn must be safe to call concurrently.*/
+  template<typename BoxPredFn, typename ItemFn>
+  bool traverseWithParallel(const RTree& other, BoxPredFn boxPred, ItemFn itemFn) const
+  {
+    std::vector<std::pair<NodeRef, NodeRef>> pairs, next;
+    NodeRef                                  ra = rootRef();
+    NodeRef                                  rb = other.rootRef();
+    if (!ra.valid() || !rb.valid() || !boxPred(ra.bounds, rb.bounds)) {
+      return true;
+    }
+    pairs.emplace_back(ra, rb);
+    // Expand breadth first until there are enough pairs to keep all threads busy.
+    const size_t target = 64 * size_t(tbb::this_task_arena::max_concurrency());
+    bool         expanded = true;
+    while (expanded && pairs.size() < target) {
+      expanded = false;
+      next.clear();
+      for (const auto& [a, b] : pairs) {
+        if (isLeaf(a) && other.isLeaf(b)) {
+          next.emplace_back(a, b);
+          continue;
+        }
+        expanded = true;
+        forEachChildPair(
+          other, a, b, boxPred, [&next](const NodeRef& ca, const NodeRef& cb) {
+            next.emplace_back(ca, cb);
+            return true;
+          });
+      }
+      std::swap(pairs, next);
+    }
+    std::atomic<bool> stopped     = false;
+    auto              stoppableFn = [&](size_t i, size_t j) {
+      return !stopped.load(std::memory_order_relaxed) && itemFn(i, j);
+    };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, pairs.size()),
+                      [&](const tbb::blocked_range<size_t>& range) {
+                        for (size_t i = range.begin(); i < range.end(); i++) {
+                          if (stopped.load(std::memory_order_relaxed)) {
+                            return;
+                          }
+                          const auto& [a, b] = pairs[i];
+                          if (!traverseNodes(other, a, b, boxPred, stoppableFn)) {
+                            stopped = true;
+                          }
+                        }
+                      });
+    return !stopped;
+  };
+
+  /*Finds the smallest itemDistFn over all pairs of items from this tree and the other
+   * tree, with a branch and bound traversal. The boxDistFn must return a lower bound of
+   * the itemDistFn of any two items inside the given boxes. Pairs of subtrees are visited
+   * nearest first, and the search stops as soon as the distance reaches zero. Pairs that
+   * are not closer than the given bound are not looked into.*/
+  template<typename BoxDistFn, typename ItemDistFn>
+  float nearestPairWith(const RTree& other,
+                        BoxDistFn    boxDistFn,
+                        ItemDistFn   itemDistFn,
+                        float        bound = FLT_MAX) const
+  {
+    NodeRef a = rootRef();
+    NodeRef b = other.rootRef();
+    if (a.valid() && b.valid() && boxDistFn(a.bounds, b.bounds) < bound) {
+      nearestNodes(other, a, b, boxDistFn, itemDistFn, bound);
+    }
+    return bound;
   };
 
 private:
-  BoostTreeType mTree;
+  /*Built by the first refit and kept up to date by the later ones, so that a refit only
+   * visits the ancestors of the items that moved. Dropped when the tree is changed in any
+   * other way. The quality of the tree is tracked per treelet, which is a subtree of
+   * sTreeletHeight levels above the leaves.*/
+  struct RefitLinks
+  {
+    std::vector<std::pair<size_t, size_t>> parents;    // Parent and slot of each node.
+    std::vector<std::pair<size_t, size_t>> itemSlots;  // Leaf and slot of each item.
+    std::vector<float>  treeletCosts;  // Cost when built, negative for other nodes.
+    std::vector<size_t> stamps;        // Marks the nodes already visited by a refit.
+    size_t              generation    = 0;
+    size_t              treeletHeight = 0;
+    float               topCost       = 0.f;  // Cost of the levels above the treelets.
+  };
+
+  std::vector<Node> mNodes;  // The root is always the first node.
+  size_t            mNumItems = 0;
+  RefitLinks        mLinks;
+
+  friend struct gal::Serial<RTree>;
 
-  template<typename predicate_type, typename SizeTIter>
-  void query(predicate_type pred, SizeTIter inserter) const
+  /*Kept small because the packing moves the entries around a lot. The slot refers to
+   * the array of boxes being packed.*/
+  struct Entry
   {
-    for (auto i = mTree.qbegin(pred); i != mTree.qend(); i++) {
-      *(inserter++) = i->second;
+    VecT   center;
+    size_t slot;
+  };
+
+  struct NodeRef
+  {
+    size_t node = SIZE_MAX;
+    BoxT   bounds;
+
+    bool valid() const { return node != SIZE_MAX; };
+  };
+
+  /*Reused across queries by the same thread, so that the queries don't allocate.*/
+  struct NearestScratch
+  {
+    struct QueuedNode
+    {
+      float  dist;
+      size_t node;
+
+      bool operator<(const QueuedNode& other) const { return dist > other.dist; };
+    };
+    std::vector<QueuedNode>               queue;    // Min-heap of nodes to visit.
+    std::vector<std::pair<float, size_t>> results;  // Max-heap of squared distances.
+  };
+
+  /*Subtrees with more items than this are packed in parallel.*/
+  static constexpr size_t sParallelPackSize = size_t(1) << 14;
+  /*Height of the subtrees whose quality is tracked, and which are rebuilt when it
+   * degrades. Such a subtree holds at most a few thousand items.*/
+  static constexpr size_t sTreeletHeight = 2;
+  /*A treelet is rebuilt when its cost grows by more than this factor.*/
+  static constexpr float sRebuildRatio = 1.5f;
+
+  static Node emptyNode(bool leaf)
+  {
+    Node node;
+    for (int d = 0; d < Dim; d++) {
+      std::fill(node.mins[d], node.mins[d] + Width, FLT_MAX);
+      std::fill(node.maxs[d], node.maxs[d] + Width, -FLT_MAX);
     }
-  }
+    std::fill(node.children, node.children + Width, UINT64_MAX);
+    node.count = 0;
+    node.leaf  = leaf ? 1 : 0;
+    return node;
+  };
+
+  static void setChild(Node& node, size_t slot, const BoxT& b, uint64_t child)
+  {
+    for (int d = 0; d < Dim; d++) {
+      node.mins[d][slot] = b.min[d];
+      node.maxs[d][slot] = b.max[d];
+    }
+    node.children[slot] = child;
+  };
+
+  static BoxT childBox(const Node& node, size_t slot)
+  {
+    BoxT b;
+    for (int d = 0; d < Dim; d++) {
+      b.min[d] = node.mins[d][slot];
+      b.max[d] = node.maxs[d][slot];
+    }
+    return b;
+  };
+
+  BoxT nodeBounds(size_t node) const
+  {
+    const Node& nd = mNodes[node];
+    BoxT        b;
+    for (int d = 0; d < Dim; d++) {
+      b.min[d] = *std::min_element(nd.mins[d], nd.mins[d] + nd.count);
+      b.max[d] = *std::max_element(nd.maxs[d], nd.maxs[d] + nd.count);
+    }
+    return b;
+  };
 
-  // Because we created the specializations of these templates, we don't need
-  // definitions here.
-  static BoostPointT toBoost(const VecT&);
-  static VecT        fromBoost(const BoostPointT&);
+  bool isLeaf(const NodeRef& ref) const { return mNodes[ref.node].leaf; };
 
-  static BoxType toBoost(const BoxT& b)
+  NodeRef rootRef() const
   {
-    return BoxType(toBoost(b.min), toBoost(b.max));
+    return mNodes.empty() ? NodeRef() : NodeRef {0, nodeBounds(0)};
   };
-  static BoxT fromBoost(const BoxType& b)
+
+  /*Sets hits[i] to 1 for each child of the node that touches the box, and 0 for the
+   * rest. The loops have no branches so that they are vectorized.*/
+  static void overlaps(const Node& node, const BoxT& b, uint8_t (&hits)[Width])
   {
-    return BoxT(fromBoost(b.min_corner()), fromBoost(b.max_corner()));
+    std::fill(hits, hits + Width, uint8_t(1));
+    for (int d = 0; d < Dim; d++) {
+      const float  lo   = b.min[d];
+      const float  hi   = b.max[d];
+      const float* mins = node.mins[d];
+      const float* maxs = node.maxs[d];
+      for (size_t i = 0; i < Width; i++) {
+        hits[i] &= uint8_t(mins[i] <= hi) & uint8_t(maxs[i] >= lo);
+      }
+    }
+  };
+
+  /*Squared distances from the point to the boxes of all the children of the node.*/
+  static void sqDistances(const Node& node, const VecT& pt, float (&dists)[Width])
+  {
+    std::fill(dists, dists + Width, 0.f);
+    for (int d = 0; d < Dim; d++) {
+      const float  x    = pt[d];
+      const float* mins = node.mins[d];
+      const float* maxs = node.maxs[d];
+      for (size_t i = 0; i < Width; i++) {
+        float gap = std::max(std::max(mins[i] - x, x - maxs[i]), 0.f);
+        dists[i] += gap * gap;
+      }
+    }
+  };
+
+  template<typename SizeTIter>
+  void queryBox(size_t node, const BoxT& b, SizeTIter& inserter) const
+  {
+    const Node& nd = mNodes[node];
+    uint8_t     hits[Width];
+    overlaps(nd, b, hits);
+    for (size_t i = 0; i < nd.count; i++) {
+      if (!hits[i]) {
+        continue;
+      }
+      if (nd.leaf) {
+        *(inserter++) = size_t(nd.children[i]);
+      }
+      else {
+        queryBox(size_t(nd.children[i]), b, inserter);
+      }
+    }
+  };
+
+  template<typename SizeTIter>
+  void queryDistance(size_t node, const VecT& pt, float sqDist, SizeTIter& inserter) const
+  {
+    const Node& nd = mNodes[node];
+    float       dists[Width];
+    sqDistances(nd, pt, dists);
+    for (size_t i = 0; i < nd.count; i++) {
+      if (!(dists[i] < sqDist)) {
+        continue;
+      }
+      if (nd.leaf) {
+        *(inserter++) = size_t(nd.children[i]);
+      }
+      else {
+        queryDistance(size_t(nd.children[i]), pt, sqDist, inserter);
+      }
+    }
+  };
+
+  /*Best first search. Leaves the results in scratch sorted by distance.*/
+  void nearestN(const VecT& pt, size_t k, NearestScratch& scratch) const
+  {
+    auto& queue   = scratch.queue;
+    auto& results = scratch.results;
+    queue.clear();
+    results.clear();
+    if (mNodes.empty() || k == 0) {
+      return;
+    }
+    const auto worst = [&results, k]() {
+      return results.size() < k ? FLT_MAX : results.front().first;
+    };
+    float dists[Width];
+    queue.push_back({0.f, 0});
+    while (!queue.empty()) {
+      std::pop_heap(queue.begin(), queue.end());
+      auto node = queue.back();
+      queue.pop_back();
+      if (node.dist >= worst()) {
+        break;
+      }
+      const Node& nd = mNodes[node.node];
+      sqDistances(nd, pt, dists);
+      for (size_t i = 0; i < nd.count; i++) {
+        float d = dists[i];
+        if (!(d < worst())) {
+          continue;
+        }
+        if (nd.leaf) {
+          if (results.size() == k) {
+            std::pop_heap(results.begin(), results.end());
+            results.pop_back();
+          }
+          results.emplace_back(d, size_t(nd.children[i]));
+          std::push_heap(results.begin(), results.end());
+        }
+        else {
+          queue.push_back({d, size_t(nd.children[i])});
+          std::push_heap(queue.begin(), queue.end());
+        }
+      }
+    }
+    std::sort_heap(results.begin(), results.end());
+  };
+
+  static float boxSize(const BoxT& b)
+  {
+    auto d = b.diagonal();
+    return glm::dot(d, d);
+  };
+
+  static float boxVolume(const BoxT& b)
+  {
+    float v = 1.f;
+    for (int d = 0; d < Dim; d++) {
+      v *= b.max[d] - b.min[d];
+    }
+    return v;
+  };
+
+  /*The child whose box grows the least to include the given box, ties broken by the
+   * smaller box.*/
+  static size_t chooseChild(const Node& node, const BoxT& b)
+  {
+    size_t best       = 0;
+    float  bestGrowth = FLT_MAX;
+    float  bestVolume = FLT_MAX;
+    for (size_t i = 0; i < node.count; i++) {
+      BoxT  cbox   = childBox(node, i);
+      float volume = boxVolume(cbox);
+      for (int d = 0; d < Dim; d++) {
+        cbox.min[d] = std::min(cbox.min[d], b.min[d]);
+        cbox.max[d] = std::max(cbox.max[d], b.max[d]);
+      }
+      float growth = boxVolume(cbox) - volume;
+      if (growth < bestGrowth || (growth == bestGrowth && volume < bestVolume)) {
+        best       = i;
+        bestGrowth = growth;
+        bestVolume = volume;
+      }
+    }
+    return best;
+  };
+
+  /*Splits the full node and the extra child between the node and a new node, by sorting
+   * the children along the longest axis of their centers. Returns the new node.*/
+  size_t split(size_t node, const BoxT& extraBox, uint64_t extraChild)
+  {
+    BoxT     boxes[Width + 1];
+    uint64_t children[Width + 1];
+    Entry    entries[Width + 1];
+    for (size_t i = 0; i <= Width; i++) {
+      boxes[i]    = i < Width ? childBox(mNodes[node], i) : extraBox;
+      children[i] = i < Width ? mNodes[node].children[i] : extraChild;
+      entries[i]  = {boxes[i].center(), i};
+    }
+    size_t half = (Width + 1) / 2;
+    sortAlongLongestAxis(entries, entries + Width + 1, half);
+    size_t sibling = mNodes.size();
+    mNodes.push_back(emptyNode(mNodes[node].leaf));
+    Node fresh = emptyNode(mNodes[node].leaf);
+    for (size_t i = 0; i <= Width; i++) {
+      Node&  dst  = i < half ? fresh : mNodes[sibling];
+      size_t slot = entries[i].slot;
+      setChild(dst, dst.count++, boxes[slot], children[slot]);
+    }
+    mNodes[node] = fresh;
+    return sibling;
+  };
+
+  /*Partially sorts the entries along the longest axis of the box of their centers, so
+   * that the entries before mid are not greater than the ones after.*/
+  static void sortAlongLongestAxis(Entry* begin, Entry* end, size_t mid)
+  {
+    VecT lo = begin->center;
+    VecT hi = begin->center;
+    for (const Entry* e = begin; e != end; e++) {
+      lo = glm::min(lo, e->center);
+      hi = glm::max(hi, e->center);
+    }
+    int axis = 0;
+    for (int d = 1; d < Dim; d++) {
+      if (hi[d] - lo[d] > hi[axis] - lo[axis]) {
+        axis = d;
+      }
+    }
+    std::nth_element(begin, begin + mid, end, [axis](const Entry& a, const Entry& b) {
+      return a.center[axis] < b.center[axis];
+    });
+  };
+
+  /*Number of nodes needed to pack n items into a subtree of the given height, when the
+   * items are split into groups that fill all but the last child.*/
+  static size_t countNodes(size_t n, size_t height)
+  {
+    if (height == 0) {
+      return 1;
+    }
+    size_t childCap = capacity(height - 1);
+    size_t nFull    = (n - 1) / childCap;
+    return 1 + nFull * countNodes(childCap, height - 1) +
+           countNodes(n - nFull * childCap, height - 1);
+  };
+
+  /*Number of items in a full subtree of the given height.*/
+  static size_t capacity(size_t height)
+  {
+    size_t cap = Width;
+    while (height-- > 0) {
+      cap *= Width;
+    }
+    return cap;
+  };
+
+  /*Top down packing. The items are recursively split along the longest axis into groups
+   * that fill whole subtrees, so all the nodes except the last one on each level are
+   * full. The nodes are laid out in depth first order. The items are the indices of the
+   * boxes, and are the positions of the boxes when empty. The tree is made taller than
+   * needed if the minHeight asks for it.*/
+  void pack(const std::vector<BoxT>&   boxes,
+            const std::vector<size_t>& items,
+            size_t                     minHeight = 0)
+  {
+    size_t n  = boxes.size();
+    mNumItems = n;
+    mNodes.clear();
+    mLinks = RefitLinks();
+    if (n == 0) {
+      return;
+    }
+    std::vector<Entry> entries(n);
+    tbb::parallel_for(
+      size_t(0), n, [&](size_t i) { entries[i] = {boxes[i].center(), i}; });
+    size_t height = minHeight;
+    while (capacity(height) < n) {
+      height++;
+    }
+    mNodes.resize(countNodes(n, height));
+    packNode(0,
+             height,
+             entries.data(),
+             entries.data() + n,
+             boxes.data(),
+             items.empty() ? nullptr : items.data());
+  };
+
+  void packNode(size_t        node,
+                size_t        height,
+                Entry*        begin,
+                Entry*        end,
+                const BoxT*   boxes,
+                const size_t* items)
+  {
+    size_t n     = size_t(end - begin);
+    mNodes[node] = emptyNode(height == 0);
+    if (height == 0) {
+      Node& nd = mNodes[node];
+      for (const Entry* e = begin; e != end; e++) {
+        setChild(nd, nd.count++, boxes[e->slot], items ? items[e->slot] : e->slot);
+      }
+      return;
+    }
+    size_t childCap = capacity(height - 1);
+    size_t nChildren = (n + childCap - 1) / childCap;
+    size_t fullSize  = countNodes(childCap, height - 1);
+    partition(begin, end, childCap);
+    const auto packChild = [&](size_t ci) {
+      packNode(node + 1 + ci * fullSize,
+               height - 1,
+               begin + ci * childCap,
+               std::min(end, begin + (ci + 1) * childCap),
+               boxes,
+               items);
+    };
+    if (n > sParallelPackSize) {
+      tbb::parallel_for(size_t(0), nChildren, packChild);
+    }
+    else {
+      for (size_t ci = 0; ci < nChildren; ci++) {
+        packChild(ci);
+      }
+    }
+    for (size_t ci = 0; ci < nChildren; ci++) {
+      size_t child = node + 1 + ci * fullSize;
+      setChild(mNodes[node], mNodes[node].count++, nodeBounds(child), child);
+    }
+  };
+
+  /*Reorders the entries so that consecutive groups of the given size are spatially
+   * coherent, by recursively bisecting them at group boundaries.*/
+  static void partition(Entry* begin, Entry* end, size_t groupSize)
+  {
+    size_t n       = size_t(end - begin);
+    size_t nGroups = (n + groupSize - 1) / groupSize;
+    if (nGroups < 2) {
+      return;
+    }
+    size_t mid = (nGroups / 2) * groupSize;
+    sortAlongLongestAxis(begin, end, mid);
+    if (n > sParallelPackSize) {
+      tbb::parallel_invoke([&] { partition(begin, begin + mid, groupSize); },
+                           [&] { partition(begin + mid, end, groupSize); });
+    }
+    else {
+      partition(begin, begin + mid, groupSize);
+      partition(begin + mid, end, groupSize);
+    }
+  };
+
+  static float surfaceArea(const BoxT& b)
+  {
+    auto d = b.max - b.min;
+    if constexpr (Dim == 3) {
+      return 2.f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+    }
+    else {
+      return 2.f * (d[0] + d[1]);
+    }
+  };
+
+  /*Sum of the surface areas of all the boxes in the subtree, relative to the area of
+   * the subtree. This is the expected number of boxes a query tests in the subtree.*/
+  float sahCost(size_t node) const
+  {
+    float total = sahArea(node);
+    return total / std::max(surfaceArea(nodeBounds(node)), FLT_MIN);
+  };
+
+  float sahArea(size_t node) const
+  {
+    const Node& nd    = mNodes[node];
+    float       total = 0.f;
+    for (size_t i = 0; i < nd.count; i++) {
+      total += surfaceArea(childBox(nd, i));
+      if (!nd.leaf) {
+        total += sahArea(size_t(nd.children[i]));
+      }
+    }
+    return total;
+  };
+
+  /*Cost of the part of the tree above the treelets.*/
+  float topCost(size_t node) const
+  {
+    return topArea(node) / std::max(surfaceArea(nodeBounds(node)), FLT_MIN);
+  };
+
+  float topArea(size_t node) const
+  {
+    if (mLinks.treeletCosts[node] >= 0.f) {
+      return 0.f;
+    }
+    const Node& nd    = mNodes[node];
+    float       total = 0.f;
+    for (size_t i = 0; i < nd.count; i++) {
+      total += surfaceArea(childBox(nd, i)) + topArea(size_t(nd.children[i]));
+    }
+    return total;
+  };
+
+  /*Builds the links used by refit, and records the costs of the treelets as they are
+   * now.*/
+  void linkNodes()
+  {
+    RefitLinks& links = mLinks;
+    links.parents.assign(mNodes.size(), {SIZE_MAX, SIZE_MAX});
+    links.treeletCosts.assign(mNodes.size(), -1.f);
+    links.stamps.assign(mNodes.size(), 0);
+    links.generation = 0;
+    links.itemSlots.clear();
+    // All the leaves are at the same depth.
+    size_t height = 0;
+    for (size_t node = 0; !mNodes[node].leaf; node = size_t(mNodes[node].children[0])) {
+      height++;
+    }
+    links.treeletHeight = std::min(height, sTreeletHeight);
+    linkNode(0, height);
+    links.topCost = topCost(0);
+  };
+
+  void linkNode(size_t node, size_t height)
+  {
+    const Node& nd = mNodes[node];
+    if (height == mLinks.treeletHeight) {
+      mLinks.treeletCosts[node] = sahCost(node);
+    }
+    for (size_t i = 0; i < nd.count; i++) {
+      size_t child = size_t(nd.children[i]);
+      if (nd.leaf) {
+        if (child >= mLinks.itemSlots.size()) {
+          mLinks.itemSlots.resize(child + 1, {SIZE_MAX, SIZE_MAX});
+        }
+        mLinks.itemSlots[child] = {node, i};
+      }
+      else {
+        mLinks.parents[child] = {node, i};
+        linkNode(child, height - 1);
+      }
+    }
+  };
+
+  /*Refits the boxes of the ancestors of the node, stopping at the first one that
+   * doesn't change.*/
+  void refitAncestors(size_t node)
+  {
+    while (node != 0) {
+      auto [parent, slot] = mLinks.parents[node];
+      BoxT b              = nodeBounds(node);
+      BoxT old            = childBox(mNodes[parent], slot);
+      if (b.min == old.min && b.max == old.max) {
+        return;
+      }
+      setChild(mNodes[parent], slot, b, node);
+      node = parent;
+    }
+  };
+
+  /*Refits all the boxes in the subtree from its leaves up, and returns its bounds.*/
+  BoxT refitNode(size_t node)
+  {
+    Node& nd = mNodes[node];
+    if (!nd.leaf) {
+      const auto refitChild = [&](size_t i) {
+        setChild(nd, i, refitNode(size_t(nd.children[i])), nd.children[i]);
+      };
+      if (node == 0) {
+        tbb::parallel_for(size_t(0), size_t(nd.count), refitChild);
+      }
+      else {
+        for (size_t i = 0; i < nd.count; i++) {
+          refitChild(i);
+        }
+      }
+    }
+    return nodeBounds(node);
+  };
+
+  /*Repacks the items of the treelet, keeping its height. The new nodes take the places
+   * of the old nodes in the node array, so the treelet root keeps its index. The old
+   * nodes that are left over are appended to freed.*/
+  void rebuildTreelet(size_t root, std::vector<size_t>& freed)
+  {
+    std::vector<size_t> old;
+    std::vector<BoxT>   boxes;
+    std::vector<size_t> items;
+    collectSubtree(root, old, boxes, items);
+    RTree sub;
+    sub.pack(boxes, items, mLinks.treeletHeight);
+    std::vector<size_t> target(sub.mNodes.size());
+    for (size_t i = 0; i < target.size(); i++) {
+      target[i] = i < old.size() ? old[i] : mNodes.size() + (i - old.size());
+    }
+    if (target.size() > old.size()) {
+      size_t total = mNodes.size() + target.size() - old.size();
+      mNodes.resize(total);
+      mLinks.parents.resize(total);
+      mLinks.treeletCosts.resize(total);
+      mLinks.stamps.resize(total, 0);
+    }
+    for (size_t i = 0; i < target.size(); i++) {
+      Node   nd   = sub.mNodes[i];
+      size_t node = target[i];
+      for (size_t j = 0; j < nd.count; j++) {
+        if (nd.leaf) {
+          mLinks.itemSlots[size_t(nd.children[j])] = {node, j};
+        }
+        else {
+          nd.children[j]                         = target[size_t(nd.children[j])];
+          mLinks.parents[size_t(nd.children[j])] = {node, j};
+        }
+      }
+      mNodes[node]              = nd;
+      mLinks.treeletCosts[node] = -1.f;
+    }
+    mLinks.treeletCosts[root] = sahCost(root);
+    if (target.size() < old.size()) {
+      freed.insert(freed.end(), old.begin() + target.size(), old.end());
+    }
+  };
+
+  /*Collects the nodes of the subtree in depth first order, and its items.*/
+  void collectSubtree(size_t               node,
+                      std::vector<size_t>& nodes,
+                      std::vector<BoxT>&   boxes,
+                      std::vector<size_t>& items) const
+  {
+    nodes.push_back(node);
+    const Node& nd = mNodes[node];
+    for (size_t i = 0; i < nd.count; i++) {
+      if (nd.leaf) {
+        boxes.push_back(childBox(nd, i));
+        items.push_back(size_t(nd.children[i]));
+      }
+      else {
+        collectSubtree(size_t(nd.children[i]), nodes, boxes, items);
+      }
+    }
+  };
+
+  /*Removes the nodes, which must not be referenced anymore, by moving the nodes from the
+   * back of the array into the holes.*/
+  void releaseNodes(std::vector<size_t> holes)
+  {
+    std::vector<bool> dead(mNodes.size(), false);
+    for (size_t h : holes) {
+      dead[h] = true;
+    }
+    std::sort(holes.begin(), holes.end());
+    for (size_t h : holes) {
+      while (!mNodes.empty() && dead[mNodes.size() - 1]) {
+        popNode();
+      }
+      if (h >= mNodes.size()) {
+        break;
+      }
+      size_t last                   = mNodes.size() - 1;
+      auto [parent, slot]           = mLinks.parents[last];
+      mNodes[h]                     = mNodes[last];
+      mLinks.parents[h]             = mLinks.parents[last];
+      mLinks.treeletCosts[h]        = mLinks.treeletCosts[last];
+      mLinks.stamps[h]              = mLinks.stamps[last];
+      mNodes[parent].children[slot] = h;
+      const Node& nd                = mNodes[h];
+      for (size_t i = 0; i < nd.count; i++) {
+        if (nd.leaf) {
+          mLinks.itemSlots[size_t(nd.children[i])].first = h;
+        }
+        else {
+          mLinks.parents[size_t(nd.children[i])].first = h;
+        }
+      }
+      dead[h] = false;
+      popNode();
+    }
+  };
+
+  void popNode()
+  {
+    mNodes.pop_back();
+    mLinks.parents.pop_back();
+    mLinks.treeletCosts.pop_back();
+    mLinks.stamps.pop_back();
+  };
+
+  /*Calls fn with the pairs of children obtained by descending into the bigger of the
+   * two nodes, unless that node is a leaf. The pairs that fail the boxPred are skipped.*/
+  template<typename BoxPredFn, typename Fn>
+  bool forEachChildPair(const RTree&   other,
+                        const NodeRef& a,
+                        const NodeRef& b,
+                        BoxPredFn&     boxPred,
+                        Fn             fn) const
+  {
+    if (other.isLeaf(b) || (!isLeaf(a) && boxSize(a.bounds) >= boxSize(b.bounds))) {
+      const Node& na = mNodes[a.node];
+      for (size_t i = 0; i < na.count; i++) {
+        BoxT cbox = childBox(na, i);
+        if (boxPred(cbox, b.bounds) && !fn(NodeRef {size_t(na.children[i]), cbox}, b)) {
+          return false;
+        }
+      }
+    }
+    else {
+      const Node& nb = other.mNodes[b.node];
+      for (size_t i = 0; i < nb.count; i++) {
+        BoxT cbox = childBox(nb, i);
+        if (boxPred(a.bounds, cbox) && !fn(a, NodeRef {size_t(nb.children[i]), cbox})) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  template<typename BoxPredFn, typename ItemFn>
+  bool traverseNodes(const RTree&   other,
+                     const NodeRef& a,
+                     const NodeRef& b,
+                     BoxPredFn&     boxPred,
+                     ItemFn&        itemFn) const
+  {
+    if (isLeaf(a) && other.isLeaf(b)) {
+      const Node& na = mNodes[a.node];
+      const Node& nb = other.mNodes[b.node];
+      for (size_t i = 0; i < na.count; i++) {
+        BoxT abox = childBox(na, i);
+        if (!boxPred(abox, b.bounds)) {
+          continue;
+        }
+        for (size_t j = 0; j < nb.count; j++) {
+          if (boxPred(abox, childBox(nb, j)) &&
+              !itemFn(size_t(na.children[i]), size_t(nb.children[j]))) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+    return forEachChildPair(
+      other, a, b, boxPred, [&](const NodeRef& ca, const NodeRef& cb) {
+        return traverseNodes(other, ca, cb, boxPred, itemFn);
+      });
+  };
+
+  template<typename FilterFn>
+  void collectItems(size_t               node,
+                    const BoxT&          bounds,
+                    FilterFn&            filter,
+                    std::vector<BoxT>&   boxes,
+                    std::vector<size_t>& items) const
+  {
+    const Node& nd = mNodes[node];
+    uint8_t     hits[Width];
+    overlaps(nd, bounds, hits);
+    for (size_t i = 0; i < nd.count; i++) {
+      if (!hits[i]) {
+        continue;
+      }
+      if (nd.leaf) {
+        size_t index = filter(size_t(nd.children[i]));
+        if (index != SIZE_MAX) {
+          boxes.push_back(childBox(nd, i));
+          items.push_back(index);
+        }
+      }
+      else {
+        collectItems(size_t(nd.children[i]), bounds, filter, boxes, items);
+      }
+    }
+  };
+
+  template<typename BoxDistFn, typename ItemDistFn>
+  void nearestNodes(const RTree&   other,
+                    const NodeRef& a,
+                    const NodeRef& b,
+                    BoxDistFn&     boxDistFn,
+                    ItemDistFn&    itemDistFn,
+                    float&         best) const
+  {
+    if (isLeaf(a) && other.isLeaf(b)) {
+      const Node& na = mNodes[a.node];
+      const Node& nb = other.mNodes[b.node];
+      for (size_t i = 0; i < na.count; i++) {
+        BoxT abox = childBox(na, i);
+        if (!(boxDistFn(abox, b.bounds) < best)) {
+          continue;
+        }
+        for (size_t j = 0; j < nb.count; j++) {
+          if (boxDistFn(abox, childBox(nb, j)) < best) {
+            best = std::min(
+              best, itemDistFn(size_t(na.children[i]), size_t(nb.children[j])));
+            if (best <= 0.f) {
+              return;
+            }
+          }
+        }
+      }
+      return;
+    }
+    struct Candidate
+    {
+      float   dist;
+      NodeRef a, b;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(Width);
+    // The pred records the distance and the fn, which is called right after, fills in
+    // the nodes.
+    auto pred = [&](const BoxT& ba, const BoxT& bb) {
+      float dist = boxDistFn(ba, bb);
+      if (dist < best) {
+        candidates.push_back({dist, NodeRef(), NodeRef()});
+        return true;
+      }
+      return false;
+    };
+    forEachChildPair(
+      other, a, b, pred, [&candidates](const NodeRef& ca, const NodeRef& cb) {
+        candidates.back().a = ca;
+        candidates.back().b = cb;
+        return true;
+      });
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const Candidate& x, const Candidate& y) { return x.dist < y.dist; });
+    for (const Candidate& c : candidates) {
+      // The bound may have tightened since the candidate was collected.
+      if (!(c.dist < best)) {
+        return;
+      }
+      nearestNodes(other, c.a, c.b, boxDistFn, itemDistFn, best);
+      if (best <= 0.f) {
+        return;
+      }
+    }
   };
 
 public:
-  void clear() { mTree.clear(); };
+  void clear()
+  {
+    mNodes.clear();
+    mNumItems = 0;
+    mLinks    = RefitLinks();
+  };
 };
 
-template class RTree<bgm::point<float, 2, bg::cs::cartesian>, glm::vec2, gal::Box2>;
-typedef RTree<bgm::point<float, 2, bg::cs::cartesian>, glm::vec2, gal::Box2> RTree2d;
-template class RTree<bgm::point<float, 3, bg::cs::cartesian>, glm::vec3, gal::Box3>;
-typedef RTree<bgm::point<float, 3, bg::cs::cartesian>, glm::vec3, gal::Box3> RTree3d;
+typedef RTree<glm::vec2, gal::Box2> RTree2d;
+typedef RTree<glm::vec3, gal::Box3> RTree3d;
 
-template<>
-RTree2d::PointType RTree2d::toBoost(const glm::vec2&);
+namespace gal {
 
-template<>
-glm::vec2 RTree2d::fromBoost(const PointType&);
+/*The nodes are written as they are in memory, in the native byte order, so reading a
+ * tree is a single copy with nothing to rebuild. The version and the counts come first,
+ * so that a tree written with a different node layout can be skipped. Such a tree, or one
+ * whose nodes don't form a valid tree of its items, is read as an empty tree, which the
+ * caller can detect by its size and rebuild. Trees of the first version didn't write the
+ * counts first, so the rest of the bytes are skipped.*/
+template<typename VecT, typename BoxT>
+struct Serial<RTree<VecT, BoxT>> : public std::true_type
+{
+  using TreeT = RTree<VecT, BoxT>;
+  using NodeT = typename TreeT::Node;
+
+  static TreeT deserialize(Bytes& bytes)
+  {
+    uint32_t version;
+    bytes >> version;
+    if (version < 2) {
+      bytes.skip(bytes.remaining());
+      return TreeT();
+    }
+    uint64_t nItems, nNodes;
+    uint32_t dim, width, nodeSize;
+    bytes >> nItems >> nNodes >> dim >> width >> nodeSize;
+    if (nodeSize == 0 || nNodes > bytes.remaining() / nodeSize) {
+      bytes.skip(bytes.remaining());
+      return TreeT();
+    }
+    if (version != TreeT::FormatVersion || dim != uint32_t(TreeT::Dim) ||
+        width != uint32_t(TreeT::Width) || nodeSize != uint32_t(sizeof(NodeT)) ||
+        nItems > nNodes * TreeT::Width) {
+      bytes.skip(size_t(nNodes) * nodeSize);
+      return TreeT();
+    }
+    TreeT tree;
+    tree.mNumItems = size_t(nItems);
+    tree.mNodes.resize(size_t(nNodes));
+    bytes.readBytes(tree.mNodes.size() * sizeof(NodeT), (char*)tree.mNodes.data());
+    return isValid(tree) ? tree : TreeT();
+  }
+
+  static Bytes serialize(const TreeT& tree)
+  {
+    Bytes bytes;
+    bytes << TreeT::FormatVersion << uint64_t(tree.mNumItems)
+          << uint64_t(tree.mNodes.size()) << uint32_t(TreeT::Dim)
+          << uint32_t(TreeT::Width) << uint32_t(sizeof(NodeT));
+    bytes.writeBytes((const char*)tree.mNodes.data(),
+                     tree.mNodes.size() * sizeof(NodeT));
+    return bytes;
+  }
 
-template<>
-RTree3d::PointType RTree3d::toBoost(const glm::vec3&);
+private:
+  /*Whether every node reachable from the root is reached once, every child index is in
+   * range, and every item is in exactly one leaf. Nodes that can't be reached are
+   * ignored.*/
+  static bool isValid(const TreeT& tree)
+  {
+    const std::vector<NodeT>& nodes = tree.mNodes;
+    if (nodes.empty()) {
+      return tree.mNumItems == 0;
+    }
+    std::vector<uint8_t> seenNodes(nodes.size(), 0), seenItems(tree.mNumItems, 0);
+    std::vector<size_t>  stack = {0};
+    size_t               nItems = 0;
+    seenNodes[0]                = 1;
+    while (!stack.empty()) {
+      const NodeT& nd = nodes[stack.back()];
+      stack.pop_back();
+      if (nd.count > TreeT::Width) {
+        return false;
+      }
+      for (size_t i = 0; i < nd.count; i++) {
+        uint64_t child = nd.children[i];
+        if (nd.leaf) {
+          if (child >= seenItems.size() || seenItems[child]) {
+            return false;
+          }
+          seenItems[child] = 1;
+          nItems++;
+        }
+        else {
+          if (child >= nodes.size() || seenNodes[child]) {
+            return false;
+          }
+          seenNodes[child] = 1;
+          stack.push_back(size_t(child));
+        }
+      }
+    }
+    return nItems == tree.mNumItems;
+  }
+};
 
-template<>
-glm::vec3 RTree3d::fromBoost(const PointType&);
\ No newline at end of file
+}  // namespace gal
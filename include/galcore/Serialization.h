@@ -47,6 +47,8 @@ private:
 
 public:
   uint32_t version() const noexcept;
+  /*Number of bytes left to read.*/
+  size_t   remaining() const noexcept;
 
   void saveToFile(const fs::path& path) const;
 
@@ -78,6 +80,9 @@ public:
 
   Bytes& readBytes(size_t nBytes, char* dst);
 
+  /*Moves past the given number of bytes without reading them.*/
+  Bytes& skip(size_t nBytes);
+
   Bytes& writeNested(Bytes nested);
 
   Bytes& readNested(Bytes& nested);
@@ -122,8 +127,14 @@ struct Serial<std::vector<T>> : public std::true_type
     uint64_t size;
     bytes >> size;
     std::vector<T> v(size);
-    for (auto& e : v) {
-      bytes >> e;
+    if constexpr (IsValueType<T>::value && !std::is_same_v<T, bool>) {
+      // Same layout as reading the elements one by one, but in a single copy.
+      bytes.readBytes(size * sizeof(T), (char*)v.data());
+    }
+    else {
+      for (auto& e : v) {
+        bytes >> e;
+      }
     }
     return v;
   }
@@ -131,8 +142,13 @@ struct Serial<std::vector<T>> : public std::true_type
   {
     Bytes bytes;
     bytes << data.size();
-    for (const auto& d : data) {
-      bytes << d;
+    if constexpr (IsValueType<T>::value && !std::is_same_v<T, bool>) {
+      bytes.writeBytes((const char*)data.data(), data.size() * sizeof(T));
+    }
+    else {
+      for (const auto& d : data) {
+        bytes << d;
+      }
     }
     return bytes;
   }
@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+namespace gal {
+
+/*Sparse LDL^T factorization of a symmetric positive definite matrix (up-looking
+ * algorithm from Davis' LDL package). The matrix is factorized once, after which any
+ * number of right hand sides can be solved with a forward and a backward substitution.*/
+class SparseLDLT
+{
+public:
+  struct Entry
+  {
+    size_t row, col;
+    double value;
+  };
+
+  SparseLDLT() = default;
+  /*Each off-diagonal entry is given once, from either triangle of the matrix, and
+   * duplicate entries are summed. The permutation maps the new order to the original
+   * indices, and should be chosen to reduce the fill-in. An empty permutation keeps the
+   * original order.*/
+  SparseLDLT(size_t                     n,
+             const std::vector<Entry>&  entries,
+             const std::vector<size_t>& permutation = {});
+
+  size_t size() const;
+  /*False if the matrix turned out to not be positive definite.*/
+  bool   valid() const;
+  size_t numNonZeros() const;
+  /*Solves the system in place.*/
+  void solve(double* x) const;
+
+private:
+  size_t              mSize  = 0;
+  bool                mValid = false;
+  std::vector<size_t> mPerm;
+  std::vector<size_t> mColStarts;  // Columns of the strictly lower triangle of L.
+  std::vector<size_t> mRows;
+  std::vector<double> mValues;
+  std::vector<double> mDiag;
+};
+
+}  // namespace gal
@@ -21,6 +21,7 @@ struct Sphere
                                    const glm::vec3& c,
                                    const glm::vec3& d);
   static Sphere createFromDiameter(const glm::vec3& a, const glm::vec3& b);
+  static Sphere minBoundingSphere(const glm::vec3* points, size_t nPoints);
   static Sphere minBoundingSphere(const std::vector<glm::vec3>& points);
 };
 
@@ -4,9 +4,12 @@
 #include <galcore/Box.h>
 #include <galcore/Circle2d.h>
 #include <galcore/Mesh.h>
+#include <galcore/OrientedBox3.h>
 #include <galcore/Plane.h>
 #include <galcore/PointCloud.h>
 #include <galcore/Sphere.h>
+#include <galcore/Voronoi.h>
+#include <galcore/VoxelGrid.h>
 
 namespace gal {
 template<typename T>
@@ -60,3 +63,7 @@ GAL_TYPE_INFO(gal::PointCloud, 0xe6e934eb);
 GAL_TYPE_INFO(gal::Circle2d, 0X3271dc29);
 GAL_TYPE_INFO(gal::Mesh, 0x45342367);
 GAL_TYPE_INFO(gal::Annotations, 0x901da902);
+GAL_TYPE_INFO(gal::VoxelGrid, 0x7c3e5a14);
+GAL_TYPE_INFO(gal::Voronoi2, 0x3a9d5e72);
+GAL_TYPE_INFO(gal::Voronoi3, 0xc6b21f08);
+GAL_TYPE_INFO(gal::OrientedBox3, 0x5f0e83b9);
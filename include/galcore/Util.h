@@ -92,6 +92,10 @@ bool barycentricWithinBounds(float const (&coords)[3]);
 
 glm::vec3 barycentricEvaluate(float const (&coords)[3], glm::vec3 const (&pts)[3]);
 
+/*Eigen decomposition of a symmetric 3x3 matrix with cyclic Jacobi rotations. The
+ * columns of vectors are the unit eigenvectors, in the order of the values.*/
+void eigenSymmetric(const glm::dmat3& mat, glm::dvec3& values, glm::dmat3& vectors);
+
 template<typename TIter>
 glm::vec3 average(TIter begin, TIter end)
 {
@@ -0,0 +1,70 @@
+#pragma once
+#include <galcore/Delaunay2.h>
+#include <galcore/Delaunay3.h>
+#include <galcore/Mesh.h>
+
+namespace gal {
+
+/*Voronoi cells of the points of a Delaunay triangulation, built from the dual: the
+ * corners of the cell of a site are the circumcenters of the triangles around it, and
+ * each circumcenter is computed once, so neighboring cells share their corners exactly.
+ * The cells of the sites on the convex hull are unbounded. Without bounds they are left
+ * empty. With bounds they are clipped out of the box by the bisectors between the site
+ * and its neighbors, and the other cells are clipped to the box. The cells are computed
+ * in parallel and stored back to back.*/
+class Voronoi2
+{
+  std::vector<glm::vec2> mSites;
+  std::vector<glm::vec2> mVertices;     // Corners of all the cells, counter-clockwise.
+  std::vector<size_t>    mCellOffsets;  // Corners of each cell.
+
+  void compute(const Delaunay2& triangulation, const Box2* bounds);
+
+public:
+  explicit Voronoi2(const Delaunay2& triangulation);
+  /*Clips all the cells to the box.*/
+  Voronoi2(const Delaunay2& triangulation, const Box2& bounds);
+
+  size_t                        numCells() const;
+  const glm::vec2&              site(size_t ci) const;
+  std::vector<glm::vec2>        cell(size_t ci) const;
+  float                         cellArea(size_t ci) const;
+  const std::vector<glm::vec2>& vertices() const;
+  /*The edges of all the cells, as pairs of indices of vertices.*/
+  std::vector<IndexPair> edges() const;
+};
+
+/*Voronoi cells of the points of a Delaunay tetrahedralization, as convex polyhedra. The
+ * face between two cells is the ring of circumcenters of the tetrahedra around the edge
+ * between their sites. See Voronoi2.*/
+class Voronoi3
+{
+  std::vector<glm::vec3> mSites;
+  std::vector<glm::vec3> mVertices;
+  std::vector<size_t>    mVertexOffsets;  // Vertices of each cell.
+  std::vector<size_t>    mCorners;        // Corners of the faces, counter-clockwise.
+  std::vector<size_t>    mFaceOffsets;    // Corners of each face.
+  std::vector<size_t>    mFaceNeighbor;   // The site across each face, or SIZE_MAX.
+  std::vector<size_t>    mCellOffsets;    // Faces of each cell.
+
+  void compute(const Delaunay3& tetrahedralization, const Box3* bounds);
+
+public:
+  explicit Voronoi3(const Delaunay3& tetrahedralization);
+  /*Clips all the cells to the box.*/
+  Voronoi3(const Delaunay3& tetrahedralization, const Box3& bounds);
+
+  size_t           numCells() const;
+  const glm::vec3& site(size_t ci) const;
+  size_t           numFaces(size_t ci) const;
+  /*The site on the other side of the fi-th face of the cell, or SIZE_MAX if the face is
+   * on the bounds.*/
+  size_t                        faceNeighbor(size_t ci, size_t fi) const;
+  Mesh                          cellMesh(size_t ci) const;
+  float                         cellVolume(size_t ci) const;
+  const std::vector<glm::vec3>& vertices() const;
+  /*The edges of all the cells, as pairs of indices of vertices.*/
+  std::vector<IndexPair> edges() const;
+};
+
+}  // namespace gal
@@ -0,0 +1,101 @@
+#pragma once
+#include <galcore/Box.h>
+#include <galcore/Serialization.h>
+#include <galcore/Util.h>
+#include <stdint.h>
+#include <vector>
+
+namespace gal {
+
+/*Dense occupancy grid with one bit per voxel. The bits of every row along the x axis
+ * are packed into 64 bit words, and every row starts at a new word. This way a row (and
+ * hence a whole xy-layer) can be written by a thread without synchronization.*/
+class VoxelGrid
+{
+public:
+  VoxelGrid() = default;
+  VoxelGrid(const glm::vec3& origin, float voxelSize, size_t nx, size_t ny, size_t nz);
+  VoxelGrid(const Box3& bounds, float voxelSize);
+
+  const glm::vec3& origin() const noexcept;
+  float            voxelSize() const noexcept;
+  size_t           numX() const noexcept;
+  size_t           numY() const noexcept;
+  size_t           numZ() const noexcept;
+  size_t           numVoxels() const noexcept;
+  size_t           numOccupied() const;
+  Box3             bounds() const;
+  Box3             voxelBounds(size_t x, size_t y, size_t z) const;
+  glm::vec3        voxelCenter(size_t x, size_t y, size_t z) const;
+  bool voxelIndices(const glm::vec3& pt, size_t& x, size_t& y, size_t& z) const;
+
+  bool get(size_t x, size_t y, size_t z) const;
+  void set(size_t x, size_t y, size_t z, bool occupied = true);
+  /*Marks the voxels [xbegin, xend) in the given row as occupied.*/
+  void fillRow(size_t y, size_t z, size_t xbegin, size_t xend);
+  /*Voxel that is occupied and has at least one empty face-neighbor.*/
+  bool isExposed(size_t x, size_t y, size_t z) const;
+  void unite(const VoxelGrid& other);
+  void clear();
+
+  template<typename Fn>
+  void forEachOccupied(Fn fn) const
+  {
+    for (size_t z = 0; z < mNz; z++) {
+      for (size_t y = 0; y < mNy; y++) {
+        const uint64_t* row = rowWords(y, z);
+        for (size_t wi = 0; wi < mRowWords; wi++) {
+          uint64_t word = row[wi];
+          while (word) {
+            size_t x = wi * 64 + size_t(__builtin_ctzll(word));
+            fn(x, y, z);
+            word &= word - 1;
+          }
+        }
+      }
+    }
+  }
+
+  uint64_t*       rowWords(size_t y, size_t z);
+  const uint64_t* rowWords(size_t y, size_t z) const;
+
+  const std::vector<uint64_t>& words() const;
+
+private:
+  glm::vec3             mOrigin    = vec3_zero;
+  float                 mVoxelSize = 1.f;
+  size_t                mNx = 0, mNy = 0, mNz = 0;
+  size_t                mRowWords  = 0;
+  std::vector<uint64_t> mWords;
+
+  size_t wordIndex(size_t x, size_t y, size_t z) const;
+
+  friend struct Serial<VoxelGrid>;
+};
+
+template<>
+struct Serial<VoxelGrid> : public std::true_type
+{
+  static VoxelGrid deserialize(Bytes& bytes)
+  {
+    glm::vec3 origin;
+    float     size;
+    uint64_t  nx, ny, nz;
+    bytes >> origin >> size >> nx >> ny >> nz;
+    VoxelGrid grid(origin, size, size_t(nx), size_t(ny), size_t(nz));
+    bytes.readBytes(grid.mWords.size() * sizeof(uint64_t), (char*)grid.mWords.data());
+    return grid;
+  }
+
+  static Bytes serialize(const VoxelGrid& grid)
+  {
+    Bytes bytes;
+    bytes << grid.mOrigin << grid.mVoxelSize << uint64_t(grid.mNx) << uint64_t(grid.mNy)
+          << uint64_t(grid.mNz);
+    bytes.writeBytes((const char*)grid.mWords.data(),
+                     grid.mWords.size() * sizeof(uint64_t));
+    return bytes;
+  }
+};
+
+}  // namespace gal
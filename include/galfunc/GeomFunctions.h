@@ -57,9 +57,12 @@ GAL_FUNC_DECL(((gal::PointCloud, cloud, "Point cloud")),
 GAL_FUNC_DECL(((gal::Mesh, hull, "Convex hull")),
               pointCloudConvexHull,
               true,
-              1,
-              "Creates a convex hull from the given point cloud",
-              (gal::PointCloud, cloud, "Point cloud"));
+              2,
+              "Creates a convex hull from the given point cloud. Mode 0 is sequential, "
+              "mode 1 discards the interior points in parallel first, and mode 2 also "
+              "computes partial hulls in parallel",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (int32_t, mode, "Mode"));
 
 GAL_FUNC_DECL(((gal::PointCloud, cloud, "Point cloud")),
               pointCloud3d,
@@ -68,10 +71,29 @@ GAL_FUNC_DECL(((gal::PointCloud, cloud, "Point cloud")),
               "Creates a point cloud from the list of points",
               (std::vector<glm::vec3>, points, "points"));
 
+GAL_FUNC_DECL(((gal::Voronoi3, cells, "Voronoi cells")),
+              pointCloudVoronoi,
+              true,
+              2,
+              "Creates the Voronoi cells of the points, clipped to the given box",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (gal::Box3, bounds, "Bounds of the cells"));
+
+GAL_FUNC_DECL(((gal::OrientedBox3, box, "Oriented bounding box"),
+               (float, volume, "Volume of the box")),
+              pointCloudOrientedBox,
+              true,
+              2,
+              "Creates an oriented bounding box for the given point cloud. Mode 0 uses "
+              "the principal axes of the points, mode 1 finds the smallest box with a "
+              "face flush with the convex hull",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (int32_t, mode, "Mode"));
+
 }  // namespace func
 }  // namespace gal
 
 // These are all the functions exposed from this translation unit.
 #define GAL_GeomFunctions                                                       \
   vec3, vec2, plane, box3, box2, randomPointCloudFromBox, pointCloudConvexHull, \
-    pointCloud3d
+    pointCloud3d, pointCloudVoronoi, pointCloudOrientedBox
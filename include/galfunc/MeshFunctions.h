@@ -1,5 +1,6 @@
 #pragma once
 
+#include <galcore/MeshBoolean.h>
 #include <galcore/ObjLoader.h>
 #include <galcore/Types.h>
 #include <galfunc/GeomFunctions.h>
@@ -80,9 +81,40 @@ GAL_FUNC_DECL(((gal::Box3, bounds, "Bounds of the mesh")),
               "Gets the bounding box of the mesh",
               (gal::Mesh, mesh, "Mesh"));
 
+GAL_FUNC_DECL(((gal::VoxelGrid, voxels, "Voxels occupied by the mesh")),
+              meshVoxels,
+              true,
+              3,
+              "Voxelizes the mesh. Mode 0 voxelizes the surface, mode 1 also fills the "
+              "interior of the mesh",
+              (gal::Mesh, mesh, "Mesh"),
+              (float, voxelSize, "Edge length of the voxels"),
+              (int32_t, mode, "Voxelization mode"));
+
+GAL_FUNC_DECL(((gal::Mesh, result, "Resulting mesh")),
+              meshBoolean,
+              true,
+              3,
+              "Boolean operation on two closed meshes. Operation 0 is union, 1 is "
+              "intersection and 2 is difference",
+              (gal::Mesh, meshA, "First mesh"),
+              (gal::Mesh, meshB, "Second mesh"),
+              (int32_t, operation, "The boolean operation"));
+
+GAL_FUNC_DECL(((std::vector<float>, distances, "Geodesic distance of each vertex")),
+              meshGeodesicDistances,
+              true,
+              3,
+              "Distances along the surface of the mesh from the nearest source vertex. "
+              "Method 0 is the heat method and 1 is fast marching",
+              (gal::Mesh, mesh, "Mesh"),
+              (std::vector<int32_t>, sources, "Indices of the source vertices"),
+              (int32_t, method, "Method"));
+
 }  // namespace func
 }  // namespace gal
 
 #define GAL_MeshFunctions                                                      \
   meshCentroid, meshVolume, meshSurfaceArea, loadObjFile, scaleMesh, clipMesh, \
-    meshSphereQuery, closestPointsOnMesh, meshBbox
+    meshSphereQuery, closestPointsOnMesh, meshBbox, meshVoxels, meshBoolean,   \
+    meshGeodesicDistances
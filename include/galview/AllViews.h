@@ -5,3 +5,5 @@
 #include <galview/PointCloudView.h>
 #include <galview/SphereView.h>
 #include <galview/AnnotationsView.h>
+#include <galview/VoronoiView.h>
+#include <galview/VoxelGridView.h>
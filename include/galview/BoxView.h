@@ -1,19 +1,28 @@
+#pragma once
 #include <galcore/Box.h>
+#include <galcore/OrientedBox3.h>
 #include <galview/Context.h>
+#include <array>
 
 namespace gal {
 namespace view {
 
 class BoxView : public Drawable
 {
-  friend struct MakeDrawable<gal::Box3>;
-
 public:
   BoxView() = default;
   ~BoxView();
 
   void draw() const override;
 
+  /*Draws the segments between the pairs of points given by the indices. Boxes and the
+   * other wireframes are drawn this way.*/
+  static std::shared_ptr<Drawable> createLines(const glm::vec3*             points,
+                                               size_t                       nPoints,
+                                               const uint32_t*              indices,
+                                               size_t                       nIndices,
+                                               std::vector<RenderSettings>& settings);
+
 private:
   BoxView(const BoxView&) = delete;
   const BoxView& operator=(const BoxView&) = delete;
@@ -25,46 +34,40 @@ private:
   uint mISize = 0;  // index buffer size.
 };
 
+/*The edges of a box, given its corners in the order of OrientedBox3::corners.*/
+static constexpr std::array<uint32_t, 24> sBoxEdges = {{
+  0, 1, 1, 2, 2, 3, 3, 0, 4, 5, 5, 6, 6, 7, 7, 4, 0, 4, 1, 5, 2, 6, 3, 7,
+}};
+
 template<>
 struct MakeDrawable<gal::Box3> : public std::true_type
 {
   static std::shared_ptr<Drawable> get(const gal::Box3&             box,
                                        std::vector<RenderSettings>& renderSettings)
   {
-    glutil::VertexBuffer vBuf(8);
-
-    auto vbegin = vBuf.begin();
-    *(vbegin++) = {{box.min.x, box.min.y, box.min.z}};
-    *(vbegin++) = {{box.max.x, box.min.y, box.min.z}};
-    *(vbegin++) = {{box.max.x, box.max.y, box.min.z}};
-    *(vbegin++) = {{box.min.x, box.max.y, box.min.z}};
-    *(vbegin++) = {{box.min.x, box.min.y, box.max.z}};
-    *(vbegin++) = {{box.max.x, box.min.y, box.max.z}};
-    *(vbegin++) = {{box.max.x, box.max.y, box.max.z}};
-    *(vbegin++) = {{box.min.x, box.max.y, box.max.z}};
-
-    static constexpr std::array<uint32_t, 24> sIBuf = {{
-      0, 1, 1, 2, 2, 3, 3, 0, 4, 5, 5, 6, 6, 7, 7, 4, 0, 4, 1, 5, 2, 6, 3, 7,
-    }};
-
-    glutil::IndexBuffer iBuf(sIBuf.size());
-    std::copy(sIBuf.begin(), sIBuf.end(), iBuf.begin());
-
-    auto view = std::make_shared<BoxView>();
-    view->setBounds(box);
-    view->mVSize = (uint32_t)vBuf.size();
-    view->mISize = (uint32_t)iBuf.size();
-    vBuf.finalize(view->mVAO, view->mVBO);
-    iBuf.finalize(view->mIBO);
+    glm::vec3 corners[8] = {{box.min.x, box.min.y, box.min.z},
+                            {box.max.x, box.min.y, box.min.z},
+                            {box.max.x, box.max.y, box.min.z},
+                            {box.min.x, box.max.y, box.min.z},
+                            {box.min.x, box.min.y, box.max.z},
+                            {box.max.x, box.min.y, box.max.z},
+                            {box.max.x, box.max.y, box.max.z},
+                            {box.min.x, box.max.y, box.max.z}};
+    return BoxView::createLines(
+      corners, 8, sBoxEdges.data(), sBoxEdges.size(), renderSettings);
+  }
+};
 
-    // Render settings.
-    static constexpr glm::vec4 sLineColor = {1.0, 1.0, 1.0, 1.0};
-    RenderSettings             settings;
-    settings.faceColor     = sLineColor;
-    settings.edgeColor     = sLineColor;
-    settings.shadingFactor = 0.0f;
-    renderSettings.push_back(settings);
-    return view;
+template<>
+struct MakeDrawable<gal::OrientedBox3> : public std::true_type
+{
+  static std::shared_ptr<Drawable> get(const gal::OrientedBox3&     box,
+                                       std::vector<RenderSettings>& renderSettings)
+  {
+    glm::vec3 corners[8];
+    box.corners(corners);
+    return BoxView::createLines(
+      corners, 8, sBoxEdges.data(), sBoxEdges.size(), renderSettings);
   }
 };
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <galcore/Voronoi.h>
+#include <galview/BoxView.h>
+
+namespace gal {
+namespace view {
+
+/*The edges of the cells are drawn as lines.*/
+inline std::shared_ptr<Drawable> cellEdgesView(const std::vector<glm::vec3>& vertices,
+                                               const std::vector<IndexPair>& edges,
+                                               std::vector<RenderSettings>&  settings)
+{
+  std::vector<uint32_t> indices;
+  indices.reserve(2 * edges.size());
+  for (const IndexPair& edge : edges) {
+    indices.push_back(uint32_t(edge.p));
+    indices.push_back(uint32_t(edge.q));
+  }
+  return BoxView::createLines(
+    vertices.data(), vertices.size(), indices.data(), indices.size(), settings);
+}
+
+template<>
+struct MakeDrawable<gal::Voronoi2> : public std::true_type
+{
+  static std::shared_ptr<Drawable> get(const gal::Voronoi2&         cells,
+                                       std::vector<RenderSettings>& renderSettings)
+  {
+    std::vector<glm::vec3> vertices(cells.vertices().size());
+    std::transform(cells.vertices().begin(),
+                   cells.vertices().end(),
+                   vertices.begin(),
+                   [](const glm::vec2& v) { return glm::vec3(v.x, v.y, 0.f); });
+    return cellEdgesView(vertices, cells.edges(), renderSettings);
+  }
+};
+
+template<>
+struct MakeDrawable<gal::Voronoi3> : public std::true_type
+{
+  static std::shared_ptr<Drawable> get(const gal::Voronoi3&         cells,
+                                       std::vector<RenderSettings>& renderSettings)
+  {
+    return cellEdgesView(cells.vertices(), cells.edges(), renderSettings);
+  }
+};
+
+}  // namespace view
+}  // namespace gal
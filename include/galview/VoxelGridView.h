@@ -0,0 +1,98 @@
+#pragma once
+
+#include <galcore/VoxelGrid.h>
+#include <galview/Context.h>
+#include <galview/GLUtil.h>
+#include <array>
+
+namespace gal {
+namespace view {
+
+/*Draws a single voxel sized cube once per exposed voxel, using instanced rendering.
+ * The min-corner of each voxel is the per-instance attribute.*/
+class VoxelGridView : public Drawable
+{
+  friend struct MakeDrawable<gal::VoxelGrid>;
+
+public:
+  VoxelGridView() = default;
+  ~VoxelGridView();
+
+  void draw() const override;
+
+private:
+  VoxelGridView(const VoxelGridView&) = delete;
+  const VoxelGridView& operator=(const VoxelGridView&) = delete;
+
+  void initInstances(const std::vector<glm::vec3>& offsets);
+
+  uint mVAO        = 0;  // vertex array object.
+  uint mVBO        = 0;  // vertex buffer object.
+  uint mIBO        = 0;  // index buffer object.
+  uint mInstBO     = 0;  // instance buffer object.
+  uint mISize      = 0;  // index buffer size.
+  uint mNInstances = 0;  // number of instances.
+};
+
+template<>
+struct MakeDrawable<gal::VoxelGrid> : public std::true_type
+{
+  static std::shared_ptr<Drawable> get(const gal::VoxelGrid&        grid,
+                                       std::vector<RenderSettings>& renderSettings)
+  {
+    // Corner i of the cube has the coordinates (i & 1, (i >> 1) & 1, (i >> 2) & 1).
+    static constexpr std::array<std::array<uint32_t, 4>, 6> sFaceCorners = {{
+      {0, 4, 6, 2},
+      {1, 3, 7, 5},
+      {0, 1, 5, 4},
+      {2, 6, 7, 3},
+      {0, 2, 3, 1},
+      {4, 5, 7, 6},
+    }};
+    float                size = grid.voxelSize();
+    glutil::VertexBuffer vBuf(24);
+    glutil::IndexBuffer  iBuf(36);
+    auto                 vbegin = vBuf.begin();
+    uint32_t*            dsti   = iBuf.data();
+    for (uint32_t fi = 0; fi < 6; fi++) {
+      glm::vec3 normal(0.f);
+      normal[fi / 2] = (fi % 2) ? 1.f : -1.f;
+      for (uint32_t ci : sFaceCorners[fi]) {
+        *(vbegin++) = {glm::vec3(float(ci & 1), float((ci >> 1) & 1), float(ci >> 2)) *
+                         size,
+                       normal};
+      }
+      uint32_t first = 4 * fi;
+      for (uint32_t i : {0, 1, 2, 0, 2, 3}) {
+        *(dsti++) = first + i;
+      }
+    }
+
+    // Voxels completely surrounded by other voxels can never be seen.
+    std::vector<glm::vec3> offsets;
+    grid.forEachOccupied([&](size_t x, size_t y, size_t z) {
+      if (grid.isExposed(x, y, z)) {
+        offsets.push_back(grid.voxelBounds(x, y, z).min);
+      }
+    });
+
+    auto view = std::make_shared<VoxelGridView>();
+    view->setBounds(grid.bounds());
+    view->mISize = (uint32_t)iBuf.size();
+    vBuf.finalize(view->mVAO, view->mVBO);
+    iBuf.finalize(view->mIBO);
+    view->initInstances(offsets);
+
+    // Render settings.
+    static constexpr glm::vec4 sFaceColor = {1.0, 1.0, 1.0, 1.0};
+    RenderSettings             settings;
+    settings.faceColor   = sFaceColor;
+    settings.polygonMode = std::make_pair(GL_FRONT_AND_BACK, GL_FILL);
+    settings.shaderId    = Context::get().shaderId("voxel");
+    renderSettings.push_back(settings);
+    return view;
+  }
+};
+
+}  // namespace view
+}  // namespace gal
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace gal {
+namespace bench {
+
+/*Runs fn once and returns the time it took in milliseconds.*/
+inline double timeMs(const std::function<void()>& fn)
+{
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                   start)
+    .count();
+}
+
+inline void report(const std::string& name, double ms, size_t nOps = 0)
+{
+  std::cout << name << ": " << ms << " ms";
+  if (nOps > 0) {
+    std::cout << " (" << double(nOps) / (ms / 1000.) << " per second)";
+  }
+  std::cout << std::endl;
+}
+
+/*Each benchmark reads its sizes from the command line arguments that follow its name.*/
+void bounding(int argc, char** argv);
+void downsample(int argc, char** argv);
+void kdTree(int argc, char** argv);
+void kMeans(int argc, char** argv);
+void rtree(int argc, char** argv);
+
+}  // namespace bench
+}  // namespace gal
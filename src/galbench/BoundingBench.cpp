@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+#include <galcore/Circle2d.h>
+#include <galcore/OrientedBox3.h>
+#include <galcore/Sphere.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace gal {
+namespace bench {
+
+/*Minimum bounding circle and sphere of random points, in random order and sorted along
+ * x. The sorted order is the worst case for Welzl's algorithm without shuffling. Then
+ * the oriented boxes of points in a box and on an ellipsoid, where every point is on the
+ * hull. Arguments: number of points (10M), number of points for the oriented boxes
+ * (20000).*/
+void bounding(int argc, char** argv)
+{
+  size_t nPoints    = argc > 0 ? std::stoull(argv[0]) : 10000000;
+  size_t nBoxPoints = argc > 1 ? std::stoull(argv[1]) : 20000;
+  std::cout << nPoints << " points" << std::endl;
+
+  Box3                   box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3> points;
+  points.reserve(nPoints);
+  box.randomPoints(nPoints, std::back_inserter(points));
+  std::vector<glm::vec2> points2d(nPoints);
+  std::transform(points.begin(), points.end(), points2d.begin(), [](const glm::vec3& p) {
+    return glm::vec2(p.x, p.y);
+  });
+
+  for (bool sorted : {false, true}) {
+    if (sorted) {
+      auto byX = [](const auto& a, const auto& b) { return a.x < b.x; };
+      std::sort(points.begin(), points.end(), byX);
+      std::sort(points2d.begin(), points2d.end(), byX);
+    }
+    std::string order = sorted ? " (sorted)" : " (random)";
+    report("minBoundingCircle" + order,
+           timeMs([&] { Circle2d::minBoundingCircle(points2d.data(), nPoints); }),
+           nPoints);
+    report("minBoundingSphere" + order,
+           timeMs([&] { Sphere::minBoundingSphere(points.data(), nPoints); }),
+           nPoints);
+  }
+
+  std::cout << nBoxPoints << " points for the oriented boxes" << std::endl;
+  std::vector<glm::vec3> inBox(points.begin(),
+                               points.begin() + std::min(nBoxPoints, nPoints));
+  std::vector<glm::vec3>          onEllipsoid(nBoxPoints);
+  std::mt19937                    rng(42);
+  std::normal_distribution<float> nd;
+  for (auto& pt : onEllipsoid) {
+    pt = glm::normalize(glm::vec3(nd(rng), nd(rng), nd(rng))) * glm::vec3(1.f, 2.f, 3.f);
+  }
+  for (const auto* cloud : {&inBox, &onEllipsoid}) {
+    std::string shape = cloud == &inBox ? " (box)" : " (ellipsoid)";
+    report("fitPCA" + shape, timeMs([&] {
+             OrientedBox3::fit(*cloud, eOrientedBoxFit::pca);
+           }));
+    report("fitMinVolume" + shape, timeMs([&] {
+             OrientedBox3::fit(*cloud, eOrientedBoxFit::minVolume);
+           }));
+  }
+}
+
+}  // namespace bench
+}  // namespace gal
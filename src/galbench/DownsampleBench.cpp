@@ -0,0 +1,34 @@
+#include "Benchmark.h"
+#include <galcore/PointCloud.h>
+#include <vector>
+
+namespace gal {
+namespace bench {
+
+/*Voxel and Poisson disk downsampling of random points in a unit cube.
+ * Arguments: number of points (10M), voxel size and sampling radius (0.01).*/
+void downsample(int argc, char** argv)
+{
+  size_t nPoints = argc > 0 ? std::stoull(argv[0]) : 10000000;
+  float  size    = argc > 1 ? std::stof(argv[1]) : 0.01f;
+  std::cout << nPoints << " points, size " << size << std::endl;
+
+  Box3       box(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f});
+  PointCloud cloud;
+  cloud.reserve(nPoints);
+  box.randomPoints(nPoints, std::back_inserter(cloud));
+
+  std::vector<size_t> offsets, sources;
+  size_t              nResult = 0;
+  report("voxelDownsample",
+         timeMs([&] { nResult = cloud.voxelDownsample(size, offsets, sources).size(); }),
+         nPoints);
+  std::cout << nResult << " voxels" << std::endl;
+  report("poissonDiskSample",
+         timeMs([&] { nResult = cloud.poissonDiskSample(size, sources).size(); }),
+         nPoints);
+  std::cout << nResult << " samples" << std::endl;
+}
+
+}  // namespace bench
+}  // namespace gal
@@ -0,0 +1,36 @@
+#include "Benchmark.h"
+#include <galcore/PointCloud.h>
+#include <vector>
+
+namespace gal {
+namespace bench {
+
+/*k-means of random points around random centers.
+ * Arguments: number of points (10M), number of clusters (1000).*/
+void kMeans(int argc, char** argv)
+{
+  size_t nPoints   = argc > 0 ? std::stoull(argv[0]) : 10000000;
+  size_t nClusters = argc > 1 ? std::stoull(argv[1]) : 1000;
+  std::cout << nPoints << " points, " << nClusters << " clusters" << std::endl;
+
+  Box3                   box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3> blobs, points;
+  box.randomPoints(nClusters, std::back_inserter(blobs));
+  points.reserve(nPoints);
+  box.inflate(-0.95f);
+  box.randomPoints(nPoints, std::back_inserter(points));
+  for (size_t i = 0; i < nPoints; i++) {
+    points[i] += blobs[i % nClusters];
+  }
+
+  std::vector<size_t> indices(nPoints);
+  report("kMeansClusters",
+         timeMs([&] {
+           kMeansClusters<glm::vec3>(
+             points.begin(), points.end(), nClusters, indices.begin());
+         }),
+         nPoints);
+}
+
+}  // namespace bench
+}  // namespace gal
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include <galcore/KdTree.h>
+#include <galcore/RTree.h>
+#include <vector>
+
+namespace gal {
+namespace bench {
+
+/*Compares the k-d tree with the RTree3d over the same random points. Arguments: number
+ * of points (10M), number of queries (1M) and number of neighbors (8).*/
+void kdTree(int argc, char** argv)
+{
+  size_t nPoints  = argc > 0 ? std::stoull(argv[0]) : 10000000;
+  size_t nQueries = argc > 1 ? std::stoull(argv[1]) : 1000000;
+  size_t k        = argc > 2 ? std::stoull(argv[2]) : 8;
+
+  Box3                   box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3> points, queries;
+  points.reserve(nPoints);
+  queries.reserve(nQueries);
+  box.randomPoints(nPoints, std::back_inserter(points));
+  box.randomPoints(nQueries, std::back_inserter(queries));
+  std::cout << nPoints << " points, " << nQueries << " queries, k = " << k << std::endl;
+
+  KdTree3 kdtree;
+  RTree3d rtree;
+  report("KdTree3 build", timeMs([&] { kdtree = KdTree3(points.data(), nPoints); }));
+  report("RTree3d build", timeMs([&] {
+           rtree.build(nPoints, [&points](size_t i) { return Box3(points[i]); });
+         }));
+
+  std::vector<size_t> indices(nQueries * k);
+  std::vector<float>  dists(nQueries * k);
+  report("KdTree3 kNN batch",
+         timeMs([&] {
+           kdtree.queryNearestNBatch(
+             queries.data(), nQueries, k, indices.data(), dists.data());
+         }),
+         nQueries);
+  report("RTree3d kNN batch",
+         timeMs([&] {
+           rtree.queryNearestNBatch(
+             queries.data(), nQueries, k, indices.data(), dists.data());
+         }),
+         nQueries);
+
+  // Radius that holds about k points on average.
+  float               radius = 2.f * std::cbrt(float(k) / float(nPoints) * 3.f / 12.566f);
+  std::vector<size_t> offsets, found;
+  report("KdTree3 radius batch",
+         timeMs([&] {
+           kdtree.queryRadiusBatch(queries.data(), nQueries, radius, offsets, found);
+         }),
+         nQueries);
+}
+
+}  // namespace bench
+}  // namespace gal
@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+#include <galcore/RTree.h>
+#include <vector>
+
+namespace gal {
+namespace bench {
+
+/*Box queries on an RTree3d of small random boxes, one at a time and in a batch.
+ * Arguments: number of items (1M), number of queries (1M) and the half size of the query
+ * boxes (0.02).*/
+void rtree(int argc, char** argv)
+{
+  size_t nItems   = argc > 0 ? std::stoull(argv[0]) : 1000000;
+  size_t nQueries = argc > 1 ? std::stoull(argv[1]) : 1000000;
+  float  halfSize = argc > 2 ? std::stof(argv[2]) : 0.02f;
+
+  Box3                   box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3> centers, queryCenters;
+  box.randomPoints(nItems, std::back_inserter(centers));
+  box.randomPoints(nQueries, std::back_inserter(queryCenters));
+  std::vector<Box3> queries(nQueries);
+  for (size_t i = 0; i < nQueries; i++) {
+    queries[i] = Box3(queryCenters[i] - glm::vec3(halfSize),
+                      queryCenters[i] + glm::vec3(halfSize));
+  }
+  std::cout << nItems << " items, " << nQueries << " queries" << std::endl;
+
+  RTree3d tree;
+  report("RTree3d build", timeMs([&] {
+           tree.build(nItems, [&centers](size_t i) {
+             return Box3(centers[i] - glm::vec3(.005f), centers[i] + glm::vec3(.005f));
+           });
+         }));
+
+  std::vector<size_t> results;
+  size_t              nHits = 0;
+  report("RTree3d box queries",
+         timeMs([&] {
+           for (const Box3& q : queries) {
+             results.clear();
+             tree.queryBoxIntersects(q, std::back_inserter(results));
+             nHits += results.size();
+           }
+         }),
+         nQueries);
+  std::vector<size_t> offsets, indices;
+  report("RTree3d box query batch",
+         timeMs([&] {
+           tree.queryBoxIntersectsBatch(queries.data(), nQueries, offsets, indices);
+         }),
+         nQueries);
+  std::cout << nHits << " hits, " << indices.size() << " in the batch" << std::endl;
+}
+
+}  // namespace bench
+}  // namespace gal
@@ -0,0 +1,23 @@
+#include "Benchmark.h"
+#include <map>
+
+int main(int argc, char** argv)
+{
+  static const std::map<std::string, void (*)(int, char**)> sBenchmarks = {
+    {"bounding", gal::bench::bounding},
+    {"downsample", gal::bench::downsample},
+    {"kdtree", gal::bench::kdTree},
+    {"kmeans", gal::bench::kMeans},
+    {"rtree", gal::bench::rtree},
+  };
+  if (argc < 2 || sBenchmarks.find(argv[1]) == sBenchmarks.end()) {
+    std::cerr << "Usage: galbench <benchmark> [args...]\nBenchmarks:";
+    for (const auto& [name, fn] : sBenchmarks) {
+      std::cerr << " " << name;
+    }
+    std::cerr << std::endl;
+    return 1;
+  }
+  sBenchmarks.at(argv[1])(argc - 2, argv + 2);
+  return 0;
+}
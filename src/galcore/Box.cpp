@@ -92,6 +92,28 @@ bool Box3::valid() const
   return !(min == vec3_unset || max == -vec3_unset);
 }
 
+float Box3::sqDistance(const Box3& b) const
+{
+  glm::vec3 gap = glm::max(glm::max(b.min - max, min - b.max), vec3_zero);
+  return glm::dot(gap, gap);
+}
+
+Box3 Box3::transformed(const glm::mat4& mat) const
+{
+  // Arvo's method: each column of the matrix contributes its extreme values along each
+  // axis independently of the other columns.
+  Box3 b;
+  b.min = glm::vec3(mat[3]);
+  b.max = b.min;
+  for (int col = 0; col < 3; col++) {
+    glm::vec3 lo = glm::vec3(mat[col]) * min[col];
+    glm::vec3 hi = glm::vec3(mat[col]) * max[col];
+    b.min += glm::min(lo, hi);
+    b.max += glm::max(lo, hi);
+  }
+  return b;
+}
+
 Box3 Box3::init(const glm::vec3& m1, const glm::vec3& m2)
 {
   Box3 b;
@@ -0,0 +1,110 @@
+#pragma once
+#include <tbb/tbb.h>
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace gal {
+
+/*Index of the cell along the Hilbert curve through a grid of 2^Bits cells per axis,
+ * following Skilling's transposition. Overwrites the coordinates.*/
+template<size_t Dim, uint32_t Bits>
+uint64_t hilbertKey(uint32_t (&x)[Dim])
+{
+  static_assert(Dim * Bits <= 64, "The keys must fit in 64 bits");
+  static constexpr uint32_t sTop = uint32_t(1) << (Bits - 1);
+  for (uint32_t q = sTop; q > 1; q >>= 1) {
+    uint32_t p = q - 1;
+    for (size_t i = 0; i < Dim; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      }
+      else {
+        uint32_t t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+  for (size_t i = 1; i < Dim; i++) {
+    x[i] ^= x[i - 1];
+  }
+  uint32_t t = 0;
+  for (uint32_t q = sTop; q > 1; q >>= 1) {
+    if (x[Dim - 1] & q) {
+      t ^= q - 1;
+    }
+  }
+  uint64_t key = 0;
+  for (int bit = int(Bits) - 1; bit >= 0; bit--) {
+    for (size_t i = 0; i < Dim; i++) {
+      key = (key << 1) | (((x[i] ^ t) >> bit) & 1);
+    }
+  }
+  return key;
+}
+
+/*Biased randomized insertion order (BRIO): the shuffled points are split in rounds, each
+ * twice as large as the one before, and each round is sorted along a Hilbert curve with
+ * 2^Bits cells per axis. Consecutive points are close, so walking from one to the next
+ * takes only a few steps, and the rounds keep the order random enough for the expected
+ * run time of the randomized incremental construction. TPt is glm::vec2 or glm::vec3.*/
+template<uint32_t Bits, typename TPt>
+std::vector<size_t> brioOrder(const std::vector<TPt>& pts, bool parallel)
+{
+  static constexpr size_t sDim = sizeof(TPt) / sizeof(float);
+  // Rounds smaller than this are merged into the first one.
+  static constexpr size_t sMinRound = 64;
+
+  std::vector<size_t> order(pts.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  TPt lo(FLT_MAX), hi(-FLT_MAX);
+  for (const TPt& pt : pts) {
+    lo = glm::min(lo, pt);
+    hi = glm::max(hi, pt);
+  }
+  float span = FLT_MIN;
+  for (size_t i = 0; i < sDim; i++) {
+    span = std::max(span, hi[i] - lo[i]);
+  }
+  float                 scale = float((uint32_t(1) << Bits) - 1) / span;
+  std::vector<uint64_t> keys(pts.size());
+  auto                  computeKey = [&](size_t pi) {
+    TPt      rel = (pts[pi] - lo) * scale;
+    uint32_t x[sDim];
+    for (size_t i = 0; i < sDim; i++) {
+      x[i] = uint32_t(rel[i]);
+    }
+    keys[pi] = hilbertKey<sDim, Bits>(x);
+  };
+  auto byKey = [&](size_t a, size_t b) { return keys[a] < keys[b]; };
+
+  std::vector<size_t> ends = {0};
+  for (size_t end = order.size(); end > 0; end = end > sMinRound ? end / 2 : 0) {
+    ends.push_back(end);
+  }
+  std::reverse(ends.begin() + 1, ends.end());
+  if (parallel) {
+    tbb::parallel_for(size_t(0), pts.size(), computeKey);
+    for (size_t i = 0; i + 1 < ends.size(); i++) {
+      tbb::parallel_sort(order.begin() + ends[i], order.begin() + ends[i + 1], byKey);
+    }
+  }
+  else {
+    for (size_t pi = 0; pi < pts.size(); pi++) {
+      computeKey(pi);
+    }
+    for (size_t i = 0; i + 1 < ends.size(); i++) {
+      std::sort(order.begin() + ends[i], order.begin() + ends[i + 1], byKey);
+    }
+  }
+  return order;
+}
+
+}  // namespace gal
@@ -1,6 +1,8 @@
 #include <galcore/Circle2d.h>
+#include <galcore/ConvexHull2d.h>
 #include <galcore/DebugProfile.h>
 #include <algorithm>
+#include <random>
 #include <glm/gtx/norm.hpp>
 
 namespace gal {
@@ -57,55 +59,61 @@ Circle2d Circle2d::createFromDiameter(const glm::vec2& a, const glm::vec2& b)
   return Circle2d(center, glm::distance(center, a));
 };
 
-static void minBoundingCircleImpl(Circle2d&        circ,
-                                  const glm::vec2* begin,
-                                  const glm::vec2* end,
-                                  const glm::vec2* pin1 = nullptr,
-                                  const glm::vec2* pin2 = nullptr)
-{
-  auto current = begin;
-  if (pin1 && pin2) {
-    circ = Circle2d::createFromDiameter(*pin1, *pin2);
-    GALCAPTURE(circ);
-  }
-  else if (pin1) {
-    circ = Circle2d::createFromDiameter(*(current++), *pin1);
-    GALCAPTURE(circ);
-  }
-  else {
-    circ = Circle2d::createFromDiameter(*current, *(current + 1));
-    GALCAPTURE(circ);
-    current += 2;
-  }
+static constexpr size_t sHullFilterMinSize = 64;
 
-  while (current != end) {
-    if (!circ.contains(*current)) {
-      if (pin1 && pin2) {
-        circ = Circle2d::createCircumcircle(*pin1, *pin2, *current);
-        GALCAPTURE(circ);
-      }
-      else if (pin1) {
-        minBoundingCircleImpl(circ, begin, current, pin1, current);
+/*Welzl's algorithm with the recursion unrolled into one loop per point of the support
+ * set, so the depth is fixed. The points must be in random order. A point found outside
+ * the circle is moved to the front, so that the points defining the circle are checked
+ * first from then on.*/
+static Circle2d minBoundingCircleImpl(glm::vec2* pts, size_t nPoints)
+{
+  Circle2d circ(pts[0], 0.f);
+  for (size_t i = 1; i < nPoints; i++) {
+    if (circ.contains(pts[i])) {
+      continue;
+    }
+    circ = Circle2d(pts[i], 0.f);
+    for (size_t j = 0; j < i; j++) {
+      if (circ.contains(pts[j])) {
+        continue;
       }
-      else {
-        minBoundingCircleImpl(circ, begin, current, current);
+      circ = Circle2d::createFromDiameter(pts[i], pts[j]);
+      for (size_t k = 0; k < j; k++) {
+        if (!circ.contains(pts[k])) {
+          circ = Circle2d::createCircumcircle(pts[i], pts[j], pts[k]);
+          std::rotate(pts, pts + k, pts + k + 1);
+        }
       }
+      std::rotate(pts, pts + j, pts + j + 1);
     }
-    current++;
+    std::rotate(pts, pts + i, pts + i + 1);
+    GALCAPTURE(circ);
   }
+  return circ;
 }
 
-Circle2d Circle2d::minBoundingCircle(const std::vector<glm::vec2>& points)
+Circle2d Circle2d::minBoundingCircle(const glm::vec2* points, size_t nPoints)
 {
   GALSCOPE(__func__);
-  if (points.size() < 2) {
+  if (nPoints < 2) {
     throw "Cannot compute circle";
   }
 
-  Circle2d circ;
-  minBoundingCircleImpl(circ, points.data(), points.data() + points.size());
+  // The circle is defined by the vertices of the convex hull, so only they are visited.
+  // They come in order around the hull, so like any other input they are shuffled to
+  // keep the expected linear time.
+  std::vector<glm::vec2> pts = nPoints <= sHullFilterMinSize
+                                 ? std::vector<glm::vec2>(points, points + nPoints)
+                                 : ConvexHull2d(points, nPoints).vertices();
+  std::shuffle(pts.begin(), pts.end(), std::mt19937(42));
+  Circle2d circ = minBoundingCircleImpl(pts.data(), pts.size());
   GALCAPTURE(circ);
   return circ;
+}
+
+Circle2d Circle2d::minBoundingCircle(const std::vector<glm::vec2>& points)
+{
+  return minBoundingCircle(points.data(), points.size());
 };
 
-}  // namespace gal
\ No newline at end of file
+}  // namespace gal
@@ -1,463 +1,714 @@
 #include "galcore/ConvexHull.h"
+#include <galcore/ConvexHull2d.h>
+#include <tbb/tbb.h>
 
 namespace gal {
 
-const ConvexHull::Face ConvexHull::Face::unset = Face(-1, -1, -1, -1);
+/*Clouds smaller than this are always processed sequentially.*/
+static constexpr size_t sParallelMinSize = size_t(1) << 14;
+/*The parallel mode splits the cloud into chunks of this many points.*/
+static constexpr size_t sSubHullSize = size_t(1) << 15;
 
 ConvexHull::Face::Face()
-    : id(-1)
-    , a(-1)
-    , b(-1)
-    , c(-1)
+    : a(SIZE_MAX)
+    , b(SIZE_MAX)
+    , c(SIZE_MAX)
+    , adjacent {SIZE_MAX, SIZE_MAX, SIZE_MAX}
+    , normal(0.)
+    , offset(0.)
+    , bound(0.)
+    , farthest(SIZE_MAX)
+    , farthestDist(-DBL_MAX)
+    , visited(0)
+    , alive(false)
 {}
 
-ConvexHull::Face::Face(size_t idVal, size_t v1, size_t v2, size_t v3)
-    : id(idVal)
-    , a(v1)
-    , b(v2)
-    , c(v3)
-    , normal(vec3_unset)
-{}
-
-ConvexHull::ConvexHull(std::vector<glm::vec3>&& points)
-    : mPts(std::move(points))
+ConvexHull::Face::Face(size_t v1, size_t v2, size_t v3)
+    : Face()
 {
-  initOutside();
-  compute();
+  a = v1;
+  b = v2;
+  c = v3;
 }
 
-ConvexHull::ConvexHull(const std::vector<glm::vec3>& points)
-    : mPts(points)
+ConvexHull::ConvexHull(std::vector<glm::vec3>&& points, eConvexHullMode mode)
+    : mPts(std::move(points))
 {
-  initOutside();
-  compute();
+  compute(mode);
 }
 
-void ConvexHull::initOutside()
+ConvexHull::ConvexHull(const std::vector<glm::vec3>& points, eConvexHullMode mode)
+    : mPts(points)
 {
-  size_t nPts = mPts.size();
-  mOutsidePts.reserve(nPts);
-  for (size_t i = 0; i < nPts; i++) {
-    mOutsidePts.insert(i);
-  }
+  compute(mode);
 }
 
-bool ConvexHull::Face::isValid()
+glm::vec3 ConvexHull::getPt(size_t index) const
 {
-  return (id != -1 && a != -1 && b != -1 && c != -1) && (a != b && b != c && c != a);
+  return index < mPts.size() ? mPts[index] : vec3_unset;
 }
 
-void ConvexHull::Face::flip()
+size_t ConvexHull::numFaces() const
 {
-  std::swap(b, c);
-  normal = -normal;
+  return mNumFaces;
 }
 
-gal::IndexPair ConvexHull::Face::edge(char edgeIndex) const
+void ConvexHull::copyFaces(int* faceIndices) const
 {
-  switch (edgeIndex) {
-  case 0:
-    return gal::IndexPair(a, b);
-  case 1:
-    return gal::IndexPair(b, c);
-  case 2:
-    return gal::IndexPair(c, a);
-  default:
-    throw "Invalid edge index.";
+  int i = 0;
+  for (const Face& face : mFaces) {
+    if (face.alive) {
+      faceIndices[i++] = (int)face.a;
+      faceIndices[i++] = (int)face.b;
+      faceIndices[i++] = (int)face.c;
+    }
   }
 }
 
-bool ConvexHull::Face::containsVertex(size_t vi) const
+std::vector<size_t> ConvexHull::vertexIndices() const
 {
-  return vi == -1 && (vi == a || vi == b || vi == c);
-}
-
-glm::vec3 ConvexHull::getPt(size_t index) const
-{
-  return index < 0 || index > mPts.size() - 1 ? vec3_unset : mPts[index];
+  std::vector<size_t> indices;
+  indices.reserve(mNumFaces * 3);
+  for (const Face& face : mFaces) {
+    if (face.alive) {
+      indices.insert(indices.end(), face.indices, face.indices + 3);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  return indices;
 }
 
-size_t ConvexHull::numFaces() const
+void ConvexHull::compute(eConvexHullMode mode)
 {
-  return mFaces.size();
+  createInitialSimplex();
+  const size_t simplex[4] = {0, 1, 2, 3};
+  if (mode == eConvexHullMode::sequential || mPts.size() < sParallelMinSize) {
+    for (size_t pi = 0; pi < mPts.size(); pi++) {
+      assign(pi, simplex, 4);
+    }
+  }
+  else {
+    std::vector<size_t> candidates = filterInterior();
+    if (mode == eConvexHullMode::parallel) {
+      // The hull of the vertices of the hulls of the chunks is the hull of the cloud.
+      size_t nCands  = candidates.size();
+      size_t nChunks = (nCands + sSubHullSize - 1) / sSubHullSize;
+      std::vector<uint8_t> keep(nCands, 0);
+      tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+        size_t first = ci * sSubHullSize;
+        size_t last  = std::min(nCands, first + sSubHullSize);
+        keepSubHullVertices(
+          candidates.data() + first, candidates.data() + last, keep.data() + first);
+      });
+      size_t nKept = 0;
+      for (size_t i = 0; i < nCands; i++) {
+        if (keep[i]) {
+          candidates[nKept++] = candidates[i];
+        }
+      }
+      candidates.resize(nKept);
+    }
+    std::vector<size_t> faces(candidates.size());
+    std::vector<double> dists(candidates.size());
+    tbb::parallel_for(size_t(0), candidates.size(), [&](size_t i) {
+      faces[i] = farthestFace(candidates[i], simplex, 4, dists[i]);
+    });
+    for (size_t i = 0; i < candidates.size(); i++) {
+      if (faces[i] != SIZE_MAX) {
+        assign(candidates[i], faces[i], dists[i]);
+      }
+    }
+  }
+  for (size_t fi = 0; fi < 4; fi++) {
+    mFaceStack.push_back(fi);
+  }
+  expand();
 }
 
-void ConvexHull::copyFaces(int* faceIndices) const
+void ConvexHull::expand()
 {
-  int i = 0;
-  for (auto const& pair : mFaces) {
-    faceIndices[i++] = (int)pair.second.a;
-    faceIndices[i++] = (int)pair.second.b;
-    faceIndices[i++] = (int)pair.second.c;
+  while (!mFaceStack.empty()) {
+    size_t fi = mFaceStack.back();
+    mFaceStack.pop_back();
+    if (mFaces[fi].alive && !mFaces[fi].outside.empty()) {
+      addPoint(fi);
+    }
   }
 }
 
-void ConvexHull::compute()
+std::vector<size_t> ConvexHull::filterInterior() const
 {
-  size_t curFaceId = 0;
-  createInitialSimplex(curFaceId);
-  std::queue<size_t> faceQ;
-  for (const auto& f : mFaces) {
-    faceQ.push(f.first);
-  }
-
-  size_t                      fi, fpi;
-  Face                        curFace, pFace, newFace;
-  Face                        adjFaces[3];
-  gal::IndexPair              edges[3];
-  glm::vec3                   farPt;
-  std::queue<size_t>          popQ;
-  std::vector<gal::IndexPair> horizonEdges;
-  std::vector<Face>           poppedFaces, newFaces;
-
-  while (!faceQ.empty()) {
-    fi = faceQ.front();
-    faceQ.pop();
-    if (!getFace(fi, curFace) || !getFarthestPt(curFace, farPt, fpi)) {
-      continue;
+  // Akl-Toussaint heuristic: the points inside the hull of the extreme points are inside
+  // the hull of the cloud.
+  std::vector<glm::vec3> extremes(6);
+  for (size_t i = 0; i < 6; i++) {
+    extremes[i] = mPts[mExtremes[i]];
+  }
+  std::unique_ptr<ConvexHull> octahedron;
+  std::vector<const Face*>    planes;
+  try {
+    octahedron = std::make_unique<ConvexHull>(std::move(extremes));
+    for (const Face& face : octahedron->mFaces) {
+      if (face.alive) {
+        planes.push_back(&face);
+      }
     }
-    popQ.push(fi);
-
-    horizonEdges.clear();
-    poppedFaces.clear();
-    while (!popQ.empty()) {
-      pFace = popFace(popQ.front(), edges, adjFaces);
-      popQ.pop();
-
-      if (!pFace.isValid()) {
-        continue;
+  }
+  catch (const char*) {
+    // The extreme points are coplanar, so nothing is strictly inside them.
+  }
+  static constexpr size_t          sChunkSize = size_t(1) << 12;
+  size_t                           nChunks = (mPts.size() + sChunkSize - 1) / sChunkSize;
+  std::vector<std::vector<size_t>> chunks(nChunks);
+  tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+    size_t last = std::min(mPts.size(), (ci + 1) * sChunkSize);
+    for (size_t pi = ci * sChunkSize; pi < last; pi++) {
+      bool inside = !planes.empty();
+      double dist;
+      for (size_t i = 0; inside && i < planes.size(); i++) {
+        inside = octahedron->side(*planes[i], mPts[pi], dist) < 0;
       }
-
-      poppedFaces.push_back(pFace);
-
-      for (size_t i = 0; i < 3; i++) {
-        if (!adjFaces[i].isValid()) {
-          continue;
-        }
-        if (faceVisible(adjFaces[i], farPt)) {
-          popQ.push(adjFaces[i].id);
-        }
-        else {
-          horizonEdges.push_back(edges[i]);
-        }
+      if (!inside) {
+        chunks[ci].push_back(pi);
       }
     }
+  });
+  std::vector<size_t> offsets(nChunks + 1, 0);
+  for (size_t ci = 0; ci < nChunks; ci++) {
+    offsets[ci + 1] = offsets[ci] + chunks[ci].size();
+  }
+  std::vector<size_t> candidates(offsets.back());
+  tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+    std::copy(chunks[ci].begin(), chunks[ci].end(), candidates.begin() + offsets[ci]);
+  });
+  return candidates;
+}
 
-    newFaces.clear();
-    newFaces.reserve(horizonEdges.size());
-    for (const gal::IndexPair& he : horizonEdges) {
-      newFace = Face(curFaceId++, fpi, he.p, he.q);
-      setFace(newFace);
-      faceQ.push(newFace.id);
-      newFaces.push_back(newFace);
+void ConvexHull::keepSubHullVertices(const size_t* begin,
+                                     const size_t* end,
+                                     uint8_t*      keep) const
+{
+  std::vector<glm::vec3> pts(size_t(end - begin));
+  std::transform(begin, end, pts.begin(), [this](size_t pi) { return mPts[pi]; });
+  try {
+    ConvexHull hull(std::move(pts));
+    for (const Face& face : hull.mFaces) {
+      if (face.alive) {
+        keep[face.a] = keep[face.b] = keep[face.c] = 1;
+      }
     }
-
-    updateExteriorPt(newFaces, poppedFaces);
+  }
+  catch (const char*) {
+    std::fill_n(keep, size_t(end - begin), uint8_t(1));
   }
 }
 
-void ConvexHull::setFace(Face& face)
+size_t ConvexHull::addFace(size_t a, size_t b, size_t c)
 {
-  if (!face.isValid())
-    return;
-  face.normal =
-    glm::normalize(glm::cross(mPts[face.b] - mPts[face.a], mPts[face.c] - mPts[face.a]));
-  if (faceVisible(face, mCenter)) {
-    face.flip();
+  size_t fi;
+  if (mFreeFaces.empty()) {
+    fi = mFaces.size();
+    mFaces.emplace_back();
   }
-
-  mFaces.insert_or_assign(face.id, face);
-
-  for (char ei = 0; ei < 3; ei++) {
-    if (!mEdgeFaceMap[face.edge(ei)].add(face.id)) {
-      throw "Failed to add face to the edge map.";
-    }
+  else {
+    fi = mFreeFaces.back();
+    mFreeFaces.pop_back();
   }
+  Face& face = mFaces[fi];
+  face.a     = a;
+  face.b     = b;
+  face.c     = c;
+  std::fill_n(face.adjacent, 3, SIZE_MAX);
+  setPlane(face);
+  face.outside.clear();
+  face.farthest     = SIZE_MAX;
+  face.farthestDist = -DBL_MAX;
+  face.alive        = true;
+  mNumFaces++;
+  return fi;
 }
 
-ConvexHull::Face ConvexHull::popFace(size_t id, gal::IndexPair edges[3], Face adjFaces[3])
+void ConvexHull::setPlane(Face& face) const
 {
-  Face face;
-  if (getFace(id, face)) {
-    mFaces.erase(id);
-    gal::IndexPair edge, fPair;
-    size_t         adjFid;
-    for (char ei = 0; ei < 3; ei++) {
-      edge      = face.edge(ei);
-      edges[ei] = edge;
-      if (!getEdgeFaces(edge, fPair) || !fPair.contains(id)) {
-        adjFaces[ei] = Face::unset;
-        continue;
-      }
-      fPair.unset(id);
-      mEdgeFaceMap[edge] = fPair;
-      adjFid             = fPair.p == -1 ? fPair.q : fPair.p;
-      if (!getFace(adjFid, adjFaces[ei])) {
-        adjFaces[ei] = Face::unset;
-      }
-    }
-  }
+  glm::dvec3 origin(mPts[face.a]);
+  glm::dvec3 u    = glm::dvec3(mPts[face.b]) - origin;
+  glm::dvec3 v    = glm::dvec3(mPts[face.c]) - origin;
+  double     m[6] = {u.y * v.z, u.z * v.y, u.z * v.x, u.x * v.z, u.x * v.y, u.y * v.x};
+  glm::dvec3 n    = {m[0] - m[1], m[2] - m[3], m[4] - m[5]};
+  double     len  = glm::length(n);
+  double     perm = std::abs(m[0]) + std::abs(m[1]) + std::abs(m[2]) + std::abs(m[3]) +
+                std::abs(m[4]) + std::abs(m[5]);
+  face.normal     = len > 0. ? n / len : glm::dvec3(0.);
+  face.offset     = glm::dot(face.normal, origin);
+  // Semi-static filter. The error of the direction of the normal is a few epsilons of
+  // the permanent of its minors relative to its length, and the dot products add a few
+  // epsilons of the largest coordinate.
+  face.bound = len > 0. ? PREDICATE_EPSILON * mMaxCoord * (16. * perm / len + 32.) : 0.;
+}
 
-  return face;
+inline int ConvexHull::side(const Face& face, const glm::vec3& pt, double& dist) const
+{
+  dist = glm::dot(face.normal, glm::dvec3(pt)) - face.offset;
+  if (dist > face.bound) {
+    return 1;
+  }
+  else if (-dist > face.bound) {
+    return -1;
+  }
+  return sideExact(face, pt);
 }
 
-bool ConvexHull::faceVisible(const Face& face, const glm::vec3& pt) const
+int ConvexHull::sideExact(const Face& face, const glm::vec3& pt) const
 {
-  return gal::utils::isValid(face.normal) ? facePlaneDistance(face, pt) > PLANE_DIST_TOL
-                                          : false;
+  return orient3dExact(mPts[face.a], mPts[face.b], mPts[face.c], pt);
 }
 
-float ConvexHull::facePlaneDistance(const Face& face, const glm::vec3& pt) const
+void ConvexHull::removeFace(size_t fi)
 {
-  return glm::dot(pt - mPts[face.a], face.normal);
+  Face& face = mFaces[fi];
+  face.alive = false;
+  face.outside.clear();
+  mFreeFaces.push_back(fi);
+  mNumFaces--;
 }
 
-bool ConvexHull::getFarthestPt(const Face& face, glm::vec3& pt, size_t& ptIndex) const
+size_t ConvexHull::farthestFace(size_t        pi,
+                                const size_t* faces,
+                                size_t        nFaces,
+                                double&       dist) const
 {
-  ptIndex    = -1;
-  pt         = vec3_unset;
-  float dMax = PLANE_DIST_TOL, dist;
-  for (const size_t& i : mOutsidePts) {
-    if (face.containsVertex(i)) {
-      continue;
-    }
-    dist = facePlaneDistance(face, mPts[i]);
-    if (dist > dMax) {
-      dMax    = dist;
-      ptIndex = i;
-      pt      = mPts[i];
+  size_t    best     = SIZE_MAX;
+  double    bestDist = -DBL_MAX;
+  glm::vec3 pt       = mPts[pi];
+  for (size_t i = 0; i < nFaces; i++) {
+    // Same as side, with the cheap rejection of the faces that can't see the point first.
+    const Face& face = mFaces[faces[i]];
+    double      d    = glm::dot(face.normal, glm::dvec3(pt)) - face.offset;
+    if (d >= -face.bound && d > bestDist && (d > face.bound || sideExact(face, pt) > 0)) {
+      best     = faces[i];
+      bestDist = d;
     }
   }
+  dist = bestDist;
+  return best;
+}
 
-  return ptIndex != -1;
+void ConvexHull::assign(size_t pi, const size_t* faces, size_t nFaces)
+{
+  // The point goes to the face it is farthest from, and is dropped if no face sees it.
+  double dist;
+  size_t fi = farthestFace(pi, faces, nFaces, dist);
+  if (fi != SIZE_MAX) {
+    assign(pi, fi, dist);
+  }
 }
 
-void ConvexHull::updateExteriorPt(const std::vector<Face>& newFaces,
-                                  const std::vector<Face>& poppedFaces)
+void ConvexHull::assign(size_t pi, size_t fi, double dist)
 {
-  bool                outside;
-  glm::vec3           testPt;
-  std::vector<size_t> remove, check;
-  for (const size_t& opi : mOutsidePts) {
-    outside = false;
-    testPt  = mPts[opi];
-    for (const Face& face : poppedFaces) {
-      if (face.containsVertex(opi)) {
-        remove.push_back(opi);
-        break;
-      }
-      if (faceVisible(face, testPt)) {
-        outside = true;
-        break;
+  Face& face = mFaces[fi];
+  face.outside.push_back(pi);
+  if (dist > face.farthestDist) {
+    face.farthest     = pi;
+    face.farthestDist = dist;
+  }
+}
+
+void ConvexHull::findHorizon(size_t fi, const glm::vec3& eye)
+{
+  // Depth first search over the visible faces. Each face is left through its edges in
+  // order, starting after the edge it was entered from, so the horizon edges are found
+  // in order around the eye.
+  size_t stamp = ++mStamp;
+  mVisible.clear();
+  mHorizon.clear();
+  mFrames.clear();
+  mFaces[fi].visited = stamp;
+  mVisible.push_back(fi);
+  mFrames.push_back({fi, 0, 0, 3});
+  while (!mFrames.empty()) {
+    Frame& frame = mFrames.back();
+    if (frame.step == frame.end) {
+      mFrames.pop_back();
+      continue;
+    }
+    size_t      cur  = frame.face;
+    uint8_t     ei   = uint8_t((frame.entry + frame.step++) % 3);
+    const Face& face = mFaces[cur];
+    size_t      ni   = face.adjacent[ei];
+    Face&       next = mFaces[ni];
+    if (next.visited == stamp) {
+      continue;
+    }
+    double  dist;
+    if (side(next, eye, dist) > 0) {
+      next.visited = stamp;
+      mVisible.push_back(ni);
+      uint8_t entry = 0;
+      while (next.adjacent[entry] != cur) {
+        entry++;
       }
+      mFrames.push_back({ni, entry, 1, 3});
     }
-
-    if (outside) {
-      check.push_back(opi);
+    else {
+      mHorizon.push_back({face.indices[ei], face.indices[(ei + 1) % 3], ni});
     }
   }
+}
 
-  for (const size_t& ci : check) {
-    outside = false;
-    testPt  = mPts[ci];
-    for (const Face& newFace : newFaces) {
-      if (faceVisible(newFace, testPt)) {
-        outside = true;
+void ConvexHull::addPoint(size_t fi)
+{
+  size_t    eyeIndex = mFaces[fi].farthest;
+  glm::vec3 eye      = mPts[eyeIndex];
+  findHorizon(fi, eye);
+  mOrphans.clear();
+  for (size_t vi : mVisible) {
+    const auto& outside = mFaces[vi].outside;
+    std::copy_if(outside.begin(),
+                 outside.end(),
+                 std::back_inserter(mOrphans),
+                 [eyeIndex](size_t pi) { return pi != eyeIndex; });
+    removeFace(vi);
+  }
+  // One new face per horizon edge, each sharing its sides with the previous and the next
+  // one around the horizon.
+  mNewFaces.clear();
+  for (const HorizonEdge& edge : mHorizon) {
+    size_t nfi        = addFace(edge.p, edge.q, eyeIndex);
+    Face&  nface      = mFaces[nfi];
+    Face&  neighbor   = mFaces[edge.neighbor];
+    nface.adjacent[0] = edge.neighbor;
+    for (uint8_t i = 0; i < 3; i++) {
+      if (neighbor.indices[i] == edge.q && neighbor.indices[(i + 1) % 3] == edge.p) {
+        neighbor.adjacent[i] = nfi;
         break;
       }
     }
-
-    if (!outside) {
-      remove.push_back(ci);
-    }
+    mNewFaces.push_back(nfi);
   }
-
-  for (const size_t& ri : remove) {
-    mOutsidePts.erase(ri);
+  size_t nNew = mNewFaces.size();
+  for (size_t i = 0; i < nNew; i++) {
+    Face& nface       = mFaces[mNewFaces[i]];
+    nface.adjacent[1] = mNewFaces[(i + 1) % nNew];
+    nface.adjacent[2] = mNewFaces[(i + nNew - 1) % nNew];
+  }
+  for (size_t pi : mOrphans) {
+    assign(pi, mNewFaces.data(), nNew);
+  }
+  for (size_t nfi : mNewFaces) {
+    if (!mFaces[nfi].outside.empty()) {
+      mFaceStack.push_back(nfi);
+    }
   }
 }
 
-void ConvexHull::createInitialSimplex(size_t& faceIndex)
+void ConvexHull::createInitialSimplex()
 {
-  size_t best[4];
+  size_t best[4] = {0, 0, 0, 0};
   if (mPts.size() < 4) {
     throw "Failed to create the initial simplex";
   }
-  else if (mPts.size() == 4) {
-    for (size_t i = 0; i < 4; i++) {
-      best[i] = i;
-    }
-  }
-  else {
-    float extremes[6];
-    for (size_t ei = 0; ei < 6; ei++) {
-      extremes[ei] = ei % 2 == 0 ? FLT_MAX : -FLT_MAX;
-    }
-
-    size_t bounds[6];
-    for (size_t i = 0; i < 6; i++) {
-      bounds[i] = (size_t)(-1);
-    }
-    float coords[3];
-    for (size_t pi = 0; pi < mPts.size(); pi++) {
-      std::copy_n(&mPts[pi].x, 3, coords);
-      for (size_t ei = 0; ei < 6; ei++) {
-        if (ei % 2 == 0 && extremes[ei] > coords[ei / 2]) {
-          extremes[ei] = coords[ei / 2];
-          bounds[ei]   = pi;
-        }
-        else if (ei % 2 == 1 && extremes[ei] < coords[ei / 2]) {
-          extremes[ei] = coords[ei / 2];
-          bounds[ei]   = pi;
-        }
+  // Points extreme along each axis.
+  size_t* bounds = mExtremes;
+  std::fill_n(bounds, 6, 0);
+  mMaxCoord = 0.;
+  for (size_t pi = 0; pi < mPts.size(); pi++) {
+    const glm::vec3& pt = mPts[pi];
+    for (int axis = 0; axis < 3; axis++) {
+      if (pt[axis] < mPts[bounds[2 * axis]][axis]) {
+        bounds[2 * axis] = pi;
       }
-    }
-
-    glm::vec3 pt;
-    float     maxD = -FLT_MAX, dist;
-    for (size_t i = 0; i < 6; i++) {
-      pt = mPts[bounds[i]];
-      for (size_t j = i + 1; j < 6; j++) {
-        dist = glm::length2(pt - mPts[bounds[j]]);
-        if (dist > maxD) {
-          best[0] = bounds[i];
-          best[1] = bounds[j];
-          maxD    = dist;
-        }
+      if (pt[axis] > mPts[bounds[2 * axis + 1]][axis]) {
+        bounds[2 * axis + 1] = pi;
       }
+      mMaxCoord = std::max(mMaxCoord, double(std::abs(pt[axis])));
     }
+  }
 
-    if (maxD <= 0) {
-      throw "Failed to create the initial simplex";
-    }
-
-    maxD           = -FLT_MAX;
-    glm::vec3 ref  = mPts[best[0]];
-    glm::vec3 uDir = glm::normalize(mPts[best[1]] - ref);
-    for (size_t pi = 0; pi < mPts.size(); pi++) {
-      dist = glm::length2((mPts[pi] - ref) - uDir * glm::dot(uDir, (mPts[pi] - ref)));
+  float maxD = 0.f;
+  for (size_t i = 0; i < 6; i++) {
+    for (size_t j = i + 1; j < 6; j++) {
+      float dist = glm::length2(mPts[bounds[i]] - mPts[bounds[j]]);
       if (dist > maxD) {
-        best[2] = pi;
+        best[0] = bounds[i];
+        best[1] = bounds[j];
         maxD    = dist;
       }
     }
+  }
+  if (maxD <= 0.f) {
+    throw "Failed to create the initial simplex";
+  }
 
-    if (maxD <= 0) {
-      throw "Failed to create the initial simplex";
+  maxD           = 0.f;
+  glm::vec3 ref  = mPts[best[0]];
+  glm::vec3 uDir = glm::normalize(mPts[best[1]] - ref);
+  for (size_t pi = 0; pi < mPts.size(); pi++) {
+    float dist = glm::length2((mPts[pi] - ref) - uDir * glm::dot(uDir, (mPts[pi] - ref)));
+    if (dist > maxD) {
+      best[2] = pi;
+      maxD    = dist;
     }
+  }
+  if (maxD <= 0.f) {
+    throw "Failed to create the initial simplex";
+  }
 
-    maxD = -FLT_MAX;
-    uDir = glm::normalize(glm::cross(mPts[best[1]] - ref, mPts[best[2]] - ref));
-    for (size_t pi = 0; pi < mPts.size(); pi++) {
-      dist = std::abs(glm::dot(uDir, (mPts[pi] - ref)));
-      if (dist > maxD) {
-        best[3] = pi;
-        maxD    = dist;
+  maxD = 0.f;
+  uDir = glm::normalize(glm::cross(mPts[best[1]] - ref, mPts[best[2]] - ref));
+  for (size_t pi = 0; pi < mPts.size(); pi++) {
+    float dist = std::abs(glm::dot(uDir, (mPts[pi] - ref)));
+    if (dist > maxD) {
+      best[3] = pi;
+      maxD    = dist;
+    }
+  }
+  // Orient the first face away from the fourth point, and the others to match.
+  int orientation = orient3d(mPts[best[0]], mPts[best[1]], mPts[best[2]], mPts[best[3]]);
+  if (orientation == 0) {
+    throw "Failed to create the initial simplex";
+  }
+  else if (orientation > 0) {
+    std::swap(best[1], best[2]);
+  }
+  size_t v0 = best[0], v1 = best[1], v2 = best[2], v3 = best[3];
+  addFace(v0, v1, v2);  // 0
+  addFace(v0, v3, v1);  // 1
+  addFace(v1, v3, v2);  // 2
+  addFace(v2, v3, v0);  // 3
+  // Each edge of each face is shared with exactly one other face.
+  for (size_t fi = 0; fi < 4; fi++) {
+    for (uint8_t ei = 0; ei < 3; ei++) {
+      size_t p = mFaces[fi].indices[ei], q = mFaces[fi].indices[(ei + 1) % 3];
+      for (size_t fj = 0; fj < 4; fj++) {
+        for (uint8_t ej = 0; ej < 3; ej++) {
+          if (mFaces[fj].indices[ej] == q && mFaces[fj].indices[(ej + 1) % 3] == p) {
+            mFaces[fi].adjacent[ei] = fj;
+          }
+        }
       }
     }
+  }
+}
 
-    if (maxD <= 0) {
-      throw "Failed to create the initial simplex";
+Mesh ConvexHull::toMesh() const
+{
+  std::unordered_map<size_t, size_t, CustomSizeTHash> map;
+  std::vector<glm::vec3>                              vertices;
+  std::vector<Mesh::Face>                             faces;
+  faces.reserve(numFaces());
+  map.reserve(numFaces() / 2 + 2);
+  vertices.reserve(numFaces() / 2 + 2);
+  for (const Face& face : mFaces) {
+    if (!face.alive) {
+      continue;
+    }
+    size_t indices[3];
+    for (uint8_t i = 0; i < 3; i++) {
+      auto match = map.find(face.indices[i]);
+      if (match == map.end()) {
+        indices[i] = vertices.size();
+        map.emplace(face.indices[i], vertices.size());
+        vertices.push_back(mPts[face.indices[i]]);
+      }
+      else {
+        indices[i] = match->second;
+      }
     }
+    faces.emplace_back(indices);
   }
+  return Mesh(std::move(vertices), std::move(faces));
+}
 
-  Face simplex[4];
-  simplex[0] = Face(faceIndex++, best[0], best[1], best[2]);
-  simplex[1] = Face(faceIndex++, best[0], best[2], best[3]);
-  simplex[2] = Face(faceIndex++, best[1], best[2], best[3]);
-  simplex[3] = Face(faceIndex++, best[0], best[1], best[3]);
-
-  mCenter = vec3_zero;
-  for (size_t i = 0; i < 4; i++) {
-    mCenter += mPts[best[i]];
+std::vector<glm::vec3> IncrementalConvexHull::reduceBatch(const glm::vec3* points,
+                                                          size_t           nPoints) const
+{
+  std::vector<glm::vec3> pts(points, points + nPoints);
+  if (nPoints < sSubHullSize / 8) {
+    return pts;
   }
-  mCenter /= 4;
-
-  for (size_t i = 0; i < 4; i++) {
-    if (!simplex[i].isValid()) {
-      continue;
-    }
-    setFace(simplex[i]);
+  try {
+    ConvexHull             hull(std::move(pts), eConvexHullMode::filtered);
+    std::vector<size_t>    indices = hull.vertexIndices();
+    std::vector<glm::vec3> verts(indices.size());
+    std::transform(indices.begin(), indices.end(), verts.begin(), [&](size_t pi) {
+      return hull.getPt(pi);
+    });
+    return verts;
   }
+  catch (const char*) {
+    // The batch is flat, so it is tested as it is.
+    return std::vector<glm::vec3>(points, points + nPoints);
+  }
+}
 
-  std::vector<size_t> removePts;
-  bool                outside;
-  for (const size_t& opi : mOutsidePts) {
-    outside = false;
-    for (size_t i = 0; i < 4; i++) {
-      if (simplex[i].containsVertex(opi)) {
-        removePts.push_back(opi);
-        break;
-      }
-      if (faceVisible(simplex[i], getPt(opi))) {
-        outside = true;
+void IncrementalConvexHull::reduceFlat()
+{
+  if (mPts.size() < 4) {
+    return;
+  }
+  // The points are projected by dropping one axis. If they span a plane, the axis is one
+  // along which three of them don't project to a line, and if they are collinear it is
+  // one along which two distinct points don't project to the same point. Either way the
+  // projection is one to one on the points, and exact.
+  const glm::vec3& a = mPts[0];
+  auto bIt = std::find_if(mPts.begin(), mPts.end(), [&a](const glm::vec3& pt) {
+    return pt != a;
+  });
+  if (bIt == mPts.end()) {
+    mPts.resize(1);
+    return;
+  }
+  const glm::vec3 b       = *bIt;
+  const auto      project = [](const glm::vec3& pt, int drop) {
+    return glm::dvec2(pt[(drop + 1) % 3], pt[(drop + 2) % 3]);
+  };
+  int    drop = -1;
+  size_t ci   = SIZE_MAX;
+  for (size_t pi = 0; pi < mPts.size() && drop == -1; pi++) {
+    for (int axis = 0; axis < 3; axis++) {
+      if (orient2d(project(a, axis), project(b, axis), project(mPts[pi], axis)) != 0) {
+        drop = axis;
+        ci   = pi;
         break;
       }
     }
-
-    if (!outside) {
-      removePts.push_back(opi);
+  }
+  if (drop == -1) {
+    // Collinear, so the shortest extent of the line is dropped.
+    glm::vec3 span = glm::abs(b - a);
+    drop = span.x <= span.y && span.x <= span.z ? 0 : (span.y <= span.z ? 1 : 2);
+  }
+  else {
+    const glm::vec3& c = mPts[ci];
+    for (const glm::vec3& pt : mPts) {
+      if (orient3d(a, b, c, pt) != 0) {
+        return;  // Not flat after all, the points are kept for the next batch.
+      }
     }
   }
-
-  for (const size_t& ri : removePts) {
-    mOutsidePts.erase(ri);
+  std::vector<glm::vec2> flat(mPts.size());
+  std::vector<size_t>    order(mPts.size());
+  std::iota(order.begin(), order.end(), 0);
+  for (size_t pi = 0; pi < mPts.size(); pi++) {
+    flat[pi] = glm::vec2(project(mPts[pi], drop));
+  }
+  const auto lexLess = [](const glm::vec2& p, const glm::vec2& q) {
+    return p.x < q.x || (p.x == q.x && p.y < q.y);
+  };
+  std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+    return lexLess(flat[i], flat[j]);
+  });
+  ConvexHull2d           hull(flat.data(), flat.size());
+  std::vector<glm::vec3> pts;
+  pts.reserve(hull.size());
+  for (const glm::vec2& v : hull.vertices()) {
+    size_t pi = *std::lower_bound(
+      order.begin(), order.end(), v, [&](size_t i, const glm::vec2& q) {
+        return lexLess(flat[i], q);
+      });
+    pts.push_back(mPts[pi]);
   }
+  mPts = std::move(pts);
 }
 
-bool ConvexHull::getFace(size_t id, Face& face) const
+void IncrementalConvexHull::addPoints(const glm::vec3* points, size_t nPoints)
 {
-  auto match = mFaces.find(id);
-  if (match != mFaces.end()) {
-    face = match->second;
-    return true;
+  std::vector<glm::vec3> batch = reduceBatch(points, nPoints);
+  if (batch.empty()) {
+    return;
+  }
+  size_t first = mPts.size();
+  mPts.insert(mPts.end(), batch.begin(), batch.end());
+  if (!mInitialized) {
+    try {
+      createInitialSimplex();
+    }
+    catch (const char*) {
+      // Not enough points yet, so only the ones that can be vertices of the hull are
+      // kept.
+      reduceFlat();
+      return;
+    }
+    mInitialized            = true;
+    const size_t simplex[4] = {0, 1, 2, 3};
+    for (size_t pi = 0; pi < mPts.size(); pi++) {
+      assign(pi, simplex, 4);
+    }
+    for (size_t fi = 0; fi < 4; fi++) {
+      mFaceStack.push_back(fi);
+    }
+  }
+  else {
+    // The filters of the faces are only valid for coordinates up to mMaxCoord.
+    double maxCoord = mMaxCoord;
+    for (const glm::vec3& pt : batch) {
+      for (int axis = 0; axis < 3; axis++) {
+        maxCoord = std::max(maxCoord, double(std::abs(pt[axis])));
+      }
+    }
+    std::vector<size_t> faces;
+    faces.reserve(mNumFaces);
+    for (size_t fi = 0; fi < mFaces.size(); fi++) {
+      if (mFaces[fi].alive) {
+        faces.push_back(fi);
+      }
+    }
+    if (maxCoord > mMaxCoord) {
+      mMaxCoord = maxCoord;
+      for (size_t fi : faces) {
+        setPlane(mFaces[fi]);
+      }
+    }
+    size_t              nNew = mPts.size() - first;
+    std::vector<size_t> best(nNew);
+    std::vector<double> dists(nNew);
+    tbb::parallel_for(size_t(0), nNew, [&](size_t i) {
+      best[i] = farthestFace(first + i, faces.data(), faces.size(), dists[i]);
+    });
+    for (size_t i = 0; i < nNew; i++) {
+      if (best[i] != SIZE_MAX) {
+        if (mFaces[best[i]].outside.empty()) {
+          mFaceStack.push_back(best[i]);
+        }
+        assign(first + i, best[i], dists[i]);
+      }
+    }
   }
-  return false;
+  expand();
+  compact();
+  mMesh = std::make_shared<const Mesh>(toMesh());
 }
 
-bool ConvexHull::getEdgeFaces(const gal::IndexPair& edge, gal::IndexPair& faces) const
+void IncrementalConvexHull::compact()
 {
-  auto match = mEdgeFaceMap.find(edge);
-  if (match != mEdgeFaceMap.end()) {
-    faces = match->second;
-    return true;
+  // Only the vertices of the hull are kept.
+  std::vector<size_t>    remap(mPts.size(), SIZE_MAX);
+  std::vector<glm::vec3> pts;
+  pts.reserve(mNumFaces / 2 + 2);
+  for (Face& face : mFaces) {
+    if (!face.alive) {
+      continue;
+    }
+    for (size_t& vi : face.indices) {
+      if (remap[vi] == SIZE_MAX) {
+        remap[vi] = pts.size();
+        pts.push_back(mPts[vi]);
+      }
+      vi = remap[vi];
+    }
   }
-  return false;
+  mPts = std::move(pts);
 }
 
-glm::vec3 ConvexHull::faceCenter(const Face& face) const
+std::shared_ptr<const Mesh> IncrementalConvexHull::mesh() const noexcept
 {
-  return (mPts[face.a] + mPts[face.b] + mPts[face.c]) / 3.0f;
+  return mMesh;
 }
 
-Mesh ConvexHull::toMesh() const
+size_t IncrementalConvexHull::numPoints() const noexcept
 {
-  std::unordered_map<size_t, size_t, CustomSizeTHash> map;
-  std::vector<glm::vec3>                              vertices;
-  std::vector<Mesh::Face>                             faces;
-  faces.reserve(numFaces());
-  vertices.reserve(mPts.size());
-
-  std::transform(mFaces.cbegin(),
-                 mFaces.cend(),
-                 std::back_inserter(faces),
-                 [&map, &vertices, this](const auto& pair) {
-                   const auto& face = pair.second;
-                   size_t      indices[3];
-                   for (uint8_t i = 0; i < 3; i++) {
-                     auto match = map.find(face.indices[i]);
-                     if (match == map.end()) {
-                       indices[i] = vertices.size();
-                       vertices.push_back(mPts[face.indices[i]]);
-                     }
-                     else {
-                       indices[i] = match->second;
-                     }
-                   }
-                   return Mesh::Face(indices);
-                 });
-
-  return Mesh(std::move(vertices), std::move(faces));
+  return mPts.size();
 }
 
-}  // namespace gal
\ No newline at end of file
+}  // namespace gal
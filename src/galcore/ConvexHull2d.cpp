@@ -0,0 +1,160 @@
+#include <galcore/ConvexHull2d.h>
+#include <galcore/Predicates.h>
+#include <tbb/tbb.h>
+#include <array>
+
+namespace gal {
+
+static int orient(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+  return orient2d(glm::dvec2(a), glm::dvec2(b), glm::dvec2(c));
+}
+
+/*Replaces the points with their hull. The points are sorted in place.*/
+static void monotoneChain(std::vector<glm::vec2>& points)
+{
+  tbb::parallel_sort(
+    points.begin(), points.end(), [](const glm::vec2& a, const glm::vec2& b) {
+      return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  if (points.size() < 3) {
+    return;
+  }
+  std::vector<glm::vec2> hull;
+  hull.reserve(points.size() + 1);
+  // Lower chain from left to right, then the upper chain from right to left.
+  for (const glm::vec2& pt : points) {
+    while (hull.size() > 1 && orient(hull[hull.size() - 2], hull.back(), pt) <= 0) {
+      hull.pop_back();
+    }
+    hull.push_back(pt);
+  }
+  size_t lowerSize = hull.size();
+  for (auto it = points.rbegin() + 1; it != points.rend(); it++) {
+    while (hull.size() > lowerSize &&
+           orient(hull[hull.size() - 2], hull.back(), *it) <= 0) {
+      hull.pop_back();
+    }
+    hull.push_back(*it);
+  }
+  hull.pop_back();  // The first point again.
+  points = std::move(hull);
+}
+
+/*Whether the point is strictly inside the convex polygon with the given counter-clockwise
+ * vertices. The wedge of the fan from the first vertex containing the point is found by a
+ * binary search.*/
+static bool strictlyInside(const std::vector<glm::vec2>& poly, const glm::vec2& pt)
+{
+  size_t n = poly.size();
+  if (n < 3 || orient(poly[0], poly[1], pt) <= 0 ||
+      orient(poly[0], poly[n - 1], pt) >= 0) {
+    return false;
+  }
+  size_t lo = 1, hi = n - 1;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (orient(poly[0], poly[mid], pt) > 0) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return orient(poly[lo], poly[hi], pt) > 0;
+}
+
+ConvexHull2d::ConvexHull2d(const glm::vec2* points, size_t nPoints)
+{
+  addPoints(points, nPoints);
+}
+
+void ConvexHull2d::addPoints(const glm::vec2* points, size_t nPoints)
+{
+  if (nPoints == 0) {
+    return;
+  }
+  // Extreme points of the chunk along the axes and the diagonals.
+  using Extremes = std::array<glm::vec2, 8>;
+  static const auto score = [](const glm::vec2& p, size_t i) {
+    float s = i < 2 ? p.x : (i < 4 ? p.y : (i < 6 ? p.x + p.y : p.x - p.y));
+    return i % 2 ? s : -s;
+  };
+  Extremes init;
+  init.fill(points[0]);
+  Extremes extremes = tbb::parallel_reduce(
+    tbb::blocked_range<size_t>(0, nPoints),
+    init,
+    [&](const tbb::blocked_range<size_t>& r, Extremes ext) {
+      for (size_t pi = r.begin(); pi < r.end(); pi++) {
+        for (size_t i = 0; i < 8; i++) {
+          if (score(points[pi], i) > score(ext[i], i)) {
+            ext[i] = points[pi];
+          }
+        }
+      }
+      return ext;
+    },
+    [](Extremes a, const Extremes& b) {
+      for (size_t i = 0; i < 8; i++) {
+        if (score(b[i], i) > score(a[i], i)) {
+          a[i] = b[i];
+        }
+      }
+      return a;
+    });
+  std::vector<glm::vec2> filter(mVertices);
+  filter.insert(filter.end(), extremes.begin(), extremes.end());
+  monotoneChain(filter);
+
+  // Only the points outside the filter polygon, and its vertices, can be on the hull.
+  static constexpr size_t sChunkSize = size_t(1) << 12;
+  size_t                  nChunks    = (nPoints + sChunkSize - 1) / sChunkSize;
+  std::vector<std::vector<glm::vec2>> outside(nChunks);
+  tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+    size_t last = std::min(nPoints, (ci + 1) * sChunkSize);
+    for (size_t pi = ci * sChunkSize; pi < last; pi++) {
+      if (!strictlyInside(filter, points[pi])) {
+        outside[ci].push_back(points[pi]);
+      }
+    }
+  });
+  for (const auto& pts : outside) {
+    filter.insert(filter.end(), pts.begin(), pts.end());
+  }
+  monotoneChain(filter);
+  mVertices = std::move(filter);
+}
+
+const std::vector<glm::vec2>& ConvexHull2d::vertices() const noexcept
+{
+  return mVertices;
+}
+
+size_t ConvexHull2d::size() const noexcept
+{
+  return mVertices.size();
+}
+
+bool ConvexHull2d::contains(const glm::vec2& pt) const
+{
+  size_t n = mVertices.size();
+  if (n < 3) {
+    // A point or a segment.
+    if (n == 0 || orient(mVertices.front(), mVertices.back(), pt) != 0) {
+      return false;
+    }
+    glm::vec2 lo = glm::min(mVertices.front(), mVertices.back());
+    glm::vec2 hi = glm::max(mVertices.front(), mVertices.back());
+    return lo.x <= pt.x && pt.x <= hi.x && lo.y <= pt.y && pt.y <= hi.y;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (orient(mVertices[i], mVertices[(i + 1) % n], pt) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace gal
@@ -0,0 +1,547 @@
+#include "BrioOrder.h"
+#include <galcore/Delaunay2.h>
+#include <deque>
+
+namespace gal {
+
+/*Bits per axis of the Hilbert keys.*/
+static constexpr uint32_t sHilbertBits = 16;
+
+Delaunay2::Delaunay2(const std::vector<glm::vec2>& points,
+                     const std::vector<IndexPair>& constraints)
+    : mPts(points)
+{
+  compute(constraints);
+}
+
+glm::vec2 Delaunay2::getPt(size_t index) const
+{
+  return index < mPts.size() ? mPts[index] : vec2_unset;
+}
+
+size_t Delaunay2::numPoints() const
+{
+  return mPts.size();
+}
+
+size_t Delaunay2::numTriangles() const
+{
+  return mFinite.size();
+}
+
+std::array<size_t, 3> Delaunay2::triangle(size_t ti) const
+{
+  const Tri& tri = mTris[mFinite[ti]];
+  return {tri.v[0], tri.v[1], tri.v[2]};
+}
+
+bool Delaunay2::isConstrained(size_t ti, uint8_t i) const
+{
+  return (mTris[mFinite[ti]].constrained >> i) & 1;
+}
+
+void Delaunay2::copyTriangles(int* triIndices) const
+{
+  for (size_t ti : mFinite) {
+    for (size_t vi : mTris[ti].v) {
+      *(triIndices++) = (int)vi;
+    }
+  }
+}
+
+Circle2d Delaunay2::circumcircle(size_t ti) const
+{
+  const Tri& tri = mTris[mFinite[ti]];
+  return Circle2d::createCircumcircle(mPts[tri.v[0]], mPts[tri.v[1]], mPts[tri.v[2]]);
+}
+
+std::vector<size_t> Delaunay2::enclosedTriangles() const
+{
+  // Fewest constraints crossed from the outside to each triangle, with a 0-1 breadth
+  // first search.
+  std::vector<size_t> depth(mTris.size(), SIZE_MAX);
+  std::deque<size_t>  queue;
+  for (size_t ti = 0; ti < mTris.size(); ti++) {
+    if (mTris[ti].alive && infiniteSlot(mTris[ti]) != 3) {
+      depth[ti] = 0;
+      queue.push_back(ti);
+    }
+  }
+  while (!queue.empty()) {
+    size_t ti = queue.front();
+    queue.pop_front();
+    const Tri& tri = mTris[ti];
+    for (uint8_t i = 0; i < 3; i++) {
+      size_t ni    = tri.adj[i];
+      bool   cross = (tri.constrained >> i) & 1;
+      if (depth[ti] + cross < depth[ni]) {
+        depth[ni] = depth[ti] + cross;
+        if (cross) {
+          queue.push_back(ni);
+        }
+        else {
+          queue.push_front(ni);
+        }
+      }
+    }
+  }
+  std::vector<size_t> enclosed;
+  for (size_t i = 0; i < mFinite.size(); i++) {
+    if (depth[mFinite[i]] % 2) {
+      enclosed.push_back(i);
+    }
+  }
+  return enclosed;
+}
+
+void Delaunay2::compute(const std::vector<IndexPair>& constraints)
+{
+  std::vector<size_t> order = brioOrder<sHilbertBits>(mPts, false);
+  mVertTri.assign(mPts.size(), SIZE_MAX);
+  mDuplicateOf.assign(mPts.size(), SIZE_MAX);
+  mStartOf.assign(mPts.size() + 1, SIZE_MAX);
+  std::array<size_t, 3> initial = createInitialTri(order);
+  for (size_t pi : order) {
+    if (std::find(initial.begin(), initial.end(), pi) == initial.end()) {
+      insert(pi);
+    }
+  }
+  for (const IndexPair& edge : constraints) {
+    if (edge.p >= mPts.size() || edge.q >= mPts.size()) {
+      throw "Constraint edge with an invalid point index";
+    }
+    size_t a = mDuplicateOf[edge.p] == SIZE_MAX ? edge.p : mDuplicateOf[edge.p];
+    size_t b = mDuplicateOf[edge.q] == SIZE_MAX ? edge.q : mDuplicateOf[edge.q];
+    if (a != b) {
+      insertConstraint(a, b);
+    }
+  }
+  for (size_t ti = 0; ti < mTris.size(); ti++) {
+    if (mTris[ti].alive && infiniteSlot(mTris[ti]) == 3) {
+      mFinite.push_back(ti);
+    }
+  }
+}
+
+glm::dvec2 Delaunay2::point(size_t vi) const
+{
+  return glm::dvec2(mPts[vi]);
+}
+
+uint8_t Delaunay2::infiniteSlot(const Tri& tri) const
+{
+  uint8_t i = 0;
+  while (i < 3 && tri.v[i] != sInfinite) {
+    i++;
+  }
+  return i;
+}
+
+bool Delaunay2::inConflict(size_t ti, const glm::dvec2& pt) const
+{
+  const Tri& tri = mTris[ti];
+  uint8_t    inf = infiniteSlot(tri);
+  if (inf == 3) {
+    return incircle(point(tri.v[0]), point(tri.v[1]), point(tri.v[2]), pt) > 0;
+  }
+  // The circumcircle of a triangle at infinity is the open half plane beyond its finite
+  // edge. On the line of the edge, it follows the finite neighbor.
+  int side =
+    orient2d(point(tri.v[(inf + 1) % 3]), point(tri.v[(inf + 2) % 3]), pt);
+  return side != 0 ? side > 0 : inConflict(tri.adj[inf], pt);
+}
+
+size_t Delaunay2::addTri(size_t a, size_t b, size_t c)
+{
+  size_t ti;
+  if (mFreeTris.empty()) {
+    ti = mTris.size();
+    mTris.emplace_back();
+  }
+  else {
+    ti = mFreeTris.back();
+    mFreeTris.pop_back();
+  }
+  Tri& tri = mTris[ti];
+  tri.v[0] = a;
+  tri.v[1] = b;
+  tri.v[2] = c;
+  std::fill_n(tri.adj, 3, SIZE_MAX);
+  tri.stamp       = 0;
+  tri.constrained = 0;
+  tri.alive       = true;
+  for (size_t vi : tri.v) {
+    if (vi != sInfinite) {
+      mVertTri[vi] = ti;
+    }
+  }
+  return ti;
+}
+
+void Delaunay2::linkNewTris()
+{
+  // The new triangles (a, b, apex) fan around the apex, so the one across the edge
+  // opposite a is the one that starts at b.
+  auto key = [this](size_t vi) { return vi == sInfinite ? mPts.size() : vi; };
+  for (size_t ti : mNewTris) {
+    mStartOf[key(mTris[ti].v[0])] = ti;
+  }
+  for (size_t ti : mNewTris) {
+    size_t next       = mStartOf[key(mTris[ti].v[1])];
+    mTris[ti].adj[0]  = next;
+    mTris[next].adj[1] = ti;
+  }
+}
+
+std::array<size_t, 3> Delaunay2::createInitialTri(const std::vector<size_t>& order)
+{
+  static constexpr const char* sError = "Cannot triangulate collinear points";
+  auto                         it     = order.begin();
+  auto                         next   = [&](const auto& accept) {
+    while (it != order.end() && !accept(point(*it))) {
+      it++;
+    }
+    if (it == order.end()) {
+      throw sError;
+    }
+    return *(it++);
+  };
+  size_t     v0 = next([](const glm::dvec2&) { return true; });
+  glm::dvec2 p0 = point(v0);
+  size_t     v1 = next([&](const glm::dvec2& p) { return p != p0; });
+  glm::dvec2 p1 = point(v1);
+  size_t     v2 = next([&](const glm::dvec2& p) { return orient2d(p0, p1, p) != 0; });
+  if (orient2d(p0, p1, point(v2)) < 0) {
+    std::swap(v1, v2);
+  }
+  size_t t0 = addTri(v0, v1, v2);
+  mNewTris.clear();
+  for (uint8_t i = 0; i < 3; i++) {
+    // The triangles at infinity see the edges from outside.
+    const Tri& tri      = mTris[t0];
+    size_t     ghost    = addTri(tri.v[(i + 2) % 3], tri.v[(i + 1) % 3], sInfinite);
+    mTris[ghost].adj[2] = t0;
+    mTris[t0].adj[i]    = ghost;
+    mNewTris.push_back(ghost);
+  }
+  linkNewTris();
+  mLast = t0;
+  return {v0, v1, v2};
+}
+
+size_t Delaunay2::locate(const glm::dvec2& pt)
+{
+  // Visibility walk from the last triangle, like Delaunay3::locate.
+  size_t  ti  = mLast;
+  uint8_t inf = infiniteSlot(mTris[ti]);
+  if (inf != 3) {
+    ti = mTris[ti].adj[inf];
+  }
+  size_t prev = SIZE_MAX;
+  while (true) {
+    const Tri& tri = mTris[ti];
+    if (infiniteSlot(tri) != 3) {
+      return ti;
+    }
+    mRand ^= mRand << 13;
+    mRand ^= mRand >> 17;
+    mRand ^= mRand << 5;
+    uint8_t first = uint8_t(mRand % 3);
+    size_t  next  = SIZE_MAX;
+    for (uint8_t j = 0; j < 3 && next == SIZE_MAX; j++) {
+      uint8_t i = uint8_t((first + j) % 3);
+      if (tri.adj[i] != prev &&
+          orient2d(point(tri.v[(i + 1) % 3]), point(tri.v[(i + 2) % 3]), pt) < 0) {
+        next = tri.adj[i];
+      }
+    }
+    if (next == SIZE_MAX) {
+      return ti;
+    }
+    prev = ti;
+    ti   = next;
+  }
+}
+
+void Delaunay2::insert(size_t pi)
+{
+  glm::dvec2 pt    = point(pi);
+  size_t     start = locate(pt);
+  if (!inConflict(start, pt)) {
+    // The point is a vertex of the triangle it fell in.
+    for (size_t vi : mTris[start].v) {
+      if (vi != sInfinite && mPts[vi] == mPts[pi]) {
+        mDuplicateOf[pi] = vi;
+      }
+    }
+    return;
+  }
+  // Same cavity search as Delaunay3::insert.
+  size_t stamp = mStamp + 1;
+  mStamp += 2;
+  mCavity.clear();
+  mBoundary.clear();
+  mStack.clear();
+  mTris[start].stamp = stamp;
+  mStack.push_back(start);
+  while (!mStack.empty()) {
+    size_t ci = mStack.back();
+    mStack.pop_back();
+    mCavity.push_back(ci);
+    for (uint8_t i = 0; i < 3; i++) {
+      size_t ni = mTris[ci].adj[i];
+      if (mTris[ni].stamp == stamp) {
+        continue;
+      }
+      if (mTris[ni].stamp != stamp + 1) {
+        if (inConflict(ni, pt)) {
+          mTris[ni].stamp = stamp;
+          mStack.push_back(ni);
+          continue;
+        }
+        mTris[ni].stamp = stamp + 1;
+      }
+      const Tri& tri  = mTris[ci];
+      const Tri& nbr  = mTris[ni];
+      uint8_t    slot = 0;
+      while (nbr.adj[slot] != ci) {
+        slot++;
+      }
+      mBoundary.push_back({{tri.v[(i + 1) % 3], tri.v[(i + 2) % 3]}, ni, slot});
+    }
+  }
+  for (size_t ci : mCavity) {
+    mTris[ci].alive = false;
+    mFreeTris.push_back(ci);
+  }
+  mNewTris.clear();
+  for (const BoundaryEdge& edge : mBoundary) {
+    size_t ti                           = addTri(edge.v[0], edge.v[1], pi);
+    mTris[ti].adj[2]                    = edge.neighbor;
+    mTris[edge.neighbor].adj[edge.slot] = ti;
+    mNewTris.push_back(ti);
+  }
+  linkNewTris();
+  mLast = mNewTris.back();
+}
+
+bool Delaunay2::findEdge(size_t u, size_t v, size_t& ti, uint8_t& slot) const
+{
+  // Rotates counter-clockwise around u.
+  size_t start = mVertTri[u];
+  ti           = start;
+  do {
+    const Tri& tri = mTris[ti];
+    uint8_t    i   = 0;
+    while (tri.v[i] != u) {
+      i++;
+    }
+    if (tri.v[(i + 1) % 3] == v) {
+      slot = uint8_t((i + 2) % 3);
+      return true;
+    }
+    if (tri.v[(i + 2) % 3] == v) {
+      slot = uint8_t((i + 1) % 3);
+      return true;
+    }
+    ti = tri.adj[(i + 1) % 3];
+  } while (ti != start);
+  return false;
+}
+
+void Delaunay2::replaceNeighbor(size_t ti, size_t oldNeighbor, size_t newNeighbor)
+{
+  for (size_t& ni : mTris[ti].adj) {
+    if (ni == oldNeighbor) {
+      ni = newNeighbor;
+      return;
+    }
+  }
+}
+
+void Delaunay2::flip(size_t ti, uint8_t k)
+{
+  // The triangles (p, q, r) and (s, r, q) become (p, q, s) and (s, r, p).
+  size_t  ni = mTris[ti].adj[k];
+  uint8_t m  = 0;
+  while (mTris[ni].adj[m] != ti) {
+    m++;
+  }
+  Tri&    t = mTris[ti];
+  Tri&    n = mTris[ni];
+  uint8_t k1 = uint8_t((k + 1) % 3), k2 = uint8_t((k + 2) % 3);
+  uint8_t m1 = uint8_t((m + 1) % 3), m2 = uint8_t((m + 2) % 3);
+  size_t  p = t.v[k], q = t.v[k1], r = t.v[k2], s = n.v[m];
+  size_t  aq = t.adj[k1], ar = t.adj[k2], br = n.adj[m1], bq = n.adj[m2];
+  uint8_t caq = (t.constrained >> k1) & 1, car = (t.constrained >> k2) & 1;
+  uint8_t cbr = (n.constrained >> m1) & 1, cbq = (n.constrained >> m2) & 1;
+
+  t.v[0] = p, t.v[1] = q, t.v[2] = s;
+  t.adj[0] = br, t.adj[1] = ni, t.adj[2] = ar;
+  t.constrained = uint8_t(cbr | (car << 2));
+  n.v[0] = s, n.v[1] = r, n.v[2] = p;
+  n.adj[0] = aq, n.adj[1] = ti, n.adj[2] = bq;
+  n.constrained = uint8_t(caq | (cbq << 2));
+  replaceNeighbor(br, ni, ti);
+  replaceNeighbor(aq, ti, ni);
+  for (size_t vi : {p, q, s}) {
+    if (vi != sInfinite) {
+      mVertTri[vi] = ti;
+    }
+  }
+  if (r != sInfinite) {
+    mVertTri[r] = ni;
+  }
+}
+
+void Delaunay2::setConstrained(size_t u, size_t v)
+{
+  size_t  ti;
+  uint8_t slot;
+  if (!findEdge(u, v, ti, slot)) {
+    throw "Constraint edge was not recovered";
+  }
+  size_t ni = mTris[ti].adj[slot];
+  mTris[ti].constrained |= uint8_t(1 << slot);
+  for (uint8_t i = 0; i < 3; i++) {
+    if (mTris[ni].adj[i] == ti) {
+      mTris[ni].constrained |= uint8_t(1 << i);
+    }
+  }
+}
+
+void Delaunay2::insertConstraint(size_t a, size_t b)
+{
+  std::vector<IndexPair> crossed;
+  while (a != b) {
+    size_t  ti;
+    uint8_t slot;
+    if (findEdge(a, b, ti, slot)) {
+      setConstrained(a, b);
+      return;
+    }
+    // Recovers the part of the edge up to the first point on it, and continues from
+    // there.
+    crossed.clear();
+    size_t stop = crossedEdges(a, b, crossed);
+    if (!crossed.empty()) {
+      recoverConstraint(a, stop, crossed);
+    }
+    setConstrained(a, stop);
+    a = stop;
+  }
+}
+
+size_t Delaunay2::crossedEdges(size_t a, size_t b, std::vector<IndexPair>& edges) const
+{
+  glm::dvec2 pa = point(a), pb = point(b);
+  // The triangle around a through which the edge leaves a.
+  size_t start = mVertTri[a];
+  size_t ti    = start;
+  size_t l = SIZE_MAX, r = SIZE_MAX;
+  do {
+    const Tri& tri = mTris[ti];
+    uint8_t    i   = 0;
+    while (tri.v[i] != a) {
+      i++;
+    }
+    size_t u = tri.v[(i + 1) % 3], w = tri.v[(i + 2) % 3];
+    if (u != sInfinite && w != sInfinite) {
+      glm::dvec2 pu = point(u), pw = point(w);
+      if (orient2d(pa, pb, pu) == 0 && glm::dot(pu - pa, pb - pa) > 0.) {
+        return u;
+      }
+      if (orient2d(pa, pb, pw) == 0 && glm::dot(pw - pa, pb - pa) > 0.) {
+        return w;
+      }
+      if (orient2d(pa, pu, pb) > 0 && orient2d(pa, pw, pb) < 0) {
+        l = w;
+        r = u;
+        break;
+      }
+    }
+    ti = tri.adj[(i + 1) % 3];
+  } while (ti != start);
+  if (l == SIZE_MAX) {
+    throw "Constraint edge leaves the convex hull";
+  }
+  // Walks along the edge, through the triangles it crosses.
+  while (true) {
+    edges.emplace_back(l, r);
+    const Tri& tri = mTris[ti];
+    uint8_t    k   = 0;
+    while (tri.v[k] == l || tri.v[k] == r) {
+      k++;
+    }
+    size_t     ni  = tri.adj[k];
+    const Tri& nbr = mTris[ni];
+    size_t     x   = nbr.v[0] ^ nbr.v[1] ^ nbr.v[2] ^ l ^ r;
+    if (x == b) {
+      return b;
+    }
+    int side = orient2d(pa, pb, point(x));
+    if (side == 0) {
+      return x;
+    }
+    (side > 0 ? l : r) = x;
+    ti                 = ni;
+  }
+}
+
+void Delaunay2::recoverConstraint(size_t a, size_t b, std::vector<IndexPair>& crossed)
+{
+  glm::dvec2 pa = point(a), pb = point(b);
+  auto       crosses = [&](size_t u, size_t v) {
+    return orient2d(pa, pb, point(u)) * orient2d(pa, pb, point(v)) < 0;
+  };
+  // Flips the crossed edges whose quadrilaterals are convex until none is left.
+  std::deque<IndexPair>  queue(crossed.begin(), crossed.end());
+  std::vector<IndexPair> created;
+  while (!queue.empty()) {
+    IndexPair edge = queue.front();
+    queue.pop_front();
+    size_t  ti;
+    uint8_t k;
+    findEdge(edge.p, edge.q, ti, k);
+    const Tri& t  = mTris[ti];
+    const Tri& n  = mTris[t.adj[k]];
+    size_t     p  = t.v[k];
+    size_t     s  = n.v[0] ^ n.v[1] ^ n.v[2] ^ edge.p ^ edge.q;
+    glm::dvec2 pp = point(p), ps = point(s);
+    if (orient2d(pp, ps, point(edge.p)) * orient2d(pp, ps, point(edge.q)) >= 0) {
+      queue.push_back(edge);
+      continue;
+    }
+    flip(ti, k);
+    if (crosses(p, s)) {
+      queue.emplace_back(p, s);
+    }
+    else {
+      created.emplace_back(p, s);
+    }
+  }
+  // Restores the Delaunay property of the new edges, except the constraint.
+  bool flipped = true;
+  while (flipped) {
+    flipped = false;
+    for (IndexPair& edge : created) {
+      if (edge == IndexPair(a, b)) {
+        continue;
+      }
+      size_t  ti;
+      uint8_t k;
+      findEdge(edge.p, edge.q, ti, k);
+      const Tri& t = mTris[ti];
+      const Tri& n = mTris[t.adj[k]];
+      size_t     s = n.v[0] ^ n.v[1] ^ n.v[2] ^ edge.p ^ edge.q;
+      if (incircle(point(t.v[0]), point(t.v[1]), point(t.v[2]), point(s)) > 0) {
+        size_t p = t.v[k];
+        flip(ti, k);
+        edge    = IndexPair(p, s);
+        flipped = true;
+      }
+    }
+  }
+}
+
+}  // namespace gal
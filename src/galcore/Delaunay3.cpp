@@ -0,0 +1,349 @@
+#include "BrioOrder.h"
+#include <galcore/Delaunay3.h>
+#include <galcore/Util.h>
+#include <tbb/tbb.h>
+
+namespace gal {
+
+/*The face opposite v[i], ordered so that v[i] is on its positive side.*/
+static constexpr uint8_t sFaces[4][3] = {{1, 3, 2}, {0, 2, 3}, {0, 3, 1}, {0, 1, 2}};
+/*Bits per axis of the Hilbert keys.*/
+static constexpr uint32_t sHilbertBits = 10;
+/*Clouds smaller than this are ordered sequentially.*/
+static constexpr size_t sParallelMinSize = size_t(1) << 14;
+
+Delaunay3::Delaunay3(const std::vector<glm::vec3>& points)
+    : mPts(points)
+{
+  compute();
+}
+
+Delaunay3::Delaunay3(std::vector<glm::vec3>&& points)
+    : mPts(std::move(points))
+{
+  compute();
+}
+
+glm::vec3 Delaunay3::getPt(size_t index) const
+{
+  return index < mPts.size() ? mPts[index] : vec3_unset;
+}
+
+size_t Delaunay3::numPoints() const
+{
+  return mPts.size();
+}
+
+size_t Delaunay3::numTetrahedra() const
+{
+  return mFinite.size();
+}
+
+std::array<size_t, 4> Delaunay3::tetrahedron(size_t ti) const
+{
+  const Tet& tet = mTets[mFinite[ti]];
+  return {tet.v[0], tet.v[1], tet.v[2], tet.v[3]};
+}
+
+void Delaunay3::copyTetrahedra(int* tetIndices) const
+{
+  for (size_t ti : mFinite) {
+    for (size_t vi : mTets[ti].v) {
+      *(tetIndices++) = (int)vi;
+    }
+  }
+}
+
+Sphere Delaunay3::circumsphere(size_t ti) const
+{
+  const Tet& tet = mTets[mFinite[ti]];
+  return Sphere::createCircumsphere(
+    mPts[tet.v[0]], mPts[tet.v[1]], mPts[tet.v[2]], mPts[tet.v[3]]);
+}
+
+void Delaunay3::compute()
+{
+  // While inserting, the vertices are numbered in the insertion order, so that the
+  // coordinates of nearby tetrahedra are close in memory.
+  const bool          parallel = mPts.size() >= sParallelMinSize;
+  std::vector<size_t> order    = brioOrder<sHilbertBits>(mPts, parallel);
+  mCoords.resize(order.size());
+  auto copyCoords = [&](size_t i) { mCoords[i] = glm::dvec3(mPts[order[i]]); };
+  auto renumber   = [&](size_t ti) {
+    for (size_t& vi : mTets[ti].v) {
+      vi = vi == sInfinite ? vi : order[vi];
+    }
+  };
+  if (parallel) {
+    tbb::parallel_for(size_t(0), order.size(), copyCoords);
+  }
+  else {
+    for (size_t i = 0; i < order.size(); i++) {
+      copyCoords(i);
+    }
+  }
+  std::array<size_t, 4> initial = createInitialTet();
+  for (size_t vi = 0; vi < mCoords.size(); vi++) {
+    if (std::find(initial.begin(), initial.end(), vi) == initial.end()) {
+      insert(vi);
+    }
+  }
+  for (size_t ti = 0; ti < mTets.size(); ti++) {
+    if (mTets[ti].alive && infiniteSlot(mTets[ti]) == 4) {
+      mFinite.push_back(ti);
+    }
+  }
+  if (parallel) {
+    tbb::parallel_for(size_t(0), mTets.size(), renumber);
+  }
+  else {
+    for (size_t ti = 0; ti < mTets.size(); ti++) {
+      renumber(ti);
+    }
+  }
+  mCoords.clear();
+  mCoords.shrink_to_fit();
+}
+
+const glm::dvec3& Delaunay3::point(size_t vi) const
+{
+  return mCoords[vi];
+}
+
+uint8_t Delaunay3::infiniteSlot(const Tet& tet) const
+{
+  uint8_t i = 0;
+  while (i < 4 && tet.v[i] != sInfinite) {
+    i++;
+  }
+  return i;
+}
+
+int Delaunay3::faceSide(const Tet& tet, uint8_t fi, const glm::dvec3& pt) const
+{
+  const uint8_t* f = sFaces[fi];
+  return orient3d(point(tet.v[f[0]]), point(tet.v[f[1]]), point(tet.v[f[2]]), pt);
+}
+
+bool Delaunay3::inConflict(size_t ti, const glm::dvec3& pt) const
+{
+  const Tet& tet = mTets[ti];
+  uint8_t    inf = infiniteSlot(tet);
+  if (inf == 4) {
+    return insphere(
+             point(tet.v[0]), point(tet.v[1]), point(tet.v[2]), point(tet.v[3]), pt) > 0;
+  }
+  // The circumsphere of a tetrahedron at infinity is the open half space beyond its
+  // finite face. On the plane of the face, it follows the finite neighbor.
+  int side = faceSide(tet, inf, pt);
+  return side != 0 ? side > 0 : inConflict(tet.adj[inf], pt);
+}
+
+size_t Delaunay3::addTet(size_t a, size_t b, size_t c, size_t d)
+{
+  size_t ti;
+  if (mFreeTets.empty()) {
+    ti = mTets.size();
+    mTets.emplace_back();
+  }
+  else {
+    ti = mFreeTets.back();
+    mFreeTets.pop_back();
+  }
+  Tet& tet = mTets[ti];
+  tet.v[0] = a;
+  tet.v[1] = b;
+  tet.v[2] = c;
+  tet.v[3] = d;
+  std::fill_n(tet.adj, 4, SIZE_MAX);
+  tet.stamp = 0;
+  tet.alive = true;
+  return ti;
+}
+
+void Delaunay3::linkFaces()
+{
+  // The new tetrahedra all have their apex at v[3], and bases that form a closed surface
+  // oriented away from it. So the tetrahedra across the open faces, opposite v[0], v[1]
+  // and v[2], are the ones whose bases share the same edges in the opposite direction.
+  // The entries of the table are only valid if they have the current stamp, so it never
+  // needs to be cleared.
+  size_t stamp = ++mStamp;
+  if (mLinks.size() < 6 * mNewTets.size()) {
+    size_t size = 64;
+    while (size < 6 * mNewTets.size()) {
+      size <<= 1;
+    }
+    mLinks.assign(size, {0, 0, 0, 0, 0});
+  }
+  size_t mask = mLinks.size() - 1;
+  for (size_t ti : mNewTets) {
+    for (uint8_t i = 0; i < 3; i++) {
+      size_t p = mTets[ti].v[(i + 1) % 3];
+      size_t q = mTets[ti].v[(i + 2) % 3];
+      size_t h = ((q * 73856093) ^ (p * 19349663)) & mask;
+      while (mLinks[h].stamp == stamp && (mLinks[h].p != q || mLinks[h].q != p)) {
+        h = (h + 1) & mask;
+      }
+      if (mLinks[h].stamp != stamp) {
+        // The twin isn't there yet, so this edge waits for it.
+        h = ((p * 73856093) ^ (q * 19349663)) & mask;
+        while (mLinks[h].stamp == stamp) {
+          h = (h + 1) & mask;
+        }
+        mLinks[h] = {p, q, ti, stamp, i};
+      }
+      else {
+        const EdgeLink& twin           = mLinks[h];
+        mTets[ti].adj[i]               = twin.tet;
+        mTets[twin.tet].adj[twin.slot] = ti;
+      }
+    }
+  }
+}
+
+std::array<size_t, 4> Delaunay3::createInitialTet()
+{
+  static constexpr const char* sError = "Cannot tetrahedralize coplanar points";
+  size_t                       vi     = 0;
+  auto                         next   = [&](const auto& accept) {
+    while (vi < mCoords.size() && !accept(point(vi))) {
+      vi++;
+    }
+    if (vi == mCoords.size()) {
+      throw sError;
+    }
+    return vi++;
+  };
+  size_t     v0 = next([](const glm::dvec3&) { return true; });
+  glm::dvec3 p0 = point(v0);
+  size_t     v1 = next([&](const glm::dvec3& p) { return p != p0; });
+  glm::dvec3 p1 = point(v1);
+  size_t     v2 = next([&](const glm::dvec3& p) {
+    return orient2d({p0.x, p0.y}, {p1.x, p1.y}, {p.x, p.y}) != 0 ||
+           orient2d({p0.y, p0.z}, {p1.y, p1.z}, {p.y, p.z}) != 0 ||
+           orient2d({p0.z, p0.x}, {p1.z, p1.x}, {p.z, p.x}) != 0;
+  });
+  glm::dvec3 p2 = point(v2);
+  size_t     v3 =
+    next([&](const glm::dvec3& p) { return orient3d(p0, p1, p2, p) != 0; });
+  if (orient3d(p0, p1, p2, point(v3)) < 0) {
+    std::swap(v1, v2);
+  }
+  size_t t0 = addTet(v0, v1, v2, v3);
+  mNewTets.clear();
+  for (uint8_t i = 0; i < 4; i++) {
+    // The tetrahedra at infinity see the faces from outside.
+    const uint8_t* f     = sFaces[i];
+    const Tet&     tet   = mTets[t0];
+    size_t         ghost = addTet(tet.v[f[0]], tet.v[f[2]], tet.v[f[1]], sInfinite);
+    mTets[ghost].adj[3]  = t0;
+    mTets[t0].adj[i]     = ghost;
+    mNewTets.push_back(ghost);
+  }
+  linkFaces();
+  mLast = t0;
+  return {v0, v1, v2, v3};
+}
+
+size_t Delaunay3::locate(const glm::dvec3& pt)
+{
+  // Visibility walk from the last tetrahedron, crossing any face that has the point on
+  // the other side. The faces are tried from a random start so that the walk can't
+  // cycle.
+  size_t ti = mLast;
+  if (!mTets[ti].alive) {
+    ti = 0;
+    while (!mTets[ti].alive) {
+      ti++;
+    }
+  }
+  uint8_t inf = infiniteSlot(mTets[ti]);
+  if (inf != 4) {
+    ti = mTets[ti].adj[inf];
+  }
+  size_t prev = SIZE_MAX;
+  while (true) {
+    const Tet& tet = mTets[ti];
+    if (infiniteSlot(tet) != 4) {
+      // Entered through its finite face, so the point is beyond it.
+      return ti;
+    }
+    mRand ^= mRand << 13;
+    mRand ^= mRand >> 17;
+    mRand ^= mRand << 5;
+    uint8_t first = uint8_t(mRand & 3);
+    size_t  next  = SIZE_MAX;
+    for (uint8_t j = 0; j < 4 && next == SIZE_MAX; j++) {
+      uint8_t i = uint8_t((first + j) & 3);
+      if (tet.adj[i] != prev && faceSide(tet, i, pt) < 0) {
+        next = tet.adj[i];
+      }
+    }
+    if (next == SIZE_MAX) {
+      return ti;
+    }
+    prev = ti;
+    ti   = next;
+  }
+}
+
+void Delaunay3::insert(size_t pi)
+{
+  glm::dvec3 pt    = point(pi);
+  size_t     start = locate(pt);
+  if (!inConflict(start, pt)) {
+    return;  // Duplicate of a vertex.
+  }
+  // The tetrahedra in conflict form a cavity that is star shaped from the point. The ones
+  // found not to be in conflict get the next stamp, so they are tested only once.
+  size_t stamp = mStamp + 1;
+  mStamp += 2;
+  mCavity.clear();
+  mBoundary.clear();
+  mStack.clear();
+  mTets[start].stamp = stamp;
+  mStack.push_back(start);
+  while (!mStack.empty()) {
+    size_t ci = mStack.back();
+    mStack.pop_back();
+    mCavity.push_back(ci);
+    for (uint8_t i = 0; i < 4; i++) {
+      size_t ni = mTets[ci].adj[i];
+      if (mTets[ni].stamp == stamp) {
+        continue;
+      }
+      if (mTets[ni].stamp != stamp + 1) {
+        if (inConflict(ni, pt)) {
+          mTets[ni].stamp = stamp;
+          mStack.push_back(ni);
+          continue;
+        }
+        mTets[ni].stamp = stamp + 1;
+      }
+      const Tet&     tet  = mTets[ci];
+      const Tet&     nbr  = mTets[ni];
+      const uint8_t* f    = sFaces[i];
+      uint8_t        slot = 0;
+      while (nbr.adj[slot] != ci) {
+        slot++;
+      }
+      mBoundary.push_back({{tet.v[f[0]], tet.v[f[1]], tet.v[f[2]]}, ni, slot});
+    }
+  }
+  for (size_t ci : mCavity) {
+    mTets[ci].alive = false;
+    mFreeTets.push_back(ci);
+  }
+  mNewTets.clear();
+  for (const BoundaryFace& face : mBoundary) {
+    size_t ti                           = addTet(face.v[0], face.v[1], face.v[2], pi);
+    mTets[ti].adj[3]                    = face.neighbor;
+    mTets[face.neighbor].adj[face.slot] = ti;
+    mNewTets.push_back(ti);
+  }
+  linkFaces();
+  mLast = mNewTets.back();
+}
+
+}  // namespace gal
@@ -0,0 +1,357 @@
+#include <galcore/Geodesics.h>
+#include <galcore/Mesh.h>
+#include <tbb/tbb.h>
+#include <algorithm>
+#include <numeric>
+
+namespace gal {
+
+using dvec3 = glm::dvec3;
+
+/*Vertex to vertex adjacency in compressed rows.*/
+struct VertexAdjacency
+{
+  std::vector<size_t> starts;
+  std::vector<size_t> neighbors;
+
+  VertexAdjacency(const Mesh& mesh)
+      : starts(mesh.numVertices() + 1, 0)
+  {
+    std::vector<std::pair<size_t, size_t>> edges;
+    edges.reserve(mesh.numFaces() * 6);
+    for (const Mesh::Face& f : mesh.faces()) {
+      for (int i = 0; i < 3; i++) {
+        edges.emplace_back(f.indices[i], f.indices[(i + 1) % 3]);
+        edges.emplace_back(f.indices[(i + 1) % 3], f.indices[i]);
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    neighbors.reserve(edges.size());
+    for (const auto& [v, nb] : edges) {
+      starts[v + 1]++;
+      neighbors.push_back(nb);
+    }
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  }
+
+  const size_t* begin(size_t v) const { return neighbors.data() + starts[v]; }
+  const size_t* end(size_t v) const { return neighbors.data() + starts[v + 1]; }
+};
+
+/*Fill reducing order for the factorization. The vertices are recursively split at the
+ * median along the longest axis of their bounds, and the vertices that separate the two
+ * halves are eliminated after both halves.*/
+static void nestedDissection(size_t*                       begin,
+                             size_t*                       end,
+                             const std::vector<glm::vec3>& points,
+                             const VertexAdjacency&        adj,
+                             std::vector<size_t>&          stamps,
+                             size_t&                       generation,
+                             std::vector<size_t>&          order)
+{
+  static constexpr size_t sLeafSize = 64;
+  if (size_t(end - begin) <= sLeafSize) {
+    order.insert(order.end(), begin, end);
+    return;
+  }
+  Box3 box;
+  for (const size_t* it = begin; it != end; it++) {
+    box.inflate(points[*it]);
+  }
+  glm::vec3 diag = box.diagonal();
+  int     axis = diag.x >= diag.y && diag.x >= diag.z ? 0 : (diag.y >= diag.z ? 1 : 2);
+  size_t* mid  = begin + (end - begin) / 2;
+  std::nth_element(begin, mid, end, [&points, axis](size_t a, size_t b) {
+    return points[a][axis] < points[b][axis];
+  });
+  size_t gen = ++generation;
+  for (const size_t* it = begin; it != mid; it++) {
+    stamps[*it] = gen;
+  }
+  size_t* sep = std::partition(mid, end, [&](size_t v) {
+    return std::none_of(
+      adj.begin(v), adj.end(v), [&](size_t nb) { return stamps[nb] == gen; });
+  });
+  nestedDissection(begin, mid, points, adj, stamps, generation, order);
+  nestedDissection(mid, sep, points, adj, stamps, generation, order);
+  order.insert(order.end(), sep, end);
+}
+
+static size_t findRoot(std::vector<size_t>& parents, size_t i)
+{
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i          = parents[i];
+  }
+  return i;
+}
+
+HeatGeodesics::HeatGeodesics(const Mesh& mesh)
+{
+  const auto&  verts  = mesh.vertices();
+  const auto&  faces  = mesh.faces();
+  const size_t nVerts = verts.size();
+  const size_t nFaces = faces.size();
+
+  mComponents.resize(nVerts);
+  std::iota(mComponents.begin(), mComponents.end(), size_t(0));
+  mCotans.resize(nFaces * 3);
+  std::vector<double> mass(nVerts, 0.);
+  double              edgeLengthSum = 0.;
+  for (size_t fi = 0; fi < nFaces; fi++) {
+    const Mesh::Face& f = faces[fi];
+    dvec3             p[3] = {verts[f.a], verts[f.b], verts[f.c]};
+    double            area2 = glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+    if (!(area2 > 0.)) {
+      return;
+    }
+    for (int i = 0; i < 3; i++) {
+      dvec3 u = p[(i + 1) % 3] - p[i];
+      dvec3 v = p[(i + 2) % 3] - p[i];
+      mCotans[fi * 3 + i] = glm::dot(u, v) / area2;
+      mass[f.indices[i]] += area2 / 6.;
+      edgeLengthSum += glm::length(u);
+      mComponents[findRoot(mComponents, f.indices[i])] =
+        findRoot(mComponents, f.indices[(i + 1) % 3]);
+    }
+  }
+  for (size_t vi = 0; vi < nVerts; vi++) {
+    mComponents[vi] = findRoot(mComponents, vi);
+  }
+  const double h = nFaces > 0 ? edgeLengthSum / double(nFaces * 3) : 1.;
+  const double t = h * h;
+
+  // Cotan Laplacian, positive semi-definite, and the lumped mass matrix.
+  std::vector<SparseLDLT::Entry> laplacian;
+  laplacian.reserve(nFaces * 6);
+  for (size_t fi = 0; fi < nFaces; fi++) {
+    const Mesh::Face& f = faces[fi];
+    for (int i = 0; i < 3; i++) {
+      size_t a = f.indices[(i + 1) % 3];
+      size_t b = f.indices[(i + 2) % 3];
+      double w = 0.5 * mCotans[fi * 3 + i];
+      laplacian.push_back({a, b, -w});
+      laplacian.push_back({a, a, w});
+      laplacian.push_back({b, b, w});
+    }
+  }
+  std::vector<SparseLDLT::Entry> heatFlow, poisson;
+  heatFlow.reserve(laplacian.size() + nVerts);
+  poisson.reserve(laplacian.size() + nVerts);
+  for (const auto& e : laplacian) {
+    heatFlow.push_back({e.row, e.col, t * e.value});
+    poisson.push_back(e);
+  }
+  // The Laplacian is singular, so a tiny multiple of the mass matrix is added for the
+  // Poisson system. Vertices not used by any face only get a diagonal entry.
+  static constexpr double sRegularization = 1e-8;
+  for (size_t vi = 0; vi < nVerts; vi++) {
+    double m = mass[vi] > 0. ? mass[vi] : t;
+    heatFlow.push_back({vi, vi, m});
+    poisson.push_back({vi, vi, m * sRegularization / t});
+  }
+
+  VertexAdjacency     adj(mesh);
+  std::vector<size_t> ids(nVerts), stamps(nVerts, 0), order;
+  std::iota(ids.begin(), ids.end(), size_t(0));
+  order.reserve(nVerts);
+  size_t generation = 0;
+  nestedDissection(
+    ids.data(), ids.data() + nVerts, verts, adj, stamps, generation, order);
+
+  tbb::parallel_invoke([&] { mHeatFlow = SparseLDLT(nVerts, heatFlow, order); },
+                       [&] { mPoisson = SparseLDLT(nVerts, poisson, order); });
+  mValid = mHeatFlow.valid() && mPoisson.valid();
+}
+
+bool HeatGeodesics::valid() const
+{
+  return mValid;
+}
+
+void HeatGeodesics::distances(const Mesh&   mesh,
+                              const size_t* sources,
+                              size_t        nSources,
+                              float*        dst) const
+{
+  const auto&  verts  = mesh.vertices();
+  const auto&  faces  = mesh.faces();
+  const size_t nVerts = verts.size();
+  const size_t nFaces = faces.size();
+
+  // Flow heat from the sources for a short time.
+  std::vector<double> u(nVerts, 0.);
+  for (size_t i = 0; i < nSources; i++) {
+    if (sources[i] < nVerts) {
+      u[sources[i]] = 1.;
+    }
+  }
+  mHeatFlow.solve(u.data());
+
+  // Divergence of the normalized gradient of the heat, computed per face first.
+  std::vector<double> div(nFaces * 3);
+  tbb::parallel_for(size_t(0), nFaces, [&](size_t fi) {
+    const Mesh::Face& f     = faces[fi];
+    dvec3             p[3]  = {verts[f.a], verts[f.b], verts[f.c]};
+    dvec3             n     = glm::cross(p[1] - p[0], p[2] - p[0]);
+    double            area2 = glm::length(n);
+    n /= area2;
+    dvec3 grad(0.);
+    for (int i = 0; i < 3; i++) {
+      grad += glm::cross(n, p[(i + 2) % 3] - p[(i + 1) % 3]) * u[f.indices[i]];
+    }
+    double len = glm::length(grad);
+    dvec3  x   = len > 0. ? -grad / len : dvec3(0.);
+    for (int i = 0; i < 3; i++) {
+      int j = (i + 1) % 3, k = (i + 2) % 3;
+      div[fi * 3 + i] = 0.5 * (mCotans[fi * 3 + k] * glm::dot(p[j] - p[i], x) +
+                               mCotans[fi * 3 + j] * glm::dot(p[k] - p[i], x));
+    }
+  });
+  std::vector<double> phi(nVerts, 0.);
+  for (size_t fi = 0; fi < nFaces; fi++) {
+    for (int i = 0; i < 3; i++) {
+      phi[faces[fi].indices[i]] -= div[fi * 3 + i];
+    }
+  }
+  // Recover the distances whose gradient best matches the normalized gradient.
+  mPoisson.solve(phi.data());
+
+  // The distances are only known up to a constant in each connected component.
+  static constexpr double sUnset = std::numeric_limits<double>::max();
+  std::vector<double>     offsets(nVerts, sUnset);
+  for (size_t i = 0; i < nSources; i++) {
+    if (sources[i] < nVerts) {
+      double& offset = offsets[mComponents[sources[i]]];
+      offset         = std::min(offset, phi[sources[i]]);
+    }
+  }
+  tbb::parallel_for(size_t(0), nVerts, [&](size_t vi) {
+    double offset = offsets[mComponents[vi]];
+    dst[vi]       = offset == sUnset ? FLT_MAX : float(std::max(0., phi[vi] - offset));
+  });
+}
+
+/*Distance at c from a planar wavefront that reached a and b with the given distances.
+ * Falls back to the paths along the edges when the wavefront does not enter the triangle
+ * through the opposite edge.*/
+static double triangleUpdate(const dvec3& pa,
+                             const dvec3& pb,
+                             const dvec3& pc,
+                             double       da,
+                             double       db)
+{
+  double viaEdges = std::min(da + glm::distance(pa, pc), db + glm::distance(pb, pc));
+  if (da == DBL_MAX || db == DBL_MAX) {
+    return viaEdges;
+  }
+  // Unfold the triangle with a at the origin and b on the positive x axis.
+  dvec3  ab = pb - pa;
+  double c  = glm::length(ab);
+  if (!(c > 0.)) {
+    return viaEdges;
+  }
+  dvec3  ex = ab / c;
+  dvec3  ac = pc - pa;
+  double cx = glm::dot(ac, ex);
+  double cy = glm::length(ac - ex * cx);
+  // Virtual point source at distance da from a and db from b, on the other side of ab.
+  double sx  = (da * da - db * db + c * c) / (2. * c);
+  double sy2 = da * da - sx * sx;
+  if (sy2 < 0.) {
+    return viaEdges;
+  }
+  double sy = -std::sqrt(sy2);
+  double x  = sx + (cx - sx) * (-sy / (cy - sy));
+  if (x < 0. || x > c) {
+    return viaEdges;
+  }
+  return std::min(viaEdges, std::sqrt((cx - sx) * (cx - sx) + (cy - sy) * (cy - sy)));
+}
+
+void fastMarchingDistances(const Mesh&   mesh,
+                           const size_t* sources,
+                           size_t        nSources,
+                           float*        dst)
+{
+  const auto&  verts  = mesh.vertices();
+  const auto&  faces  = mesh.faces();
+  const size_t nVerts = verts.size();
+
+  std::vector<size_t> vertFaceStarts(nVerts + 1, 0), vertFaces(faces.size() * 3);
+  for (const Mesh::Face& f : faces) {
+    for (size_t vi : f.indices) {
+      vertFaceStarts[vi + 1]++;
+    }
+  }
+  std::partial_sum(vertFaceStarts.begin(), vertFaceStarts.end(), vertFaceStarts.begin());
+  {
+    std::vector<size_t> fill(vertFaceStarts.begin(), vertFaceStarts.end() - 1);
+    for (size_t fi = 0; fi < faces.size(); fi++) {
+      for (size_t vi : faces[fi].indices) {
+        vertFaces[fill[vi]++] = fi;
+      }
+    }
+  }
+
+  std::vector<double> dists(nVerts, DBL_MAX), updates;
+  std::vector<size_t> active, changed, stamps(nVerts, 0);
+  size_t              generation = 0;
+  const auto          activateNeighbors = [&](const std::vector<size_t>& from) {
+    size_t gen = ++generation;
+    active.clear();
+    for (size_t vi : from) {
+      for (size_t i = vertFaceStarts[vi]; i < vertFaceStarts[vi + 1]; i++) {
+        for (size_t nb : faces[vertFaces[i]].indices) {
+          if (stamps[nb] != gen && dists[nb] > 0.) {
+            stamps[nb] = gen;
+            active.push_back(nb);
+          }
+        }
+      }
+    }
+  };
+  for (size_t i = 0; i < nSources; i++) {
+    if (sources[i] < nVerts) {
+      dists[sources[i]] = 0.;
+      changed.push_back(sources[i]);
+    }
+  }
+  activateNeighbors(changed);
+  static constexpr double sRelTolerance = 1e-9;
+  while (!active.empty()) {
+    // Jacobi style relaxation of the active vertices, reading the distances of the
+    // previous iteration.
+    updates.resize(active.size());
+    tbb::parallel_for(size_t(0), active.size(), [&](size_t ai) {
+      size_t vi   = active[ai];
+      double best = dists[vi];
+      for (size_t i = vertFaceStarts[vi]; i < vertFaceStarts[vi + 1]; i++) {
+        const Mesh::Face& f = faces[vertFaces[i]];
+        int               k = f.a == vi ? 0 : (f.b == vi ? 1 : 2);
+        size_t            a = f.indices[(k + 1) % 3], b = f.indices[(k + 2) % 3];
+        if (dists[a] == DBL_MAX && dists[b] == DBL_MAX) {
+          continue;
+        }
+        best = std::min(
+          best, triangleUpdate(verts[a], verts[b], verts[vi], dists[a], dists[b]));
+      }
+      updates[ai] = best;
+    });
+    changed.clear();
+    for (size_t ai = 0; ai < active.size(); ai++) {
+      size_t vi = active[ai];
+      if (updates[ai] < dists[vi] * (1. - sRelTolerance)) {
+        dists[vi] = updates[ai];
+        changed.push_back(vi);
+      }
+    }
+    activateNeighbors(changed);
+  }
+  tbb::parallel_for(size_t(0), nVerts, [&](size_t vi) {
+    dst[vi] = dists[vi] == DBL_MAX ? FLT_MAX : float(dists[vi]);
+  });
+}
+
+}  // namespace gal
@@ -0,0 +1,215 @@
+#include <galcore/KdTree.h>
+#include <tbb/tbb.h>
+#include <algorithm>
+#include <numeric>
+
+namespace gal {
+
+/*Subtrees smaller than this are built by a single task.*/
+static constexpr size_t sParallelBuildSize = size_t(1) << 14;
+
+KdTree3::KdTree3(const glm::vec3* points, size_t nPoints)
+{
+  while ((nPoints >> mDepth) > LeafSize) {
+    mDepth++;
+  }
+  mNodes.resize((size_t(1) << mDepth) - 1);
+  std::vector<Entry> entries(nPoints);
+  tbb::parallel_for(size_t(0), nPoints, [&](size_t i) { entries[i] = {points[i], i}; });
+  build(0, 0, entries.data(), entries.data() + nPoints, Box3(points, nPoints));
+  mPoints.resize(nPoints);
+  mIndices.resize(nPoints);
+  tbb::parallel_for(size_t(0), nPoints, [&](size_t i) {
+    mPoints[i]  = entries[i].pos;
+    mIndices[i] = entries[i].index;
+  });
+}
+
+void KdTree3::build(size_t node, size_t level, Entry* begin, Entry* end, const Box3& cell)
+{
+  if (level == mDepth) {
+    return;
+  }
+  glm::vec3 diag = cell.diagonal();
+  uint8_t   axis = diag.x >= diag.y && diag.x >= diag.z ? 0 : (diag.y >= diag.z ? 1 : 2);
+  Entry*    mid  = begin + (end - begin) / 2;
+  std::nth_element(begin, mid, end, [axis](const Entry& a, const Entry& b) {
+    return a.pos[axis] < b.pos[axis];
+  });
+  float split       = mid->pos[axis];
+  mNodes[node]      = {split, axis};
+  Box3 left         = cell;
+  Box3 right        = cell;
+  left.max[axis]    = split;
+  right.min[axis]   = split;
+  const auto buildL = [&] { build(2 * node + 1, level + 1, begin, mid, left); };
+  const auto buildR = [&] { build(2 * node + 2, level + 1, mid, end, right); };
+  if (size_t(end - begin) > sParallelBuildSize) {
+    tbb::parallel_invoke(buildL, buildR);
+  }
+  else {
+    buildL();
+    buildR();
+  }
+}
+
+size_t KdTree3::size() const noexcept
+{
+  return mPoints.size();
+}
+
+void KdTree3::nearestN(size_t           node,
+                       size_t           level,
+                       size_t           begin,
+                       size_t           end,
+                       const glm::vec3& pt,
+                       size_t           k,
+                       Heap&            heap) const
+{
+  if (level == mDepth) {
+    for (size_t i = begin; i < end; i++) {
+      float d = glm::length2(mPoints[i] - pt);
+      if (heap.size() < k) {
+        heap.emplace_back(d, i);
+        std::push_heap(heap.begin(), heap.end());
+      }
+      else if (d < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = {d, i};
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+    return;
+  }
+  const Node& n    = mNodes[node];
+  size_t      mid  = begin + (end - begin) / 2;
+  float       diff = pt[n.axis] - n.split;
+  if (diff < 0.f) {
+    nearestN(2 * node + 1, level + 1, begin, mid, pt, k, heap);
+    if (heap.size() < k || diff * diff < heap.front().first) {
+      nearestN(2 * node + 2, level + 1, mid, end, pt, k, heap);
+    }
+  }
+  else {
+    nearestN(2 * node + 2, level + 1, mid, end, pt, k, heap);
+    if (heap.size() < k || diff * diff < heap.front().first) {
+      nearestN(2 * node + 1, level + 1, begin, mid, pt, k, heap);
+    }
+  }
+}
+
+size_t KdTree3::nearestN(const glm::vec3& pt,
+                         size_t           k,
+                         Heap&            heap,
+                         size_t*          indices,
+                         float*           distances) const
+{
+  heap.clear();
+  if (k > 0) {
+    nearestN(0, 0, 0, mPoints.size(), pt, k, heap);
+  }
+  std::sort_heap(heap.begin(), heap.end());
+  for (size_t i = 0; i < heap.size(); i++) {
+    indices[i]   = mIndices[heap[i].second];
+    distances[i] = std::sqrt(heap[i].first);
+  }
+  return heap.size();
+}
+
+size_t KdTree3::queryNearestN(const glm::vec3& pt,
+                              size_t           k,
+                              size_t*          indices,
+                              float*           distances) const
+{
+  Heap heap;
+  heap.reserve(k);
+  return nearestN(pt, k, heap, indices, distances);
+}
+
+void KdTree3::radius(size_t               node,
+                     size_t               level,
+                     size_t               begin,
+                     size_t               end,
+                     const glm::vec3&     pt,
+                     float                sqRadius,
+                     std::vector<size_t>& results) const
+{
+  if (level == mDepth) {
+    for (size_t i = begin; i < end; i++) {
+      if (glm::length2(mPoints[i] - pt) <= sqRadius) {
+        results.push_back(mIndices[i]);
+      }
+    }
+    return;
+  }
+  const Node& n    = mNodes[node];
+  size_t      mid  = begin + (end - begin) / 2;
+  float       diff = pt[n.axis] - n.split;
+  if (diff <= 0.f || diff * diff <= sqRadius) {
+    radius(2 * node + 1, level + 1, begin, mid, pt, sqRadius, results);
+  }
+  if (diff >= 0.f || diff * diff <= sqRadius) {
+    radius(2 * node + 2, level + 1, mid, end, pt, sqRadius, results);
+  }
+}
+
+void KdTree3::queryRadius(const glm::vec3&     pt,
+                          float                rad,
+                          std::vector<size_t>& results) const
+{
+  if (!mPoints.empty()) {
+    radius(0, 0, 0, mPoints.size(), pt, rad * rad, results);
+  }
+}
+
+void KdTree3::queryNearestNBatch(const glm::vec3* points,
+                                 size_t           nPoints,
+                                 size_t           k,
+                                 size_t*          outIndices,
+                                 float*           outDistances) const
+{
+  tbb::enumerable_thread_specific<Heap> heaps;
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, nPoints),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      Heap& heap = heaps.local();
+                      for (size_t i = r.begin(); i < r.end(); i++) {
+                        size_t* indices = outIndices + i * k;
+                        float*  dists   = outDistances + i * k;
+                        size_t  nFound  = nearestN(points[i], k, heap, indices, dists);
+                        std::fill(indices + nFound, indices + k, SIZE_MAX);
+                        std::fill(dists + nFound, dists + k, FLT_MAX);
+                      }
+                    });
+}
+
+void KdTree3::queryRadiusBatch(const glm::vec3*     points,
+                               size_t               nPoints,
+                               float                rad,
+                               std::vector<size_t>& offsets,
+                               std::vector<size_t>& indices) const
+{
+  // The queries are split into fixed chunks whose results are gathered separately, then
+  // copied into place once the offsets are known.
+  static constexpr size_t          sChunkSize = 256;
+  size_t                           nChunks    = (nPoints + sChunkSize - 1) / sChunkSize;
+  std::vector<std::vector<size_t>> chunkResults(nChunks);
+  offsets.assign(nPoints + 1, 0);
+  tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+    std::vector<size_t>& results = chunkResults[ci];
+    size_t               last    = std::min(nPoints, (ci + 1) * sChunkSize);
+    for (size_t i = ci * sChunkSize; i < last; i++) {
+      size_t before = results.size();
+      queryRadius(points[i], rad, results);
+      offsets[i + 1] = results.size() - before;
+    }
+  });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  indices.resize(offsets.back());
+  tbb::parallel_for(size_t(0), nChunks, [&](size_t ci) {
+    std::copy(chunkResults[ci].begin(),
+              chunkResults[ci].end(),
+              indices.begin() + offsets[ci * sChunkSize]);
+  });
+}
+
+}  // namespace gal
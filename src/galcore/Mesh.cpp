@@ -1,9 +1,14 @@
 #include "galcore/Mesh.h"
 #define _USE_MATH_DEFINES
 #include <galcore/DebugProfile.h>
+#include <galcore/Delaunay2.h>
 #include <galcore/ObjLoader.h>
+#include <galcore/Predicates.h>
+#include <assert.h>
 #include <math.h>
+#include <tbb/tbb.h>
 #include <array>
+#include <atomic>
 #include <numeric>
 
 static constexpr uint8_t                               X = UINT8_MAX;
@@ -20,6 +25,210 @@ static constexpr std::array<std::array<uint8_t, 6>, 8> s_clipTriTable {{
 
 static constexpr std::array<uint8_t, 8> s_clipVertCountTable {0, 3, 3, 6, 3, 6, 6, 3};
 
+/*Separating axis test between a triangle and an axis aligned box (Akenine-Moller). The
+ * triangle vertices are expected relative to the center of the box.*/
+static bool triangleBoxOverlap(const glm::vec3& halfSize, glm::vec3 const (&tri)[3])
+{
+  // Box face normals.
+  for (int ai = 0; ai < 3; ai++) {
+    float min = std::min({tri[0][ai], tri[1][ai], tri[2][ai]});
+    float max = std::max({tri[0][ai], tri[1][ai], tri[2][ai]});
+    if (min > halfSize[ai] || max < -halfSize[ai]) {
+      return false;
+    }
+  }
+  // Triangle normal.
+  glm::vec3 edges[3] = {tri[1] - tri[0], tri[2] - tri[1], tri[0] - tri[2]};
+  glm::vec3 normal   = glm::cross(edges[0], edges[1]);
+  float     radius   = glm::dot(halfSize, glm::abs(normal));
+  if (std::abs(glm::dot(normal, tri[0])) > radius) {
+    return false;
+  }
+  // Cross products of the edges with the box axes.
+  for (const glm::vec3& e : edges) {
+    for (int ai = 0; ai < 3; ai++) {
+      glm::vec3 unit(0.f);
+      unit[ai]       = 1.f;
+      glm::vec3 axis = glm::cross(unit, e);
+      float     p0   = glm::dot(axis, tri[0]);
+      float     p1   = glm::dot(axis, tri[1]);
+      float     p2   = glm::dot(axis, tri[2]);
+      float     r    = glm::dot(halfSize, glm::abs(axis));
+      if (std::min({p0, p1, p2}) > r || std::max({p0, p1, p2}) < -r) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*Separating axis test between two triangles. Touching triangles are reported as
+ * intersecting. Besides the two face normals and the nine edge-edge cross products, the
+ * in-plane edge normals are tested so that coplanar triangles are handled too.*/
+static bool trianglesIntersect(glm::vec3 const (&t1)[3], glm::vec3 const (&t2)[3])
+{
+  const auto separates = [&](const glm::vec3& axis) {
+    if (glm::length2(axis) < FLT_MIN) {
+      return false;
+    }
+    float a0 = glm::dot(axis, t1[0]), a1 = glm::dot(axis, t1[1]),
+          a2 = glm::dot(axis, t1[2]);
+    float b0 = glm::dot(axis, t2[0]), b1 = glm::dot(axis, t2[1]),
+          b2 = glm::dot(axis, t2[2]);
+    return std::min({a0, a1, a2}) > std::max({b0, b1, b2}) ||
+           std::min({b0, b1, b2}) > std::max({a0, a1, a2});
+  };
+  glm::vec3 e1[3] = {t1[1] - t1[0], t1[2] - t1[1], t1[0] - t1[2]};
+  glm::vec3 e2[3] = {t2[1] - t2[0], t2[2] - t2[1], t2[0] - t2[2]};
+  glm::vec3 n1    = glm::cross(e1[0], e1[1]);
+  glm::vec3 n2    = glm::cross(e2[0], e2[1]);
+  if (separates(n1) || separates(n2)) {
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      if (separates(glm::cross(e1[i], e2[j]))) {
+        return false;
+      }
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    if (separates(glm::cross(n1, e1[i])) || separates(glm::cross(n2, e2[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*Closest point on the triangle to the given point (Ericson, Real-Time Collision
+ * Detection, 5.1.5).*/
+static glm::vec3 closestPointOnTriangle(const glm::vec3& p, glm::vec3 const (&tri)[3])
+{
+  const glm::vec3 &a = tri[0], &b = tri[1], &c = tri[2];
+  glm::vec3        ab = b - a, ac = c - a, ap = p - a;
+  float            d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0.f && d2 <= 0.f) {
+    return a;
+  }
+  glm::vec3 bp = p - b;
+  float     d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0.f && d4 <= d3) {
+    return b;
+  }
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+  glm::vec3 cp = p - c;
+  float     d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0.f && d5 <= d6) {
+    return c;
+  }
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+  float denom = 1.f / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+/*Squared distance between the closest points of the segments p1-q1 and p2-q2 (Ericson,
+ * Real-Time Collision Detection, 5.1.9).*/
+static float segmentsSqDistance(const glm::vec3& p1,
+                                const glm::vec3& q1,
+                                const glm::vec3& p2,
+                                const glm::vec3& q2)
+{
+  glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+  float     a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+  float     s = 0.f, t = 0.f;
+  if (a <= FLT_EPSILON && e <= FLT_EPSILON) {
+    return glm::dot(r, r);
+  }
+  if (a <= FLT_EPSILON) {
+    t = std::clamp(f / e, 0.f, 1.f);
+  }
+  else {
+    float c = glm::dot(d1, r);
+    if (e <= FLT_EPSILON) {
+      s = std::clamp(-c / a, 0.f, 1.f);
+    }
+    else {
+      float b     = glm::dot(d1, d2);
+      float denom = a * e - b * b;
+      s           = denom > 0.f ? std::clamp((b * f - c * e) / denom, 0.f, 1.f) : 0.f;
+      t           = (b * s + f) / e;
+      if (t < 0.f) {
+        t = 0.f;
+        s = std::clamp(-c / a, 0.f, 1.f);
+      }
+      else if (t > 1.f) {
+        t = 1.f;
+        s = std::clamp((b - c) / a, 0.f, 1.f);
+      }
+    }
+  }
+  return glm::length2((p1 + d1 * s) - (p2 + d2 * t));
+}
+
+static float trianglesSqDistance(glm::vec3 const (&t1)[3], glm::vec3 const (&t2)[3])
+{
+  if (trianglesIntersect(t1, t2)) {
+    return 0.f;
+  }
+  // When the triangles don't intersect, the closest pair of points involves either a
+  // vertex of one of the triangles, or a pair of edges.
+  float best = FLT_MAX;
+  for (int i = 0; i < 3; i++) {
+    best = std::min(best, glm::length2(t1[i] - closestPointOnTriangle(t1[i], t2)));
+    best = std::min(best, glm::length2(t2[i] - closestPointOnTriangle(t2[i], t1)));
+    for (int j = 0; j < 3; j++) {
+      best = std::min(
+        best, segmentsSqDistance(t1[i], t1[(i + 1) % 3], t2[j], t2[(j + 1) % 3]));
+    }
+  }
+  return best;
+}
+
+/*Lock free union-find. The root with the larger index is always linked under the root
+ * with the smaller index, so every set ends up rooted at its smallest element no matter
+ * the order in which the threads unite the sets.*/
+static size_t concurrentFind(std::vector<std::atomic<size_t>>& parents, size_t i)
+{
+  while (true) {
+    size_t p = parents[i].load(std::memory_order_relaxed);
+    if (p == i) {
+      return i;
+    }
+    size_t gp = parents[p].load(std::memory_order_relaxed);
+    // Path halving. Failing to shorten the path is harmless.
+    parents[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+    i = gp;
+  }
+}
+
+static void concurrentUnite(std::vector<std::atomic<size_t>>& parents, size_t a, size_t b)
+{
+  while (true) {
+    a = concurrentFind(parents, a);
+    b = concurrentFind(parents, b);
+    if (a == b) {
+      return;
+    }
+    if (a < b) {
+      std::swap(a, b);
+    }
+    size_t expected = a;
+    if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
 namespace gal {
 
 const Mesh::Face Mesh::Face::unset = Face(-1, -1, -1);
@@ -73,6 +282,7 @@ bool Mesh::Face::isDegenerate() const
 
 void Mesh::computeCache()
 {
+  std::atomic_store(&mHeatGeodesics, std::shared_ptr<const HeatGeodesics>());
   computeRTrees();
   computeTopology();
   computeNormals();
@@ -84,6 +294,13 @@ void Mesh::computeTopology()
   mVertEdges.clear();
   mVertFaces.clear();
   mFaceEdges.clear();
+  mEdgeIndexMap.clear();
+  mEdges.clear();
+  mEdgeFaces.clear();
+  // Closed meshes have 1.5 edges per face.
+  mEdgeIndexMap.reserve(mFaces.size() * 3 / 2);
+  mEdges.reserve(mFaces.size() * 3 / 2);
+  mEdgeFaces.reserve(mFaces.size() * 3 / 2);
   mVertEdges.resize(numVertices());
   mVertFaces.resize(numVertices());
   mFaceEdges.resize(numFaces());
@@ -102,16 +319,10 @@ void Mesh::computeTopology()
 
 void Mesh::computeRTrees()
 {
-  mFaceTree.clear();
-  for (size_t fi = 0; fi < mFaces.size(); fi++) {
-    mFaceTree.insert(faceBounds(fi), fi);
-  }
-
-  mVertexTree.clear();
-  size_t vi = 0;
-  for (const glm::vec3& v : mVertices) {
-    mVertexTree.insert(Box3(v), vi++);
-  }
+  const auto faceBoxFn = [this](size_t fi) { return faceBounds(fi); };
+  const auto vertBoxFn = [this](size_t vi) { return Box3(mVertices[vi]); };
+  tbb::parallel_invoke([&] { mFaceTree.build(mFaces.size(), faceBoxFn); },
+                       [&] { mVertexTree.build(mVertices.size(), vertBoxFn); });
 }
 
 void Mesh::computeNormals()
@@ -124,23 +335,32 @@ void Mesh::computeNormals()
     const glm::vec3& c = mVertices.at(fi->c);
     mFaceNormals.push_back(glm::normalize(glm::cross(b - a, c - a)));
   }
+  computeVertexNormals();
+}
 
+void Mesh::computeVertexNormals()
+{
   mVertexNormals.clear();
   mVertexNormals.resize(mVertices.size());
   std::vector<glm::vec3> faceNormals;
   for (size_t vi = 0; vi < mVertices.size(); vi++) {
-    const auto& faces = mVertFaces.at(vi);
-    faceNormals.clear();
-    faceNormals.reserve(faces.size());
-    std::transform(faces.cbegin(),
-                   faces.cend(),
-                   std::back_inserter(faceNormals),
-                   [this](const size_t fi) { return mFaceNormals[fi]; });
-    mVertexNormals[vi] =
-      glm::normalize(utils::average(faceNormals.cbegin(), faceNormals.cend()));
+    computeVertexNormal(vi, faceNormals);
   }
 }
 
+void Mesh::computeVertexNormal(size_t vi, std::vector<glm::vec3>& faceNormals)
+{
+  const auto& faces = mVertFaces.at(vi);
+  faceNormals.clear();
+  faceNormals.reserve(faces.size());
+  std::transform(faces.cbegin(),
+                 faces.cend(),
+                 std::back_inserter(faceNormals),
+                 [this](const size_t fi) { return mFaceNormals[fi]; });
+  mVertexNormals[vi] =
+    glm::normalize(utils::average(faceNormals.cbegin(), faceNormals.cend()));
+}
+
 void Mesh::addEdge(const Face& f, size_t fi, uint8_t fei, size_t& newEi)
 {
   EdgeType e      = f.edge(fei);
@@ -258,6 +478,15 @@ const RTree3d& Mesh::elementTree(eMeshElement element) const
   }
 }
 
+void Mesh::queryBox(const gal::Box3*     boxes,
+                    size_t               nBoxes,
+                    std::vector<size_t>& offsets,
+                    std::vector<size_t>& indices,
+                    eMeshElement         element) const
+{
+  elementTree(element).queryBoxIntersectsBatch(boxes, nBoxes, offsets, indices);
+}
+
 void Mesh::faceClosestPt(size_t           faceIndex,
                          const glm::vec3& pt,
                          glm::vec3&       closePt,
@@ -307,7 +536,10 @@ Mesh::Mesh(const Mesh& other)
            other.numVertices(),
            other.mFaces.data(),
            other.numFaces())
-{}
+{
+  // Same geometry, so the cached factorization can be shared.
+  std::atomic_store(&mHeatGeodesics, std::atomic_load(&other.mHeatGeodesics));
+}
 
 Mesh::Mesh(const std::vector<glm::vec3>& verts, const std::vector<Face>& faces)
     : Mesh(verts.data(), verts.size(), faces.data(), faces.size()) {};
@@ -319,6 +551,42 @@ Mesh::Mesh(std::vector<glm::vec3>&& verts, std::vector<Face>&& faces)
   computeCache();
 }
 
+Mesh::Mesh(std::vector<glm::vec3>&& verts,
+           std::vector<Face>&&      faces,
+           RTree3d&&                faceTree,
+           RTree3d&&                vertexTree)
+    : mVertices(std::move(verts))
+    , mFaces(std::move(faces))
+    , mFaceTree(std::move(faceTree))
+    , mVertexTree(std::move(vertexTree))
+{
+  if (mFaceTree.size() != mFaces.size()) {
+    mFaceTree.build(mFaces.size(), [this](size_t fi) { return faceBounds(fi); });
+  }
+  if (mVertexTree.size() != mVertices.size()) {
+    mVertexTree.build(mVertices.size(),
+                      [this](size_t vi) { return Box3(mVertices[vi]); });
+  }
+  computeTopology();
+  computeNormals();
+  checkSolid();
+}
+
+Mesh::Mesh(std::vector<glm::vec3>&& verts,
+           std::vector<Face>&&      faces,
+           RTree3d&&                faceTree,
+           std::vector<glm::vec3>&& faceNormals)
+    : mVertices(std::move(verts))
+    , mFaces(std::move(faces))
+    , mFaceNormals(std::move(faceNormals))
+    , mFaceTree(std::move(faceTree))
+{
+  mVertexTree.build(mVertices.size(), [this](size_t vi) { return Box3(mVertices[vi]); });
+  computeTopology();
+  computeVertexNormals();
+  checkSolid();
+}
+
 Mesh::Mesh(const glm::vec3* verts, size_t nVerts, const Face* faces, size_t nFaces)
 {
   mVertices.reserve(nVerts);
@@ -505,49 +773,136 @@ glm::vec3 Mesh::centroid(const eMeshCentroidType centroid_type) const
   }
 }
 
-bool Mesh::contains(const glm::vec3& pt) const
+/*Sign of orient2d(a, b, p) with p moved by (e, e^2) for an infinitesimal e. It is only
+ * zero when a and b coincide, so a point on a shared edge or vertex of the projection is
+ * inside exactly one of the triangles around it.*/
+static int perturbedOrient2d(const glm::dvec2& a,
+                             const glm::dvec2& b,
+                             const glm::dvec2& p)
 {
-  static const auto comparer = [](const std::pair<float, float>& a,
-                                  const std::pair<float, float>& b) {
-    return a.first < b.first;
-  };
+  int sign = orient2d(a, b, p);
+  if (sign != 0) {
+    return sign;
+  }
+  else if (a.y != b.y) {
+    return a.y > b.y ? 1 : -1;
+  }
+  return b.x > a.x ? 1 : (b.x < a.x ? -1 : 0);
+}
 
+/*Whether a point in the plane of the triangle lies on the triangle, including its edges.
+ * The test is done in a coordinate plane onto which the triangle doesn't project flat.*/
+static bool onTriangle(const glm::dvec3 (&tri)[3], const glm::dvec3& p)
+{
+  for (int axis = 2; axis >= 0; axis--) {
+    int        u = (axis + 1) % 3, v = (axis + 2) % 3;
+    glm::dvec2 t[3];
+    for (int i = 0; i < 3; i++) {
+      t[i] = {tri[i][u], tri[i][v]};
+    }
+    glm::dvec2 q(p[u], p[v]);
+    int        s = orient2d(t[0], t[1], t[2]);
+    if (s != 0) {
+      return orient2d(t[0], t[1], q) != -s && orient2d(t[1], t[2], q) != -s &&
+             orient2d(t[2], t[0], q) != -s;
+    }
+  }
+  return false;
+}
+
+bool Mesh::contains(const glm::vec3& pt) const
+{
+  // Winding number of the mesh around the point, counted along the ray going up from the
+  // point. Faces facing up count as +1 and faces facing down as -1.
   Box3                b(pt, {pt.x, pt.y, DBL_MAX});
   std::vector<size_t> faces;
   faces.reserve(10);
   mFaceTree.queryBoxIntersects(b, std::back_inserter(faces));
-  glm::vec3 triangles[3];
-  glm::vec2 p2(pt);
-
-  std::vector<std::pair<float, float>> hits;
-  hits.reserve(faces.size());
-
+  glm::dvec3 p3(pt);
+  glm::dvec2 p2(pt.x, pt.y);
+  int        winding = 0;
   for (size_t fi : faces) {
-    Face      f       = mFaces[fi];
-    glm::vec3 pts3[3] = {mVertices[f.a], mVertices[f.b], mVertices[f.c]};
-    glm::vec2 pts2[3] = {{pts3[0]}, {pts3[1]}, {pts3[2]}};
-    float     bary[3];
-    utils::barycentricCoords(pts2, p2, bary);
-    if (!utils::barycentricWithinBounds(bary))
+    const Face& f      = mFaces[fi];
+    glm::dvec3  tri[3] = {mVertices[f.a], mVertices[f.b], mVertices[f.c]};
+    int         side   = orient3d(tri[0], tri[1], tri[2], p3);
+    if (side == 0) {
+      if (onTriangle(tri, p3)) {
+        return true;
+      }
+      // Otherwise the ray can only meet the face at the point.
       continue;
-    hits.emplace_back(faceNormal(fi).z, utils::barycentricEvaluate(bary, pts3).z);
+    }
+    glm::dvec2 proj[3] = {glm::dvec2(tri[0]), glm::dvec2(tri[1]), glm::dvec2(tri[2])};
+    int        s0      = perturbedOrient2d(proj[0], proj[1], p2);
+    if (s0 != 0 && perturbedOrient2d(proj[1], proj[2], p2) == s0 &&
+        perturbedOrient2d(proj[2], proj[0], p2) == s0 && side != s0) {
+      // The ray pierces the face, and s0 is the orientation of its projection.
+      winding += s0;
+    }
   }
+  return winding != 0;
+}
 
-  std::sort(hits.begin(), hits.end(), comparer);
-  bool   first = true;
-  float  last  = 0;
-  size_t count = 0;
-  for (const std::pair<float, float>& hit : hits) {
-    if (first || last * hit.second < 0)
-      count++;
-    last  = hit.second;
-    first = false;
+/*Triangulates the region enclosed by the boundary edges between the given cut vertices,
+ * and appends the triangles facing along the normal.*/
+static void capSection(const Plane&                  plane,
+                       const std::vector<glm::vec3>& verts,
+                       const std::vector<size_t>&    cutVerts,
+                       std::vector<Mesh::Face>&      faces)
+{
+  if (cutVerts.size() < 3) {
+    return;
+  }
+  std::unordered_map<size_t, size_t> local;
+  local.reserve(cutVerts.size());
+  for (size_t vi : cutVerts) {
+    local.emplace(vi, local.size());
+  }
+  // The edges between cut vertices that only one face uses form the contours.
+  std::unordered_map<EdgeType, size_t, EdgeTypeHash> uses;
+  for (const Mesh::Face& face : faces) {
+    for (uint8_t i = 0; i < 3; i++) {
+      EdgeType edge = face.edge(i);
+      if (local.count(edge.p) && local.count(edge.q)) {
+        uses[edge]++;
+      }
+    }
+  }
+  std::vector<IndexPair> contours;
+  for (const auto& [edge, count] : uses) {
+    if (count == 1) {
+      contours.emplace_back(local[edge.p], local[edge.q]);
+    }
   }
 
-  return count % 2;
+  glm::vec3              unorm = glm::normalize(plane.normal());
+  glm::vec3              u     = glm::normalize(plane.xaxis());
+  glm::vec3              v     = glm::cross(unorm, u);
+  std::vector<glm::vec2> pts2d;
+  pts2d.reserve(cutVerts.size());
+  for (size_t vi : cutVerts) {
+    glm::vec3 rel = verts[vi] - plane.origin();
+    pts2d.emplace_back(glm::dot(rel, u), glm::dot(rel, v));
+  }
+  // When all the cut points are on a line the section encloses nothing. That is the only
+  // input the triangulation can't handle, so any other error is a real one.
+  auto other = std::find_if(
+    pts2d.begin(), pts2d.end(), [&](const glm::vec2& p) { return p != pts2d.front(); });
+  if (other == pts2d.end() ||
+      std::all_of(pts2d.begin(), pts2d.end(), [&](const glm::vec2& p) {
+        return orient2d(glm::dvec2(pts2d.front()), glm::dvec2(*other), glm::dvec2(p)) ==
+               0;
+      })) {
+    return;
+  }
+  Delaunay2 tris(pts2d, contours);
+  for (size_t ti : tris.enclosedTriangles()) {
+    auto tri = tris.triangle(ti);
+    faces.emplace_back(cutVerts[tri[0]], cutVerts[tri[1]], cutVerts[tri[2]]);
+  }
 }
 
-void Mesh::clipWithPlane(const Plane& plane)
+void Mesh::clipWithPlane(const Plane& plane, bool cap)
 {
   const glm::vec3& pt     = plane.origin();
   const glm::vec3& normal = plane.normal();
@@ -566,7 +921,7 @@ void Mesh::clipWithPlane(const Plane& plane)
     const EdgeType& edge = mEdges.at(ei);
     float           d1   = vdistances[edge.p];
     float           d2   = vdistances[edge.q];
-    if (d1 * d2 >= 0)
+    if ((d1 < 0) == (d2 < 0))
       continue;
 
     float r     = d2 / (d2 - d1);
@@ -614,13 +969,7 @@ void Mesh::clipWithPlane(const Plane& plane)
     std::transform(row,
                    row + s_clipVertCountTable[venum],
                    std::back_inserter(tempIndices),
-                   [this, &map, &verts, &edgepts, &face](const uint8_t vi) {
-                     decltype(mEdgeIndexMap)::const_iterator match2;
-                     if (vi > 2) {
-                       match2 = mEdgeIndexMap.find(face.edge(vi - 3));
-                       if (match2 == mEdgeIndexMap.end())
-                         throw 1;
-                     }
+                   [this, &map, &verts, &edgepts, &vdistances, &face](const uint8_t vi) {
                      size_t key;
                      switch (vi) {
                      case 0:
@@ -632,44 +981,54 @@ void Mesh::clipWithPlane(const Plane& plane)
                      case 2:
                        key = face.c;
                        break;
-                     case 3:
-                     case 4:
-                     case 5:
-                       key = match2->second + numVertices();
+                     default: {
+                       EdgeType edge   = face.edge(vi - 3);
+                       auto     match2 = mEdgeIndexMap.find(edge);
+                       if (match2 == mEdgeIndexMap.end())
+                         throw 1;
+                       // An edge that ends in the plane is cut at that vertex.
+                       if (vdistances[edge.p] == 0.f)
+                         key = edge.p;
+                       else if (vdistances[edge.q] == 0.f)
+                         key = edge.q;
+                       else
+                         key = match2->second + numVertices();
                        break;
                      }
+                     }
                      auto match = map.find(key);
                      if (match == map.end()) {
                        size_t vi2 = verts.size();
                        map.emplace(key, vi2);
-
-                       switch (vi) {
-                       case 0:
-                         verts.push_back(vertex(face.a));
-                         break;
-                       case 1:
-                         verts.push_back(vertex(face.b));
-                         break;
-                       case 2:
-                         verts.push_back(vertex(face.c));
-                         break;
-                       case 3:
-                       case 4:
-                       case 5:
-                         verts.push_back(edgepts[match2->second]);
-                         break;
-                       }
+                       size_t nv = numVertices();
+                       verts.push_back(key < nv ? vertex(key) : edgepts[key - nv]);
                        return vi2;
                      }
                      return match->second;
                    });
 
     for (size_t fvi = 0; fvi < tempIndices.size(); fvi += 3) {
-      faces.emplace_back(tempIndices.data() + fvi);
+      Face newFace(tempIndices.data() + fvi);
+      // Cutting at vertices in the plane can collapse faces.
+      if (!newFace.isDegenerate()) {
+        faces.push_back(newFace);
+      }
     }
   }
 
-  assert(faces.size() * 3 == nIndices);
+  assert(faces.size() * 3 <= nIndices);
+  if (cap) {
+    // The section passes through the new points on the split edges, and through the
+    // original vertices that lie exactly in the plane.
+    std::vector<size_t> cutVerts;
+    for (const auto& [key, vi] : map) {
+      if (key >= numVertices() || vdistances[key] == 0.f) {
+        cutVerts.push_back(vi);
+      }
+    }
+    std::sort(cutVerts.begin(), cutVerts.end());
+    capSection(plane, verts, cutVerts, faces);
+  }
   // Create new mesh with the copied data.
   mVertices = std::move(verts);
   mFaces    = std::move(faces);
@@ -681,10 +1040,134 @@ void Mesh::transform(const glm::mat4& mat)
   for (auto& v : mVertices) {
     v = glm::vec3(mat * glm::vec4(v.x, v.y, v.z, 1.0f));
   }
+  std::atomic_store(&mHeatGeodesics, std::shared_ptr<const HeatGeodesics>());
   computeRTrees();
   computeNormals();
 }
 
+void Mesh::updateVertices(const glm::vec3* positions, size_t nPositions)
+{
+  if (nPositions != mVertices.size()) {
+    throw std::invalid_argument("Expected one position per vertex");
+  }
+  std::vector<size_t> movedVerts;
+  for (size_t vi = 0; vi < nPositions; vi++) {
+    if (positions[vi] != mVertices[vi]) {
+      mVertices[vi] = positions[vi];
+      movedVerts.push_back(vi);
+    }
+  }
+  if (movedVerts.empty()) {
+    return;
+  }
+  std::atomic_store(&mHeatGeodesics, std::shared_ptr<const HeatGeodesics>());
+  // The faces around the moved vertices, and the vertices of those faces, whose normals
+  // change.
+  RemapScratch& remap = mRemap;
+  size_t        gen   = ++remap.generation;
+  remap.vertStamps.resize(mVertices.size(), 0);
+  remap.faceStamps.resize(mFaces.size(), 0);
+  std::vector<size_t> movedFaces, normalVerts;
+  for (size_t vi : movedVerts) {
+    for (size_t fi : mVertFaces[vi]) {
+      if (remap.faceStamps[fi] == gen) {
+        continue;
+      }
+      remap.faceStamps[fi] = gen;
+      movedFaces.push_back(fi);
+      for (size_t fvi : mFaces[fi].indices) {
+        if (remap.vertStamps[fvi] != gen) {
+          remap.vertStamps[fvi] = gen;
+          normalVerts.push_back(fvi);
+        }
+      }
+    }
+  }
+  tbb::parallel_invoke(
+    [&] {
+      mVertexTree.refit(movedVerts.data(), movedVerts.size(), [this](size_t vi) {
+        return Box3(mVertices[vi]);
+      });
+    },
+    [&] {
+      mFaceTree.refit(movedFaces.data(), movedFaces.size(), [this](size_t fi) {
+        return faceBounds(fi);
+      });
+    });
+  for (size_t fi : movedFaces) {
+    const Face&      f = mFaces[fi];
+    const glm::vec3& a = mVertices[f.a];
+    mFaceNormals[fi] = glm::normalize(glm::cross(mVertices[f.b] - a, mVertices[f.c] - a));
+  }
+  std::vector<glm::vec3> faceNormals;
+  for (size_t vi : normalVerts) {
+    computeVertexNormal(vi, faceNormals);
+  }
+}
+
+void Mesh::faceTriangle(size_t fi, glm::vec3 (&tri)[3]) const
+{
+  const Face& f = mFaces[fi];
+  tri[0]        = mVertices[f.a];
+  tri[1]        = mVertices[f.b];
+  tri[2]        = mVertices[f.c];
+}
+
+void Mesh::faceTriangle(size_t fi, const glm::mat4& xform, glm::vec3 (&tri)[3]) const
+{
+  faceTriangle(fi, tri);
+  for (glm::vec3& v : tri) {
+    v = glm::vec3(xform * glm::vec4(v, 1.f));
+  }
+}
+
+bool Mesh::facesIntersect(size_t           fi,
+                          const Mesh&      other,
+                          size_t           ofi,
+                          const glm::mat4& otherXform) const
+{
+  glm::vec3 t1[3], t2[3];
+  faceTriangle(fi, t1);
+  other.faceTriangle(ofi, otherXform, t2);
+  return trianglesIntersect(t1, t2);
+}
+
+bool Mesh::intersects(const Mesh& other, const glm::mat4& otherXform) const
+{
+  // Stop at the first intersecting pair of faces.
+  return !overlappingFaces(other, otherXform, [](size_t, size_t) { return false; });
+}
+
+RTree3d Mesh::placedFaceTree(const glm::mat4& xform) const
+{
+  return mFaceTree.transformed([&xform](const Box3& b) { return b.transformed(xform); });
+}
+
+float Mesh::minimumDistance(const Mesh&      other,
+                            const glm::mat4& otherXform,
+                            bool             placeTree) const
+{
+  glm::vec3 t1[3], t2[3];
+  auto      faceDistFn = [&](size_t fi, size_t ofi) {
+    faceTriangle(fi, t1);
+    other.faceTriangle(ofi, otherXform, t2);
+    return trianglesSqDistance(t1, t2);
+  };
+  float sqDist =
+    placeTree
+      ? mFaceTree.nearestPairWith(
+          other.placedFaceTree(otherXform),
+          [](const Box3& a, const Box3& b) { return a.sqDistance(b); },
+          faceDistFn)
+      : mFaceTree.nearestPairWith(
+          other.mFaceTree,
+          [&otherXform](const Box3& a, const Box3& b) {
+            return a.sqDistance(b.transformed(otherXform));
+          },
+          faceDistFn);
+  return sqDist == FLT_MAX ? FLT_MAX : std::sqrt(sqDist);
+}
+
 glm::vec3 Mesh::closestPoint(const glm::vec3& pt, float searchDist) const
 {
   size_t nearestVertIndex = SIZE_MAX;
@@ -711,6 +1194,158 @@ glm::vec3 Mesh::closestPoint(const glm::vec3& pt, float searchDist) const
   return closePt;
 }
 
+std::shared_ptr<const HeatGeodesics> Mesh::heatGeodesics() const
+{
+  auto cached = std::atomic_load(&mHeatGeodesics);
+  if (!cached) {
+    // Concurrent callers may both build it, but only one copy stays cached.
+    cached = std::make_shared<const HeatGeodesics>(*this);
+    std::shared_ptr<const HeatGeodesics> expected;
+    if (!std::atomic_compare_exchange_strong(&mHeatGeodesics, &expected, cached)) {
+      cached = expected;
+    }
+  }
+  return cached;
+}
+
+std::vector<float> Mesh::geodesicDistances(const size_t*   sources,
+                                           size_t          nSources,
+                                           eGeodesicMethod method) const
+{
+  std::vector<float> dists(mVertices.size(), FLT_MAX);
+  if (method == eGeodesicMethod::heat) {
+    auto heat = heatGeodesics();
+    if (heat->valid()) {
+      heat->distances(*this, sources, nSources, dists.data());
+      return dists;
+    }
+  }
+  fastMarchingDistances(*this, sources, nSources, dists.data());
+  return dists;
+}
+
+void Mesh::voxelizeSurface(VoxelGrid& grid) const
+{
+  const float     size     = grid.voxelSize();
+  const glm::vec3 halfSize = glm::vec3(size * 0.5f);
+  const glm::vec3 origin   = grid.origin();
+  const Box3      gbounds  = grid.bounds();
+  const auto      toIndex  = [size](float coord, size_t n) {
+    return size_t(std::clamp(std::floor(coord / size), 0.f, float(n - 1)));
+  };
+  // Each task owns whole xy-layers of the grid, so no two tasks write the same word.
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, grid.numZ()),
+    [&](const tbb::blocked_range<size_t>& range) {
+      std::vector<size_t> faces;
+      for (size_t z = range.begin(); z < range.end(); z++) {
+        float zmin = origin.z + float(z) * size;
+        Box3  layer({gbounds.min.x, gbounds.min.y, zmin},
+                   {gbounds.max.x, gbounds.max.y, zmin + size});
+        faces.clear();
+        mFaceTree.queryBoxIntersects(layer, std::back_inserter(faces));
+        for (size_t fi : faces) {
+          const Face& f  = mFaces[fi];
+          Box3        fb = faceBounds(fi);
+          size_t      x0 = toIndex(fb.min.x - origin.x, grid.numX());
+          size_t      x1 = toIndex(fb.max.x - origin.x, grid.numX());
+          size_t      y0 = toIndex(fb.min.y - origin.y, grid.numY());
+          size_t      y1 = toIndex(fb.max.y - origin.y, grid.numY());
+          for (size_t y = y0; y <= y1; y++) {
+            for (size_t x = x0; x <= x1; x++) {
+              if (grid.get(x, y, z)) {
+                continue;
+              }
+              glm::vec3 center  = grid.voxelCenter(x, y, z);
+              glm::vec3 tri[3]  = {mVertices[f.a] - center,
+                                  mVertices[f.b] - center,
+                                  mVertices[f.c] - center};
+              if (triangleBoxOverlap(halfSize, tri)) {
+                grid.set(x, y, z);
+              }
+            }
+          }
+        }
+      }
+    });
+}
+
+void Mesh::voxelizeInterior(VoxelGrid& grid) const
+{
+  const float     size    = grid.voxelSize();
+  const glm::vec3 origin  = grid.origin();
+  const Box3      gbounds = grid.bounds();
+  // Shoot a ray along +x through the voxel centers of every row. A hit with a face whose
+  // normal points against the ray enters the solid, and the other way round. Judging
+  // the crossings by the normal instead of by parity makes duplicate hits on shared
+  // edges harmless.
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, grid.numZ()),
+    [&](const tbb::blocked_range<size_t>& range) {
+      std::vector<size_t>                  faces;
+      std::vector<std::pair<float, float>> hits;
+      for (size_t z = range.begin(); z < range.end(); z++) {
+        for (size_t y = 0; y < grid.numY(); y++) {
+          glm::vec3 c = grid.voxelCenter(0, y, z);
+          faces.clear();
+          Box3 line({gbounds.min.x, c.y, c.z}, {gbounds.max.x, c.y, c.z});
+          mFaceTree.queryBoxIntersects(line, std::back_inserter(faces));
+          hits.clear();
+          glm::vec2 p2(c.y, c.z);
+          for (size_t fi : faces) {
+            const Face& f       = mFaces[fi];
+            glm::vec3   pts3[3] = {mVertices[f.a], mVertices[f.b], mVertices[f.c]};
+            glm::vec2   pts2[3] = {
+              {pts3[0].y, pts3[0].z}, {pts3[1].y, pts3[1].z}, {pts3[2].y, pts3[2].z}};
+            float bary[3];
+            utils::barycentricCoords(pts2, p2, bary);
+            if (!utils::barycentricWithinBounds(bary)) {
+              continue;
+            }
+            hits.emplace_back(utils::barycentricEvaluate(bary, pts3).x, faceNormal(fi).x);
+          }
+          std::sort(hits.begin(), hits.end());
+
+          bool  inside = false;
+          float start  = 0.f;
+          for (const auto& [x, nx] : hits) {
+            if (nx < 0.f && !inside) {
+              inside = true;
+              start  = x;
+            }
+            else if (nx > 0.f && inside) {
+              inside = false;
+              // Voxels whose centers lie within [start, x].
+              float first = std::ceil((start - origin.x) / size - 0.5f);
+              float last  = std::floor((x - origin.x) / size - 0.5f);
+              if (last >= first && last >= 0.f) {
+                grid.fillRow(y, z, size_t(std::max(first, 0.f)), size_t(last) + 1);
+              }
+            }
+          }
+        }
+      }
+    });
+}
+
+VoxelGrid Mesh::voxelize(float voxelSize, eMeshVoxelMode mode) const
+{
+  GALSCOPE(__func__);
+  if (voxelSize <= 0.f) {
+    throw std::invalid_argument("Voxel size must be positive");
+  }
+  Box3 box = bounds();
+  if (numFaces() == 0 || !box.valid()) {
+    return VoxelGrid();
+  }
+  VoxelGrid grid(box, voxelSize);
+  voxelizeSurface(grid);
+  if (mode == eMeshVoxelMode::solid) {
+    voxelizeInterior(grid);
+  }
+  return grid;
+}
+
 Mesh::EdgeTriplet::EdgeTriplet(size_t const (&indices)[3])
     : a(indices[0])
     , b(indices[1])
@@ -742,34 +1377,119 @@ void Mesh::EdgeTriplet::set(size_t i)
     throw i;
 }
 
+size_t Mesh::components(std::vector<size_t>& faceLabels,
+                        eMeshConnectivity    connectivity) const
+{
+  const size_t                     nFaces = mFaces.size();
+  std::vector<std::atomic<size_t>> parents(nFaces);
+  tbb::parallel_for(size_t(0), nFaces, [&](size_t fi) {
+    parents[fi].store(fi, std::memory_order_relaxed);
+  });
+  const auto& groups = connectivity == eMeshConnectivity::edge ? mEdgeFaces : mVertFaces;
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, groups.size()),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      for (size_t gi = r.begin(); gi < r.end(); gi++) {
+                        const std::vector<size_t>& group = groups[gi];
+                        for (size_t i = 1; i < group.size(); i++) {
+                          concurrentUnite(parents, group[0], group[i]);
+                        }
+                      }
+                    });
+  faceLabels.resize(nFaces);
+  tbb::parallel_for(size_t(0), nFaces, [&](size_t fi) {
+    faceLabels[fi] = concurrentFind(parents, fi);
+  });
+  // Every root is the first face of its component, so it is labeled before the rest.
+  size_t nComponents = 0;
+  for (size_t fi = 0; fi < nFaces; fi++) {
+    size_t root    = faceLabels[fi];
+    faceLabels[fi] = root == fi ? nComponents++ : faceLabels[root];
+  }
+  return nComponents;
+}
+
+std::vector<Mesh> Mesh::shells(eMeshConnectivity connectivity) const
+{
+  std::vector<size_t> labels;
+  size_t              nShells = components(labels, connectivity);
+  // Group the faces by shell with a counting sort, so each shell can be remapped in one
+  // go. A vertex can be shared by shells connected only through that vertex, so the
+  // remap entries are stamped with the shell they belong to.
+  std::vector<size_t> starts(nShells + 1, 0), order(mFaces.size());
+  for (size_t label : labels) {
+    starts[label + 1]++;
+  }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  {
+    std::vector<size_t> fill(starts.begin(), starts.end() - 1);
+    for (size_t fi = 0; fi < mFaces.size(); fi++) {
+      order[fill[labels[fi]]++] = fi;
+    }
+  }
+  std::vector<size_t> remap(mVertices.size()), stamps(mVertices.size(), SIZE_MAX);
+  std::vector<Mesh>   result;
+  result.reserve(nShells);
+  for (size_t si = 0; si < nShells; si++) {
+    std::vector<glm::vec3> verts;
+    std::vector<Face>      faces;
+    faces.reserve(starts[si + 1] - starts[si]);
+    for (size_t i = starts[si]; i < starts[si + 1]; i++) {
+      Face f = mFaces[order[i]];
+      for (size_t& vi : f.indices) {
+        if (stamps[vi] != si) {
+          stamps[vi] = si;
+          remap[vi]  = verts.size();
+          verts.push_back(mVertices[vi]);
+        }
+        vi = remap[vi];
+      }
+      faces.push_back(f);
+    }
+    result.emplace_back(std::move(verts), std::move(faces));
+  }
+  return result;
+}
+
 Mesh Mesh::extractFaces(const std::vector<size_t>& faceIndices)
 {
+  RemapScratch& remap = mRemap;
+  size_t        gen   = ++remap.generation;
+  remap.vertIndices.resize(mVertices.size());
+  remap.vertStamps.resize(mVertices.size(), 0);
+  remap.faceIndices.resize(mFaces.size());
+  remap.faceStamps.resize(mFaces.size(), 0);
+
   std::vector<glm::vec3> vertices;
   std::vector<Face>      faces;
+  std::vector<glm::vec3> faceNormals;
+  Box3                   bounds;
   faces.reserve(faceIndices.size());
+  faceNormals.reserve(faceIndices.size());
   vertices.reserve(faceIndices.size() / 2);
-
-  std::unordered_map<size_t, size_t, CustomSizeTHash> map;
-
-  for (const auto& fi : faceIndices) {
-    const Face& f = mFaces.at(fi);
-    Face        face;
-    for (uint8_t i = 0; i < 3; i++) {
-      size_t fvi   = f.indices[i];
-      auto   match = map.find(fvi);
-      if (match == map.end()) {
-        map.insert(std::make_pair(fvi, vertices.size()));
-        face.indices[i] = vertices.size();
-        vertices.push_back(mVertices[fvi]);
-      }
-      else {
-        face.indices[i] = match->second;
+  for (size_t fi : faceIndices) {
+    if (remap.faceStamps.at(fi) == gen) {
+      continue;
+    }
+    remap.faceStamps[fi]  = gen;
+    remap.faceIndices[fi] = faces.size();
+    Face face             = mFaces[fi];
+    for (size_t& vi : face.indices) {
+      if (remap.vertStamps[vi] != gen) {
+        remap.vertStamps[vi]  = gen;
+        remap.vertIndices[vi] = vertices.size();
+        vertices.push_back(mVertices[vi]);
+        bounds.inflate(mVertices[vi]);
       }
+      vi = remap.vertIndices[vi];
     }
     faces.push_back(face);
+    faceNormals.push_back(mFaceNormals[fi]);
   }
-
-  return Mesh(std::move(vertices), std::move(faces));
+  RTree3d faceTree = mFaceTree.filtered(bounds, [&remap, gen](size_t fi) {
+    return remap.faceStamps[fi] == gen ? remap.faceIndices[fi] : SIZE_MAX;
+  });
+  return Mesh(
+    std::move(vertices), std::move(faces), std::move(faceTree), std::move(faceNormals));
 };
 
 }  // namespace gal
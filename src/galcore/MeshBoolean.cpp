@@ -0,0 +1,815 @@
+#include <galcore/DebugProfile.h>
+#include <galcore/MeshBoolean.h>
+#include <galcore/Predicates.h>
+#include <tbb/tbb.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <numeric>
+#include <tuple>
+
+namespace gal {
+
+using dvec2 = glm::dvec2;
+using dvec3 = glm::dvec3;
+
+/*Degenerate configurations are resolved by treating zero as positive. Because every
+ * decision is made from the same predicate with the arguments in a canonical order, the
+ * decisions made for neighboring faces agree with each other.*/
+static int nonZero(int sign)
+{
+  return sign == 0 ? 1 : sign;
+}
+
+static bool boxesOverlap(const Box3& a, const Box3& b)
+{
+  // Unlike Box3::intersects, touching boxes and flat boxes are considered overlapping.
+  return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y &&
+         b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+struct MeshData
+{
+  const Mesh*        mesh;
+  std::vector<dvec3> points;
+  size_t             offset;  // Offset of the vertex indices in the combined indexing.
+
+  MeshData(const Mesh& m, size_t off)
+      : mesh(&m)
+      , points(m.vertexCBegin(), m.vertexCEnd())
+      , offset(off)
+  {}
+
+  void triangle(size_t fi, dvec3 (&tri)[3]) const
+  {
+    Mesh::Face f = mesh->face(fi);
+    for (int i = 0; i < 3; i++) {
+      tri[i] = points[f.indices[i]];
+    }
+  }
+};
+
+/*Intersection point where the edge (v0, v1) of one of the meshes pierces a face of the
+ * other mesh. Every intersection point is identified by such a key, so the faces on
+ * either side of the edge and the pierced face all refer to the same point.*/
+struct PierceKey
+{
+  size_t side;  // The mesh that owns the edge.
+  size_t v0, v1;
+  size_t face;
+
+  bool operator<(const PierceKey& other) const
+  {
+    return std::tie(side, v0, v1, face) <
+           std::tie(other.side, other.v0, other.v1, other.face);
+  }
+
+  bool operator==(const PierceKey& other) const
+  {
+    return side == other.side && v0 == other.v0 && v1 == other.v1 && face == other.face;
+  }
+};
+
+struct CutSegment
+{
+  PierceKey keys[2];
+  size_t    faces[2];  // Face from each of the two meshes.
+};
+
+/*Side of the edge (x, y) on which the edge (p, q) passes. The edge (p, q) must be in
+ * the canonical order. The determinant is evaluated with both the edges in canonical
+ * order, so that the tie is broken the same way irrespective of which of the two edges
+ * is the one piercing a face.*/
+static int edgeEdgeSign(const dvec3& p,
+                        const dvec3& q,
+                        const dvec3& x,
+                        const dvec3& y,
+                        size_t       xi,
+                        size_t       yi)
+{
+  return xi < yi ? nonZero(orient3d(p, q, x, y)) : -nonZero(orient3d(p, q, y, x));
+}
+
+static bool edgePiercesFace(const dvec3& p,
+                            const dvec3& q,
+                            int          sp,
+                            int          sq,
+                            dvec3 const (&tri)[3],
+                            const Mesh::Face& face)
+{
+  if (sp == sq) {
+    return false;
+  }
+  int s[3];
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3;
+    s[i]  = edgeEdgeSign(p, q, tri[i], tri[j], face.indices[i], face.indices[j]);
+  }
+  return s[0] == s[1] && s[1] == s[2];
+}
+
+static bool findCutSegment(const std::array<MeshData, 2>& meshes,
+                           size_t                         fa,
+                           size_t                         fb,
+                           CutSegment&                    seg)
+{
+  const size_t     fis[2]   = {fa, fb};
+  const Mesh::Face faces[2] = {meshes[0].mesh->face(fa), meshes[1].mesh->face(fb)};
+  dvec3            tris[2][3];
+  meshes[0].triangle(fa, tris[0]);
+  meshes[1].triangle(fb, tris[1]);
+  // Sides of the vertices of each face with respect to the plane of the other face.
+  int sides[2][3];
+  for (size_t s = 0; s < 2; s++) {
+    const auto& other = tris[1 - s];
+    for (int i = 0; i < 3; i++) {
+      sides[s][i] = nonZero(orient3d(other[0], other[1], other[2], tris[s][i]));
+    }
+    if (sides[s][0] == sides[s][1] && sides[s][1] == sides[s][2]) {
+      return false;
+    }
+  }
+  size_t nKeys = 0;
+  for (size_t s = 0; s < 2; s++) {
+    for (int i = 0; i < 3; i++) {
+      int j = (i + 1) % 3;
+      if (sides[s][i] == sides[s][j]) {
+        continue;
+      }
+      size_t v0 = faces[s].indices[i], v1 = faces[s].indices[j];
+      int    i0 = i, i1 = j;
+      if (v0 > v1) {
+        std::swap(v0, v1);
+        std::swap(i0, i1);
+      }
+      if (edgePiercesFace(tris[s][i0],
+                          tris[s][i1],
+                          sides[s][i0],
+                          sides[s][i1],
+                          tris[1 - s],
+                          faces[1 - s])) {
+        if (nKeys == 2) {
+          return false;  // Degenerate, only happens when the faces are coplanar.
+        }
+        seg.keys[nKeys++] = {s, v0, v1, fis[1 - s]};
+      }
+    }
+  }
+  seg.faces[0] = fa;
+  seg.faces[1] = fb;
+  return nKeys == 2;
+}
+
+static dvec3 piercePoint(const std::array<MeshData, 2>& meshes, const PierceKey& key)
+{
+  const dvec3& p = meshes[key.side].points[key.v0];
+  const dvec3& q = meshes[key.side].points[key.v1];
+  dvec3        tri[3];
+  meshes[1 - key.side].triangle(key.face, tri);
+  dvec3  normal = glm::cross(tri[1] - tri[0], tri[2] - tri[0]);
+  double dp     = glm::dot(normal, p - tri[0]);
+  double dq     = glm::dot(normal, q - tri[0]);
+  double t      = dp == dq ? 0.5 : dp / (dp - dq);
+  return p + (q - p) * std::clamp(t, 0., 1.);
+}
+
+/*Triangulation of a single face in its own plane, into which the intersection points
+ * and segments are inserted.*/
+class FaceTriangulation
+{
+public:
+  using Tri = std::array<uint32_t, 3>;
+
+  explicit FaceTriangulation(dvec2 const (&corners)[3])
+      : mPts(corners, corners + 3)
+  {
+    addTriangle({0, 1, 2});
+  }
+
+  uint32_t addPoint(const dvec2& pt)
+  {
+    mPts.push_back(pt);
+    return uint32_t(mPts.size() - 1);
+  }
+
+  /*Splits the boundary edge (x, y) at the point m that lies on it.*/
+  void splitBoundaryEdge(uint32_t x, uint32_t y, uint32_t m)
+  {
+    uint32_t ti;
+    if (!findTriangle(x, y, ti)) {
+      return;
+    }
+    uint32_t z = third(ti, x, y);
+    setTriangle(ti, {x, m, z});
+    addTriangle({m, y, z});
+  }
+
+  /*Inserts a point that lies inside the face. Returns the index of an existing point if
+   * the new point coincides with it, otherwise m.*/
+  uint32_t insertInterior(uint32_t m)
+  {
+    const dvec2& p = mPts[m];
+    for (uint32_t ti = 0; ti < mTris.size(); ti++) {
+      Tri t = mTris[ti];
+      int s[3];
+      for (int i = 0; i < 3; i++) {
+        s[i] = orient2d(mPts[t[i]], mPts[t[(i + 1) % 3]], p);
+      }
+      if (s[0] < 0 || s[1] < 0 || s[2] < 0) {
+        continue;
+      }
+      for (int i = 0; i < 3; i++) {
+        if (s[i] == 0 && s[(i + 2) % 3] == 0) {
+          return t[i];
+        }
+      }
+      for (int i = 0; i < 3; i++) {
+        uint32_t tj;
+        if (s[i] == 0 && findTriangle(t[(i + 1) % 3], t[i], tj)) {
+          uint32_t x = t[i], y = t[(i + 1) % 3], z = t[(i + 2) % 3];
+          uint32_t w = third(tj, y, x);
+          setTriangle(ti, {x, m, z});
+          addTriangle({m, y, z});
+          setTriangle(tj, {y, m, w});
+          addTriangle({m, x, w});
+          return m;
+        }
+      }
+      splitTriangle(ti, m);
+      return m;
+    }
+    // The point falls outside all triangles due to rounding.
+    uint32_t best     = 0;
+    double   bestDist = std::numeric_limits<double>::max();
+    for (uint32_t ti = 0; ti < mTris.size(); ti++) {
+      const Tri& t = mTris[ti];
+      dvec2      d = (mPts[t[0]] + mPts[t[1]] + mPts[t[2]]) / 3. - p;
+      if (glm::dot(d, d) < bestDist) {
+        bestDist = glm::dot(d, d);
+        best     = ti;
+      }
+    }
+    splitTriangle(best, m);
+    return m;
+  }
+
+  /*Flips the edges crossing the segment (u, v) until the segment is an edge of the
+   * triangulation (Sloan's algorithm).*/
+  bool insertSegment(uint32_t u, uint32_t v)
+  {
+    uint32_t ti;
+    if (u == v || findTriangle(u, v, ti) || findTriangle(v, u, ti)) {
+      return true;
+    }
+    std::deque<std::pair<uint32_t, uint32_t>> crossing;
+    for (const Tri& t : mTris) {
+      for (int i = 0; i < 3; i++) {
+        uint32_t x = t[i], y = t[(i + 1) % 3];
+        if (x < y && crosses(u, v, x, y)) {
+          crossing.emplace_back(x, y);
+        }
+      }
+    }
+    size_t budget = 16 * (crossing.size() + 1) * (crossing.size() + 1);
+    while (!crossing.empty() && budget--) {
+      auto [x, y] = crossing.front();
+      crossing.pop_front();
+      uint32_t t1, t2;
+      if (!findTriangle(x, y, t1) || !findTriangle(y, x, t2)) {
+        continue;
+      }
+      uint32_t p = third(t1, x, y);
+      uint32_t q = third(t2, y, x);
+      const dvec2 &pp = mPts[p], &pq = mPts[q];
+      if (orient2d(pp, pq, mPts[x]) * orient2d(pp, pq, mPts[y]) >= 0) {
+        crossing.emplace_back(x, y);  // The quad is not convex, try again later.
+        continue;
+      }
+      setTriangle(t1, {x, q, p});
+      setTriangle(t2, {q, y, p});
+      if (crosses(u, v, p, q)) {
+        crossing.emplace_back(p, q);
+      }
+    }
+    return findTriangle(u, v, ti) || findTriangle(v, u, ti);
+  }
+
+  const std::vector<Tri>& triangles() const { return mTris; }
+
+private:
+  std::vector<dvec2>                     mPts;
+  std::vector<Tri>                       mTris;
+  std::unordered_map<uint64_t, uint32_t> mEdgeTris;  // Directed edge to triangle.
+
+  static uint64_t edgeKey(uint32_t u, uint32_t v)
+  {
+    return (uint64_t(u) << 32) | uint64_t(v);
+  }
+
+  bool findTriangle(uint32_t u, uint32_t v, uint32_t& ti) const
+  {
+    auto match = mEdgeTris.find(edgeKey(u, v));
+    if (match == mEdgeTris.end()) {
+      return false;
+    }
+    ti = match->second;
+    return true;
+  }
+
+  uint32_t third(uint32_t ti, uint32_t x, uint32_t y) const
+  {
+    const Tri& t = mTris[ti];
+    for (uint32_t vi : t) {
+      if (vi != x && vi != y) {
+        return vi;
+      }
+    }
+    return t[0];
+  }
+
+  bool crosses(uint32_t u, uint32_t v, uint32_t x, uint32_t y) const
+  {
+    if (x == u || x == v || y == u || y == v) {
+      return false;
+    }
+    const dvec2 &pu = mPts[u], &pv = mPts[v], &px = mPts[x], &py = mPts[y];
+    return orient2d(pu, pv, px) * orient2d(pu, pv, py) < 0 &&
+           orient2d(px, py, pu) * orient2d(px, py, pv) < 0;
+  }
+
+  void setTriangle(uint32_t ti, const Tri& t)
+  {
+    const Tri& old = mTris[ti];
+    for (int i = 0; i < 3; i++) {
+      auto match = mEdgeTris.find(edgeKey(old[i], old[(i + 1) % 3]));
+      if (match != mEdgeTris.end() && match->second == ti) {
+        mEdgeTris.erase(match);
+      }
+    }
+    mTris[ti] = t;
+    for (int i = 0; i < 3; i++) {
+      mEdgeTris[edgeKey(t[i], t[(i + 1) % 3])] = ti;
+    }
+  }
+
+  void addTriangle(const Tri& t)
+  {
+    mTris.push_back(t);
+    uint32_t ti = uint32_t(mTris.size() - 1);
+    for (int i = 0; i < 3; i++) {
+      mEdgeTris[edgeKey(t[i], t[(i + 1) % 3])] = ti;
+    }
+  }
+
+  void splitTriangle(uint32_t ti, uint32_t m)
+  {
+    Tri t = mTris[ti];
+    setTriangle(ti, {t[0], t[1], m});
+    addTriangle({t[1], t[2], m});
+    addTriangle({t[2], t[0], m});
+  }
+};
+
+using Triangle = std::array<size_t, 3>;
+
+/*Everything known about the intersection of the two meshes, with all vertices indexed in
+ * the combined indexing: vertices of the first mesh, then of the second mesh, and then
+ * the intersection points.*/
+struct Intersection
+{
+  std::vector<PierceKey> keys;       // Sorted, one per intersection point.
+  std::vector<dvec3>     points;     // Intersection points.
+  size_t                 offset;     // Offset of the intersection points.
+  std::vector<size_t>    canonical;  // Vertex that represents each intersection point.
+  /*Pairs of canonical vertex and intersection point, sorted. Coincident intersection
+   * points are merged into one canonical vertex.*/
+  std::vector<std::pair<size_t, size_t>> members;
+  std::vector<IndexPair>                 segments;  // Pairs of canonical vertices.
+  std::vector<size_t>                    faces[2];  // Faces of each mesh, per segment.
+
+  size_t pointIndex(const PierceKey& key) const
+  {
+    return size_t(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+  }
+};
+
+static const dvec3& globalPoint(const std::array<MeshData, 2>& meshes,
+                                const Intersection&            isect,
+                                size_t                         vi)
+{
+  return vi < meshes[1].offset ? meshes[0].points[vi]
+         : vi < isect.offset   ? meshes[1].points[vi - meshes[1].offset]
+                               : isect.points[vi - isect.offset];
+}
+
+/*Returns the vertex of the edge or the pierced face, that the intersection point
+ * coincides with. Returns SIZE_MAX if there is no such vertex.*/
+static size_t coincidentVertex(const std::array<MeshData, 2>& meshes,
+                               const PierceKey&               key,
+                               const dvec3&                   pt)
+{
+  const MeshData& em = meshes[key.side];
+  const MeshData& fm = meshes[1 - key.side];
+  for (size_t vi : {key.v0, key.v1}) {
+    if (em.points[vi] == pt) {
+      return em.offset + vi;
+    }
+  }
+  Mesh::Face f = fm.mesh->face(key.face);
+  for (size_t vi : f.indices) {
+    if (fm.points[vi] == pt) {
+      return fm.offset + vi;
+    }
+  }
+  return SIZE_MAX;
+}
+
+static Intersection intersect(const std::array<MeshData, 2>& meshes)
+{
+  tbb::enumerable_thread_specific<std::vector<CutSegment>> tlSegments;
+  meshes[0].mesh->elementTree(eMeshElement::face)
+    .traverseWithParallel(meshes[1].mesh->elementTree(eMeshElement::face),
+                          boxesOverlap,
+                          [&](size_t fa, size_t fb) {
+                            CutSegment seg;
+                            if (findCutSegment(meshes, fa, fb, seg)) {
+                              tlSegments.local().push_back(seg);
+                            }
+                            return true;
+                          });
+  std::vector<CutSegment> segs;
+  for (const auto& local : tlSegments) {
+    segs.insert(segs.end(), local.begin(), local.end());
+  }
+
+  Intersection result;
+  result.offset = meshes[0].points.size() + meshes[1].points.size();
+  result.keys.reserve(2 * segs.size());
+  for (const CutSegment& seg : segs) {
+    result.keys.push_back(seg.keys[0]);
+    result.keys.push_back(seg.keys[1]);
+  }
+  tbb::parallel_sort(result.keys.begin(), result.keys.end());
+  result.keys.erase(std::unique(result.keys.begin(), result.keys.end()),
+                    result.keys.end());
+  const size_t nPts = result.keys.size();
+  result.points.resize(nPts);
+  result.canonical.resize(nPts);
+  tbb::parallel_for(size_t(0), nPts, [&](size_t i) {
+    result.points[i]    = piercePoint(meshes, result.keys[i]);
+    result.canonical[i] = coincidentVertex(meshes, result.keys[i], result.points[i]);
+  });
+
+  // In degenerate configurations, several intersection points can coincide.
+  std::vector<size_t> order(nPts);
+  std::iota(order.begin(), order.end(), size_t(0));
+  tbb::parallel_sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+    const dvec3& a = result.points[i];
+    const dvec3& b = result.points[j];
+    return std::tie(a.x, a.y, a.z, i) < std::tie(b.x, b.y, b.z, j);
+  });
+  for (size_t first = 0, last = 0; first < nPts; first = last) {
+    const dvec3& pt        = result.points[order[first]];
+    size_t       canonical = result.offset + order[first];
+    for (last = first; last < nPts && result.points[order[last]] == pt; last++) {
+      canonical = std::min(canonical, result.canonical[order[last]]);
+    }
+    for (size_t i = first; i < last; i++) {
+      result.canonical[order[i]] = canonical;
+    }
+  }
+  result.members.resize(nPts);
+  for (size_t i = 0; i < nPts; i++) {
+    result.members[i] = {result.canonical[i], i};
+  }
+  tbb::parallel_sort(result.members.begin(), result.members.end());
+
+  result.segments.reserve(segs.size());
+  result.faces[0].reserve(segs.size());
+  result.faces[1].reserve(segs.size());
+  for (const CutSegment& seg : segs) {
+    size_t p = result.canonical[result.pointIndex(seg.keys[0])];
+    size_t q = result.canonical[result.pointIndex(seg.keys[1])];
+    if (p != q) {
+      result.segments.emplace_back(p, q);
+      result.faces[0].push_back(seg.faces[0]);
+      result.faces[1].push_back(seg.faces[1]);
+    }
+  }
+  return result;
+}
+
+static void triangulateCutFace(const std::array<MeshData, 2>& meshes,
+                               size_t                         side,
+                               size_t                         fi,
+                               const size_t*                  segBegin,
+                               const size_t*                  segEnd,
+                               const Intersection&            isect,
+                               std::vector<Triangle>&         out)
+{
+  const MeshData&  md   = meshes[side];
+  const Mesh::Face face = md.mesh->face(fi);
+  dvec3            corners[3];
+  md.triangle(fi, corners);
+  // Project onto the coordinate plane closest to the face, keeping the orientation.
+  dvec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+  int   axis   = 0;
+  for (int i = 1; i < 3; i++) {
+    if (std::abs(normal[i]) > std::abs(normal[axis])) {
+      axis = i;
+    }
+  }
+  int ax0 = (axis + 1) % 3, ax1 = (axis + 2) % 3;
+  if (normal[axis] < 0.) {
+    std::swap(ax0, ax1);
+  }
+  const auto project = [&](size_t vi) {
+    const dvec3& p = globalPoint(meshes, isect, vi);
+    return dvec2(p[ax0], p[ax1]);
+  };
+
+  std::vector<size_t> ids = {md.offset + face.a, md.offset + face.b, md.offset + face.c};
+  dvec2             corners2[3] = {project(ids[0]), project(ids[1]), project(ids[2])};
+  FaceTriangulation tri(corners2);
+  std::vector<std::pair<size_t, uint32_t>> localIds;  // Vertex to local index.
+  std::vector<std::pair<double, size_t>>   onEdge[3];
+  std::vector<size_t>                      interior;
+  for (const size_t* si = segBegin; si != segEnd; si++) {
+    for (size_t vi : {isect.segments[*si].p, isect.segments[*si].q}) {
+      localIds.emplace_back(vi, 0);
+    }
+  }
+  std::sort(localIds.begin(), localIds.end());
+  localIds.erase(std::unique(localIds.begin(), localIds.end()), localIds.end());
+  for (auto& [vi, li] : localIds) {
+    auto corner = std::find(ids.begin(), ids.end(), vi);
+    if (corner != ids.end()) {
+      li = uint32_t(corner - ids.begin());
+      continue;
+    }
+    // Look for an intersection point at this vertex, where an edge of this face pierces
+    // the other mesh.
+    int  edge    = -1;
+    auto members = std::equal_range(isect.members.begin(),
+                                    isect.members.end(),
+                                    std::make_pair(vi, size_t(0)),
+                                    [](const auto& a, const auto& b) {
+                                      return a.first < b.first;
+                                    });
+    for (auto m = members.first; m != members.second && edge == -1; m++) {
+      const PierceKey& key = isect.keys[m->second];
+      for (int e = 0; e < 3 && key.side == side; e++) {
+        size_t a = face.indices[e], b = face.indices[(e + 1) % 3];
+        if (std::min(a, b) == key.v0 && std::max(a, b) == key.v1) {
+          edge = e;
+          break;
+        }
+      }
+    }
+    if (edge == -1) {
+      interior.push_back(vi);
+      continue;
+    }
+    dvec3 dir = corners[(edge + 1) % 3] - corners[edge];
+    onEdge[edge].emplace_back(
+      glm::dot(globalPoint(meshes, isect, vi) - corners[edge], dir) / glm::dot(dir, dir),
+      vi);
+  }
+  const auto local = [&localIds](size_t vi) -> uint32_t& {
+    return std::lower_bound(localIds.begin(),
+                            localIds.end(),
+                            std::make_pair(vi, uint32_t(0)))
+      ->second;
+  };
+  for (int e = 0; e < 3; e++) {
+    std::sort(onEdge[e].begin(), onEdge[e].end());
+    uint32_t x = uint32_t(e), y = uint32_t((e + 1) % 3);
+    for (const auto& [t, vi] : onEdge[e]) {
+      uint32_t m = tri.addPoint(project(vi));
+      ids.push_back(vi);
+      tri.splitBoundaryEdge(x, y, m);
+      local(vi) = m;
+      x         = m;
+    }
+  }
+  for (size_t vi : interior) {
+    uint32_t m = tri.addPoint(project(vi));
+    ids.push_back(vi);
+    local(vi) = tri.insertInterior(m);
+  }
+  for (const size_t* si = segBegin; si != segEnd; si++) {
+    tri.insertSegment(local(isect.segments[*si].p), local(isect.segments[*si].q));
+  }
+  for (const auto& t : tri.triangles()) {
+    Triangle gt = {ids[t[0]], ids[t[1]], ids[t[2]]};
+    if (gt[0] != gt[1] && gt[1] != gt[2] && gt[2] != gt[0]) {
+      out.push_back(gt);
+    }
+  }
+}
+
+/*Triangles of one of the meshes after cutting it along the intersection curves.*/
+static std::vector<Triangle> cutMesh(const std::array<MeshData, 2>& meshes,
+                                     size_t                         side,
+                                     const Intersection&            isect)
+{
+  const MeshData&                        md = meshes[side];
+  std::vector<std::pair<size_t, size_t>> faceSegs(isect.segments.size());
+  for (size_t i = 0; i < faceSegs.size(); i++) {
+    faceSegs[i] = {isect.faces[side][i], i};
+  }
+  tbb::parallel_sort(faceSegs.begin(), faceSegs.end());
+  std::vector<size_t> segIndices(faceSegs.size());
+  std::vector<size_t> groups;  // Start of the segments of each cut face.
+  for (size_t i = 0; i < faceSegs.size(); i++) {
+    segIndices[i] = faceSegs[i].second;
+    if (i == 0 || faceSegs[i].first != faceSegs[i - 1].first) {
+      groups.push_back(i);
+    }
+  }
+  groups.push_back(faceSegs.size());
+
+  std::vector<Triangle> tris;
+  const size_t          nFaces = md.mesh->numFaces();
+  tris.reserve(nFaces + 4 * faceSegs.size());
+  size_t gi = 0;
+  for (size_t fi = 0; fi < nFaces; fi++) {
+    if (gi + 1 < groups.size() && faceSegs[groups[gi]].first == fi) {
+      gi++;
+      continue;
+    }
+    Mesh::Face f = md.mesh->face(fi);
+    tris.push_back({md.offset + f.a, md.offset + f.b, md.offset + f.c});
+  }
+  tbb::enumerable_thread_specific<std::vector<Triangle>> tlTris;
+  tbb::parallel_for(size_t(0), groups.size() - 1, [&](size_t i) {
+    triangulateCutFace(meshes,
+                       side,
+                       faceSegs[groups[i]].first,
+                       segIndices.data() + groups[i],
+                       segIndices.data() + groups[i + 1],
+                       isect,
+                       tlTris.local());
+  });
+  for (const auto& local : tlTris) {
+    tris.insert(tris.end(), local.begin(), local.end());
+  }
+  return tris;
+}
+
+/*Winding number of the mesh around the point, counting the crossings of a ray along +x.*/
+static int windingNumber(const MeshData& md, const dvec3& pt)
+{
+  const Mesh& mesh   = *md.mesh;
+  Box3        bounds = mesh.bounds();
+  if (pt.x > bounds.max.x) {
+    return 0;
+  }
+  Box3 ray(glm::vec3(float(pt.x), float(pt.y), float(pt.z)),
+           glm::vec3(bounds.max.x, float(pt.y), float(pt.z)));
+  ray.inflate(1e-6f * std::max(1.f, glm::length(bounds.diagonal())));
+  std::vector<size_t> faces;
+  mesh.queryBox(ray, std::back_inserter(faces), eMeshElement::face);
+  const auto yz      = [](const dvec3& p) { return dvec2(p.y, p.z); };
+  const dvec2 pt2    = yz(pt);
+  int         winding = 0;
+  for (size_t fi : faces) {
+    Mesh::Face f = mesh.face(fi);
+    int        s = 0;
+    bool       inside = true;
+    for (int i = 0; i < 3 && inside; i++) {
+      size_t a = f.indices[i], b = f.indices[(i + 1) % 3];
+      int    si = nonZero(orient2d(yz(md.points[std::min(a, b)]),
+                                yz(md.points[std::max(a, b)]),
+                                pt2));
+      si        = a > b ? -si : si;
+      inside    = i == 0 || si == s;
+      s         = si;
+    }
+    if (!inside) {
+      continue;
+    }
+    // The ray hits the face if the point is behind it.
+    dvec3 tri[3];
+    md.triangle(fi, tri);
+    if (orient3d(tri[0], tri[1], tri[2], pt) == -s) {
+      winding += s;
+    }
+  }
+  return winding;
+}
+
+static size_t findRoot(std::vector<size_t>& parents, size_t i)
+{
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i          = parents[i];
+  }
+  return i;
+}
+
+/*Classifies the triangles of one of the meshes as inside or outside the other mesh. The
+ * triangles are grouped into patches that are not separated by intersection segments,
+ * and one triangle from each patch is tested.*/
+static std::vector<uint8_t> classify(const std::vector<Triangle>&   tris,
+                                     const std::array<MeshData, 2>& meshes,
+                                     size_t                         side,
+                                     const Intersection&            isect)
+{
+  using EdgeKey = std::pair<size_t, size_t>;
+  std::vector<std::pair<EdgeKey, size_t>> edges(3 * tris.size());
+  tbb::parallel_for(size_t(0), tris.size(), [&](size_t ti) {
+    for (int i = 0; i < 3; i++) {
+      size_t a = tris[ti][i], b = tris[ti][(i + 1) % 3];
+      edges[3 * ti + i] = {{std::min(a, b), std::max(a, b)}, ti};
+    }
+  });
+  tbb::parallel_sort(edges.begin(), edges.end());
+  std::vector<EdgeKey> cutEdges(isect.segments.size());
+  for (size_t i = 0; i < cutEdges.size(); i++) {
+    const IndexPair& s = isect.segments[i];
+    cutEdges[i]        = {std::min(s.p, s.q), std::max(s.p, s.q)};
+  }
+  std::sort(cutEdges.begin(), cutEdges.end());
+
+  std::vector<size_t> parents(tris.size());
+  std::iota(parents.begin(), parents.end(), size_t(0));
+  for (size_t i = 1; i < edges.size(); i++) {
+    if (edges[i].first != edges[i - 1].first ||
+        std::binary_search(cutEdges.begin(), cutEdges.end(), edges[i].first)) {
+      continue;
+    }
+    size_t r1 = findRoot(parents, edges[i].second);
+    size_t r2 = findRoot(parents, edges[i - 1].second);
+    if (r1 != r2) {
+      parents[std::max(r1, r2)] = std::min(r1, r2);
+    }
+  }
+
+  const auto globalPt = [&](size_t vi) -> const dvec3& {
+    return globalPoint(meshes, isect, vi);
+  };
+  std::vector<size_t> roots;
+  for (size_t ti = 0; ti < tris.size(); ti++) {
+    if (findRoot(parents, ti) == ti) {
+      roots.push_back(ti);
+    }
+  }
+  std::vector<uint8_t> inside(tris.size(), 0);
+  tbb::parallel_for(size_t(0), roots.size(), [&](size_t i) {
+    const Triangle& t = tris[roots[i]];
+    dvec3 center = (globalPt(t[0]) + globalPt(t[1]) + globalPt(t[2])) / 3.;
+    inside[roots[i]] = windingNumber(meshes[1 - side], center) > 0 ? 1 : 0;
+  });
+  for (size_t ti = 0; ti < tris.size(); ti++) {
+    inside[ti] = inside[findRoot(parents, ti)];
+  }
+  return inside;
+}
+
+Mesh meshBoolean(const Mesh& a, const Mesh& b, eMeshBoolean op)
+{
+  GALSCOPE(__func__);
+  const std::array<MeshData, 2> meshes = {MeshData(a, 0), MeshData(b, a.numVertices())};
+  Intersection                  isect  = intersect(meshes);
+
+  std::vector<glm::vec3>  verts;
+  std::vector<Mesh::Face> faces;
+  std::vector<size_t>     remap(isect.offset + isect.points.size(), SIZE_MAX);
+  const auto              vertex = [&](size_t vi) {
+    if (remap[vi] == SIZE_MAX) {
+      remap[vi] = verts.size();
+      if (vi < meshes[1].offset) {
+        verts.push_back(a.vertex(vi));
+      }
+      else if (vi < isect.offset) {
+        verts.push_back(b.vertex(vi - meshes[1].offset));
+      }
+      else {
+        verts.push_back(glm::vec3(isect.points[vi - isect.offset]));
+      }
+    }
+    return remap[vi];
+  };
+  for (size_t side = 0; side < 2; side++) {
+    std::vector<Triangle> tris   = cutMesh(meshes, side, isect);
+    std::vector<uint8_t>  inside = classify(tris, meshes, side, isect);
+    // The subtracted mesh contributes the faces inside the first mesh, flipped.
+    bool flip       = op == eMeshBoolean::subtract && side == 1;
+    bool keepInside = op == eMeshBoolean::intersect || flip;
+    for (size_t ti = 0; ti < tris.size(); ti++) {
+      if (bool(inside[ti]) != keepInside) {
+        continue;
+      }
+      Mesh::Face f(vertex(tris[ti][0]), vertex(tris[ti][1]), vertex(tris[ti][2]));
+      if (flip) {
+        f.flip();
+      }
+      faces.push_back(f);
+    }
+  }
+  return Mesh(std::move(verts), std::move(faces));
+}
+
+}  // namespace gal
@@ -0,0 +1,451 @@
+#include <galcore/ConvexHull.h>
+#include <galcore/ConvexHull2d.h>
+#include <galcore/DebugProfile.h>
+#include <galcore/OrientedBox3.h>
+#include <tbb/tbb.h>
+#include <numeric>
+
+namespace gal {
+
+OrientedBox3::OrientedBox3(const glm::vec3& c, const glm::mat3& a, const glm::vec3& h)
+    : center(c)
+    , axes(a)
+    , halfSize(glm::abs(h))
+{}
+
+float OrientedBox3::volume() const
+{
+  return 8.f * halfSize.x * halfSize.y * halfSize.z;
+}
+
+Box3 OrientedBox3::bounds() const
+{
+  glm::vec3 ext = glm::abs(axes[0]) * halfSize.x + glm::abs(axes[1]) * halfSize.y +
+                  glm::abs(axes[2]) * halfSize.z;
+  return Box3(center - ext, center + ext);
+}
+
+bool OrientedBox3::contains(const glm::vec3& pt, float tolerance) const
+{
+  glm::vec3 local = glm::abs(glm::transpose(axes) * (pt - center));
+  return local.x <= halfSize.x + tolerance && local.y <= halfSize.y + tolerance &&
+         local.z <= halfSize.z + tolerance;
+}
+
+void OrientedBox3::corners(glm::vec3 (&pts)[8]) const
+{
+  static constexpr float sSigns[8][3] = {{-1.f, -1.f, -1.f},
+                                         {1.f, -1.f, -1.f},
+                                         {1.f, 1.f, -1.f},
+                                         {-1.f, 1.f, -1.f},
+                                         {-1.f, -1.f, 1.f},
+                                         {1.f, -1.f, 1.f},
+                                         {1.f, 1.f, 1.f},
+                                         {-1.f, 1.f, 1.f}};
+  for (size_t i = 0; i < 8; i++) {
+    glm::vec3 signs(sSigns[i][0], sSigns[i][1], sSigns[i][2]);
+    pts[i] = center + axes * (halfSize * signs);
+  }
+}
+
+OrientedBox3 OrientedBox3::fitAxes(const glm::mat3& axes,
+                                   const glm::vec3* points,
+                                   size_t           nPoints)
+{
+  glm::mat3 toLocal = glm::transpose(axes);
+  glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+  for (size_t i = 0; i < nPoints; i++) {
+    glm::vec3 local = toLocal * points[i];
+    lo              = glm::min(lo, local);
+    hi              = glm::max(hi, local);
+  }
+  return OrientedBox3(axes * (0.5f * (lo + hi)), axes, 0.5f * (hi - lo));
+}
+
+/*Unit eigenvectors of the covariance of the points, as a right handed frame.*/
+static glm::mat3 principalAxes(const glm::vec3* points, size_t nPoints)
+{
+  glm::dvec3 mean(0.);
+  for (size_t i = 0; i < nPoints; i++) {
+    mean += glm::dvec3(points[i]);
+  }
+  mean /= double(nPoints);
+  glm::dmat3 cov(0.);
+  for (size_t i = 0; i < nPoints; i++) {
+    glm::dvec3 d = glm::dvec3(points[i]) - mean;
+    cov[0] += d * d.x;
+    cov[1] += d * d.y;
+    cov[2] += d * d.z;
+  }
+  glm::dvec3 values;
+  glm::dmat3 vectors;
+  utils::eigenSymmetric(cov, values, vectors);
+  glm::vec3 x = glm::normalize(glm::vec3(vectors[0]));
+  glm::vec3 y = glm::normalize(glm::vec3(vectors[1]));
+  return glm::mat3(x, y, glm::cross(x, y));
+}
+
+OrientedBox3 OrientedBox3::fitPCA(const glm::vec3* points, size_t nPoints)
+{
+  GALSCOPE(__func__);
+  if (nPoints == 0) {
+    throw "Cannot fit a box to zero points";
+  }
+  return fitAxes(principalAxes(points, nPoints), points, nPoints);
+}
+
+/*Smallest rectangle containing the convex polygon, with rotating calipers. The polygon
+ * must be counter-clockwise. One side of the rectangle is always flush with an edge of
+ * the polygon, so only the directions of the edges are visited, and the three other
+ * calipers only ever move forward. Returns the area and the direction of the flush
+ * side.*/
+static float minAreaRectangle(const std::vector<glm::vec2>& poly, glm::vec2& dir)
+{
+  const size_t n = poly.size();
+  if (n < 3) {
+    dir = n == 2 ? glm::normalize(poly[1] - poly[0]) : glm::vec2 {1.f, 0.f};
+    return 0.f;
+  }
+  size_t right = 1, top = 1, left = 1;
+  float  best  = FLT_MAX;
+  for (size_t i = 0; i < n; i++) {
+    const glm::vec2& a = poly[i];
+    glm::vec2        e = glm::normalize(poly[(i + 1) % n] - a);
+    glm::vec2        u = {-e.y, e.x};  // Points inside the polygon.
+    // Each caliper stops at the vertex farthest in its direction. The directions are
+    // unimodal around a convex polygon, so looking at the next vertex is enough.
+    while (glm::dot(e, poly[(right + 1) % n] - poly[right]) > 0.f) {
+      right = (right + 1) % n;
+    }
+    if (i == 0) {
+      top = right;
+    }
+    while (glm::dot(u, poly[(top + 1) % n] - poly[top]) > 0.f) {
+      top = (top + 1) % n;
+    }
+    if (i == 0) {
+      left = top;
+    }
+    while (glm::dot(e, poly[(left + 1) % n] - poly[left]) < 0.f) {
+      left = (left + 1) % n;
+    }
+    float area = glm::dot(e, poly[right] - poly[left]) * glm::dot(u, poly[top] - a);
+    if (area < best) {
+      best = area;
+      dir  = e;
+    }
+  }
+  return best;
+}
+
+/*The convex hull as a graph of its vertices, so that the extreme vertices in a direction
+ * and the silhouette seen from a direction are found by walking over the surface instead
+ * of visiting every vertex.*/
+struct HullGraph
+{
+  std::vector<glm::vec3> verts;
+  std::vector<glm::vec3> faceNormals;  // Unit normals, zero for degenerate faces.
+  std::vector<size_t>    nbrOffsets, nbrs;    // Neighbors of each vertex.
+  std::vector<size_t>    faceOffsets, faces;  // Faces around each vertex.
+
+  HullGraph(std::vector<glm::vec3>&& vertices, const std::vector<int>& tris)
+      : verts(std::move(vertices))
+  {
+    const size_t nVerts = verts.size(), nFaces = tris.size() / 3;
+    faceNormals.resize(nFaces);
+    std::vector<std::pair<size_t, size_t>> edges;
+    edges.reserve(tris.size());
+    faceOffsets.assign(nVerts + 1, 0);
+    for (size_t fi = 0; fi < nFaces; fi++) {
+      const int*       tri = tris.data() + 3 * fi;
+      const glm::vec3& p   = verts[tri[0]];
+      glm::vec3        n   = glm::cross(verts[tri[1]] - p, verts[tri[2]] - p);
+      faceNormals[fi]      = glm::length2(n) > 0.f ? glm::normalize(n) : glm::vec3(0.f);
+      for (int i = 0; i < 3; i++) {
+        edges.emplace_back(size_t(tri[i]), size_t(tri[(i + 1) % 3]));
+        edges.emplace_back(size_t(tri[(i + 1) % 3]), size_t(tri[i]));
+        faceOffsets[tri[i] + 1]++;
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    nbrOffsets.assign(nVerts + 1, 0);
+    nbrs.resize(edges.size());
+    for (size_t ei = 0; ei < edges.size(); ei++) {
+      nbrOffsets[edges[ei].first + 1]++;
+      nbrs[ei] = edges[ei].second;
+    }
+    std::partial_sum(nbrOffsets.begin(), nbrOffsets.end(), nbrOffsets.begin());
+    std::partial_sum(faceOffsets.begin(), faceOffsets.end(), faceOffsets.begin());
+    faces.resize(tris.size());
+    std::vector<size_t> fill(faceOffsets.begin(), faceOffsets.end() - 1);
+    for (size_t fi = 0; fi < nFaces; fi++) {
+      for (int i = 0; i < 3; i++) {
+        faces[fill[tris[3 * fi + i]]++] = fi;
+      }
+    }
+  }
+
+  /*Vertex farthest in the direction, by walking uphill from the start. A vertex of a
+   * convex polytope with no neighbor farther in a direction is the farthest of all.*/
+  size_t support(const glm::dvec3& dir, size_t vi) const
+  {
+    double best = glm::dot(glm::dvec3(verts[vi]), dir);
+    for (bool moved = true; moved;) {
+      moved = false;
+      for (size_t i = nbrOffsets[vi]; i < nbrOffsets[vi + 1]; i++) {
+        double d = glm::dot(glm::dvec3(verts[nbrs[i]]), dir);
+        if (d > best) {
+          best  = d;
+          vi    = nbrs[i];
+          moved = true;
+        }
+      }
+    }
+    return vi;
+  }
+
+  /*Whether the vertex has faces both facing the direction and facing away from it, up
+   * to a tolerance, i.e. whether it can be on the outline of the hull projected along the
+   * direction.*/
+  bool onSilhouette(size_t vi, const glm::vec3& dir) const
+  {
+    static constexpr float sTolerance = 1e-5f;
+    bool                   front = false, back = false;
+    for (size_t i = faceOffsets[vi]; i < faceOffsets[vi + 1]; i++) {
+      float d = glm::dot(faceNormals[faces[i]], dir);
+      front |= d >= -sTolerance;
+      back |= d <= sTolerance;
+    }
+    return front && back;
+  }
+};
+
+/*Scratch space of a thread.*/
+struct FlushScratch
+{
+  std::vector<size_t>    stamps;
+  size_t                 stamp = 0;
+  std::vector<size_t>    stack;
+  std::vector<glm::vec2> projected;
+};
+
+/*Cells per side of the cube map used to group the face normals of large hulls.*/
+static constexpr size_t sCubeCells = 26;
+/*Hulls with more distinct face normals than this are searched coarse to fine.*/
+static constexpr size_t sMaxPlanes = 6 * sCubeCells * sCubeCells;
+/*Number of the best coarse cells whose every face normal is tried.*/
+static constexpr size_t sRefineCells = 16;
+
+/*Cube map cell of a unit direction.*/
+static size_t directionCell(const glm::vec3& n)
+{
+  glm::vec3 a     = glm::abs(n);
+  int       major = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+  auto      bin   = [&](int axis) {
+    float t = (n[(major + axis) % 3] / a[major] + 1.f) * 0.5f;
+    return std::min(size_t(std::max(t, 0.f) * sCubeCells), sCubeCells - 1);
+  };
+  size_t side = 2 * size_t(major) + (n[major] < 0.f ? 1 : 0);
+  return (side * sCubeCells + bin(1)) * sCubeCells + bin(2);
+}
+
+/*Volume of the smallest box that has a face in the plane through the vertex a with the
+ * normal n, and contains the hull. The outline of the hull seen along n is found by
+ * walking from a vertex known to be on it, the one farthest along an axis of the plane,
+ * across the vertices that have faces on both sides. Only those vertices are projected
+ * to find the smallest rectangle.*/
+static float flushBoxVolume(const HullGraph& hull,
+                            size_t           a,
+                            const glm::vec3& n,
+                            const glm::vec3& x,
+                            FlushScratch&    scratch,
+                            glm::mat3&       frame)
+{
+  glm::vec3 y      = glm::cross(n, x);
+  size_t    top    = hull.support(glm::dvec3(n), a);
+  size_t    bottom = hull.support(-glm::dvec3(n), a);
+  float     height = glm::dot(hull.verts[top] - hull.verts[bottom], n);
+
+  std::vector<glm::vec2>& projected = scratch.projected;
+  auto project = [&](size_t vi) {
+    projected.emplace_back(glm::dot(hull.verts[vi], x), glm::dot(hull.verts[vi], y));
+  };
+  projected.clear();
+  size_t start = hull.support(glm::dvec3(x), a);
+  if (hull.onSilhouette(start, n)) {
+    size_t               stamp = ++scratch.stamp;
+    std::vector<size_t>& stack = scratch.stack;
+    scratch.stamps[start]      = stamp;
+    stack.assign(1, start);
+    while (!stack.empty()) {
+      size_t vi = stack.back();
+      stack.pop_back();
+      project(vi);
+      for (size_t i = hull.nbrOffsets[vi]; i < hull.nbrOffsets[vi + 1]; i++) {
+        size_t nbr = hull.nbrs[i];
+        if (scratch.stamps[nbr] != stamp && hull.onSilhouette(nbr, n)) {
+          scratch.stamps[nbr] = stamp;
+          stack.push_back(nbr);
+        }
+      }
+    }
+  }
+  else {
+    // Rounding stopped the walk short of the outline, so all the vertices are projected.
+    for (size_t vi = 0; vi < hull.verts.size(); vi++) {
+      project(vi);
+    }
+  }
+  glm::vec2 dir;
+  float     area =
+    minAreaRectangle(ConvexHull2d(projected.data(), projected.size()).vertices(), dir);
+  glm::vec3 ax = x * dir.x + y * dir.y;
+  frame        = glm::mat3(ax, glm::cross(n, ax), n);
+  return area * height;
+}
+
+OrientedBox3 OrientedBox3::fitMinVolume(const glm::vec3* points, size_t nPoints)
+{
+  GALSCOPE(__func__);
+  if (nPoints == 0) {
+    throw "Cannot fit a box to zero points";
+  }
+  std::vector<glm::vec3> verts;
+  std::vector<int>       tris;
+  try {
+    ConvexHull          hull(points, points + nPoints);
+    std::vector<size_t> indices = hull.vertexIndices();
+    verts.resize(indices.size());
+    std::transform(indices.begin(), indices.end(), verts.begin(), [&](size_t pi) {
+      return hull.getPt(pi);
+    });
+    tris.resize(hull.numFaces() * 3);
+    hull.copyFaces(tris.data());
+    for (int& vi : tris) {
+      vi = int(std::lower_bound(indices.begin(), indices.end(), size_t(vi)) -
+               indices.begin());
+    }
+  }
+  catch (const char*) {
+    // Flat input, the principal axes include the normal of the plane.
+    return fitPCA(points, nPoints);
+  }
+  const HullGraph hull(std::move(verts), tris);
+
+  // The triangles of a flat facet of the hull give the same box, so only one face per
+  // normal is visited.
+  std::vector<size_t> planes;
+  planes.reserve(hull.faceNormals.size());
+  for (size_t fi = 0; fi < hull.faceNormals.size(); fi++) {
+    if (glm::length2(hull.faceNormals[fi]) > 0.f) {
+      planes.push_back(fi);
+    }
+  }
+  const auto&        normals = hull.faceNormals;
+  std::vector<size_t> cells(normals.size(), 0);
+  for (size_t fi : planes) {
+    cells[fi] = directionCell(normals[fi]);
+  }
+  // Sorted by cell first, so that the faces of a cell are contiguous.
+  std::sort(planes.begin(), planes.end(), [&normals, &cells](size_t i, size_t j) {
+    if (cells[i] != cells[j]) {
+      return cells[i] < cells[j];
+    }
+    const glm::vec3 &a = normals[i], &b = normals[j];
+    return a.x < b.x || (a.x == b.x && (a.y < b.y || (a.y == b.y && a.z < b.z)));
+  });
+  planes.erase(std::unique(planes.begin(),
+                           planes.end(),
+                           [&normals](size_t i, size_t j) {
+                             return glm::dot(normals[i], normals[j]) > 1.f - 1e-6f;
+                           }),
+               planes.end());
+
+  const size_t           nPlanes = planes.size();
+  std::vector<float>     volumes(nPlanes, FLT_MAX);
+  std::vector<glm::mat3> frames(nPlanes);
+  FlushScratch           empty;
+  empty.stamps.assign(hull.verts.size(), 0);
+  tbb::enumerable_thread_specific<FlushScratch> scratches(empty);
+  auto evaluate = [&](const std::vector<size_t>& which) {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, which.size()),
+                      [&](const tbb::blocked_range<size_t>& range) {
+                        FlushScratch& scratch = scratches.local();
+                        for (size_t i = range.begin(); i < range.end(); i++) {
+                          size_t     pi  = which[i];
+                          const int* tri = tris.data() + 3 * planes[pi];
+                          glm::vec3  x   = glm::normalize(hull.verts[tri[1]] -
+                                                       hull.verts[tri[0]]);
+                          volumes[pi]    = flushBoxVolume(hull,
+                                                       size_t(tri[0]),
+                                                       normals[planes[pi]],
+                                                       x,
+                                                       scratch,
+                                                       frames[pi]);
+                        }
+                      });
+  };
+  std::vector<size_t> which(nPlanes);
+  std::iota(which.begin(), which.end(), size_t(0));
+  if (nPlanes > sMaxPlanes) {
+    // Large curved hulls: one face per cell first, then all faces of the best cells.
+    // The result is then not guaranteed to be the smallest box, but stays within a
+    // small fraction of it.
+    std::vector<size_t> firsts;
+    for (size_t pi = 0; pi < nPlanes; pi++) {
+      if (pi == 0 || cells[planes[pi]] != cells[planes[pi - 1]]) {
+        firsts.push_back(pi);
+      }
+    }
+    evaluate(firsts);
+    std::vector<size_t> order(firsts.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    size_t nRefine = std::min(sRefineCells, order.size());
+    std::partial_sort(order.begin(),
+                      order.begin() + nRefine,
+                      order.end(),
+                      [&](size_t i, size_t j) {
+                        return volumes[firsts[i]] < volumes[firsts[j]];
+                      });
+    which.clear();
+    for (size_t r = 0; r < nRefine; r++) {
+      size_t ci  = order[r];
+      size_t end = ci + 1 < firsts.size() ? firsts[ci + 1] : nPlanes;
+      for (size_t pi = firsts[ci] + 1; pi < end; pi++) {
+        which.push_back(pi);
+      }
+    }
+  }
+  evaluate(which);
+
+  // The principal axes of the hull are a candidate too.
+  OrientedBox3 best = fitPCA(hull.verts.data(), hull.verts.size());
+  size_t bestPlane  = std::min_element(volumes.begin(), volumes.end()) - volumes.begin();
+  if (bestPlane < nPlanes && volumes[bestPlane] < best.volume()) {
+    best = fitAxes(frames[bestPlane], hull.verts.data(), hull.verts.size());
+  }
+  GALCAPTURE(best);
+  return best;
+}
+
+OrientedBox3 OrientedBox3::fit(const glm::vec3* points,
+                               size_t           nPoints,
+                               eOrientedBoxFit  mode)
+{
+  switch (mode) {
+  case eOrientedBoxFit::pca:
+    return fitPCA(points, nPoints);
+  case eOrientedBoxFit::minVolume:
+    return fitMinVolume(points, nPoints);
+  default:
+    throw "Unknown box fitting mode";
+  }
+}
+
+OrientedBox3 OrientedBox3::fit(const std::vector<glm::vec3>& points, eOrientedBoxFit mode)
+{
+  return fit(points.data(), points.size(), mode);
+}
+
+}  // namespace gal
@@ -1,4 +1,6 @@
 #include <galcore/PointCloud.h>
+#include <galcore/Util.h>
+#include <tuple>
 
 namespace gal {
 
@@ -18,4 +20,598 @@ Box3 PointCloud::bounds() const
   return Box3(data(), size());
 }
 
+bool PointCloud::hasNormals() const noexcept
+{
+  return !empty() && mNormals.size() == size();
+}
+
+std::vector<glm::vec3>& PointCloud::normals() noexcept
+{
+  return mNormals;
+}
+
+const std::vector<glm::vec3>& PointCloud::normals() const noexcept
+{
+  return mNormals;
+}
+
+bool PointCloud::hasColors() const noexcept
+{
+  return !empty() && mColors.size() == size();
+}
+
+std::vector<glm::vec3>& PointCloud::colors() noexcept
+{
+  return mColors;
+}
+
+const std::vector<glm::vec3>& PointCloud::colors() const noexcept
+{
+  return mColors;
+}
+
+bool PointCloud::hasScalarField(const std::string& name) const
+{
+  return mScalarFields.find(name) != mScalarFields.end();
+}
+
+std::vector<float>& PointCloud::scalarField(const std::string& name)
+{
+  std::vector<float>& field = mScalarFields[name];
+  if (field.empty()) {
+    field.resize(size(), 0.f);
+  }
+  return field;
+}
+
+const std::vector<float>& PointCloud::scalarField(const std::string& name) const
+{
+  auto match = mScalarFields.find(name);
+  if (match == mScalarFields.end()) {
+    throw "Cannot find the scalar field";
+  }
+  return match->second;
+}
+
+void PointCloud::removeScalarField(const std::string& name)
+{
+  mScalarFields.erase(name);
+}
+
+std::vector<std::string> PointCloud::scalarFieldNames() const
+{
+  std::vector<std::string> names;
+  names.reserve(mScalarFields.size());
+  for (const auto& field : mScalarFields) {
+    names.push_back(field.first);
+  }
+  return names;
+}
+
+void PointCloud::clearAttributes()
+{
+  mNormals.clear();
+  mColors.clear();
+  mScalarFields.clear();
+}
+
+void PointCloud::estimateNormals(size_t nNeighbors)
+{
+  estimateNormals(nNeighbors, kdTree());
+}
+
+void PointCloud::estimateNormals(size_t nNeighbors, const KdTree3& tree)
+{
+  if (nNeighbors < 3) {
+    throw "Cannot estimate normals from fewer than 3 neighbors";
+  }
+  if (tree.size() != size()) {
+    throw "The k-d tree doesn't match the points";
+  }
+  const glm::vec3* pts = data();
+  const size_t     k    = std::min(nNeighbors, size());
+  mNormals.resize(size());
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, size()), [&](const tbb::blocked_range<size_t>& range) {
+      std::vector<size_t> nbrs(k);
+      std::vector<float>  dists(k);
+      for (size_t i = range.begin(); i < range.end(); i++) {
+        size_t     nFound = tree.queryNearestN(pts[i], k, nbrs.data(), dists.data());
+        glm::dvec3 mean(0.);
+        for (size_t j = 0; j < nFound; j++) {
+          mean += glm::dvec3(pts[nbrs[j]]);
+        }
+        mean /= double(nFound);
+        glm::dmat3 cov(0.);
+        for (size_t j = 0; j < nFound; j++) {
+          glm::dvec3 d = glm::dvec3(pts[nbrs[j]]) - mean;
+          cov[0] += d * d.x;
+          cov[1] += d * d.y;
+          cov[2] += d * d.z;
+        }
+        glm::dvec3 values;
+        glm::dmat3 vectors;
+        utils::eigenSymmetric(cov, values, vectors);
+        int least = values.x <= values.y ? (values.x <= values.z ? 0 : 2)
+                                         : (values.y <= values.z ? 1 : 2);
+        mNormals[i] = glm::normalize(glm::vec3(vectors[least]));
+      }
+    });
+}
+
+void PointCloud::orientNormals(size_t nNeighbors)
+{
+  orientNormals(nNeighbors, kdTree());
+}
+
+void PointCloud::orientNormals(size_t nNeighbors, const KdTree3& tree)
+{
+  struct Edge
+  {
+    float  weight;
+    size_t a;
+    size_t b;
+  };
+  if (!hasNormals()) {
+    throw "Cannot orient the normals of a cloud without normals";
+  }
+  if (tree.size() != size()) {
+    throw "The k-d tree doesn't match the points";
+  }
+  const size_t nPts = size();
+  // The nearest neighbor of a point is usually the point itself.
+  const size_t      k = std::min(nNeighbors + 1, nPts);
+  std::vector<Edge> edges(nPts * k);
+  {
+    std::vector<size_t> nbrs(nPts * k);
+    std::vector<float>  dists(nPts * k);
+    tree.queryNearestNBatch(data(), nPts, k, nbrs.data(), dists.data());
+    tbb::parallel_for(size_t(0), edges.size(), [&](size_t ei) {
+      size_t a  = ei / k, b = nbrs[ei];
+      edges[ei] = {1.f - std::abs(glm::dot(mNormals[a], mNormals[b])), a, b};
+    });
+  }
+  // The indices break the ties so the tree doesn't depend on the sort.
+  tbb::parallel_sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) {
+    return std::tie(x.weight, x.a, x.b) < std::tie(y.weight, y.a, y.b);
+  });
+
+  std::vector<size_t> parents(nPts);
+  std::iota(parents.begin(), parents.end(), size_t(0));
+  auto findRoot = [&](size_t i) {
+    while (parents[i] != i) {
+      parents[i] = parents[parents[i]];
+      i          = parents[i];
+    }
+    return i;
+  };
+  std::vector<std::pair<size_t, size_t>> treeEdges;
+  treeEdges.reserve(nPts);
+  for (const Edge& edge : edges) {
+    size_t ra = findRoot(edge.a), rb = findRoot(edge.b);
+    if (ra == rb) {
+      continue;
+    }
+    parents[std::max(ra, rb)] = std::min(ra, rb);
+    treeEdges.emplace_back(edge.a, edge.b);
+    if (treeEdges.size() + 1 == nPts) {
+      break;
+    }
+  }
+  std::vector<Edge>().swap(edges);
+
+  std::vector<size_t> offsets(nPts + 1, 0), adjacent(2 * treeEdges.size());
+  for (const auto& edge : treeEdges) {
+    offsets[edge.first + 1]++;
+    offsets[edge.second + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  {
+    std::vector<size_t> dst(offsets.begin(), offsets.end() - 1);
+    for (const auto& edge : treeEdges) {
+      adjacent[dst[edge.first]++]  = edge.second;
+      adjacent[dst[edge.second]++] = edge.first;
+    }
+  }
+
+  // Breadth first from the highest point of every connected part at once.
+  std::vector<size_t> highest(nPts, SIZE_MAX);
+  for (size_t i = 0; i < nPts; i++) {
+    size_t& best = highest[findRoot(i)];
+    if (best == SIZE_MAX || (*this)[i].z > (*this)[best].z) {
+      best = i;
+    }
+  }
+  std::vector<bool>   visited(nPts, false);
+  std::vector<size_t> queue;
+  queue.reserve(nPts);
+  for (size_t root : highest) {
+    if (root == SIZE_MAX) {
+      continue;
+    }
+    if (mNormals[root].z < 0.f) {
+      mNormals[root] = -mNormals[root];
+    }
+    visited[root] = true;
+    queue.push_back(root);
+  }
+  for (size_t qi = 0; qi < queue.size(); qi++) {
+    size_t i = queue[qi];
+    for (size_t ai = offsets[i]; ai < offsets[i + 1]; ai++) {
+      size_t j = adjacent[ai];
+      if (visited[j]) {
+        continue;
+      }
+      if (glm::dot(mNormals[i], mNormals[j]) < 0.f) {
+        mNormals[j] = -mNormals[j];
+      }
+      visited[j] = true;
+      queue.push_back(j);
+    }
+  }
+}
+
+void PointCloud::copyAttributes(const std::vector<size_t>& sources,
+                                PointCloud&                result) const
+{
+  auto gather = [&](const auto& src, auto& dst) {
+    dst.resize(sources.size());
+    tbb::parallel_for(
+      size_t(0), sources.size(), [&](size_t i) { dst[i] = src[sources[i]]; });
+  };
+  if (hasNormals()) {
+    gather(mNormals, result.mNormals);
+  }
+  if (hasColors()) {
+    gather(mColors, result.mColors);
+  }
+  for (const auto& field : mScalarFields) {
+    if (field.second.size() == size()) {
+      gather(field.second, result.mScalarFields[field.first]);
+    }
+  }
+}
+
+void PointCloud::averageAttributes(const std::vector<size_t>& offsets,
+                                   const std::vector<size_t>& sources,
+                                   PointCloud&                result) const
+{
+  const size_t nOut    = offsets.size() - 1;
+  auto         average = [&](const auto& src, auto& dst) {
+    using ValueType = typename std::decay_t<decltype(src)>::value_type;
+    dst.resize(nOut);
+    tbb::parallel_for(size_t(0), nOut, [&](size_t oi) {
+      ValueType sum(0.f);
+      for (size_t i = offsets[oi]; i < offsets[oi + 1]; i++) {
+        sum += src[sources[i]];
+      }
+      dst[oi] = sum / float(offsets[oi + 1] - offsets[oi]);
+    });
+  };
+  if (hasNormals()) {
+    result.mNormals.resize(nOut);
+    tbb::parallel_for(size_t(0), nOut, [&](size_t oi) {
+      // Every normal is within 90 degrees of the first after flipping, so the sum is
+      // never zero.
+      const glm::vec3& first = mNormals[sources[offsets[oi]]];
+      glm::vec3        sum(0.f);
+      for (size_t i = offsets[oi]; i < offsets[oi + 1]; i++) {
+        const glm::vec3& normal = mNormals[sources[i]];
+        sum += glm::dot(normal, first) < 0.f ? -normal : normal;
+      }
+      result.mNormals[oi] = glm::normalize(sum);
+    });
+  }
+  if (hasColors()) {
+    average(mColors, result.mColors);
+  }
+  for (const auto& field : mScalarFields) {
+    if (field.second.size() == size()) {
+      average(field.second, result.mScalarFields[field.first]);
+    }
+  }
+}
+
+struct CellEntry
+{
+  uint64_t key;
+  size_t   index;
+};
+
+static constexpr uint64_t sCellBits = 21;
+static constexpr uint64_t sCellMask = (uint64_t(1) << sCellBits) - 1;
+
+static uint64_t cellKey(const glm::uvec3& cell)
+{
+  return (uint64_t(cell.x) << (2 * sCellBits)) | (uint64_t(cell.y) << sCellBits) |
+         uint64_t(cell.z);
+}
+
+static glm::uvec3 cellCoords(uint64_t key)
+{
+  return {uint32_t(key >> (2 * sCellBits)), uint32_t((key >> sCellBits) & sCellMask),
+          uint32_t(key & sCellMask)};
+}
+
+/*Sorts the points by the cubic cell they fall in, and writes the offsets of the runs of
+ * points in the same cell. Within a cell the points are in a pseudo-random order, so that
+ * taking them in turn doesn't follow the order of the scan.*/
+static void sortIntoCells(const PointCloud&       cloud,
+                          float                   cellSize,
+                          std::vector<CellEntry>& entries,
+                          std::vector<size_t>&    cellOffsets)
+{
+  if (!(cellSize > 0.f)) {
+    throw "Cannot use cells of zero size";
+  }
+  entries.clear();
+  cellOffsets.assign(1, 0);
+  if (cloud.empty()) {
+    return;
+  }
+  Box3      bounds = cloud.bounds();
+  glm::vec3 dims   = glm::floor(bounds.diagonal() / cellSize) + 1.f;
+  if (std::max({dims.x, dims.y, dims.z}) > float(uint64_t(1) << sCellBits)) {
+    throw "Cannot use cells this small for the size of the cloud";
+  }
+  entries.resize(cloud.size());
+  tbb::parallel_for(size_t(0), cloud.size(), [&](size_t i) {
+    glm::uvec3 cell = glm::min(glm::uvec3((cloud[i] - bounds.min) / cellSize),
+                               glm::uvec3(dims) - glm::uvec3(1));
+    entries[i]      = {cellKey(cell), i};
+  });
+  // Multiplicative hash of the index to shuffle the points of a cell.
+  auto shuffled = [](size_t i) { return uint64_t(i) * 0x9e3779b97f4a7c15ULL; };
+  tbb::parallel_sort(
+    entries.begin(), entries.end(), [&](const CellEntry& a, const CellEntry& b) {
+      return a.key < b.key || (a.key == b.key && shuffled(a.index) < shuffled(b.index));
+    });
+  for (size_t i = 1; i < entries.size(); i++) {
+    if (entries[i].key != entries[i - 1].key) {
+      cellOffsets.push_back(i);
+    }
+  }
+  cellOffsets.push_back(entries.size());
+}
+
+PointCloud PointCloud::voxelDownsample(float                voxelSize,
+                                       std::vector<size_t>& offsets,
+                                       std::vector<size_t>& sources) const
+{
+  std::vector<CellEntry> entries;
+  sortIntoCells(*this, voxelSize, entries, offsets);
+  const glm::vec3* pts     = data();
+  const size_t     nVoxels = offsets.size() - 1;
+  PointCloud       result;
+  result.resize(nVoxels);
+  sources.resize(entries.size());
+  tbb::parallel_for(size_t(0), nVoxels, [&](size_t vi) {
+    glm::dvec3 sum(0.);
+    for (size_t i = offsets[vi]; i < offsets[vi + 1]; i++) {
+      sum += glm::dvec3(pts[entries[i].index]);
+      sources[i] = entries[i].index;
+    }
+    result[vi] = glm::vec3(sum / double(offsets[vi + 1] - offsets[vi]));
+  });
+  averageAttributes(offsets, sources, result);
+  return result;
+}
+
+PointCloud PointCloud::poissonDiskSample(float radius, std::vector<size_t>& sources) const
+{
+  std::vector<CellEntry> entries;
+  std::vector<size_t>    offsets;
+  sortIntoCells(*this, radius, entries, offsets);
+  const glm::vec3*      pts    = data();
+  const size_t          nCells = offsets.size() - 1;
+  std::vector<uint64_t> keys(nCells);
+  for (size_t ci = 0; ci < nCells; ci++) {
+    keys[ci] = entries[offsets[ci]].key;
+  }
+  // The neighbors of a cell are found by looking up the rows of cells along z around it,
+  // then the cells in each row, so the searches stay short.
+  std::vector<uint64_t> rows;
+  std::vector<size_t>   rowOffsets;
+  for (size_t ci = 0; ci < nCells; ci++) {
+    if (ci == 0 || (keys[ci] >> sCellBits) != rows.back()) {
+      rows.push_back(keys[ci] >> sCellBits);
+      rowOffsets.push_back(ci);
+    }
+  }
+  rowOffsets.push_back(nCells);
+
+  std::vector<size_t> nAccepted(nCells, 0);
+  std::vector<size_t> phaseOffsets(28, 0), byPhase(nCells);
+  auto                phaseOf = [&](size_t ci) {
+    glm::uvec3 cell = cellCoords(keys[ci]);
+    return (cell.x % 3) * 9 + (cell.y % 3) * 3 + cell.z % 3;
+  };
+  for (size_t ci = 0; ci < nCells; ci++) {
+    phaseOffsets[phaseOf(ci) + 1]++;
+  }
+  std::partial_sum(phaseOffsets.begin(), phaseOffsets.end(), phaseOffsets.begin());
+  {
+    std::vector<size_t> dst(phaseOffsets.begin(), phaseOffsets.end() - 1);
+    for (size_t ci = 0; ci < nCells; ci++) {
+      byPhase[dst[phaseOf(ci)]++] = ci;
+    }
+  }
+
+  // The points are copied in the order of the entries, and the accepted points of a cell
+  // are moved to the front of its range, so the checks only read contiguous memory.
+  std::vector<glm::vec3> sorted(entries.size());
+  tbb::parallel_for(
+    size_t(0), entries.size(), [&](size_t i) { sorted[i] = pts[entries[i].index]; });
+  const float sqRadius = radius * radius;
+  tbb::enumerable_thread_specific<std::vector<glm::vec3>> nearScratch;
+  for (size_t phase = 0; phase < 27; phase++) {
+    tbb::parallel_for(phaseOffsets[phase], phaseOffsets[phase + 1], [&](size_t pi) {
+      size_t     ci   = byPhase[pi];
+      glm::ivec3 cell = glm::ivec3(cellCoords(keys[ci]));
+      // The samples of the surrounding cells are gathered once for all the points of the
+      // cell. Neighbors past the last cell of an axis are skipped or clamped, so that
+      // they don't carry into the bits of the next axis.
+      std::vector<glm::vec3>& near = nearScratch.local();
+      near.clear();
+      for (int dx = -1; dx < 2; dx++) {
+        for (int dy = -1; dy < 2; dy++) {
+          glm::ivec3 lo = cell + glm::ivec3(dx, dy, -1);
+          if (lo.x < 0 || lo.y < 0 || lo.x > int(sCellMask) || lo.y > int(sCellMask)) {
+            continue;
+          }
+          uint64_t first = cellKey(glm::uvec3(lo.x, lo.y, std::max(lo.z, 0)));
+          uint64_t last =
+            cellKey(glm::uvec3(lo.x, lo.y, std::min(lo.z + 2, int(sCellMask))));
+          auto     row   = std::lower_bound(rows.begin(), rows.end(), first >> sCellBits);
+          if (row == rows.end() || *row != (first >> sCellBits)) {
+            continue;
+          }
+          size_t ri  = size_t(row - rows.begin());
+          auto   end = keys.begin() + rowOffsets[ri + 1];
+          for (auto it = std::lower_bound(keys.begin() + rowOffsets[ri], end, first);
+               it != end && *it <= last;
+               it++) {
+            size_t nc  = size_t(it - keys.begin());
+            auto   src = sorted.begin() + offsets[nc];
+            near.insert(near.end(), src, src + nAccepted[nc]);
+          }
+        }
+      }
+      for (size_t i = offsets[ci]; i < offsets[ci + 1]; i++) {
+        const glm::vec3 pt = sorted[i];
+        if (std::all_of(near.begin(), near.end(), [&](const glm::vec3& other) {
+              return glm::distance2(pt, other) >= sqRadius;
+            })) {
+          size_t dst = offsets[ci] + nAccepted[ci]++;
+          near.push_back(pt);
+          std::swap(sorted[i], sorted[dst]);
+          std::swap(entries[i], entries[dst]);
+        }
+      }
+    });
+  }
+
+  std::vector<size_t> sampleOffsets(nCells + 1, 0);
+  std::partial_sum(nAccepted.begin(), nAccepted.end(), sampleOffsets.begin() + 1);
+  PointCloud result;
+  result.resize(sampleOffsets.back());
+  sources.resize(sampleOffsets.back());
+  tbb::parallel_for(size_t(0), nCells, [&](size_t ci) {
+    for (size_t i = 0; i < nAccepted[ci]; i++) {
+      size_t dst   = sampleOffsets[ci] + i;
+      sources[dst] = entries[offsets[ci] + i].index;
+      result[dst]  = sorted[offsets[ci] + i];
+    }
+  });
+  copyAttributes(sources, result);
+  return result;
+}
+
+KdTree3 PointCloud::kdTree() const
+{
+  return KdTree3(data(), size());
+}
+
+MiniBatchKMeans::MiniBatchKMeans(size_t nClusters)
+    : mNumClusters(nClusters)
+{
+  if (nClusters == 0) {
+    throw "Cannot cluster into zero clusters";
+  }
+}
+
+void MiniBatchKMeans::addBatch(const glm::vec3* points, size_t nPoints)
+{
+  if (!mCenters.empty()) {
+    update(points, nPoints);
+    return;
+  }
+  mPending.insert(mPending.end(), points, points + nPoints);
+  if (mPending.size() < mNumClusters) {
+    return;
+  }
+  std::vector<glm::vec3> pending;
+  std::swap(pending, mPending);
+  mCenters = kMeansSeeds<glm::vec3>(pending.begin(), pending.end(), mNumClusters);
+  mCounts.assign(mNumClusters, 0);
+  update(pending.data(), pending.size());
+}
+
+void MiniBatchKMeans::addBatches(const std::function<bool(PointCloud&)>& readChunk)
+{
+  PointCloud chunk;
+  while (readChunk(chunk)) {
+    addBatch(chunk.data(), chunk.size());
+  }
+}
+
+void MiniBatchKMeans::update(const glm::vec3* points, size_t nPoints)
+{
+  struct Partial
+  {
+    std::vector<glm::dvec3> sums;
+    std::vector<uint64_t>   counts;
+  };
+  // Every thread sums into its own copy of the total, which is still zero here.
+  Partial total {std::vector<glm::dvec3>(mNumClusters, glm::dvec3(0.)),
+                 std::vector<uint64_t>(mNumClusters, 0)};
+  tbb::enumerable_thread_specific<Partial> partials(total);
+  KdTree3                                  tree(mCenters.data(), mCenters.size());
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, nPoints), [&](const tbb::blocked_range<size_t>& range) {
+      Partial& partial = partials.local();
+      for (size_t i = range.begin(); i < range.end(); i++) {
+        size_t ci;
+        float  dist;
+        tree.queryNearestN(points[i], 1, &ci, &dist);
+        partial.sums[ci] += glm::dvec3(points[i]);
+        partial.counts[ci]++;
+      }
+    });
+  partials.combine_each([&](const Partial& partial) {
+    for (size_t ci = 0; ci < mNumClusters; ci++) {
+      total.sums[ci] += partial.sums[ci];
+      total.counts[ci] += partial.counts[ci];
+    }
+  });
+  for (size_t ci = 0; ci < mNumClusters; ci++) {
+    if (total.counts[ci] == 0) {
+      continue;
+    }
+    mCounts[ci] += total.counts[ci];
+    glm::dvec3 center(mCenters[ci]);
+    center += (total.sums[ci] - double(total.counts[ci]) * center) / double(mCounts[ci]);
+    mCenters[ci] = glm::vec3(center);
+  }
+}
+
+void MiniBatchKMeans::assign(const glm::vec3* points,
+                             size_t           nPoints,
+                             size_t*          idxOut) const
+{
+  if (mCenters.empty()) {
+    throw "Cannot assign points before the centers are seeded";
+  }
+  KdTree3 tree(mCenters.data(), mCenters.size());
+  tbb::parallel_for(size_t(0), nPoints, [&](size_t i) {
+    float dist;
+    tree.queryNearestN(points[i], 1, idxOut + i, &dist);
+  });
+}
+
+size_t MiniBatchKMeans::numClusters() const noexcept
+{
+  return mNumClusters;
+}
+
+const std::vector<glm::vec3>& MiniBatchKMeans::centers() const noexcept
+{
+  return mCenters;
+}
+
+const std::vector<uint64_t>& MiniBatchKMeans::counts() const noexcept
+{
+  return mCounts;
+}
+
 };  // namespace gal
\ No newline at end of file
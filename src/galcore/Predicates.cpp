@@ -0,0 +1,209 @@
+#include <galcore/Predicates.h>
+#include <vector>
+
+namespace gal {
+
+using Expansion = std::vector<double>;
+
+/*Error free transformations and arithmetic on nonoverlapping expansions, following
+ * Shewchuk. These are only used when the floating point filter can't decide a sign.*/
+static void twoSum(double a, double b, double& x, double& y)
+{
+  x         = a + b;
+  double bv = x - a;
+  double av = x - bv;
+  y         = (a - av) + (b - bv);
+}
+
+static void twoProduct(double a, double b, double& x, double& y)
+{
+  x = a * b;
+  y = std::fma(a, b, -x);
+}
+
+static Expansion difference(double a, double b)
+{
+  double x, y;
+  twoSum(a, -b, x, y);
+  return y == 0. ? Expansion {x} : Expansion {y, x};
+}
+
+static Expansion growExpansion(const Expansion& e, double b)
+{
+  Expansion h;
+  h.reserve(e.size() + 1);
+  double q = b, hh;
+  for (double ei : e) {
+    twoSum(q, ei, q, hh);
+    if (hh != 0.) {
+      h.push_back(hh);
+    }
+  }
+  if (q != 0. || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+static Expansion sumExpansions(const Expansion& e, const Expansion& f)
+{
+  Expansion h = e;
+  for (double fi : f) {
+    h = growExpansion(h, fi);
+  }
+  return h;
+}
+
+static Expansion scaleExpansion(const Expansion& e, double b)
+{
+  Expansion h;
+  h.reserve(2 * e.size());
+  double q, hh;
+  twoProduct(e[0], b, q, hh);
+  if (hh != 0.) {
+    h.push_back(hh);
+  }
+  for (size_t i = 1; i < e.size(); i++) {
+    double p1, p0, sum;
+    twoProduct(e[i], b, p1, p0);
+    twoSum(q, p0, sum, hh);
+    if (hh != 0.) {
+      h.push_back(hh);
+    }
+    twoSum(p1, sum, q, hh);
+    if (hh != 0.) {
+      h.push_back(hh);
+    }
+  }
+  if (q != 0. || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+static Expansion multiplyExpansions(const Expansion& e, const Expansion& f)
+{
+  Expansion h = {0.};
+  for (double fi : f) {
+    h = sumExpansions(h, scaleExpansion(e, fi));
+  }
+  return h;
+}
+
+static Expansion negated(Expansion e)
+{
+  for (double& v : e) {
+    v = -v;
+  }
+  return e;
+}
+
+static int expansionSign(const Expansion& e)
+{
+  // The last nonzero component is the most significant.
+  for (auto it = e.rbegin(); it != e.rend(); it++) {
+    if (*it != 0.) {
+      return *it > 0. ? 1 : -1;
+    }
+  }
+  return 0;
+}
+
+int orient2dExact(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c)
+{
+  Expansion acx = difference(a.x, c.x);
+  Expansion acy = difference(a.y, c.y);
+  Expansion bcx = difference(b.x, c.x);
+  Expansion bcy = difference(b.y, c.y);
+  return expansionSign(sumExpansions(multiplyExpansions(acx, bcy),
+                                     negated(multiplyExpansions(acy, bcx))));
+}
+
+int orient3dExact(const glm::dvec3& a,
+                  const glm::dvec3& b,
+                  const glm::dvec3& c,
+                  const glm::dvec3& d)
+{
+  Expansion u[3], v[3], w[3];
+  for (int i = 0; i < 3; i++) {
+    u[i] = difference(b[i], a[i]);
+    v[i] = difference(c[i], a[i]);
+    w[i] = difference(d[i], a[i]);
+  }
+  Expansion det = {0.};
+  for (int i = 0; i < 3; i++) {
+    int       j     = (i + 1) % 3;
+    int       k     = (i + 2) % 3;
+    Expansion minor = sumExpansions(multiplyExpansions(v[j], w[k]),
+                                    negated(multiplyExpansions(v[k], w[j])));
+    det             = sumExpansions(det, multiplyExpansions(u[i], minor));
+  }
+  return expansionSign(det);
+}
+
+int incircleExact(const glm::dvec2& a,
+                  const glm::dvec2& b,
+                  const glm::dvec2& c,
+                  const glm::dvec2& d)
+{
+  const glm::dvec2* pts[3] = {&a, &b, &c};
+  Expansion         x[3], y[3];
+  for (int i = 0; i < 3; i++) {
+    x[i] = difference(pts[i]->x, d.x);
+    y[i] = difference(pts[i]->y, d.y);
+  }
+  Expansion det = {0.};
+  for (int i = 0; i < 3; i++) {
+    int       j     = (i + 1) % 3;
+    int       k     = (i + 2) % 3;
+    Expansion lift  = sumExpansions(multiplyExpansions(x[i], x[i]),
+                                   multiplyExpansions(y[i], y[i]));
+    Expansion minor = sumExpansions(multiplyExpansions(x[j], y[k]),
+                                    negated(multiplyExpansions(x[k], y[j])));
+    det             = sumExpansions(det, multiplyExpansions(lift, minor));
+  }
+  return expansionSign(det);
+}
+
+int insphereExact(const glm::dvec3& a,
+                  const glm::dvec3& b,
+                  const glm::dvec3& c,
+                  const glm::dvec3& d,
+                  const glm::dvec3& e)
+{
+  // Rows of the lifted matrix, relative to e.
+  const glm::dvec3* pts[4] = {&a, &b, &c, &d};
+  Expansion         x[4][3], lift[4];
+  for (int i = 0; i < 4; i++) {
+    lift[i] = {0.};
+    for (int j = 0; j < 3; j++) {
+      x[i][j] = difference((*pts[i])[j], e[j]);
+      lift[i] = sumExpansions(lift[i], multiplyExpansions(x[i][j], x[i][j]));
+    }
+  }
+  // Cofactor expansion along the lifted column. The minor of row i is the determinant of
+  // the coordinates of the other three rows.
+  Expansion det = {0.};
+  for (int i = 0; i < 4; i++) {
+    int r[3], n = 0;
+    for (int k = 0; k < 4; k++) {
+      if (k != i) {
+        r[n++] = k;
+      }
+    }
+    Expansion minor = {0.};
+    for (int j = 0; j < 3; j++) {
+      int       j1  = (j + 1) % 3;
+      int       j2  = (j + 2) % 3;
+      Expansion sub =
+        sumExpansions(multiplyExpansions(x[r[1]][j1], x[r[2]][j2]),
+                      negated(multiplyExpansions(x[r[1]][j2], x[r[2]][j1])));
+      minor         = sumExpansions(minor, multiplyExpansions(x[r[0]][j], sub));
+    }
+    Expansion term = multiplyExpansions(lift[i], minor);
+    det            = sumExpansions(det, i % 2 ? term : negated(term));
+  }
+  return -expansionSign(det);
+}
+
+}  // namespace gal
@@ -8,6 +8,11 @@ Bytes::Bytes()
   mData.reserve(5120);
 };
 
+size_t Bytes::remaining() const noexcept
+{
+  return mData.size() - mReadPos;
+}
+
 Bytes& Bytes::writeBytes(const char* src, size_t nBytes)
 {
   std::copy(src, src + nBytes, std::back_inserter(mData));
@@ -25,6 +30,15 @@ Bytes& Bytes::readBytes(size_t nBytes, char* dst)
   return *this;
 }
 
+Bytes& Bytes::skip(size_t nBytes)
+{
+  if (nBytes > remaining()) {
+    throw std::out_of_range("Out of bounds while reading bytes!");
+  }
+  mReadPos += nBytes;
+  return *this;
+}
+
 Bytes& Bytes::writeNested(Bytes nested)
 {
   write(uint64_t(nested.mData.size()));
@@ -35,6 +49,9 @@ Bytes& Bytes::readNested(Bytes& nested)
 {
   uint64_t size = 0;
   read(size);
+  if (size > remaining()) {
+    throw std::out_of_range("Out of bounds while reading bytes!");
+  }
   nested.mData.resize(size);
   return readBytes(size, nested.mData.data());
 }
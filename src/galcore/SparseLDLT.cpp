@@ -0,0 +1,153 @@
+#include <galcore/SparseLDLT.h>
+#include <algorithm>
+#include <numeric>
+#include <stdint.h>
+
+namespace gal {
+
+SparseLDLT::SparseLDLT(size_t                     n,
+                       const std::vector<Entry>&  entries,
+                       const std::vector<size_t>& permutation)
+    : mSize(n)
+    , mPerm(permutation)
+{
+  if (mPerm.empty()) {
+    mPerm.resize(n);
+    std::iota(mPerm.begin(), mPerm.end(), size_t(0));
+  }
+  std::vector<size_t> inverse(n);
+  for (size_t i = 0; i < n; i++) {
+    inverse[mPerm[i]] = i;
+  }
+  // Upper triangle of the permuted matrix in compressed columns.
+  std::vector<Entry> upper;
+  upper.reserve(entries.size());
+  for (const Entry& e : entries) {
+    size_t r = inverse[e.row], c = inverse[e.col];
+    upper.push_back({std::min(r, c), std::max(r, c), e.value});
+  }
+  std::sort(upper.begin(), upper.end(), [](const Entry& a, const Entry& b) {
+    return a.col < b.col || (a.col == b.col && a.row < b.row);
+  });
+  std::vector<size_t> colStarts(n + 1, 0);
+  std::vector<size_t> rows;
+  std::vector<double> values;
+  rows.reserve(upper.size());
+  values.reserve(upper.size());
+  for (size_t i = 0; i < upper.size(); i++) {
+    if (i > 0 && upper[i].row == upper[i - 1].row && upper[i].col == upper[i - 1].col) {
+      values.back() += upper[i].value;
+      continue;
+    }
+    rows.push_back(upper[i].row);
+    values.push_back(upper[i].value);
+    colStarts[upper[i].col + 1]++;
+  }
+  std::partial_sum(colStarts.begin(), colStarts.end(), colStarts.begin());
+
+  // Symbolic factorization: the elimination tree and the column counts of L.
+  static constexpr size_t NONE = SIZE_MAX;
+  std::vector<size_t>     parent(n, NONE), flag(n), counts(n, 0);
+  for (size_t k = 0; k < n; k++) {
+    flag[k] = k;
+    for (size_t p = colStarts[k]; p < colStarts[k + 1]; p++) {
+      for (size_t i = rows[p]; i < k && flag[i] != k; i = parent[i]) {
+        if (parent[i] == NONE) {
+          parent[i] = k;
+        }
+        counts[i]++;
+        flag[i] = k;
+      }
+    }
+  }
+  mColStarts.resize(n + 1);
+  mColStarts[0] = 0;
+  std::partial_sum(counts.begin(), counts.end(), mColStarts.begin() + 1);
+  mRows.resize(mColStarts[n]);
+  mValues.resize(mColStarts[n]);
+  mDiag.resize(n);
+
+  // Numeric factorization, one row of L at a time.
+  std::vector<double> y(n, 0.);
+  std::vector<size_t> pattern(n);
+  std::fill(counts.begin(), counts.end(), size_t(0));
+  for (size_t k = 0; k < n; k++) {
+    size_t top = n;
+    flag[k]    = k;
+    for (size_t p = colStarts[k]; p < colStarts[k + 1]; p++) {
+      size_t i = rows[p];
+      y[i] += values[p];
+      size_t len = 0;
+      for (; i < k && flag[i] != k; i = parent[i]) {
+        pattern[len++] = i;
+        flag[i]        = k;
+      }
+      while (len > 0) {
+        pattern[--top] = pattern[--len];
+      }
+    }
+    double d = y[k];
+    y[k]     = 0.;
+    for (; top < n; top++) {
+      size_t i  = pattern[top];
+      double yi = y[i];
+      y[i]      = 0.;
+      size_t pi = mColStarts[i];
+      size_t pe = pi + counts[i];
+      for (; pi < pe; pi++) {
+        y[mRows[pi]] -= mValues[pi] * yi;
+      }
+      double lki = yi / mDiag[i];
+      d -= lki * yi;
+      mRows[pe]   = k;
+      mValues[pe] = lki;
+      counts[i]++;
+    }
+    if (!(d > 0.)) {
+      return;  // Not positive definite.
+    }
+    mDiag[k] = d;
+  }
+  mValid = true;
+}
+
+size_t SparseLDLT::size() const
+{
+  return mSize;
+}
+
+bool SparseLDLT::valid() const
+{
+  return mValid;
+}
+
+size_t SparseLDLT::numNonZeros() const
+{
+  return mValues.size() + mDiag.size();
+}
+
+void SparseLDLT::solve(double* x) const
+{
+  std::vector<double> b(mSize);
+  for (size_t i = 0; i < mSize; i++) {
+    b[i] = x[mPerm[i]];
+  }
+  for (size_t j = 0; j < mSize; j++) {
+    for (size_t p = mColStarts[j]; p < mColStarts[j + 1]; p++) {
+      b[mRows[p]] -= mValues[p] * b[j];
+    }
+  }
+  for (size_t j = 0; j < mSize; j++) {
+    b[j] /= mDiag[j];
+  }
+  for (size_t j = mSize; j-- > 0;) {
+    for (size_t p = mColStarts[j]; p < mColStarts[j + 1]; p++) {
+      b[j] -= mValues[p] * b[mRows[p]];
+    }
+  }
+  for (size_t i = 0; i < mSize; i++) {
+    x[mPerm[i]] = b[i];
+  }
+}
+
+}  // namespace gal
@@ -1,5 +1,7 @@
 #include <galcore/DebugProfile.h>
 #include <galcore/Sphere.h>
+#include <algorithm>
+#include <random>
 
 namespace gal {
 
@@ -75,60 +77,56 @@ static Sphere triangleCircumsphere(const glm::vec3& a,
   return Sphere(a + rvec, glm::length(rvec));
 }
 
-static void minBoundingSphereImpl(Sphere&          sp,
-                                  const glm::vec3* begin,
-                                  const glm::vec3* end,
-                                  const glm::vec3* pin1 = nullptr,
-                                  const glm::vec3* pin2 = nullptr,
-                                  const glm::vec3* pin3 = nullptr)
+/*Iterative move-to-front Welzl, see minBoundingCircleImpl in Circle2d.cpp.*/
+static Sphere minBoundingSphereImpl(glm::vec3* pts, size_t nPoints)
 {
-  auto current = begin;
-  if (pin1 && pin2 && pin3) {
-    sp = triangleCircumsphere(*pin1, *pin2, *pin3);
-    GALCAPTURE(sp);
-  }
-  else if (pin1 && pin2) {
-    sp = Sphere::createFromDiameter(*pin1, *pin2);
-    GALCAPTURE(sp);
-  }
-  else if (pin1) {
-    sp = Sphere::createFromDiameter(*(current++), *pin1);
-    GALCAPTURE(sp);
-  }
-  else {
-    sp = Sphere::createFromDiameter(*current, *(current + 1));
-    GALCAPTURE(sp);
-    current += 2;
-  }
-
-  while (current != end) {
-    if (!sp.contains(*current)) {
-      if (pin1 && pin2 && pin3) {
-        sp = Sphere::createCircumsphere(*pin1, *pin2, *pin3, *current);
-      }
-      else if (pin1 && pin2) {
-        minBoundingSphereImpl(sp, begin, current, pin1, pin2, current);
-      }
-      else if (pin1) {
-        minBoundingSphereImpl(sp, begin, current, pin1, current);
+  Sphere sp(pts[0], 0.f);
+  for (size_t i = 1; i < nPoints; i++) {
+    if (sp.contains(pts[i])) {
+      continue;
+    }
+    sp = Sphere(pts[i], 0.f);
+    for (size_t j = 0; j < i; j++) {
+      if (sp.contains(pts[j])) {
+        continue;
       }
-      else {
-        minBoundingSphereImpl(sp, begin, current, current);
+      sp = Sphere::createFromDiameter(pts[i], pts[j]);
+      for (size_t k = 0; k < j; k++) {
+        if (sp.contains(pts[k])) {
+          continue;
+        }
+        sp = triangleCircumsphere(pts[i], pts[j], pts[k]);
+        for (size_t l = 0; l < k; l++) {
+          if (!sp.contains(pts[l])) {
+            sp = Sphere::createCircumsphere(pts[i], pts[j], pts[k], pts[l]);
+            std::rotate(pts, pts + l, pts + l + 1);
+          }
+        }
+        std::rotate(pts, pts + k, pts + k + 1);
       }
+      std::rotate(pts, pts + j, pts + j + 1);
     }
-    current++;
+    std::rotate(pts, pts + i, pts + i + 1);
+    GALCAPTURE(sp);
   }
+  return sp;
 }
 
-Sphere Sphere::minBoundingSphere(const std::vector<glm::vec3>& points)
+Sphere Sphere::minBoundingSphere(const glm::vec3* points, size_t nPoints)
 {
-  if (points.size() < 2) {
+  if (nPoints < 2) {
     throw "Cannot create minimum bounding sphere";
   }
 
-  Sphere sp;
-  minBoundingSphereImpl(sp, points.data(), points.data() + points.size());
-  return sp;
+  // Shuffled to keep the expected linear time on sorted input.
+  std::vector<glm::vec3> pts(points, points + nPoints);
+  std::shuffle(pts.begin(), pts.end(), std::mt19937(42));
+  return minBoundingSphereImpl(pts.data(), pts.size());
+}
+
+Sphere Sphere::minBoundingSphere(const std::vector<glm::vec3>& points)
+{
+  return minBoundingSphere(points.data(), points.size());
 }
 
 }  // namespace gal
@@ -105,6 +105,44 @@ glm::vec3 gal::utils::barycentricEvaluate(float const (&coords)[3],
   return pts[0] * coords[0] + pts[1] * coords[1] + pts[2] * coords[2];
 }
 
+void gal::utils::eigenSymmetric(const glm::dmat3& mat,
+                                glm::dvec3&       values,
+                                glm::dmat3&       vectors)
+{
+  static constexpr int sMaxSweeps   = 32;
+  static constexpr int sPairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+  glm::dmat3           a            = mat;
+  vectors                           = glm::dmat3(1.);
+  for (int sweep = 0; sweep < sMaxSweeps; sweep++) {
+    double off  = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+    double diag = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+    if (off <= DBL_EPSILON * DBL_EPSILON * diag) {
+      break;
+    }
+    for (const auto& pair : sPairs) {
+      int p = pair[0], q = pair[1];
+      if (a[p][q] == 0.) {
+        continue;
+      }
+      // The rotation in the pq plane that zeroes a[p][q].
+      double theta = (a[q][q] - a[p][p]) / (2. * a[p][q]);
+      double t = (theta < 0. ? -1. : 1.) / (std::abs(theta) + std::hypot(theta, 1.));
+      double c = 1. / std::sqrt(t * t + 1.);
+      double s = t * c;
+      glm::dmat3 rot(1.);
+      rot[p][p] = c;
+      rot[q][q] = c;
+      rot[q][p] = s;
+      rot[p][q] = -s;
+      a         = glm::transpose(rot) * a * rot;
+      a[p][q]   = 0.;
+      a[q][p]   = 0.;
+      vectors   = vectors * rot;
+    }
+  }
+  values = {a[0][0], a[1][1], a[2][2]};
+}
+
 /**
  * @brief For the given path relative to the executable, the absolute path is returned.
  * @param relPath Path relative to the executable.
@@ -0,0 +1,727 @@
+#include <galcore/Voronoi.h>
+#include <tbb/tbb.h>
+#include <numeric>
+
+namespace gal {
+
+/*The elements around each point, with the elements given as arrays of point indices.*/
+template<typename TGetElement>
+static void incidence(size_t               nPoints,
+                      size_t               nElements,
+                      TGetElement          getElement,
+                      std::vector<size_t>& offsets,
+                      std::vector<size_t>& elements)
+{
+  offsets.assign(nPoints + 1, 0);
+  for (size_t ei = 0; ei < nElements; ei++) {
+    for (size_t pi : getElement(ei)) {
+      offsets[pi + 1]++;
+    }
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+  elements.resize(offsets.back());
+  for (size_t ei = 0; ei < nElements; ei++) {
+    for (size_t pi : getElement(ei)) {
+      elements[fill[pi]++] = ei;
+    }
+  }
+}
+
+/*The other points of the given elements around the point, sorted and unique.*/
+template<typename TGetElement>
+static void neighbors(size_t               pi,
+                      const size_t*        begin,
+                      const size_t*        end,
+                      TGetElement          getElement,
+                      std::vector<size_t>& dst)
+{
+  dst.clear();
+  for (const size_t* it = begin; it != end; it++) {
+    for (size_t vi : getElement(*it)) {
+      if (vi != pi) {
+        dst.push_back(vi);
+      }
+    }
+  }
+  std::sort(dst.begin(), dst.end());
+  dst.erase(std::unique(dst.begin(), dst.end()), dst.end());
+}
+
+/*Circumcenters in double precision, the slivers of the triangulations would lose the
+ * accuracy of the cells in single precision.*/
+static glm::dvec2 circumcenter(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c)
+{
+  glm::dvec2 ba = b - a, ca = c - a;
+  double     d  = 2. * (ba.x * ca.y - ba.y * ca.x);
+  double     b2 = glm::dot(ba, ba), c2 = glm::dot(ca, ca);
+  return a + glm::dvec2(ca.y * b2 - ba.y * c2, ba.x * c2 - ca.x * b2) / d;
+}
+
+static glm::dvec3 circumcenter(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c, glm::dvec3 d)
+{
+  glm::dvec3 ba = b - a, ca = c - a, da = d - a;
+  glm::dvec3 sum = glm::dot(ba, ba) * glm::cross(ca, da) +
+                   glm::dot(ca, ca) * glm::cross(da, ba) +
+                   glm::dot(da, da) * glm::cross(ba, ca);
+  return a + sum / (2. * glm::dot(ba, glm::cross(ca, da)));
+}
+
+/*Keeps the part of the polygon where dot(normal, x) <= offset.*/
+static void clipPolygon(std::vector<glm::dvec2>& poly,
+                        const glm::dvec2&        normal,
+                        double                   offset,
+                        std::vector<glm::dvec2>& scratch)
+{
+  scratch.clear();
+  for (size_t i = 0; i < poly.size(); i++) {
+    const glm::dvec2& a  = poly[i];
+    const glm::dvec2& b  = poly[(i + 1) % poly.size()];
+    double            da = glm::dot(normal, a) - offset;
+    double            db = glm::dot(normal, b) - offset;
+    if (da <= 0.) {
+      scratch.push_back(a);
+    }
+    if ((da < 0. && db > 0.) || (da > 0. && db < 0.)) {
+      scratch.push_back(a + (b - a) * (da / (da - db)));
+    }
+  }
+  std::swap(poly, scratch);
+  if (poly.size() < 3) {
+    poly.clear();
+  }
+}
+
+/*The corners of the cell of an interior site are the circumcenters of the triangles
+ * around it. The triangles are counter-clockwise, so following the edge that each one
+ * shares with the next walks around the site counter-clockwise. Returns false if the
+ * triangles don't close around the site, i.e. if it is on the convex hull.*/
+static bool dualPolygon(size_t                              pi,
+                        const size_t*                       begin,
+                        const size_t*                       end,
+                        const Delaunay2&                    triangulation,
+                        const std::vector<glm::dvec2>&      centers,
+                        std::vector<glm::dvec2>&            poly,
+                        std::vector<std::array<size_t, 3>>& fan)
+{
+  poly.clear();
+  fan.clear();
+  for (const size_t* it = begin; it != end; it++) {
+    auto    tri = triangulation.triangle(*it);
+    uint8_t i   = tri[0] == pi ? 0 : (tri[1] == pi ? 1 : 2);
+    fan.push_back({tri[(i + 1) % 3], tri[(i + 2) % 3], *it});
+  }
+  size_t cur = 0;
+  for (size_t n = 0; n < fan.size(); n++) {
+    glm::dvec2 corner = centers[fan[cur][2]];
+    if (poly.empty() || poly.back() != corner) {
+      poly.push_back(corner);
+    }
+    auto next = std::find_if(fan.begin(), fan.end(), [&](const auto& other) {
+      return other[0] == fan[cur][1];
+    });
+    if (next == fan.end()) {
+      return false;
+    }
+    cur = size_t(std::distance(fan.begin(), next));
+  }
+  if (cur != 0) {
+    return false;
+  }
+  // Cocircular triangles share their circumcenter.
+  if (poly.size() > 1 && poly.front() == poly.back()) {
+    poly.pop_back();
+  }
+  if (poly.size() < 3) {
+    poly.clear();
+  }
+  return true;
+}
+
+Voronoi2::Voronoi2(const Delaunay2& triangulation)
+{
+  compute(triangulation, nullptr);
+}
+
+Voronoi2::Voronoi2(const Delaunay2& triangulation, const Box2& bounds)
+{
+  compute(triangulation, &bounds);
+}
+
+void Voronoi2::compute(const Delaunay2& triangulation, const Box2* bounds)
+{
+  size_t nSites = triangulation.numPoints();
+  mSites.resize(nSites);
+  for (size_t pi = 0; pi < nSites; pi++) {
+    mSites[pi] = triangulation.getPt(pi);
+  }
+  auto getTri = [&](size_t ti) { return triangulation.triangle(ti); };
+  std::vector<size_t> offsets, tris;
+  incidence(nSites, triangulation.numTriangles(), getTri, offsets, tris);
+  // Every circumcenter is computed once, so the cells that share a corner have exactly
+  // the same coordinates for it.
+  std::vector<glm::dvec2> centers(triangulation.numTriangles());
+  tbb::parallel_for(size_t(0), centers.size(), [&](size_t ti) {
+    auto tri    = triangulation.triangle(ti);
+    centers[ti] = circumcenter(mSites[tri[0]], mSites[tri[1]], mSites[tri[2]]);
+  });
+
+  std::vector<std::vector<glm::dvec2>> cells(nSites);
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, nSites), [&](const tbb::blocked_range<size_t>& range) {
+      std::vector<size_t>                nbrs;
+      std::vector<glm::dvec2>            scratch;
+      std::vector<std::array<size_t, 3>> fan;
+      for (size_t pi = range.begin(); pi < range.end(); pi++) {
+        const size_t* begin = tris.data() + offsets[pi];
+        const size_t* end   = tris.data() + offsets[pi + 1];
+        if (begin == end) {
+          continue;  // A duplicate point.
+        }
+        std::vector<glm::dvec2>& poly = cells[pi];
+        if (dualPolygon(pi, begin, end, triangulation, centers, poly, fan)) {
+          if (bounds) {
+            clipPolygon(poly, {-1., 0.}, -double(bounds->min.x), scratch);
+            clipPolygon(poly, {1., 0.}, double(bounds->max.x), scratch);
+            clipPolygon(poly, {0., -1.}, -double(bounds->min.y), scratch);
+            clipPolygon(poly, {0., 1.}, double(bounds->max.y), scratch);
+          }
+          continue;
+        }
+        if (!bounds) {
+          poly.clear();  // Unbounded.
+          continue;
+        }
+        // The cell of a site on the hull is unbounded, and has no dual polygon. It is
+        // clipped out of the box by the bisectors with its neighbors instead.
+        neighbors(pi, begin, end, getTri, nbrs);
+        const Box2& box = *bounds;
+        poly = {box.min, {box.max.x, box.min.y}, box.max, {box.min.x, box.max.y}};
+        glm::dvec2 site = mSites[pi];
+        // The nearest neighbors cut the most, and leave little for the others to clip.
+        auto sqDist = [&](size_t ni) {
+          glm::vec2 d = mSites[ni] - mSites[pi];
+          return glm::dot(d, d);
+        };
+        std::sort(nbrs.begin(), nbrs.end(), [&](size_t a, size_t b) {
+          return sqDist(a) < sqDist(b);
+        });
+        for (size_t ni : nbrs) {
+          glm::dvec2 other = mSites[ni];
+          glm::dvec2 dir   = other - site;
+          clipPolygon(poly, dir, glm::dot(dir, (site + other) * 0.5), scratch);
+          if (poly.empty()) {
+            break;
+          }
+        }
+      }
+    });
+
+  mCellOffsets.resize(nSites + 1);
+  mCellOffsets[0] = 0;
+  for (size_t pi = 0; pi < nSites; pi++) {
+    mCellOffsets[pi + 1] = mCellOffsets[pi] + cells[pi].size();
+  }
+  mVertices.resize(mCellOffsets.back());
+  tbb::parallel_for(size_t(0), nSites, [&](size_t pi) {
+    std::transform(cells[pi].begin(),
+                   cells[pi].end(),
+                   mVertices.begin() + mCellOffsets[pi],
+                   [](const glm::dvec2& v) { return glm::vec2(v); });
+  });
+}
+
+size_t Voronoi2::numCells() const
+{
+  return mSites.size();
+}
+
+const glm::vec2& Voronoi2::site(size_t ci) const
+{
+  return mSites[ci];
+}
+
+std::vector<glm::vec2> Voronoi2::cell(size_t ci) const
+{
+  return std::vector<glm::vec2>(mVertices.begin() + mCellOffsets[ci],
+                                mVertices.begin() + mCellOffsets[ci + 1]);
+}
+
+float Voronoi2::cellArea(size_t ci) const
+{
+  size_t begin = mCellOffsets[ci], end = mCellOffsets[ci + 1];
+  float  area  = 0.f;
+  for (size_t i = begin; i < end; i++) {
+    const glm::vec2& a = mVertices[i];
+    const glm::vec2& b = mVertices[i + 1 < end ? i + 1 : begin];
+    area += a.x * b.y - a.y * b.x;
+  }
+  return area * 0.5f;
+}
+
+const std::vector<glm::vec2>& Voronoi2::vertices() const
+{
+  return mVertices;
+}
+
+std::vector<IndexPair> Voronoi2::edges() const
+{
+  std::vector<IndexPair> edges;
+  edges.reserve(mVertices.size());
+  for (size_t ci = 0; ci < mSites.size(); ci++) {
+    size_t begin = mCellOffsets[ci], end = mCellOffsets[ci + 1];
+    for (size_t i = begin; i < end; i++) {
+      edges.emplace_back(i, i + 1 < end ? i + 1 : begin);
+    }
+  }
+  return edges;
+}
+
+/*Convex polyhedron with indexed polygonal faces, used while clipping a cell.*/
+struct Polytope
+{
+  std::vector<glm::dvec3> verts;
+  std::vector<size_t>     corners;
+  std::vector<size_t>     offsets = {0};
+  std::vector<size_t>     neighbors;
+
+  void clear()
+  {
+    verts.clear();
+    corners.clear();
+    offsets.assign(1, 0);
+    neighbors.clear();
+  }
+
+  size_t numFaces() const { return neighbors.size(); }
+};
+
+/*Buffers reused by every clipping of a polytope.*/
+struct ClipScratch
+{
+  Polytope                           out;
+  std::vector<double>                dist;
+  std::vector<size_t>                remap;
+  std::vector<size_t>                capNext;
+  std::vector<bool>                  onPlane;
+  std::vector<std::array<size_t, 3>> cuts;
+};
+
+/*Keeps the part of the polytope where dot(normal, x) <= offset. The new face on the plane
+ * gets the given neighbor.*/
+static void clipPolytope(Polytope&         poly,
+                         const glm::dvec3& normal,
+                         double            offset,
+                         size_t            neighbor,
+                         ClipScratch&      scratch)
+{
+  std::vector<double>& dist = scratch.dist;
+  dist.resize(poly.verts.size());
+  double dmin = DBL_MAX, dmax = -DBL_MAX;
+  for (size_t vi = 0; vi < poly.verts.size(); vi++) {
+    dist[vi] = glm::dot(normal, poly.verts[vi]) - offset;
+    dmin     = std::min(dmin, dist[vi]);
+    dmax     = std::max(dmax, dist[vi]);
+  }
+  if (dmax <= 0.) {
+    return;
+  }
+  if (dmin >= 0.) {
+    poly.clear();
+    return;
+  }
+  Polytope& out = scratch.out;
+  out.clear();
+  scratch.remap.assign(poly.verts.size(), SIZE_MAX);
+  scratch.cuts.clear();
+  std::vector<bool>& onPlane = scratch.onPlane;
+  onPlane.clear();
+  auto keep = [&](size_t vi) {
+    size_t& dst = scratch.remap[vi];
+    if (dst == SIZE_MAX) {
+      dst = out.verts.size();
+      out.verts.push_back(poly.verts[vi]);
+      onPlane.push_back(dist[vi] == 0.);
+    }
+    return dst;
+  };
+  // Each edge is cut once for both of its faces, from the same end so that the point is
+  // the same.
+  auto cut = [&](size_t a, size_t b) {
+    if (a > b) {
+      std::swap(a, b);
+    }
+    for (const auto& c : scratch.cuts) {
+      if (c[0] == a && c[1] == b) {
+        return c[2];
+      }
+    }
+    const glm::dvec3& pa = poly.verts[a];
+    const glm::dvec3& pb = poly.verts[b];
+    size_t            vi = out.verts.size();
+    out.verts.push_back(pa + (pb - pa) * (dist[a] / (dist[a] - dist[b])));
+    onPlane.push_back(true);
+    scratch.cuts.push_back({a, b, vi});
+    return vi;
+  };
+  // The clipped faces, with the corners on the plane marked.
+  // Each edge is cut at most once, so this is enough room for all the new vertices.
+  std::vector<size_t>& capNext = scratch.capNext;
+  capNext.assign(poly.verts.size() + poly.corners.size(), SIZE_MAX);
+  for (size_t fi = 0; fi < poly.numFaces(); fi++) {
+    size_t begin = poly.offsets[fi], end = poly.offsets[fi + 1];
+    size_t first = out.corners.size();
+    for (size_t i = begin; i < end; i++) {
+      size_t a = poly.corners[i], b = poly.corners[i + 1 < end ? i + 1 : begin];
+      if (dist[a] <= 0.) {
+        out.corners.push_back(keep(a));
+      }
+      if ((dist[a] < 0. && dist[b] > 0.) || (dist[a] > 0. && dist[b] < 0.)) {
+        out.corners.push_back(cut(a, b));
+      }
+    }
+    size_t n = out.corners.size() - first;
+    if (n < 3) {
+      out.corners.resize(first);
+      continue;
+    }
+    // An edge of the face on the plane is an edge of the new face, in the other
+    // direction.
+    for (size_t i = 0; i < n; i++) {
+      size_t a = out.corners[first + i], b = out.corners[first + (i + 1) % n];
+      if (onPlane[a] && onPlane[b]) {
+        capNext[b] = a;
+      }
+    }
+    out.offsets.push_back(out.corners.size());
+    out.neighbors.push_back(poly.neighbors[fi]);
+  }
+  // The new face.
+  capNext.resize(out.verts.size());
+  auto start = std::find_if(
+    capNext.begin(), capNext.end(), [](size_t vi) { return vi != SIZE_MAX; });
+  if (start != capNext.end()) {
+    size_t first = out.corners.size();
+    size_t vi    = size_t(std::distance(capNext.begin(), start));
+    do {
+      out.corners.push_back(vi);
+      vi = capNext[vi];
+    } while (vi != SIZE_MAX && vi != out.corners[first] &&
+             out.corners.size() - first <= capNext.size());
+    if (out.corners.size() - first >= 3) {
+      out.offsets.push_back(out.corners.size());
+      out.neighbors.push_back(neighbor);
+    }
+    else {
+      out.corners.resize(first);
+    }
+  }
+  std::swap(poly, out);
+  if (poly.numFaces() < 4) {
+    poly.clear();
+  }
+}
+
+/*Spoke of a site to a neighbor through a tetrahedron: the neighbor, the two other
+ * points of the tetrahedron, and the position of the tetrahedron among those around the
+ * site.*/
+using Spoke = std::array<size_t, 4>;
+
+/*The cell of an interior site has the circumcenters of the tetrahedra around it as
+ * vertices. Its face shared with a neighbor is the ring of circumcenters of the
+ * tetrahedra around their common edge, where consecutive tetrahedra share a face.
+ * Returns false if one of the rings is open, i.e. if the site is on the convex hull.*/
+static bool dualPolytope(size_t                        pi,
+                         const size_t*                 begin,
+                         const size_t*                 end,
+                         const Delaunay3&              tetrahedralization,
+                         const std::vector<glm::dvec3>& centers,
+                         Polytope&                     poly,
+                         std::vector<size_t>&          local,
+                         std::vector<Spoke>&           spokes)
+{
+  poly.clear();
+  local.clear();
+  spokes.clear();
+  const size_t nTets = size_t(end - begin);
+  for (size_t i = 0; i < nTets; i++) {
+    // Cospherical tetrahedra share their circumcenter, and their vertex.
+    const glm::dvec3& center = centers[begin[i]];
+    auto              match  = std::find(poly.verts.begin(), poly.verts.end(), center);
+    local.push_back(size_t(std::distance(poly.verts.begin(), match)));
+    if (match == poly.verts.end()) {
+      poly.verts.push_back(center);
+    }
+    auto   tet = tetrahedralization.tetrahedron(begin[i]);
+    size_t others[3], n = 0;
+    for (size_t vi : tet) {
+      if (vi != pi) {
+        others[n++] = vi;
+      }
+    }
+    for (size_t k = 0; k < 3; k++) {
+      spokes.push_back({others[k], others[(k + 1) % 3], others[(k + 2) % 3], i});
+    }
+  }
+  std::sort(spokes.begin(), spokes.end());
+  glm::dvec3 site = tetrahedralization.getPt(pi);
+  for (auto first = spokes.begin(); first != spokes.end();) {
+    auto last = std::find_if(
+      first, spokes.end(), [&](const Spoke& s) { return s[0] != (*first)[0]; });
+    // Walk around the edge to the neighbor, from one tetrahedron to the one across the
+    // face through the point last reached.
+    size_t faceBegin = poly.corners.size();
+    auto   cur       = first;
+    size_t reached   = (*cur)[2];
+    for (size_t n = 0; n < size_t(last - first); n++) {
+      size_t corner = local[(*cur)[3]];
+      if (poly.corners.size() == faceBegin || poly.corners.back() != corner) {
+        poly.corners.push_back(corner);
+      }
+      auto next = std::find_if(first, last, [&](const Spoke& s) {
+        return &s != &*cur && (s[1] == reached || s[2] == reached);
+      });
+      if (next == last) {
+        return false;
+      }
+      reached = (*next)[1] == reached ? (*next)[2] : (*next)[1];
+      cur     = next;
+    }
+    if (cur != first) {
+      return false;
+    }
+    if (poly.corners.size() - faceBegin > 1 &&
+        poly.corners.back() == poly.corners[faceBegin]) {
+      poly.corners.pop_back();
+    }
+    if (poly.corners.size() - faceBegin < 3) {
+      poly.corners.resize(faceBegin);
+    }
+    else {
+      // Counter-clockwise seen from the neighbor.
+      glm::dvec3 normal(0.);
+      size_t     nc = poly.corners.size() - faceBegin;
+      for (size_t i = 0; i < nc; i++) {
+        normal += glm::cross(poly.verts[poly.corners[faceBegin + i]],
+                             poly.verts[poly.corners[faceBegin + (i + 1) % nc]]);
+      }
+      glm::dvec3 other = tetrahedralization.getPt((*first)[0]);
+      if (glm::dot(normal, other - site) < 0.) {
+        std::reverse(poly.corners.begin() + faceBegin, poly.corners.end());
+      }
+      poly.offsets.push_back(poly.corners.size());
+      poly.neighbors.push_back((*first)[0]);
+    }
+    first = last;
+  }
+  if (poly.numFaces() < 4) {
+    poly.clear();
+  }
+  return true;
+}
+
+Voronoi3::Voronoi3(const Delaunay3& tetrahedralization)
+{
+  compute(tetrahedralization, nullptr);
+}
+
+Voronoi3::Voronoi3(const Delaunay3& tetrahedralization, const Box3& bounds)
+{
+  compute(tetrahedralization, &bounds);
+}
+
+void Voronoi3::compute(const Delaunay3& tetrahedralization, const Box3* bounds)
+{
+  // Corner i of the box has the coordinates (i & 1, (i >> 1) & 1, (i >> 2) & 1).
+  static constexpr std::array<std::array<size_t, 4>, 6> sBoxFaces = {{
+    {0, 4, 6, 2},
+    {1, 3, 7, 5},
+    {0, 1, 5, 4},
+    {2, 6, 7, 3},
+    {0, 2, 3, 1},
+    {4, 5, 7, 6},
+  }};
+  size_t nSites = tetrahedralization.numPoints();
+  mSites.resize(nSites);
+  for (size_t pi = 0; pi < nSites; pi++) {
+    mSites[pi] = tetrahedralization.getPt(pi);
+  }
+  auto getTet = [&](size_t ti) { return tetrahedralization.tetrahedron(ti); };
+  std::vector<size_t> offsets, tets;
+  incidence(nSites, tetrahedralization.numTetrahedra(), getTet, offsets, tets);
+  // Every circumcenter is computed once, so the cells that share a vertex have exactly
+  // the same coordinates for it.
+  std::vector<glm::dvec3> centers(tetrahedralization.numTetrahedra());
+  tbb::parallel_for(size_t(0), centers.size(), [&](size_t ti) {
+    auto tet    = tetrahedralization.tetrahedron(ti);
+    centers[ti] = circumcenter(
+      mSites[tet[0]], mSites[tet[1]], mSites[tet[2]], mSites[tet[3]]);
+  });
+
+  std::vector<Polytope> cells(nSites);
+  tbb::parallel_for(
+    tbb::blocked_range<size_t>(0, nSites), [&](const tbb::blocked_range<size_t>& range) {
+      std::vector<size_t> nbrs, local;
+      std::vector<Spoke>  spokes;
+      ClipScratch         scratch;
+      for (size_t pi = range.begin(); pi < range.end(); pi++) {
+        const size_t* begin = tets.data() + offsets[pi];
+        const size_t* end   = tets.data() + offsets[pi + 1];
+        if (begin == end) {
+          continue;  // A duplicate point.
+        }
+        Polytope& poly = cells[pi];
+        if (dualPolytope(
+              pi, begin, end, tetrahedralization, centers, poly, local, spokes)) {
+          for (int axis = 0; bounds && axis < 3 && !poly.verts.empty(); axis++) {
+            glm::dvec3 normal(0.);
+            normal[axis] = -1.;
+            clipPolytope(poly, normal, -double(bounds->min[axis]), SIZE_MAX, scratch);
+            normal[axis] = 1.;
+            clipPolytope(poly, normal, double(bounds->max[axis]), SIZE_MAX, scratch);
+          }
+          continue;
+        }
+        if (!bounds) {
+          poly.clear();  // Unbounded.
+          continue;
+        }
+        // The cell of a site on the hull is unbounded, and has no dual polytope. It is
+        // clipped out of the box by the bisectors with its neighbors instead.
+        neighbors(pi, begin, end, getTet, nbrs);
+        const Box3& box = *bounds;
+        poly.clear();
+        for (size_t i = 0; i < 8; i++) {
+          poly.verts.emplace_back((i & 1) ? box.max.x : box.min.x,
+                                  (i & 2) ? box.max.y : box.min.y,
+                                  (i & 4) ? box.max.z : box.min.z);
+        }
+        for (const auto& face : sBoxFaces) {
+          poly.corners.insert(poly.corners.end(), face.begin(), face.end());
+          poly.offsets.push_back(poly.corners.size());
+          poly.neighbors.push_back(SIZE_MAX);
+        }
+        glm::dvec3 site   = mSites[pi];
+        auto       sqDist = [&](size_t ni) {
+          glm::vec3 d = mSites[ni] - mSites[pi];
+          return glm::dot(d, d);
+        };
+        std::sort(nbrs.begin(), nbrs.end(), [&](size_t a, size_t b) {
+          return sqDist(a) < sqDist(b);
+        });
+        for (size_t ni : nbrs) {
+          glm::dvec3 other = mSites[ni];
+          glm::dvec3 dir   = other - site;
+          clipPolytope(poly, dir, glm::dot(dir, (site + other) * 0.5), ni, scratch);
+          if (poly.verts.empty()) {
+            break;
+          }
+        }
+      }
+    });
+
+  // Copies the cells back to back.
+  mVertexOffsets.assign(nSites + 1, 0);
+  mCellOffsets.assign(nSites + 1, 0);
+  std::vector<size_t> cornerOffsets(nSites + 1, 0);
+  for (size_t pi = 0; pi < nSites; pi++) {
+    mVertexOffsets[pi + 1] = mVertexOffsets[pi] + cells[pi].verts.size();
+    mCellOffsets[pi + 1]   = mCellOffsets[pi] + cells[pi].numFaces();
+    cornerOffsets[pi + 1]  = cornerOffsets[pi] + cells[pi].corners.size();
+  }
+  mVertices.resize(mVertexOffsets.back());
+  mCorners.resize(cornerOffsets.back());
+  mFaceOffsets.resize(mCellOffsets.back() + 1);
+  mFaceNeighbor.resize(mCellOffsets.back());
+  mFaceOffsets.back() = mCorners.size();
+  tbb::parallel_for(size_t(0), nSites, [&](size_t pi) {
+    const Polytope& poly = cells[pi];
+    std::transform(poly.verts.begin(),
+                   poly.verts.end(),
+                   mVertices.begin() + mVertexOffsets[pi],
+                   [](const glm::dvec3& v) { return glm::vec3(v); });
+    std::transform(poly.corners.begin(),
+                   poly.corners.end(),
+                   mCorners.begin() + cornerOffsets[pi],
+                   [&](size_t vi) { return vi + mVertexOffsets[pi]; });
+    for (size_t fi = 0; fi < poly.numFaces(); fi++) {
+      mFaceOffsets[mCellOffsets[pi] + fi]  = poly.offsets[fi] + cornerOffsets[pi];
+      mFaceNeighbor[mCellOffsets[pi] + fi] = poly.neighbors[fi];
+    }
+  });
+}
+
+size_t Voronoi3::numCells() const
+{
+  return mSites.size();
+}
+
+const glm::vec3& Voronoi3::site(size_t ci) const
+{
+  return mSites[ci];
+}
+
+size_t Voronoi3::numFaces(size_t ci) const
+{
+  return mCellOffsets[ci + 1] - mCellOffsets[ci];
+}
+
+size_t Voronoi3::faceNeighbor(size_t ci, size_t fi) const
+{
+  return mFaceNeighbor[mCellOffsets[ci] + fi];
+}
+
+Mesh Voronoi3::cellMesh(size_t ci) const
+{
+  size_t                  first = mVertexOffsets[ci];
+  std::vector<glm::vec3>  verts(mVertices.begin() + first,
+                               mVertices.begin() + mVertexOffsets[ci + 1]);
+  std::vector<Mesh::Face> faces;
+  for (size_t fi = mCellOffsets[ci]; fi < mCellOffsets[ci + 1]; fi++) {
+    size_t begin = mFaceOffsets[fi], end = mFaceOffsets[fi + 1];
+    for (size_t i = begin + 1; i + 1 < end; i++) {
+      faces.emplace_back(
+        mCorners[begin] - first, mCorners[i] - first, mCorners[i + 1] - first);
+    }
+  }
+  return Mesh(verts, faces);
+}
+
+float Voronoi3::cellVolume(size_t ci) const
+{
+  double volume = 0.;
+  for (size_t fi = mCellOffsets[ci]; fi < mCellOffsets[ci + 1]; fi++) {
+    size_t     begin = mFaceOffsets[fi], end = mFaceOffsets[fi + 1];
+    glm::dvec3 a     = mVertices[mCorners[begin]];
+    for (size_t i = begin + 1; i + 1 < end; i++) {
+      glm::dvec3 b = mVertices[mCorners[i]];
+      glm::dvec3 c = mVertices[mCorners[i + 1]];
+      volume += glm::dot(a, glm::cross(b, c));
+    }
+  }
+  return float(volume / 6.);
+}
+
+const std::vector<glm::vec3>& Voronoi3::vertices() const
+{
+  return mVertices;
+}
+
+std::vector<IndexPair> Voronoi3::edges() const
+{
+  // Every edge is on two faces of its cell, once in each direction.
+  std::vector<IndexPair> edges;
+  edges.reserve(mCorners.size() / 2);
+  for (size_t fi = 0; fi + 1 < mFaceOffsets.size(); fi++) {
+    size_t begin = mFaceOffsets[fi], end = mFaceOffsets[fi + 1];
+    for (size_t i = begin; i < end; i++) {
+      size_t a = mCorners[i], b = mCorners[i + 1 < end ? i + 1 : begin];
+      if (a < b) {
+        edges.emplace_back(a, b);
+      }
+    }
+  }
+  return edges;
+}
+
+}  // namespace gal
@@ -0,0 +1,191 @@
+#include <galcore/VoxelGrid.h>
+#include <cmath>
+#include <numeric>
+
+namespace gal {
+
+VoxelGrid::VoxelGrid(const glm::vec3& origin,
+                     float            voxelSize,
+                     size_t           nx,
+                     size_t           ny,
+                     size_t           nz)
+    : mOrigin(origin)
+    , mVoxelSize(voxelSize)
+    , mNx(nx)
+    , mNy(ny)
+    , mNz(nz)
+    , mRowWords((nx + 63) / 64)
+    , mWords(mRowWords * ny * nz, uint64_t(0))
+{}
+
+static size_t numVoxelsAlong(float length, float voxelSize)
+{
+  if (!std::isfinite(length) || length < 0.f || !(voxelSize > 0.f)) {
+    throw std::invalid_argument("Cannot fit voxels along an invalid length");
+  }
+  return std::max(size_t(1), size_t(std::ceil(length / voxelSize)));
+}
+
+VoxelGrid::VoxelGrid(const Box3& bounds, float voxelSize)
+    : VoxelGrid(bounds.min,
+                voxelSize,
+                numVoxelsAlong(bounds.diagonal().x, voxelSize),
+                numVoxelsAlong(bounds.diagonal().y, voxelSize),
+                numVoxelsAlong(bounds.diagonal().z, voxelSize))
+{}
+
+const glm::vec3& VoxelGrid::origin() const noexcept
+{
+  return mOrigin;
+}
+
+float VoxelGrid::voxelSize() const noexcept
+{
+  return mVoxelSize;
+}
+
+size_t VoxelGrid::numX() const noexcept
+{
+  return mNx;
+}
+
+size_t VoxelGrid::numY() const noexcept
+{
+  return mNy;
+}
+
+size_t VoxelGrid::numZ() const noexcept
+{
+  return mNz;
+}
+
+size_t VoxelGrid::numVoxels() const noexcept
+{
+  return mNx * mNy * mNz;
+}
+
+size_t VoxelGrid::numOccupied() const
+{
+  return std::accumulate(
+    mWords.begin(), mWords.end(), size_t(0), [](size_t total, uint64_t word) {
+      return total + size_t(__builtin_popcountll(word));
+    });
+}
+
+Box3 VoxelGrid::bounds() const
+{
+  glm::vec3 diag = glm::vec3(float(mNx), float(mNy), float(mNz)) * mVoxelSize;
+  return Box3(mOrigin, mOrigin + diag);
+}
+
+Box3 VoxelGrid::voxelBounds(size_t x, size_t y, size_t z) const
+{
+  glm::vec3 min = mOrigin + glm::vec3(float(x), float(y), float(z)) * mVoxelSize;
+  return Box3(min, min + glm::vec3(mVoxelSize));
+}
+
+glm::vec3 VoxelGrid::voxelCenter(size_t x, size_t y, size_t z) const
+{
+  return mOrigin + (glm::vec3(float(x), float(y), float(z)) + 0.5f) * mVoxelSize;
+}
+
+bool VoxelGrid::voxelIndices(const glm::vec3& pt, size_t& x, size_t& y, size_t& z) const
+{
+  glm::vec3 rel = (pt - mOrigin) / mVoxelSize;
+  if (rel.x < 0.f || rel.y < 0.f || rel.z < 0.f) {
+    return false;
+  }
+  // Points on the max faces of the grid belong to the last voxel.
+  x = std::min(size_t(rel.x), mNx - 1);
+  y = std::min(size_t(rel.y), mNy - 1);
+  z = std::min(size_t(rel.z), mNz - 1);
+  return rel.x <= float(mNx) && rel.y <= float(mNy) && rel.z <= float(mNz);
+}
+
+size_t VoxelGrid::wordIndex(size_t x, size_t y, size_t z) const
+{
+  return (z * mNy + y) * mRowWords + x / 64;
+}
+
+bool VoxelGrid::get(size_t x, size_t y, size_t z) const
+{
+  return (mWords[wordIndex(x, y, z)] >> (x % 64)) & uint64_t(1);
+}
+
+void VoxelGrid::set(size_t x, size_t y, size_t z, bool occupied)
+{
+  uint64_t& word = mWords[wordIndex(x, y, z)];
+  uint64_t  bit  = uint64_t(1) << (x % 64);
+  if (occupied) {
+    word |= bit;
+  }
+  else {
+    word &= ~bit;
+  }
+}
+
+void VoxelGrid::fillRow(size_t y, size_t z, size_t xbegin, size_t xend)
+{
+  xend = std::min(xend, mNx);
+  if (xbegin >= xend) {
+    return;
+  }
+  uint64_t* row    = rowWords(y, z);
+  size_t    wfirst = xbegin / 64;
+  size_t    wlast  = (xend - 1) / 64;
+  uint64_t  head   = ~uint64_t(0) << (xbegin % 64);
+  uint64_t  tail   = ~uint64_t(0) >> (63 - ((xend - 1) % 64));
+  if (wfirst == wlast) {
+    row[wfirst] |= head & tail;
+    return;
+  }
+  row[wfirst] |= head;
+  std::fill(row + wfirst + 1, row + wlast, ~uint64_t(0));
+  row[wlast] |= tail;
+}
+
+bool VoxelGrid::isExposed(size_t x, size_t y, size_t z) const
+{
+  if (!get(x, y, z)) {
+    return false;
+  }
+  if (x == 0 || y == 0 || z == 0 || x + 1 == mNx || y + 1 == mNy || z + 1 == mNz) {
+    return true;
+  }
+  return !(get(x - 1, y, z) && get(x + 1, y, z) && get(x, y - 1, z) &&
+           get(x, y + 1, z) && get(x, y, z - 1) && get(x, y, z + 1));
+}
+
+void VoxelGrid::unite(const VoxelGrid& other)
+{
+  if (other.mNx != mNx || other.mNy != mNy || other.mNz != mNz) {
+    throw std::invalid_argument("Cannot unite voxel grids of different sizes");
+  }
+  std::transform(mWords.begin(),
+                 mWords.end(),
+                 other.mWords.begin(),
+                 mWords.begin(),
+                 [](uint64_t a, uint64_t b) { return a | b; });
+}
+
+void VoxelGrid::clear()
+{
+  std::fill(mWords.begin(), mWords.end(), uint64_t(0));
+}
+
+uint64_t* VoxelGrid::rowWords(size_t y, size_t z)
+{
+  return mWords.data() + (z * mNy + y) * mRowWords;
+}
+
+const uint64_t* VoxelGrid::rowWords(size_t y, size_t z) const
+{
+  return mWords.data() + (z * mNy + y) * mRowWords;
+}
+
+const std::vector<uint64_t>& VoxelGrid::words() const
+{
+  return mWords;
+}
+
+}  // namespace gal
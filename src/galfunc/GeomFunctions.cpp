@@ -1,4 +1,6 @@
 #include <galcore/ConvexHull.h>
+#include <galcore/OrientedBox3.h>
+#include <galcore/Voronoi.h>
 #include <galfunc/GeomFunctions.h>
 
 namespace gal {
@@ -78,11 +80,15 @@ GAL_FUNC_DEFN(((gal::PointCloud, cloud, "Point cloud")),
 GAL_FUNC_DEFN(((gal::Mesh, hull, "Convex hull")),
               pointCloudConvexHull,
               true,
-              1,
-              "Creates a convex hull from the given point cloud",
-              (gal::PointCloud, cloud, "Point cloud"))
+              2,
+              "Creates a convex hull from the given point cloud. Mode 0 is sequential, "
+              "mode 1 discards the interior points in parallel first, and mode 2 also "
+              "computes partial hulls in parallel",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (int32_t, mode, "Mode"))
 {
-  gal::ConvexHull hull(cloud->begin(), cloud->end());
+  gal::ConvexHull hull(
+    cloud->begin(), cloud->end(), gal::eConvexHullMode(std::clamp(*mode, 0, 2)));
   return std::make_tuple(std::make_shared<gal::Mesh>(hull.toMesh()));
 };
 
@@ -96,5 +102,35 @@ GAL_FUNC_DEFN(((gal::PointCloud, cloud, "Point cloud")),
   return std::make_tuple(std::make_shared<gal::PointCloud>(*points));
 };
 
+GAL_FUNC_DEFN(((gal::Voronoi3, cells, "Voronoi cells")),
+              pointCloudVoronoi,
+              true,
+              2,
+              "Creates the Voronoi cells of the points, clipped to the given box",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (gal::Box3, bounds, "Bounds of the cells"))
+{
+  gal::Delaunay3 tets(*cloud);
+  return std::make_tuple(std::make_shared<gal::Voronoi3>(tets, *bounds));
+};
+
+GAL_FUNC_DEFN(((gal::OrientedBox3, box, "Oriented bounding box"),
+               (float, volume, "Volume of the box")),
+              pointCloudOrientedBox,
+              true,
+              2,
+              "Creates an oriented bounding box for the given point cloud. Mode 0 uses "
+              "the principal axes of the points, mode 1 finds the smallest box with a "
+              "face flush with the convex hull",
+              (gal::PointCloud, cloud, "Point cloud"),
+              (int32_t, mode, "Mode"))
+{
+  auto box =
+    gal::OrientedBox3::fit(*cloud, gal::eOrientedBoxFit(std::clamp(*mode, 0, 1)));
+  float volume = box.volume();
+  return std::make_tuple(std::make_shared<gal::OrientedBox3>(std::move(box)),
+                         std::make_shared<float>(volume));
+};
+
 }  // namespace func
 }  // namespace gal
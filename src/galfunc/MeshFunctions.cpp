@@ -125,5 +125,54 @@ GAL_FUNC_DEFN(((gal::Box3, bounds, "Bounds of the mesh")),
   return std::make_tuple(std::make_shared<gal::Box3>(std::move(mesh->bounds())));
 };
 
+GAL_FUNC_DEFN(((gal::VoxelGrid, voxels, "Voxels occupied by the mesh")),
+              meshVoxels,
+              true,
+              3,
+              "Voxelizes the mesh. Mode 0 voxelizes the surface, mode 1 also fills the "
+              "interior of the mesh",
+              (gal::Mesh, mesh, "Mesh"),
+              (float, voxelSize, "Edge length of the voxels"),
+              (int32_t, mode, "Voxelization mode"))
+{
+  return std::make_tuple(std::make_shared<gal::VoxelGrid>(
+    mesh->voxelize(*voxelSize, gal::eMeshVoxelMode(std::clamp(*mode, 0, 1)))));
+};
+
+GAL_FUNC_DEFN(((gal::Mesh, result, "Resulting mesh")),
+              meshBoolean,
+              true,
+              3,
+              "Boolean operation on two closed meshes. Operation 0 is union, 1 is "
+              "intersection and 2 is difference",
+              (gal::Mesh, meshA, "First mesh"),
+              (gal::Mesh, meshB, "Second mesh"),
+              (int32_t, operation, "The boolean operation"))
+{
+  return std::make_tuple(std::make_shared<gal::Mesh>(gal::meshBoolean(
+    *meshA, *meshB, gal::eMeshBoolean(std::clamp(*operation, 0, 2)))));
+};
+
+GAL_FUNC_DEFN(((std::vector<float>, distances, "Geodesic distance of each vertex")),
+              meshGeodesicDistances,
+              true,
+              3,
+              "Distances along the surface of the mesh from the nearest source vertex. "
+              "Method 0 is the heat method and 1 is fast marching",
+              (gal::Mesh, mesh, "Mesh"),
+              (std::vector<int32_t>, sources, "Indices of the source vertices"),
+              (int32_t, method, "Method"))
+{
+  std::vector<size_t> indices;
+  indices.reserve(sources->size());
+  for (int32_t i : *sources) {
+    if (i >= 0) {
+      indices.push_back(size_t(i));
+    }
+  }
+  return std::make_tuple(std::make_shared<std::vector<float>>(mesh->geodesicDistances(
+    indices.data(), indices.size(), gal::eGeodesicMethod(std::clamp(*method, 0, 1)))));
+};
+
 }  // namespace func
 }  // namespace gal
@@ -1,8 +1,18 @@
 #include <execution>
+#include <random>
 
 #include <galcore/Annotations.h>
 #include <galcore/Circle2d.h>
+#include <galcore/ConvexHull.h>
+#include <galcore/ConvexHull2d.h>
 #include <galcore/DebugProfile.h>
+#include <galcore/Delaunay2.h>
+#include <galcore/Delaunay3.h>
+#include <galcore/OrientedBox3.h>
+#include <galcore/Predicates.h>
+#include <galcore/Sphere.h>
+#include <galcore/Voronoi.h>
+#include <glm/gtx/transform.hpp>
 #include <gtest/gtest.h>
 
 static constexpr float TOLERANCE = 0.0001f;
@@ -64,6 +74,190 @@ TEST(Sphere, MinBoundingSphere)
   }
 }
 
+/*Smallest of the circles through two or three of the points that contain all of them.*/
+static gal::Circle2d bruteForceBoundingCircle(const std::vector<glm::vec2>& points)
+{
+  gal::Circle2d best(glm::vec2(0.f), FLT_MAX);
+  auto          consider = [&](const gal::Circle2d& circ) {
+    if (circ.radius() < best.radius() &&
+        std::all_of(points.begin(), points.end(), [&](const glm::vec2& pt) {
+          return circ.contains(pt, TOLERANCE);
+        })) {
+      best = circ;
+    }
+  };
+  for (size_t i = 0; i < points.size(); i++) {
+    for (size_t j = i + 1; j < points.size(); j++) {
+      consider(gal::Circle2d::createFromDiameter(points[i], points[j]));
+      for (size_t k = j + 1; k < points.size(); k++) {
+        if (gal::orient2d(points[i], points[j], points[k]) != 0) {
+          consider(gal::Circle2d::createCircumcircle(points[i], points[j], points[k]));
+        }
+      }
+    }
+  }
+  return best;
+}
+
+/*Smallest of the spheres through two, three or four of the points that contain all of
+ * them.*/
+static gal::Sphere bruteForceBoundingSphere(const std::vector<glm::vec3>& points)
+{
+  gal::Sphere best(glm::vec3(0.f), FLT_MAX);
+  auto        consider = [&](const gal::Sphere& sp) {
+    if (sp.radius < best.radius &&
+        std::all_of(points.begin(), points.end(), [&](const glm::vec3& pt) {
+          return sp.contains(pt, TOLERANCE);
+        })) {
+      best = sp;
+    }
+  };
+  size_t n = points.size();
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      consider(gal::Sphere::createFromDiameter(points[i], points[j]));
+      for (size_t k = j + 1; k < n; k++) {
+        // The circumcircle of the triangle, in its plane.
+        glm::dvec3 origin(points[i]);
+        glm::dvec3 ba  = glm::dvec3(points[j]) - origin;
+        glm::dvec3 ca  = glm::dvec3(points[k]) - origin;
+        glm::dvec3 crs = glm::cross(ba, ca);
+        if (glm::dot(crs, crs) == 0.) {
+          continue;
+        }
+        glm::dvec3 rvec = (glm::dot(ca, ca) * glm::cross(crs, ba) +
+                           glm::cross(ca, crs) * glm::dot(ba, ba)) /
+                          (2. * glm::dot(crs, crs));
+        consider(gal::Sphere(glm::vec3(origin + rvec), float(glm::length(rvec))));
+        for (size_t l = k + 1; l < n; l++) {
+          const glm::vec3 &a = points[i], &b = points[j], &c = points[k],
+                          &d = points[l];
+          if (gal::orient3d(a, b, c, d) != 0) {
+            consider(gal::Sphere::createCircumsphere(a, b, c, d));
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+TEST(Circle2d, MinBoundingCircleBruteForce)
+{
+  std::vector<std::vector<glm::vec2>> pointSets;
+  std::vector<glm::vec2>              randPts(40);
+  gal::Box2(glm::vec2(-1.f), glm::vec2(1.f)).randomPoints(40, randPts.begin());
+  pointSets.push_back(randPts);
+  // Sorted input is the worst case for the algorithm without shuffling.
+  std::sort(randPts.begin(), randPts.end(), [](const glm::vec2& a, const glm::vec2& b) {
+    return a.x < b.x;
+  });
+  pointSets.push_back(randPts);
+  // Cocircular points, in order around the circle.
+  std::vector<glm::vec2> circle;
+  for (int i = 0; i < 24; i++) {
+    float angle = float(i) * 2.f * M_PI / 24.f;
+    circle.emplace_back(2.f + std::cos(angle), -1.f + std::sin(angle));
+  }
+  pointSets.push_back(circle);
+  // Collinear points, with duplicates.
+  std::vector<glm::vec2> line;
+  for (int i = 0; i < 20; i++) {
+    line.emplace_back(float(i % 7), 2.f * float(i % 7));
+  }
+  pointSets.push_back(line);
+  // A few points repeated many times, and a clump with one far point.
+  std::vector<glm::vec2> repeated;
+  for (int i = 0; i < 30; i++) {
+    repeated.push_back(randPts[i % 3]);
+  }
+  pointSets.push_back(repeated);
+  std::vector<glm::vec2> clump(randPts.begin(), randPts.end());
+  for (glm::vec2& pt : clump) {
+    pt *= 1e-3f;
+  }
+  clump.emplace_back(10.f, 10.f);
+  pointSets.push_back(clump);
+  // Enough points for the hull filter to kick in.
+  std::vector<glm::vec2> many(2000);
+  gal::Box2(glm::vec2(0.f), glm::vec2(1.f, 3.f)).randomPoints(2000, many.begin());
+  std::vector<glm::vec2> manyHull =
+    gal::ConvexHull2d(many.data(), many.size()).vertices();
+
+  for (const auto& points : pointSets) {
+    gal::Circle2d circ     = gal::Circle2d::minBoundingCircle(points);
+    gal::Circle2d expected = bruteForceBoundingCircle(points);
+    ASSERT_NEAR(expected.radius(), circ.radius(), TOLERANCE);
+    for (const auto& pt : points) {
+      ASSERT_TRUE(circ.contains(pt, TOLERANCE));
+    }
+  }
+  ASSERT_NEAR(bruteForceBoundingCircle(manyHull).radius(),
+              gal::Circle2d::minBoundingCircle(many).radius(),
+              TOLERANCE);
+  // All the points are the same.
+  std::vector<glm::vec2> same(5, glm::vec2(1.f, 2.f));
+  ASSERT_EQ(0.f, gal::Circle2d::minBoundingCircle(same).radius());
+}
+
+TEST(Sphere, MinBoundingSphereBruteForce)
+{
+  std::vector<std::vector<glm::vec3>> pointSets;
+  std::vector<glm::vec3>              randPts(25);
+  gal::Box3(glm::vec3(-1.f), glm::vec3(1.f)).randomPoints(25, randPts.begin());
+  pointSets.push_back(randPts);
+  std::sort(randPts.begin(), randPts.end(), [](const glm::vec3& a, const glm::vec3& b) {
+    return a.x < b.x;
+  });
+  pointSets.push_back(randPts);
+  // Cospherical points.
+  std::vector<glm::vec3> sphere;
+  for (int i = 0; i < 24; i++) {
+    float z = 1.f - (float(i) + .5f) / 12.f, r = std::sqrt(1.f - z * z);
+    float angle = float(i) * 2.39996323f;
+    sphere.emplace_back(r * std::cos(angle), r * std::sin(angle), z);
+  }
+  pointSets.push_back(sphere);
+  // Cocircular points in a tilted plane.
+  std::vector<glm::vec3> circle;
+  for (int i = 0; i < 24; i++) {
+    float angle = float(i) * 2.f * M_PI / 24.f;
+    circle.emplace_back(std::cos(angle), std::sin(angle), std::cos(angle));
+  }
+  pointSets.push_back(circle);
+  // Collinear points, with duplicates.
+  std::vector<glm::vec3> line;
+  for (int i = 0; i < 20; i++) {
+    line.emplace_back(float(i % 7), 2.f * float(i % 7), -float(i % 7));
+  }
+  pointSets.push_back(line);
+  // A few points repeated many times.
+  std::vector<glm::vec3> repeated;
+  for (int i = 0; i < 30; i++) {
+    repeated.push_back(randPts[i % 4]);
+  }
+  pointSets.push_back(repeated);
+  // The vertices of a regular tetrahedron support the sphere, with points inside.
+  std::vector<glm::vec3> tet = {{1.f, 1.f, 1.f}, {1.f, -1.f, -1.f}, {-1.f, 1.f, -1.f},
+                                {-1.f, -1.f, 1.f}};
+  for (const glm::vec3& pt : randPts) {
+    tet.push_back(pt * .5f);
+  }
+  pointSets.push_back(tet);
+
+  for (const auto& points : pointSets) {
+    gal::Sphere sp       = gal::Sphere::minBoundingSphere(points);
+    gal::Sphere expected = bruteForceBoundingSphere(points);
+    ASSERT_NEAR(expected.radius, sp.radius, TOLERANCE);
+    for (const auto& pt : points) {
+      ASSERT_TRUE(sp.contains(pt, TOLERANCE));
+    }
+  }
+  gal::Sphere sp = gal::Sphere::minBoundingSphere(pointSets.back());
+  ASSERT_NEAR(0.f, glm::length(sp.center), TOLERANCE);
+  ASSERT_NEAR(std::sqrt(3.f), sp.radius, TOLERANCE);
+}
+
 TEST(PointCloud, KMeansClusters)
 {
   gal::Box3               bounds(glm::vec3(0.f), glm::vec3(10.f));
@@ -72,8 +266,9 @@ TEST(PointCloud, KMeansClusters)
   std::vector<glm::vec3>  points(nPoints);
   bounds.randomPoints(points.size(), points.begin());
   std::vector<size_t> indices(points.size());
-  gal::kMeansClusters<glm::vec3>(
+  auto                centers = gal::kMeansClusters<glm::vec3>(
     points.begin(), points.end(), nClusters, indices.begin());
+  ASSERT_EQ(centers.size(), nClusters);
 
   for (size_t i : indices) {
     ASSERT_TRUE(i < nClusters);
@@ -84,4 +279,397 @@ TEST(PointCloud, KMeansClusters)
       std::count(std::execution::par_unseq, indices.begin(), indices.end(), i);
     ASSERT_TRUE(clusterSize > 0);
   }
+
+  // Converged, so every point is in the cluster of the nearest center, and every center
+  // is the mean of its cluster.
+  std::vector<glm::vec3> sums(nClusters, glm::vec3(0.f));
+  std::vector<size_t>    counts(nClusters, 0);
+  for (size_t i = 0; i < nPoints; i++) {
+    for (const auto& center : centers) {
+      ASSERT_LE(glm::distance(points[i], centers[indices[i]]),
+                glm::distance(points[i], center) + TOLERANCE);
+    }
+    sums[indices[i]] += points[i];
+    counts[indices[i]]++;
+  }
+  for (size_t i = 0; i < nClusters; i++) {
+    ASSERT_NEAR(glm::distance(centers[i], sums[i] / float(counts[i])), 0.f, TOLERANCE);
+  }
+
+  std::vector<glm::vec2> points2d(nPoints);
+  std::transform(points.begin(), points.end(), points2d.begin(), [](const glm::vec3& pt) {
+    return glm::vec2(pt.x, pt.y);
+  });
+  gal::kMeansClusters<glm::vec2>(
+    points2d.begin(), points2d.end(), nClusters, indices.begin());
+  for (size_t i : indices) {
+    ASSERT_TRUE(i < nClusters);
+  }
+}
+
+TEST(Predicates, Orient2d)
+{
+  // Points a few ulps away from the line through q and r, where the rounding errors of a
+  // plain floating point determinant are larger than the determinant.
+  static constexpr double ulp = 1. / double(1ull << 53);
+  const glm::dvec2        q(12., 12.), r(24., 24.);
+  for (int i = 0; i < 64; i++) {
+    for (int j = 0; j < 64; j++) {
+      glm::dvec2 p(.5 + i * ulp, .5 + j * ulp);
+      int        expected = j > i ? 1 : (j < i ? -1 : 0);
+      ASSERT_EQ(expected, gal::orient2d(p, q, r));
+      ASSERT_EQ(expected, gal::orient2d(q, r, p));
+      ASSERT_EQ(-expected, gal::orient2d(q, p, r));
+      ASSERT_EQ(expected,
+                gal::orient3d(
+                  glm::dvec3(p, 0.), glm::dvec3(q, 0.), glm::dvec3(r, 0.), {0., 0., 1.}));
+    }
+  }
+}
+
+TEST(ConvexHull, Points)
+{
+  static constexpr size_t nRandPts = 100000;
+  gal::Box3               box(glm::vec3(-1.f), glm::vec3(1.f));
+  std::vector<glm::vec3>  randPts(nRandPts);
+  box.randomPoints(nRandPts, randPts.begin());
+  // A grid has lots of coplanar points on the faces of the hull.
+  std::vector<glm::vec3> gridPts;
+  for (int x = 0; x < 20; x++) {
+    for (int y = 0; y < 20; y++) {
+      for (int z = 0; z < 20; z++) {
+        gridPts.emplace_back(float(x) * .1f, float(y) * .1f, float(z) * .1f);
+      }
+    }
+  }
+
+  for (const auto& points : {randPts, gridPts}) {
+    float volume = 0.f;
+    for (auto mode : {gal::eConvexHullMode::sequential,
+                      gal::eConvexHullMode::filtered,
+                      gal::eConvexHullMode::parallel}) {
+      gal::ConvexHull hull(points, mode);
+      gal::Mesh       mesh = hull.toMesh();
+      ASSERT_TRUE(mesh.isSolid());
+      ASSERT_EQ(hull.numFaces(), mesh.numFaces());
+      ASSERT_EQ(mesh.numFaces(), 2 * mesh.numVertices() - 4);
+      for (size_t fi = 0; fi < mesh.numFaces(); fi++) {
+        glm::vec3 normal = mesh.faceNormal(fi);
+        glm::vec3 origin = mesh.vertex(mesh.face(fi).a);
+        for (const auto& pt : points) {
+          ASSERT_LE(glm::dot(pt - origin, normal), TOLERANCE);
+        }
+      }
+      if (mode == gal::eConvexHullMode::sequential) {
+        volume = mesh.volume();
+      }
+      else {
+        ASSERT_NEAR(volume, mesh.volume(), TOLERANCE);
+      }
+    }
+  }
+  ASSERT_NEAR(gal::ConvexHull(gridPts).toMesh().volume(), 1.9f * 1.9f * 1.9f, TOLERANCE);
+}
+
+TEST(ConvexHull, Incremental)
+{
+  static constexpr size_t nRandPts = 100000;
+  gal::Box3               box(glm::vec3(-1.f), glm::vec3(1.f));
+  std::vector<glm::vec3>  points(nRandPts);
+  box.randomPoints(nRandPts, points.begin());
+  // Batches that are too flat to start the hull, tiny batches and batches that grow the
+  // bounds of the hull.
+  gal::IncrementalConvexHull hull;
+  hull.addPoints(points.data(), 1);
+  hull.addPoints(points.data() + 1, 2);
+  ASSERT_EQ(hull.mesh(), nullptr);
+  for (size_t i = 3; i < nRandPts; i += 9997) {
+    hull.addPoints(points.data() + i, std::min(size_t(9997), nRandPts - i));
+  }
+  std::vector<glm::vec3> far = {glm::vec3(2.f, 2.f, 2.f), glm::vec3(-3.f, 0.f, 0.f)};
+  hull.addPoints(far.data(), far.size());
+  points.insert(points.end(), far.begin(), far.end());
+
+  auto mesh = hull.mesh();
+  ASSERT_NE(mesh, nullptr);
+  ASSERT_TRUE(mesh->isSolid());
+  ASSERT_EQ(mesh->numFaces(), 2 * mesh->numVertices() - 4);
+  ASSERT_EQ(mesh->numVertices(), hull.vertexIndices().size());
+  ASSERT_NEAR(mesh->volume(), gal::ConvexHull(points).toMesh().volume(), TOLERANCE);
+}
+
+TEST(ConvexHull, IncrementalFlat)
+{
+  static constexpr size_t nBatches = 20;
+  static constexpr size_t nBatch   = 10000;
+  gal::Box2               square(glm::vec2(0.f), glm::vec2(1.f));
+  std::vector<glm::vec2>  flat(nBatch);
+  std::vector<glm::vec3>  batch(nBatch);
+  // Points on a line, and then in a plane, only keep the corners of their hull.
+  gal::IncrementalConvexHull hull;
+  for (size_t bi = 0; bi < nBatches; bi++) {
+    square.randomPoints(nBatch, flat.begin());
+    std::transform(flat.begin(), flat.end(), batch.begin(), [](const glm::vec2& pt) {
+      return glm::vec3(pt.x, 2.f * pt.x, 0.f);
+    });
+    batch[0] = glm::vec3(0.f);
+    batch[1] = glm::vec3(1.f, 2.f, 0.f);
+    hull.addPoints(batch.data(), batch.size());
+    ASSERT_EQ(hull.mesh(), nullptr);
+    ASSERT_EQ(hull.numPoints(), 2);
+  }
+  for (size_t bi = 0; bi < nBatches; bi++) {
+    square.randomPoints(nBatch, flat.begin());
+    std::transform(flat.begin(), flat.end(), batch.begin(), [](const glm::vec2& pt) {
+      return glm::vec3(pt.x, 2.f * pt.y, 0.f);
+    });
+    batch[0] = glm::vec3(0.f, 2.f, 0.f);
+    batch[1] = glm::vec3(1.f, 0.f, 0.f);
+    hull.addPoints(batch.data(), batch.size());
+    ASSERT_EQ(hull.mesh(), nullptr);
+    ASSERT_EQ(hull.numPoints(), 4);
+  }
+  // The apex of a pyramid on the rectangle.
+  glm::vec3 apex(.5f, 1.f, 3.f);
+  hull.addPoints(&apex, 1);
+  auto mesh = hull.mesh();
+  ASSERT_NE(mesh, nullptr);
+  ASSERT_TRUE(mesh->isSolid());
+  ASSERT_EQ(5, mesh->numVertices());
+  ASSERT_NEAR(2.f, mesh->volume(), TOLERANCE);
+}
+
+TEST(ConvexHull2d, Points)
+{
+  static constexpr size_t nRandPts = 100000;
+  gal::Box2               box(glm::vec2(-1.f), glm::vec2(1.f));
+  std::vector<glm::vec2>  points(nRandPts);
+  box.randomPoints(nRandPts, points.begin());
+  // Collinear points on the boundary.
+  for (int i = 0; i <= 10; i++) {
+    points.emplace_back(-1.f + .2f * float(i), 1.f);
+  }
+
+  gal::ConvexHull2d hull(points.data(), points.size());
+  const auto&       verts = hull.vertices();
+  ASSERT_GE(verts.size(), 3);
+  for (size_t i = 0; i < verts.size(); i++) {
+    const glm::vec2& a = verts[i];
+    const glm::vec2& b = verts[(i + 1) % verts.size()];
+    const glm::vec2& c = verts[(i + 2) % verts.size()];
+    ASSERT_EQ(gal::orient2d(a, b, c), 1);
+  }
+  for (const auto& pt : points) {
+    ASSERT_TRUE(hull.contains(pt));
+  }
+
+  // Adding the points in chunks gives the same hull.
+  gal::ConvexHull2d streamed;
+  for (size_t i = 0; i < points.size(); i += 10000) {
+    streamed.addPoints(points.data() + i, std::min(size_t(10000), points.size() - i));
+  }
+  ASSERT_EQ(streamed.vertices(), verts);
+
+  auto circ = gal::Circle2d::minBoundingCircle(points);
+  for (const auto& pt : points) {
+    ASSERT_TRUE(circ.contains(pt, TOLERANCE));
+  }
+}
+
+TEST(Delaunay3, Points)
+{
+  static constexpr size_t nRandPts = 400;
+  gal::Box3               box(glm::vec3(-1.f), glm::vec3(1.f));
+  std::vector<glm::vec3>  randPts(nRandPts);
+  box.randomPoints(nRandPts, randPts.begin());
+  // A grid has lots of cospherical points, and a duplicate point.
+  std::vector<glm::vec3> gridPts;
+  for (int x = 0; x < 6; x++) {
+    for (int y = 0; y < 6; y++) {
+      for (int z = 0; z < 6; z++) {
+        gridPts.emplace_back(float(x) * .2f, float(y) * .2f, float(z) * .2f);
+      }
+    }
+  }
+  gridPts.push_back(gridPts[10]);
+
+  for (const auto& points : {randPts, gridPts}) {
+    float          hullVolume = gal::ConvexHull(points).toMesh().volume();
+    gal::Delaunay3 tets(points);
+    float          volume = 0.f;
+    for (size_t ti = 0; ti < tets.numTetrahedra(); ti++) {
+      auto      tet = tets.tetrahedron(ti);
+      glm::vec3 a = points[tet[0]], b = points[tet[1]], c = points[tet[2]],
+                d = points[tet[3]];
+      ASSERT_EQ(gal::orient3d(a, b, c, d), 1);
+      volume += glm::dot(glm::cross(b - a, c - a), d - a) / 6.f;
+      // No point is strictly inside the circumsphere.
+      for (const auto& pt : points) {
+        ASSERT_LE(gal::insphere(a, b, c, d, pt), 0);
+      }
+    }
+    ASSERT_NEAR(volume, hullVolume, TOLERANCE);
+  }
+}
+
+TEST(Delaunay2, Constraints)
+{
+  static constexpr size_t nRandPts = 300;
+  // A unit square with a square hole, inside random points. The bottom edge of the outer
+  // square passes through a point that is not one of its ends.
+  std::vector<glm::vec2> points = {{0.f, 0.f},
+                                   {1.f, 0.f},
+                                   {1.f, 1.f},
+                                   {0.f, 1.f},
+                                   {.25f, .25f},
+                                   {.75f, .25f},
+                                   {.75f, .75f},
+                                   {.25f, .75f},
+                                   {.5f, 0.f}};
+  std::vector<gal::IndexPair> edges = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6}, {6, 7}, {7, 4}};
+  gal::Box2 box(glm::vec2(.01f), glm::vec2(.99f));
+  box.randomPoints(nRandPts, std::back_inserter(points));
+  auto triArea = [&](const std::array<size_t, 3>& tri) {
+    glm::vec2 u = points[tri[1]] - points[tri[0]], v = points[tri[2]] - points[tri[0]];
+    return (u.x * v.y - u.y * v.x) / 2.f;
+  };
+
+  for (bool constrained : {false, true}) {
+    gal::Delaunay2 tris(points, constrained ? edges : std::vector<gal::IndexPair> {});
+    float          area = 0.f, enclosedArea = 0.f;
+    for (size_t ti = 0; ti < tris.numTriangles(); ti++) {
+      auto      tri = tris.triangle(ti);
+      glm::vec2 a = points[tri[0]], b = points[tri[1]], c = points[tri[2]];
+      ASSERT_EQ(gal::orient2d(a, b, c), 1);
+      area += triArea(tri);
+      if (!constrained) {
+        for (const auto& pt : points) {
+          ASSERT_LE(gal::incircle(a, b, c, pt), 0);
+        }
+      }
+    }
+    ASSERT_NEAR(area, 1.f, TOLERANCE);
+    for (size_t ti : tris.enclosedTriangles()) {
+      enclosedArea += triArea(tris.triangle(ti));
+    }
+    ASSERT_NEAR(enclosedArea, constrained ? .75f : 0.f, TOLERANCE);
+  }
+}
+
+TEST(Voronoi, Cells)
+{
+  static constexpr size_t nPts = 200;
+  gal::Box3               box(glm::vec3(-1.f), glm::vec3(1.f));
+  std::vector<glm::vec3>  points(nPts);
+  box.randomPoints(nPts, points.begin());
+  gal::Box3 bounds(glm::vec3(-1.5f), glm::vec3(1.5f));
+
+  // Every corner of a cell is at least as close to its own site as to any other.
+  auto isNearest = [&](const glm::vec3& pt, const glm::vec3& site) {
+    for (const auto& other : points) {
+      if (glm::distance(pt, other) < glm::distance(pt, site) - TOLERANCE) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  gal::Delaunay3 tets(points);
+  gal::Voronoi3  clipped(tets, bounds);
+  gal::Voronoi3  open(tets);
+  float          volume = 0.f;
+  for (size_t ci = 0; ci < clipped.numCells(); ci++) {
+    gal::Mesh cell = clipped.cellMesh(ci);
+    ASSERT_TRUE(cell.isSolid());
+    ASSERT_NEAR(cell.volume(), clipped.cellVolume(ci), TOLERANCE);
+    for (auto it = cell.vertexCBegin(); it != cell.vertexCEnd(); it++) {
+      ASSERT_TRUE(isNearest(*it, clipped.site(ci)));
+    }
+    volume += clipped.cellVolume(ci);
+    // The unbounded cells are left empty, the others are not clipped.
+    if (open.numFaces(ci) > 0 && bounds.contains(open.cellMesh(ci).bounds())) {
+      ASSERT_NEAR(open.cellVolume(ci), clipped.cellVolume(ci), TOLERANCE);
+    }
+    // Neighboring cells share their vertices exactly.
+    for (size_t fi = 0; fi < open.numFaces(ci); fi++) {
+      size_t ni = open.faceNeighbor(ci, fi);
+      if (open.numFaces(ni) == 0) {
+        continue;
+      }
+      gal::Mesh mine = open.cellMesh(ci), other = open.cellMesh(ni);
+      size_t    nShared = 0;
+      for (auto it = mine.vertexCBegin(); it != mine.vertexCEnd(); it++) {
+        nShared += std::count(other.vertexCBegin(), other.vertexCEnd(), *it) > 0;
+      }
+      ASSERT_GE(nShared, 3);
+    }
+  }
+  ASSERT_NEAR(volume, bounds.volume(), TOLERANCE * 10.f);
+
+  std::vector<glm::vec2> points2d;
+  for (const auto& pt : points) {
+    points2d.emplace_back(pt.x, pt.y);
+  }
+  gal::Delaunay2 tris(points2d);
+  gal::Voronoi2  cells2d(tris, gal::Box2(glm::vec2(-1.5f), glm::vec2(1.5f)));
+  float          area = 0.f;
+  for (size_t ci = 0; ci < cells2d.numCells(); ci++) {
+    area += cells2d.cellArea(ci);
+  }
+  ASSERT_NEAR(area, 9.f, TOLERANCE * 10.f);
+}
+
+TEST(OrientedBox3, Fit)
+{
+  // The corners of a rotated box, and points inside it.
+  static constexpr size_t nPts = 1000;
+  const glm::vec3         half(1.5f, 0.5f, 0.25f);
+  gal::Box3               box(-half, half);
+  std::vector<glm::vec3>  points(nPts);
+  box.randomPoints(nPts, points.begin());
+  for (int i = 0; i < 8; i++) {
+    points.emplace_back(i & 1 ? box.max.x : box.min.x,
+                        i & 2 ? box.max.y : box.min.y,
+                        i & 4 ? box.max.z : box.min.z);
+  }
+  glm::mat4 xform = glm::translate(glm::vec3(4.f, -2.f, 1.f)) *
+                    glm::rotate(0.7f, glm::normalize(glm::vec3(1.f, 2.f, 3.f)));
+  for (auto& pt : points) {
+    pt = glm::vec3(xform * glm::vec4(pt, 1.f));
+  }
+
+  auto minBox = gal::OrientedBox3::fit(points, gal::eOrientedBoxFit::minVolume);
+  auto pcaBox = gal::OrientedBox3::fit(points, gal::eOrientedBoxFit::pca);
+  ASSERT_NEAR(minBox.volume(), box.volume(), TOLERANCE * 10.f);
+  ASSERT_GE(pcaBox.volume(), minBox.volume() - TOLERANCE);
+  for (const auto& pt : points) {
+    ASSERT_TRUE(minBox.contains(pt, TOLERANCE));
+    ASSERT_TRUE(pcaBox.contains(pt, TOLERANCE));
+  }
+}
+
+TEST(OrientedBox3, FitLargeHull)
+{
+  // Points on a rotated ellipsoid, every one of them is on the hull. The smallest box
+  // is close to the box of the ellipsoid.
+  static constexpr size_t         nPts = 8000;
+  const glm::vec3                 radii(1.f, 2.f, 3.f);
+  std::mt19937                    rng(42);
+  std::normal_distribution<float> nd;
+  std::vector<glm::vec3>          points(nPts);
+  glm::mat4 xform = glm::rotate(0.7f, glm::normalize(glm::vec3(1.f, 2.f, 3.f)));
+  for (auto& pt : points) {
+    glm::vec3 dir = glm::normalize(glm::vec3(nd(rng), nd(rng), nd(rng)));
+    pt            = glm::vec3(xform * glm::vec4(dir * radii, 1.f));
+  }
+
+  auto  minBox   = gal::OrientedBox3::fit(points, gal::eOrientedBoxFit::minVolume);
+  auto  pcaBox   = gal::OrientedBox3::fit(points, gal::eOrientedBoxFit::pca);
+  float expected = 8.f * radii.x * radii.y * radii.z;
+  ASSERT_NEAR(minBox.volume(), expected, expected * 0.01f);
+  ASSERT_GE(pcaBox.volume(), minBox.volume() - TOLERANCE);
+  for (const auto& pt : points) {
+    ASSERT_TRUE(minBox.contains(pt, TOLERANCE));
+  }
 }
@@ -0,0 +1,383 @@
+#include <galcore/Mesh.h>
+#include <galcore/MeshBoolean.h>
+#include <glm/gtx/transform.hpp>
+#include <gtest/gtest.h>
+
+using namespace gal;
+
+static Mesh boxMesh(const Box3& b)
+{
+  std::vector<glm::vec3> verts;
+  verts.reserve(8);
+  for (size_t i = 0; i < 8; i++) {
+    verts.emplace_back((i & 1) ? b.max.x : b.min.x,
+                       (i & 2) ? b.max.y : b.min.y,
+                       (i & 4) ? b.max.z : b.min.z);
+  }
+  static const std::vector<Mesh::Face> sFaces = {
+    {0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5}, {0, 1, 5}, {0, 5, 4},
+    {2, 6, 7}, {2, 7, 3}, {0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6},
+  };
+  return Mesh(verts, sFaces);
+}
+
+TEST(Mesh, Voxelize)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  ASSERT_TRUE(mesh.isSolid());
+
+  VoxelGrid surface = mesh.voxelize(0.3f);
+  ASSERT_EQ(4, surface.numX());
+  ASSERT_EQ(4, surface.numY());
+  ASSERT_EQ(4, surface.numZ());
+  // Only the 2 x 2 x 2 voxels in the middle do not touch the surface.
+  ASSERT_EQ(56, surface.numOccupied());
+  ASSERT_FALSE(surface.get(1, 2, 1));
+  ASSERT_TRUE(surface.isExposed(3, 0, 2));
+
+  VoxelGrid solid = mesh.voxelize(0.3f, eMeshVoxelMode::solid);
+  ASSERT_EQ(64, solid.numOccupied());
+  ASSERT_FALSE(solid.isExposed(1, 2, 1));
+
+  Bytes     bytes = Serial<VoxelGrid>::serialize(surface);
+  VoxelGrid copy  = Serial<VoxelGrid>::deserialize(bytes);
+  ASSERT_EQ(surface.numOccupied(), copy.numOccupied());
+  ASSERT_EQ(surface.words(), copy.words());
+}
+
+TEST(Mesh, VoxelizeEmpty)
+{
+  Mesh      mesh(std::vector<glm::vec3> {}, std::vector<Mesh::Face> {});
+  VoxelGrid grid = mesh.voxelize(0.3f, eMeshVoxelMode::solid);
+  ASSERT_EQ(0, grid.numVoxels());
+  ASSERT_EQ(0, grid.numOccupied());
+  ASSERT_THROW(VoxelGrid(Box3::empty, 0.3f), std::invalid_argument);
+}
+
+TEST(Mesh, Contains)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // Many of the vertical rays from these points pass exactly through the edges and the
+  // vertices of the mesh.
+  for (int x = -2; x <= 6; x++) {
+    for (int y = -2; y <= 6; y++) {
+      for (int z = -2; z <= 6; z++) {
+        bool inside = x >= 0 && x <= 4 && y >= 0 && y <= 4 && z >= 0 && z <= 4;
+        ASSERT_EQ(inside, mesh.contains(glm::vec3(x, y, z) * .25f));
+      }
+    }
+  }
+}
+
+TEST(Mesh, ClipWithPlane)
+{
+  Mesh box = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // Both planes cut the box in half.
+  for (const glm::vec3& normal : {glm::vec3(0.f, 0.f, 1.f), glm::vec3(1.f, 1.f, 1.f)}) {
+    Mesh open = box;
+    open.clipWithPlane(Plane(glm::vec3(.5f), normal));
+    ASSERT_FALSE(open.isSolid());
+
+    Mesh capped = box;
+    capped.clipWithPlane(Plane(glm::vec3(.5f), normal), true);
+    ASSERT_TRUE(capped.isSolid());
+    ASSERT_NEAR(capped.volume(), .5f, 1e-5f);
+  }
+}
+
+TEST(Mesh, ClipWithPlaneThroughVertices)
+{
+  // The plane passes through four vertices of the box, and splits only the top and the
+  // bottom faces.
+  Mesh box = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  box.clipWithPlane(Plane(glm::vec3(.5f, .5f, 0.f), glm::vec3(1.f, 1.f, 0.f)), true);
+  ASSERT_TRUE(box.isSolid());
+  ASSERT_NEAR(box.volume(), .5f, 1e-5f);
+}
+
+TEST(Mesh, Booleans)
+{
+  static constexpr float tolerance = 1e-4f;
+  Mesh a = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // The second box is placed such that some of its edges pass exactly through the
+  // diagonals of the faces of the first box.
+  for (const glm::vec3& offset : {glm::vec3 {.5f, .4f, .3f}, glm::vec3 {.5f, .5f, .5f}}) {
+    Mesh b = boxMesh(Box3(offset, offset + glm::vec3 {1.f, 1.f, 1.f}));
+    glm::vec3 overlap = glm::vec3 {1.f, 1.f, 1.f} - offset;
+    float     common  = overlap.x * overlap.y * overlap.z;
+
+    Mesh uni = meshBoolean(a, b, eMeshBoolean::unite);
+    ASSERT_TRUE(uni.isSolid());
+    ASSERT_NEAR(2.f - common, uni.volume(), tolerance);
+
+    Mesh inter = meshBoolean(a, b, eMeshBoolean::intersect);
+    ASSERT_TRUE(inter.isSolid());
+    ASSERT_NEAR(common, inter.volume(), tolerance);
+
+    Mesh diff = meshBoolean(a, b, eMeshBoolean::subtract);
+    ASSERT_TRUE(diff.isSolid());
+    ASSERT_NEAR(1.f - common, diff.volume(), tolerance);
+  }
+}
+
+TEST(Mesh, MeshMeshQueries)
+{
+  static constexpr float tolerance = 1e-5f;
+  Mesh a = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  Mesh b = boxMesh(Box3(glm::vec3 {-.5f, -.5f, -.5f}, glm::vec3 {.5f, .5f, .5f}));
+
+  glm::mat4 apart = glm::translate(glm::vec3 {2.5f, .5f, .5f});
+  ASSERT_FALSE(a.intersects(b, apart));
+  ASSERT_NEAR(1.f, a.minimumDistance(b, apart), tolerance);
+  ASSERT_NEAR(1.f, a.minimumDistance(b, apart, true), tolerance);
+
+  glm::mat4 crossing = glm::translate(glm::vec3 {1.f, 1.f, 1.f});
+  size_t    nPairs   = 0;
+  ASSERT_TRUE(a.overlappingFaces(b, crossing, [&nPairs](size_t, size_t) {
+    nPairs++;
+    return true;
+  }));
+  ASSERT_LT(0, nPairs);
+  // Placing the other tree up front finds the same pairs.
+  size_t nPlacedPairs = 0;
+  ASSERT_TRUE(a.overlappingFaces(
+    b,
+    crossing,
+    [&nPlacedPairs](size_t, size_t) {
+      nPlacedPairs++;
+      return true;
+    },
+    true));
+  ASSERT_EQ(nPairs, nPlacedPairs);
+  ASSERT_TRUE(a.intersects(b, crossing));
+  ASSERT_EQ(0.f, a.minimumDistance(b, crossing));
+
+  // Rotated such that an edge of the second box faces the first box.
+  glm::mat4 rotated = glm::translate(glm::vec3 {1.25f + std::sqrt(.5f), .5f, .5f}) *
+                      glm::rotate(glm::radians(45.f), glm::vec3 {0.f, 0.f, 1.f});
+  ASSERT_FALSE(a.intersects(b, rotated));
+  ASSERT_NEAR(.25f, a.minimumDistance(b, rotated), tolerance);
+  ASSERT_NEAR(.25f, a.minimumDistance(b, rotated, true), tolerance);
+}
+
+TEST(Mesh, GeodesicDistances)
+{
+  // On a flat grid the geodesic distances are the straight line distances.
+  static constexpr size_t n       = 21;
+  static constexpr float  spacing = .1f;
+  std::vector<glm::vec3>  verts;
+  std::vector<Mesh::Face> faces;
+  for (size_t y = 0; y < n; y++) {
+    for (size_t x = 0; x < n; x++) {
+      verts.emplace_back(float(x) * spacing, float(y) * spacing, 0.f);
+      if (x + 1 < n && y + 1 < n) {
+        size_t v = y * n + x;
+        faces.emplace_back(v, v + 1, v + n + 1);
+        faces.emplace_back(v, v + n + 1, v + n);
+      }
+    }
+  }
+  Mesh   mesh(verts, faces);
+  size_t source = n * n / 2;
+  // The heat method is approximate, especially near the boundary.
+  static const std::pair<eGeodesicMethod, float> sCases[] = {
+    {eGeodesicMethod::heat, .1f}, {eGeodesicMethod::fastMarching, 1e-4f}};
+  for (auto [method, tolerance] : sCases) {
+    std::vector<float> dists = mesh.geodesicDistances(&source, 1, method);
+    ASSERT_EQ(verts.size(), dists.size());
+    ASSERT_EQ(0.f, dists[source]);
+    for (size_t vi = 0; vi < verts.size(); vi++) {
+      ASSERT_NEAR(glm::distance(verts[vi], verts[source]), dists[vi], tolerance);
+    }
+  }
+  // The cached factorization is shared with copies.
+  Mesh copy(mesh);
+  ASSERT_EQ(mesh.geodesicDistances(&source, 1), copy.geodesicDistances(&source, 1));
+}
+
+TEST(Mesh, Components)
+{
+  // Two boxes touching at a corner, which is a vertex shared by both.
+  Mesh a = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  Mesh b = boxMesh(Box3(glm::vec3 {1.f, 1.f, 1.f}, glm::vec3 {2.f, 2.f, 2.f}));
+  std::vector<glm::vec3>  verts = a.vertices();
+  std::vector<Mesh::Face> faces = a.faces();
+  verts.insert(verts.end(), b.vertexCBegin() + 1, b.vertexCEnd());
+  for (Mesh::Face f : b.faces()) {
+    for (size_t& vi : f.indices) {
+      vi = vi == 0 ? 7 : vi + 7;
+    }
+    faces.push_back(f);
+  }
+  Mesh mesh(verts, faces);
+
+  std::vector<size_t> labels;
+  ASSERT_EQ(2, mesh.components(labels));
+  ASSERT_EQ(mesh.numFaces(), labels.size());
+  for (size_t fi = 0; fi < mesh.numFaces(); fi++) {
+    ASSERT_EQ(fi < a.numFaces() ? 0 : 1, labels[fi]);
+  }
+  ASSERT_EQ(1, mesh.components(labels, eMeshConnectivity::vertex));
+
+  std::vector<Mesh> shells = mesh.shells();
+  ASSERT_EQ(2, shells.size());
+  for (const Mesh& shell : shells) {
+    ASSERT_EQ(8, shell.numVertices());
+    ASSERT_EQ(12, shell.numFaces());
+    ASSERT_TRUE(shell.isSolid());
+    ASSERT_NEAR(1.f, shell.volume(), 1e-5f);
+  }
+}
+
+TEST(Mesh, ExtractFaces)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // The scratch space is reused by the second call.
+  const std::vector<size_t> selections[]  = {{0, 1, 2, 3}, {10, 11}};
+  const size_t              numVertices[] = {8, 4};
+  for (size_t si = 0; si < 2; si++) {
+    const std::vector<size_t>& selection = selections[si];
+    Mesh                       part      = mesh.extractFaces(selection);
+    ASSERT_EQ(selection.size(), part.numFaces());
+    ASSERT_EQ(numVertices[si], part.numVertices());
+    ASSERT_FALSE(part.isSolid());
+    for (size_t fi = 0; fi < part.numFaces(); fi++) {
+      ASSERT_EQ(mesh.faceNormal(selection[fi]), part.faceNormal(fi));
+      std::vector<size_t> hits;
+      part.queryBox(part.faceBounds(fi), std::back_inserter(hits), eMeshElement::face);
+      ASSERT_NE(hits.end(), std::find(hits.begin(), hits.end(), fi));
+      ASSERT_TRUE(std::all_of(
+        hits.begin(), hits.end(), [&part](size_t i) { return i < part.numFaces(); }));
+    }
+  }
+}
+
+TEST(Mesh, ExtractRepeatedFaces)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  Mesh part = mesh.extractFaces({11, 10, 11, 10});
+  ASSERT_EQ(2, part.numFaces());
+  ASSERT_EQ(4, part.numVertices());
+  // The faces keep the order in which they first appear.
+  const size_t expected[] = {11, 10};
+  for (size_t fi = 0; fi < 2; fi++) {
+    const Mesh::Face& f1 = mesh.faces()[expected[fi]];
+    const Mesh::Face& f2 = part.faces()[fi];
+    for (size_t i = 0; i < 3; i++) {
+      ASSERT_EQ(mesh.vertex(f1.indices[i]), part.vertex(f2.indices[i]));
+    }
+  }
+  std::vector<size_t> hits;
+  part.queryBox(part.bounds(), std::back_inserter(hits), eMeshElement::face);
+  std::sort(hits.begin(), hits.end());
+  ASSERT_EQ((std::vector<size_t> {0, 1}), hits);
+}
+
+TEST(Mesh, Serialization)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // The trees are loaded with the mesh, and meshes saved without them still load.
+  Bytes withTrees = Serial<Mesh>::serialize(mesh);
+  Bytes withoutTrees;
+  withoutTrees << mesh.vertices() << mesh.faces();
+  for (Bytes* bytes : {&withTrees, &withoutTrees}) {
+    Mesh copy = Serial<Mesh>::deserialize(*bytes);
+    ASSERT_EQ(mesh.vertices(), copy.vertices());
+    ASSERT_EQ(mesh.numFaces(), copy.numFaces());
+    ASSERT_TRUE(copy.isSolid());
+    Box3                query(glm::vec3 {-.5f, -.5f, -.5f}, glm::vec3 {.5f, .5f, .5f});
+    std::vector<size_t> expected, hits;
+    mesh.queryBox(query, std::back_inserter(expected), eMeshElement::face);
+    copy.queryBox(query, std::back_inserter(hits), eMeshElement::face);
+    ASSERT_EQ(expected, hits);
+    expected.clear();
+    hits.clear();
+    mesh.queryBox(query, std::back_inserter(expected), eMeshElement::vertex);
+    copy.queryBox(query, std::back_inserter(hits), eMeshElement::vertex);
+    ASSERT_EQ(expected, hits);
+  }
+}
+
+TEST(Mesh, SerializationDamagedTree)
+{
+  Mesh    mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  RTree3d vertexTree;
+  vertexTree.build(mesh.numVertices(),
+                   [&mesh](size_t vi) { return Box3(mesh.vertex(vi)); });
+  // Face trees with another version, a node count larger than the data, and a child
+  // index out of range. Each is followed by a marker, which must still be readable.
+  RTree3d::Node node {};
+  node.count       = 1;
+  node.children[0] = 7;
+  auto treeBytes   = [&node](uint32_t version, uint64_t nNodes) {
+    Bytes bytes;
+    bytes << version << uint64_t(12) << nNodes << uint32_t(RTree3d::Dim)
+          << uint32_t(RTree3d::Width) << uint32_t(sizeof(node));
+    bytes.writeBytes((const char*)&node, sizeof(node));
+    bytes << uint32_t(42);
+    return bytes;
+  };
+  for (Bytes tree : {treeBytes(RTree3d::FormatVersion + 1, 1),
+                     treeBytes(RTree3d::FormatVersion, uint64_t(1) << 40),
+                     treeBytes(RTree3d::FormatVersion, 1)}) {
+    Bytes copy = tree;
+    ASSERT_EQ(0, Serial<RTree3d>::deserialize(copy).size());
+    uint32_t marker = 0;
+    if (copy.remaining() > 0) {
+      copy >> marker;
+      ASSERT_EQ(42, marker);
+    }
+
+    // The mesh rebuilds the damaged tree, and the tree after it is still read.
+    Bytes bytes;
+    bytes << mesh.vertices() << mesh.faces();
+    bytes.writeNested(tree);
+    bytes << vertexTree;
+    Mesh  loaded   = Serial<Mesh>::deserialize(bytes);
+    Bytes saved    = Serial<Mesh>::serialize(loaded);
+    Mesh  reloaded = Serial<Mesh>::deserialize(saved);
+    for (const Mesh* m : {&loaded, &reloaded}) {
+      ASSERT_TRUE(m->isSolid());
+      for (eMeshElement element : {eMeshElement::face, eMeshElement::vertex}) {
+        Box3                query(glm::vec3 {-.5f}, glm::vec3 {.5f});
+        std::vector<size_t> expected, hits;
+        mesh.queryBox(query, std::back_inserter(expected), element);
+        m->queryBox(query, std::back_inserter(hits), element);
+        std::sort(hits.begin(), hits.end());
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(expected, hits);
+      }
+    }
+  }
+}
+
+TEST(Mesh, UpdateVertices)
+{
+  Mesh mesh = boxMesh(Box3(glm::vec3 {0.f, 0.f, 0.f}, glm::vec3 {1.f, 1.f, 1.f}));
+  // Stretch the box along x by moving the vertices of one side.
+  std::vector<glm::vec3> verts = mesh.vertices();
+  for (glm::vec3& v : verts) {
+    if (v.x > .5f) {
+      v.x = 3.f;
+    }
+  }
+  mesh.updateVertices(verts.data(), verts.size());
+  Mesh expected(verts, mesh.faces());
+  ASSERT_NEAR(3.f, mesh.volume(), 1e-5f);
+  for (size_t fi = 0; fi < mesh.numFaces(); fi++) {
+    ASSERT_EQ(expected.faceNormal(fi), mesh.faceNormal(fi));
+  }
+  for (size_t vi = 0; vi < mesh.numVertices(); vi++) {
+    ASSERT_EQ(expected.vertexNormal(vi), mesh.vertexNormal(vi));
+  }
+  std::vector<size_t> hits;
+  mesh.queryBox(Box3(glm::vec3 {2.5f, .2f, .2f}, glm::vec3 {2.8f, .8f, .8f}),
+                std::back_inserter(hits),
+                eMeshElement::face);
+  ASSERT_TRUE(hits.empty());
+  mesh.queryBox(Box3(glm::vec3 {2.9f, .2f, .2f}, glm::vec3 {3.1f, .8f, .8f}),
+                std::back_inserter(hits),
+                eMeshElement::face);
+  ASSERT_EQ(2, hits.size());
+  ASSERT_EQ(3.f, mesh.bounds().max.x);
+}
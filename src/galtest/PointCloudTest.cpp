@@ -18,4 +18,208 @@ TEST(PointCloud, Serialization) {
 
     ASSERT_EQ(npts, cloud2.size());
     ASSERT_EQ(cloud1, cloud2);
-};
\ No newline at end of file
+};
+
+TEST(PointCloud, DeserializeWithoutAttributes)
+{
+  // Clouds saved before the attributes were added are a count followed by the points.
+  std::vector<glm::vec3> pts = {{1.f, 2.f, 3.f}, {4.f, 5.f, 6.f}, {-1.f, 0.f, .5f}};
+  Bytes                  bytes;
+  bytes << uint64_t(pts.size());
+  for (const auto& pt : pts) {
+    bytes << pt;
+  }
+  PointCloud cloud = Serial<PointCloud>::deserialize(bytes);
+  ASSERT_EQ(pts, static_cast<const std::vector<glm::vec3>&>(cloud));
+  ASSERT_FALSE(cloud.hasNormals());
+  ASSERT_FALSE(cloud.hasColors());
+  ASSERT_TRUE(cloud.scalarFieldNames().empty());
+}
+TEST(PointCloud, KdTree)
+{
+  static constexpr size_t nPts = 5000, nQueries = 50, k = 10;
+  static constexpr float  radius = .2f;
+  Box3       box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  PointCloud cloud, queries;
+  box.randomPoints(nPts, std::back_inserter(cloud));
+  box.randomPoints(nQueries, std::back_inserter(queries));
+
+  KdTree3 tree = cloud.kdTree();
+  ASSERT_EQ(nPts, tree.size());
+
+  std::vector<size_t> indices(nQueries * k), offsets, found;
+  std::vector<float>  dists(nQueries * k);
+  tree.queryNearestNBatch(queries.data(), nQueries, k, indices.data(), dists.data());
+  tree.queryRadiusBatch(queries.data(), nQueries, radius, offsets, found);
+  std::vector<float> bruteDists(nPts);
+  for (size_t qi = 0; qi < nQueries; qi++) {
+    for (size_t i = 0; i < nPts; i++) {
+      bruteDists[i] = glm::distance(cloud[i], queries[qi]);
+    }
+    size_t nInside = std::count_if(
+      bruteDists.begin(), bruteDists.end(), [](float d) { return d <= radius; });
+    ASSERT_EQ(nInside, offsets[qi + 1] - offsets[qi]);
+    for (size_t i = offsets[qi]; i < offsets[qi + 1]; i++) {
+      ASSERT_LE(bruteDists[found[i]], radius);
+    }
+    std::partial_sort(bruteDists.begin(), bruteDists.begin() + k, bruteDists.end());
+    for (size_t j = 0; j < k; j++) {
+      ASSERT_FLOAT_EQ(bruteDists[j], dists[qi * k + j]);
+      ASSERT_FLOAT_EQ(glm::distance(cloud[indices[qi * k + j]], queries[qi]),
+                      dists[qi * k + j]);
+    }
+  }
+
+  // A tree built before the points moved is rejected.
+  cloud.push_back(glm::vec3 {0.f, 0.f, 0.f});
+  ASSERT_EQ(nPts + 1, cloud.kdTree().size());
+  ASSERT_THROW(cloud.estimateNormals(k, tree), const char*);
+}
+
+TEST(PointCloud, MiniBatchKMeans)
+{
+  // Tight blobs around the corners of a cube, streamed in chunks, with a checkpoint
+  // halfway through.
+  static constexpr size_t nChunks = 20, chunkSize = 500, nClusters = 8;
+  Box3                   box(glm::vec3 {-.1f, -.1f, -.1f}, glm::vec3 {.1f, .1f, .1f});
+  std::vector<glm::vec3> corners;
+  for (int i = 0; i < 8; i++) {
+    corners.emplace_back(i & 1 ? 10.f : 0.f, i & 2 ? 10.f : 0.f, i & 4 ? 10.f : 0.f);
+  }
+  size_t nRead = 0, stopAt = nChunks / 2;
+  auto   readNext = [&](PointCloud& chunk) {
+    if (nRead == stopAt) {
+      return false;
+    }
+    chunk.clear();
+    box.randomPoints(chunkSize, std::back_inserter(chunk));
+    for (size_t i = 0; i < chunkSize; i++) {
+      chunk[i] += corners[(nRead * chunkSize + i) % corners.size()];
+    }
+    nRead++;
+    return true;
+  };
+
+  MiniBatchKMeans first(nClusters);
+  first.addBatches(readNext);
+  auto            bytes = Serial<MiniBatchKMeans>::serialize(first);
+  MiniBatchKMeans kmeans = Serial<MiniBatchKMeans>::deserialize(bytes);
+  ASSERT_EQ(first.centers(), kmeans.centers());
+  ASSERT_EQ(first.counts(), kmeans.counts());
+  stopAt = nChunks;
+  kmeans.addBatches(readNext);
+
+  ASSERT_EQ(nClusters, kmeans.centers().size());
+  ASSERT_EQ(nChunks * chunkSize,
+            std::accumulate(kmeans.counts().begin(), kmeans.counts().end(), uint64_t(0)));
+  std::vector<size_t> indices(corners.size());
+  kmeans.assign(corners.data(), corners.size(), indices.data());
+  std::sort(indices.begin(), indices.end());
+  ASSERT_EQ(indices.end(), std::unique(indices.begin(), indices.end()));
+  for (const auto& center : kmeans.centers()) {
+    float nearest = FLT_MAX;
+    for (const auto& corner : corners) {
+      nearest = std::min(nearest, glm::distance(center, corner));
+    }
+    ASSERT_LT(nearest, .05f);
+  }
+}
+
+TEST(PointCloud, Downsample)
+{
+  static constexpr size_t nPts = 20000;
+  static constexpr float  size = .2f;
+  Box3       box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  PointCloud cloud;
+  box.randomPoints(nPts, std::back_inserter(cloud));
+
+  std::vector<size_t> offsets, sources;
+  PointCloud          voxels = cloud.voxelDownsample(size, offsets, sources);
+  ASSERT_EQ(voxels.size() + 1, offsets.size());
+  ASSERT_EQ(nPts, offsets.back());
+  std::vector<size_t> sorted(sources);
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < nPts; i++) {
+    ASSERT_EQ(i, sorted[i]);
+  }
+  for (size_t vi = 0; vi < voxels.size(); vi++) {
+    glm::vec3 sum(0.f);
+    for (size_t i = offsets[vi]; i < offsets[vi + 1]; i++) {
+      sum += cloud[sources[i]];
+      ASSERT_LE(glm::distance(cloud[sources[i]], voxels[vi]), size * std::sqrt(3.f));
+    }
+    ASSERT_LT(glm::distance(sum / float(offsets[vi + 1] - offsets[vi]), voxels[vi]),
+              1e-4f);
+  }
+
+  PointCloud samples = cloud.poissonDiskSample(size, sources);
+  ASSERT_EQ(samples.size(), sources.size());
+  KdTree3             tree = samples.kdTree();
+  std::vector<size_t> nearest(2);
+  std::vector<float>  dists(2);
+  for (size_t i = 0; i < samples.size(); i++) {
+    ASSERT_EQ(samples[i], cloud[sources[i]]);
+    tree.queryNearestN(samples[i], 2, nearest.data(), dists.data());
+    ASSERT_GE(dists[1], size);
+  }
+  for (const auto& pt : cloud) {
+    tree.queryNearestN(pt, 1, nearest.data(), dists.data());
+    ASSERT_LT(dists[0], size);
+  }
+}
+
+TEST(PointCloud, Normals)
+{
+  static constexpr size_t nPts = 5000, k = 12;
+  std::mt19937                          rng(42);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  PointCloud                            cloud;
+  while (cloud.size() < nPts) {
+    glm::vec3 pt(dist(rng), dist(rng), dist(rng));
+    float     len = glm::length(pt);
+    if (len > .1f && len <= 1.f) {
+      cloud.push_back(pt / len);
+    }
+  }
+  ASSERT_FALSE(cloud.hasNormals());
+  ASSERT_THROW(cloud.orientNormals(k), const char*);
+
+  // Both passes search the same tree.
+  KdTree3 tree = cloud.kdTree();
+  cloud.estimateNormals(k, tree);
+  ASSERT_TRUE(cloud.hasNormals());
+  for (size_t i = 0; i < nPts; i++) {
+    ASSERT_GT(std::abs(glm::dot(cloud.normals()[i], cloud[i])), .95f);
+  }
+  cloud.orientNormals(k, tree);
+  for (size_t i = 0; i < nPts; i++) {
+    ASSERT_GT(glm::dot(cloud.normals()[i], cloud[i]), .95f);
+  }
+
+  std::vector<float>& heights = cloud.scalarField("height");
+  ASSERT_EQ(nPts, heights.size());
+  for (size_t i = 0; i < nPts; i++) {
+    heights[i] = cloud[i].z;
+  }
+  auto       bytes = Serial<PointCloud>::serialize(cloud);
+  PointCloud copy  = Serial<PointCloud>::deserialize(bytes);
+  ASSERT_EQ(cloud, copy);
+  ASSERT_EQ(cloud.normals(), copy.normals());
+  ASSERT_FALSE(copy.hasColors());
+  ASSERT_EQ(std::vector<std::string> {"height"}, copy.scalarFieldNames());
+  ASSERT_EQ(heights, copy.scalarField("height"));
+
+  // The attributes follow the points when downsampling.
+  std::vector<size_t> offsets, sources;
+  PointCloud          voxels = cloud.voxelDownsample(.2f, offsets, sources);
+  ASSERT_TRUE(voxels.hasNormals());
+  for (size_t vi = 0; vi < voxels.size(); vi++) {
+    ASSERT_NEAR(voxels[vi].z, voxels.scalarField("height")[vi], 1e-5f);
+    ASSERT_GT(glm::dot(voxels.normals()[vi], cloud.normals()[sources[offsets[vi]]]), .9f);
+  }
+  PointCloud samples = cloud.poissonDiskSample(.2f, sources);
+  for (size_t i = 0; i < samples.size(); i++) {
+    ASSERT_EQ(cloud.normals()[sources[i]], samples.normals()[i]);
+    ASSERT_EQ(samples[i].z, samples.scalarField("height")[i]);
+  }
+}
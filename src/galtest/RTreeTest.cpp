@@ -0,0 +1,130 @@
+#include <galcore/RTree.h>
+#include <gtest/gtest.h>
+#include <numeric>
+
+using namespace gal;
+
+TEST(RTree, NearestNBatch)
+{
+  static constexpr size_t nPts = 2000, nQueries = 100, k = 8;
+  Box3                    box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3>  points, queries;
+  box.randomPoints(nPts, std::back_inserter(points));
+  box.randomPoints(nQueries, std::back_inserter(queries));
+  RTree3d tree;
+  tree.build(nPts, [&points](size_t i) { return Box3(points[i]); });
+
+  std::vector<size_t> indices(nQueries * k);
+  std::vector<float>  dists(nQueries * k);
+  tree.queryNearestNBatch(queries.data(), nQueries, k, indices.data(), dists.data());
+  std::vector<size_t> order(nPts);
+  for (size_t qi = 0; qi < nQueries; qi++) {
+    const glm::vec3& q = queries[qi];
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::partial_sort(
+      order.begin(), order.begin() + k, order.end(), [&](size_t a, size_t b) {
+        return glm::distance(points[a], q) < glm::distance(points[b], q);
+      });
+    for (size_t j = 0; j < k; j++) {
+      float dist = dists[qi * k + j];
+      ASSERT_NEAR(glm::distance(points[order[j]], q), dist, 1e-5f);
+      ASSERT_NEAR(glm::distance(points[indices[qi * k + j]], q), dist, 1e-5f);
+    }
+  }
+
+  // Asking for more items than there are in the tree.
+  RTree2d tree2;
+  tree2.insert(Box2(glm::vec2 {1.f, 0.f}), 0);
+  tree2.insert(Box2(glm::vec2 {0.f, 2.f}), 1);
+  glm::vec2 origin(0.f, 0.f);
+  size_t    idx[3];
+  float     dist[3];
+  tree2.queryNearestNBatch(&origin, 1, 3, idx, dist);
+  ASSERT_EQ(0, idx[0]);
+  ASSERT_EQ(1, idx[1]);
+  ASSERT_EQ(SIZE_MAX, idx[2]);
+  ASSERT_FLOAT_EQ(2.f, dist[1]);
+  ASSERT_EQ(FLT_MAX, dist[2]);
+}
+
+TEST(RTree, BoxQueries)
+{
+  static constexpr size_t nItems = 3000, nQueries = 200;
+  Box3                    box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3>  centers, queryCenters;
+  box.randomPoints(nItems, std::back_inserter(centers));
+  box.randomPoints(nQueries, std::back_inserter(queryCenters));
+  std::vector<Box3> items(nItems), queries(nQueries);
+  for (size_t i = 0; i < nItems; i++) {
+    items[i] = Box3(centers[i] - glm::vec3(.02f), centers[i] + glm::vec3(.02f));
+  }
+  for (size_t i = 0; i < nQueries; i++) {
+    queries[i] = Box3(queryCenters[i] - glm::vec3(.1f), queryCenters[i] + glm::vec3(.1f));
+  }
+  // One tree packed at once, the other grown by inserting one item at a time.
+  RTree3d packed, inserted;
+  packed.build(nItems, [&items](size_t i) { return items[i]; });
+  for (size_t i = 0; i < nItems; i++) {
+    inserted.insert(items[i], i);
+  }
+  ASSERT_EQ(nItems, packed.size());
+  ASSERT_EQ(nItems, inserted.size());
+
+  std::vector<size_t> offsets, indices;
+  packed.queryBoxIntersectsBatch(queries.data(), nQueries, offsets, indices);
+  ASSERT_EQ(nQueries + 1, offsets.size());
+  for (size_t qi = 0; qi < nQueries; qi++) {
+    std::vector<size_t> expected, fromPacked, fromInserted;
+    for (size_t i = 0; i < nItems; i++) {
+      if (items[i].sqDistance(queries[qi]) == 0.f) {
+        expected.push_back(i);
+      }
+    }
+    packed.queryBoxIntersects(queries[qi], std::back_inserter(fromPacked));
+    inserted.queryBoxIntersects(queries[qi], std::back_inserter(fromInserted));
+    std::vector<size_t> fromBatch(indices.begin() + offsets[qi],
+                                  indices.begin() + offsets[qi + 1]);
+    std::sort(fromPacked.begin(), fromPacked.end());
+    std::sort(fromInserted.begin(), fromInserted.end());
+    std::sort(fromBatch.begin(), fromBatch.end());
+    ASSERT_EQ(expected, fromPacked);
+    ASSERT_EQ(expected, fromInserted);
+    ASSERT_EQ(expected, fromBatch);
+  }
+}
+
+TEST(RTree, Refit)
+{
+  static constexpr size_t nItems = 5000;
+  Box3                    box(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {1.f, 1.f, 1.f});
+  std::vector<glm::vec3>  points;
+  box.randomPoints(nItems, std::back_inserter(points));
+  RTree3d tree;
+  tree.build(nItems, [&points](size_t i) { return Box3(points[i]); });
+  const auto check = [&](const Box3& query) {
+    std::vector<size_t> expected, hits;
+    for (size_t i = 0; i < nItems; i++) {
+      if (query.contains(points[i])) {
+        expected.push_back(i);
+      }
+    }
+    tree.queryBoxIntersects(query, std::back_inserter(hits));
+    std::sort(hits.begin(), hits.end());
+    ASSERT_EQ(expected, hits);
+  };
+  // Scatter a few items, then many items, so that treelets degrade and get rebuilt.
+  std::vector<size_t> moved;
+  for (size_t step = 0; step < 4; step++) {
+    moved.clear();
+    size_t stride = step < 2 ? 97 : 3;
+    for (size_t i = step; i < nItems; i += stride) {
+      points[i] = glm::vec3(points[i].y, points[i].z, -points[i].x) * 0.9f;
+      moved.push_back(i);
+    }
+    tree.refit(
+      moved.data(), moved.size(), [&points](size_t i) { return Box3(points[i]); });
+    ASSERT_EQ(nItems, tree.size());
+    check(Box3(glm::vec3 {-.3f, -.2f, -.5f}, glm::vec3 {.4f, .3f, .1f}));
+    check(Box3(glm::vec3 {-1.f, -1.f, -1.f}, glm::vec3 {0.f, 0.f, 0.f}));
+  }
+}
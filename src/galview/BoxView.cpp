@@ -16,5 +16,37 @@ void BoxView::draw() const
   GL_CALL(glDrawElements(GL_LINES, mISize, GL_UNSIGNED_INT, nullptr));
 }
 
+std::shared_ptr<Drawable> BoxView::createLines(const glm::vec3*             points,
+                                               size_t                       nPoints,
+                                               const uint32_t*              indices,
+                                               size_t                       nIndices,
+                                               std::vector<RenderSettings>& settings)
+{
+  glutil::VertexBuffer vBuf(nPoints);
+  std::transform(
+    points,
+    points + nPoints,
+    vBuf.begin(),
+    [](const glm::vec3& pt) -> glutil::VertexBuffer::VertexType { return {pt}; });
+  glutil::IndexBuffer iBuf(nIndices);
+  std::copy(indices, indices + nIndices, iBuf.begin());
+
+  auto view = std::make_shared<BoxView>();
+  view->setBounds(Box3(points, nPoints));
+  view->mVSize = (uint32_t)vBuf.size();
+  view->mISize = (uint32_t)iBuf.size();
+  vBuf.finalize(view->mVAO, view->mVBO);
+  iBuf.finalize(view->mIBO);
+
+  // Render settings.
+  static constexpr glm::vec4 sLineColor = {1.0, 1.0, 1.0, 1.0};
+  RenderSettings             lineSettings;
+  lineSettings.faceColor     = sLineColor;
+  lineSettings.edgeColor     = sLineColor;
+  lineSettings.shadingFactor = 0.0f;
+  settings.push_back(lineSettings);
+  return view;
+}
+
 }  // namespace view
 }  // namespace gal
\ No newline at end of file
@@ -158,10 +158,14 @@ void Context::set2dMode(bool flag)
 };
 
 Context::Context()
-    : mShaders(2)
+    : mShaders(3)
 {
   mShaders[0].loadFromName("default");
   mShaders[1].loadFromName("text");
+  // Instanced boxes share the fragment shader with the default shader.
+  mShaders[2].loadFromFiles(utils::absPath("voxel_v.glsl"),
+                            utils::absPath("default_f.glsl"));
+  mShaders[2].mName = "voxel";
 
   useCamera(glm::vec3(1.0f, 1.0f, 1.0f),
             glm::vec3(0.0f, 0.0f, 0.0f),
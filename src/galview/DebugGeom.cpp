@@ -161,8 +161,15 @@ struct WatchManager
   }
 };
 
-using manager =
-  WatchManager<glm::vec2, Circle2d, Box3, Mesh, Sphere, PointCloud, Annotations>;
+using manager = WatchManager<glm::vec2,
+                             Circle2d,
+                             Box3,
+                             OrientedBox3,
+                             Mesh,
+                             Sphere,
+                             PointCloud,
+                             Annotations,
+                             VoxelGrid>;
 
 class DebugFrame : public gal::view::Text
 {
@@ -63,11 +63,15 @@ struct DrawableManager
   };
 };
 using dmanager = DrawableManager<gal::Box3,
+                                 gal::OrientedBox3,
                                  gal::PointCloud,
                                  gal::Sphere,
                                  gal::Circle2d,
                                  gal::Mesh,
-                                 gal::Plane>;
+                                 gal::Plane,
+                                 gal::VoxelGrid,
+                                 gal::Voronoi2,
+                                 gal::Voronoi3>;
 
 ShowFunc::ShowFunc(const std::string& label, uint64_t regId)
     : mShowables(1, std::make_pair(regId, 0))
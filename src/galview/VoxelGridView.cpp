@@ -0,0 +1,40 @@
+#include <galview/VoxelGridView.h>
+
+namespace gal {
+namespace view {
+
+VoxelGridView::~VoxelGridView()
+{
+  GL_CALL(glDeleteVertexArrays(1, &mVAO));
+  GL_CALL(glDeleteBuffers(1, &mVBO));
+  GL_CALL(glDeleteBuffers(1, &mIBO));
+  GL_CALL(glDeleteBuffers(1, &mInstBO));
+}
+
+void VoxelGridView::initInstances(const std::vector<glm::vec3>& offsets)
+{
+  mNInstances = (uint32_t)offsets.size();
+  GL_CALL(glBindVertexArray(mVAO));
+  GL_CALL(glGenBuffers(1, &mInstBO));
+  GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mInstBO));
+  GL_CALL(glBufferData(GL_ARRAY_BUFFER,
+                       sizeof(glm::vec3) * offsets.size(),
+                       offsets.data(),
+                       GL_STATIC_DRAW));
+  GL_CALL(glEnableVertexAttribArray(2));
+  GL_CALL(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr));
+  GL_CALL(glVertexAttribDivisor(2, 1));
+  GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  GL_CALL(glBindVertexArray(0));
+}
+
+void VoxelGridView::draw() const
+{
+  GL_CALL(glBindVertexArray(mVAO));
+  GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO));
+  GL_CALL(glDrawElementsInstanced(
+    GL_TRIANGLES, mISize, GL_UNSIGNED_INT, nullptr, GLsizei(mNInstances)));
+}
+
+}  // namespace view
+}  // namespace gal